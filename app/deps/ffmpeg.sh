@@ -51,7 +51,6 @@ else
         --extra-cflags="-O2 -fPIC"
         --disable-programs
         --disable-doc
-        --disable-swscale
         --disable-postproc
         --disable-avfilter
         --disable-network
@@ -81,17 +80,20 @@ else
         --enable-muxer=wav
     )
 
+    # libavdevice is not used (the V4L2 device is accessed directly)
+    conf+=(
+        --disable-avdevice
+    )
+
     if [[ "$HOST" == linux ]]
     then
+        # libswscale is only used for V4L2 on Linux
         conf+=(
-            --enable-libv4l2
-            --enable-outdev=v4l2
-            --enable-encoder=rawvideo
+            --enable-swscale
         )
     else
-        # libavdevice is only used for V4L2 on Linux
         conf+=(
-            --disable-avdevice
+            --disable-swscale
         )
     fi
 
@@ -0,0 +1,77 @@
+#include "adaptive_audio_buffer.h"
+
+#include <assert.h>
+
+// Two glitches within this duration (in seconds) form a cluster
+#define SC_ADAPTIVE_AUDIO_BUFFER_CLUSTER_WINDOW 10
+// Do not raise again before the compensation catches up (in seconds)
+#define SC_ADAPTIVE_AUDIO_BUFFER_RAISE_HOLD 2
+// Duration without any glitch before lowering the target (in seconds)
+#define SC_ADAPTIVE_AUDIO_BUFFER_STABLE_DELAY 30
+// Raise the target by 1/4, and lower it by 1/256 per second when stable
+#define SC_ADAPTIVE_AUDIO_BUFFER_RAISE_RANGE 4
+#define SC_ADAPTIVE_AUDIO_BUFFER_LOWER_RANGE 256
+
+void
+sc_adaptive_audio_buffer_init(struct sc_adaptive_audio_buffer *aab,
+                              uint32_t initial, uint32_t min, uint32_t max,
+                              uint32_t sample_rate) {
+    assert(min <= max);
+    aab->min = min;
+    aab->max = max;
+    aab->target = CLAMP(initial, min, max);
+    aab->step = sample_rate / 100; // 10 ms
+    aab->seconds = 0;
+    aab->has_glitch = false;
+    aab->last_raise = 0;
+    aab->stable = 0;
+}
+
+void
+sc_adaptive_audio_buffer_set_min(struct sc_adaptive_audio_buffer *aab,
+                                 uint32_t min) {
+    aab->min = MIN(min, aab->max);
+    if (aab->target < aab->min) {
+        aab->target = aab->min;
+    }
+}
+
+static void
+sc_adaptive_audio_buffer_raise(struct sc_adaptive_audio_buffer *aab) {
+    uint32_t inc = MAX(aab->target / SC_ADAPTIVE_AUDIO_BUFFER_RAISE_RANGE,
+                       aab->step);
+    aab->target = MIN(aab->target + inc, aab->max);
+    aab->last_raise = aab->seconds;
+}
+
+uint32_t
+sc_adaptive_audio_buffer_update(struct sc_adaptive_audio_buffer *aab,
+                                unsigned glitches) {
+    ++aab->seconds;
+
+    if (glitches) {
+        aab->stable = 0;
+
+        bool cluster = glitches > 1
+            || (aab->has_glitch && aab->seconds - aab->last_glitch
+                                    <= SC_ADAPTIVE_AUDIO_BUFFER_CLUSTER_WINDOW);
+        bool hold = aab->last_raise && aab->seconds - aab->last_raise
+                                        <= SC_ADAPTIVE_AUDIO_BUFFER_RAISE_HOLD;
+        if (cluster && !hold) {
+            sc_adaptive_audio_buffer_raise(aab);
+        }
+
+        aab->last_glitch = aab->seconds;
+        aab->has_glitch = true;
+    } else if (++aab->stable > SC_ADAPTIVE_AUDIO_BUFFER_STABLE_DELAY) {
+        uint32_t dec = aab->target / SC_ADAPTIVE_AUDIO_BUFFER_LOWER_RANGE;
+        if (!dec) {
+            dec = 1;
+        }
+        aab->target = aab->target > aab->min + dec ? aab->target - dec
+                                                   : aab->min;
+    }
+
+    assert(aab->target >= aab->min && aab->target <= aab->max);
+    return aab->target;
+}
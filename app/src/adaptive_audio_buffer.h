@@ -0,0 +1,67 @@
+#ifndef SC_ADAPTIVE_AUDIO_BUFFER_H
+#define SC_ADAPTIVE_AUDIO_BUFFER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Adaptive audio target buffering, driven by the observed underflows.
+ *
+ * Once per second (of audio), the caller provides the number of glitches
+ * (buffer underflow events) since the previous update.
+ *
+ * Clustered glitches (several glitches within a few seconds) raise the target
+ * immediately, while an isolated glitch is ignored. After a long period
+ * without any glitch, the target is slowly lowered to reduce latency.
+ *
+ * All values are expressed in samples.
+ */
+struct sc_adaptive_audio_buffer {
+    uint32_t min;
+    uint32_t max;
+    uint32_t target;
+    // minimal increment on raise
+    uint32_t step;
+
+    // number of updates (i.e. seconds) since the beginning
+    unsigned seconds;
+    // date (in seconds) of the last glitch, valid only if has_glitch
+    unsigned last_glitch;
+    bool has_glitch;
+    // date (in seconds) of the last raise
+    unsigned last_raise;
+    // number of consecutive updates without glitch
+    unsigned stable;
+};
+
+/**
+ * Initialize an adaptive audio buffer
+ *
+ * \param initial the initial target (clamped to [min, max])
+ * \param min the lower bound of the target
+ * \param max the upper bound of the target
+ * \param sample_rate the sample rate
+ */
+void
+sc_adaptive_audio_buffer_init(struct sc_adaptive_audio_buffer *aab,
+                              uint32_t initial, uint32_t min, uint32_t max,
+                              uint32_t sample_rate);
+
+/**
+ * Raise the lower bound of the target (e.g. when larger packets are received)
+ */
+void
+sc_adaptive_audio_buffer_set_min(struct sc_adaptive_audio_buffer *aab,
+                                 uint32_t min);
+
+/**
+ * Register the number of glitches during the last second, and return the
+ * updated target
+ */
+uint32_t
+sc_adaptive_audio_buffer_update(struct sc_adaptive_audio_buffer *aab,
+                                unsigned glitches);
+
+#endif
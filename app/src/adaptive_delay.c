@@ -0,0 +1,87 @@
+#include "adaptive_delay.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define SC_ADAPTIVE_DELAY_PERCENTILE 95
+
+// Smoothing factors (as divisors) toward the target delay
+#define SC_ADAPTIVE_DELAY_INCREASE_RANGE 8
+#define SC_ADAPTIVE_DELAY_DECREASE_RANGE 256
+
+void
+sc_adaptive_delay_init(struct sc_adaptive_delay *ad, sc_tick max) {
+    assert(max >= 0);
+    ad->max = max;
+    ad->delay = 0;
+    ad->count = 0;
+    ad->head = 0;
+}
+
+// Return the index of the first sorted sample greater than or equal to value
+static unsigned
+sc_adaptive_delay_lower_bound(struct sc_adaptive_delay *ad, sc_tick value) {
+    unsigned lo = 0;
+    unsigned hi = ad->count;
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        if (ad->sorted[mid] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void
+sc_adaptive_delay_remove_sorted(struct sc_adaptive_delay *ad, sc_tick value) {
+    unsigned index = sc_adaptive_delay_lower_bound(ad, value);
+    assert(index < ad->count && ad->sorted[index] == value);
+    memmove(&ad->sorted[index], &ad->sorted[index + 1],
+            (ad->count - index - 1) * sizeof(*ad->sorted));
+    --ad->count;
+}
+
+static void
+sc_adaptive_delay_insert_sorted(struct sc_adaptive_delay *ad, sc_tick value) {
+    assert(ad->count < SC_ADAPTIVE_DELAY_WINDOW);
+    unsigned index = sc_adaptive_delay_lower_bound(ad, value);
+    memmove(&ad->sorted[index + 1], &ad->sorted[index],
+            (ad->count - index) * sizeof(*ad->sorted));
+    ad->sorted[index] = value;
+    ++ad->count;
+}
+
+static sc_tick
+sc_adaptive_delay_get_target(struct sc_adaptive_delay *ad) {
+    assert(ad->count);
+
+    unsigned index = (ad->count - 1) * SC_ADAPTIVE_DELAY_PERCENTILE / 100;
+    sc_tick target = ad->sorted[index];
+    return CLAMP(target, 0, ad->max);
+}
+
+sc_tick
+sc_adaptive_delay_push(struct sc_adaptive_delay *ad, sc_tick lateness) {
+    if (ad->count == SC_ADAPTIVE_DELAY_WINDOW) {
+        // Evict the oldest sample (which is about to be overwritten)
+        sc_adaptive_delay_remove_sorted(ad, ad->samples[ad->head]);
+    }
+    ad->samples[ad->head] = lateness;
+    ad->head = (ad->head + 1) % SC_ADAPTIVE_DELAY_WINDOW;
+    sc_adaptive_delay_insert_sorted(ad, lateness);
+
+    sc_tick target = sc_adaptive_delay_get_target(ad);
+    sc_tick diff = target - ad->delay;
+    if (diff > 0) {
+        // Round up so that the delay eventually reaches the target
+        ad->delay += (diff + SC_ADAPTIVE_DELAY_INCREASE_RANGE - 1)
+                   / SC_ADAPTIVE_DELAY_INCREASE_RANGE;
+    } else {
+        ad->delay += diff / SC_ADAPTIVE_DELAY_DECREASE_RANGE;
+    }
+
+    assert(ad->delay >= 0 && ad->delay <= ad->max);
+    return ad->delay;
+}
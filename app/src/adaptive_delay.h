@@ -0,0 +1,53 @@
+#ifndef SC_ADAPTIVE_DELAY_H
+#define SC_ADAPTIVE_DELAY_H
+
+#include "common.h"
+
+#include "util/tick.h"
+
+#define SC_ADAPTIVE_DELAY_WINDOW 256
+
+/**
+ * Adaptive buffering delay, to compensate for the jitter of a stream.
+ *
+ * For each frame, the caller provides its lateness, i.e. the difference
+ * between its actual arrival date and its expected arrival date (estimated
+ * from its PTS by the clock). The lateness may be negative.
+ *
+ * The target delay is the SC_ADAPTIVE_DELAY_PERCENTILE-th percentile of the
+ * lateness over the last SC_ADAPTIVE_DELAY_WINDOW frames, so that most frames
+ * arrive before their deadline. The current delay converges quickly toward a
+ * greater target (to stop stuttering) and slowly toward a lower one (to
+ * reduce latency only when the network is stable).
+ *
+ * The window is also kept sorted (updated incrementally on each push), so
+ * that the percentile is read in constant time: the delay buffers call
+ * sc_adaptive_delay_push() with the shared scheduler lock held.
+ */
+struct sc_adaptive_delay {
+    sc_tick max;
+    sc_tick delay;
+
+    // ring buffer of the last lateness values
+    sc_tick samples[SC_ADAPTIVE_DELAY_WINDOW];
+    // the same values, in ascending order
+    sc_tick sorted[SC_ADAPTIVE_DELAY_WINDOW];
+    unsigned count;
+    unsigned head;
+};
+
+/**
+ * Initialize an adaptive delay
+ *
+ * \param max the upper bound of the delay
+ */
+void
+sc_adaptive_delay_init(struct sc_adaptive_delay *ad, sc_tick max);
+
+/**
+ * Register the lateness of a new frame, and return the updated delay
+ */
+sc_tick
+sc_adaptive_delay_push(struct sc_adaptive_delay *ad, sc_tick lateness);
+
+#endif
@@ -27,9 +27,10 @@
 #define SC_ADB_COMMAND(...) { sc_adb_get_executable(), __VA_ARGS__, NULL }
 
 static char *adb_executable;
+static unsigned adb_refs;
 
-bool
-sc_adb_init(void) {
+static bool
+sc_adb_init_executable(void) {
     adb_executable = sc_get_env("ADB");
     if (adb_executable) {
         LOGD("Using adb: %s", adb_executable);
@@ -58,9 +59,30 @@ sc_adb_init(void) {
     return true;
 }
 
+bool
+sc_adb_init(void) {
+    if (adb_refs) {
+        ++adb_refs;
+        return true;
+    }
+
+    if (!sc_adb_init_executable()) {
+        return false;
+    }
+
+    adb_refs = 1;
+    return true;
+}
+
 void
 sc_adb_destroy(void) {
+    assert(adb_refs);
+    if (--adb_refs) {
+        return;
+    }
+
     free(adb_executable);
+    adb_executable = NULL;
 }
 
 const char *
@@ -201,7 +223,7 @@ process_check_success_intr(struct sc_intr *intr, sc_pid pid, const char *name,
     return ret;
 }
 
-static sc_pid
+sc_pid
 sc_adb_execute_p(const char *const argv[], unsigned flags, sc_pipe *pout) {
     unsigned process_flags = 0;
     if (flags & SC_ADB_NO_STDOUT) {
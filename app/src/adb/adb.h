@@ -15,6 +15,8 @@
 
 #define SC_ADB_SILENT (SC_ADB_NO_STDOUT | SC_ADB_NO_STDERR | SC_ADB_NO_LOGERR)
 
+// Reference counted (several servers may be initialized at once), must be
+// called from the main thread
 bool
 sc_adb_init(void);
 
@@ -39,6 +41,12 @@ struct sc_adb_device_selector {
 sc_pid
 sc_adb_execute(const char *const argv[], unsigned flags);
 
+/**
+ * Execute an adb command, providing a pipe for its stdout if pout is not NULL
+ */
+sc_pid
+sc_adb_execute_p(const char *const argv[], unsigned flags, sc_pipe *pout);
+
 bool
 sc_adb_start_server(struct sc_intr *intr, unsigned flags);
 
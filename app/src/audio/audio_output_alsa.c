@@ -0,0 +1,299 @@
+#include "audio_output_alsa.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "util/log.h"
+#include "util/memory.h"
+
+/** Downcast audio_output to sc_audio_output_alsa */
+#define DOWNCAST(AO) \
+    container_of(AO, struct sc_audio_output_alsa, audio_output)
+
+// Number of periods in the device ring buffer
+#define SC_ALSA_PERIODS 2
+
+// Maximum time to wait for the device, to check regularly for stop
+#define SC_ALSA_WAIT_TIMEOUT_MS 100
+
+static bool
+sc_audio_output_alsa_recover(struct sc_audio_output_alsa *ao, int err) {
+    if (err == -EPIPE) {
+        LOGD("[Audio] ALSA underrun");
+    }
+
+    int r = snd_pcm_recover(ao->pcm, err, 1);
+    if (r < 0) {
+        LOGE("ALSA error: %s", snd_strerror(r));
+        return false;
+    }
+
+    return true;
+}
+
+static snd_pcm_sframes_t
+sc_audio_output_alsa_write_mmap(struct sc_audio_output_alsa *ao,
+                                snd_pcm_uframes_t frames) {
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset;
+    int r = snd_pcm_mmap_begin(ao->pcm, &areas, &offset, &frames);
+    if (r < 0) {
+        return r;
+    }
+
+    // Interleaved access: all the channels share the same area
+    uint8_t *ptr = (uint8_t *) areas[0].addr
+                 + (areas[0].first + offset * areas[0].step) / 8;
+    ao->pull(ptr, frames, ao->userdata);
+
+    return snd_pcm_mmap_commit(ao->pcm, offset, frames);
+}
+
+static snd_pcm_sframes_t
+sc_audio_output_alsa_write_rw(struct sc_audio_output_alsa *ao,
+                              snd_pcm_uframes_t frames) {
+    frames = MIN(frames, ao->period_size);
+    ao->pull(ao->buf, frames, ao->userdata);
+    return snd_pcm_writei(ao->pcm, ao->buf, frames);
+}
+
+static int
+run_audio_output_alsa(void *data) {
+    struct sc_audio_output_alsa *ao = data;
+
+    bool ok = sc_thread_set_priority(SC_THREAD_PRIORITY_TIME_CRITICAL);
+    if (!ok) {
+        ok = sc_thread_set_priority(SC_THREAD_PRIORITY_HIGH);
+        (void) ok; // We don't care if it worked, at least we tried
+    }
+
+    while (!atomic_load_explicit(&ao->stopped, memory_order_relaxed)) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(ao->pcm);
+        if (avail < 0) {
+            if (!sc_audio_output_alsa_recover(ao, avail)) {
+                break;
+            }
+            continue;
+        }
+
+        if ((snd_pcm_uframes_t) avail < ao->period_size) {
+            int r = snd_pcm_wait(ao->pcm, SC_ALSA_WAIT_TIMEOUT_MS);
+            if (r < 0 && !sc_audio_output_alsa_recover(ao, r)) {
+                break;
+            }
+            continue;
+        }
+
+        snd_pcm_sframes_t w = ao->mmap
+            ? sc_audio_output_alsa_write_mmap(ao, avail)
+            : sc_audio_output_alsa_write_rw(ao, avail);
+        if (w < 0) {
+            if (!sc_audio_output_alsa_recover(ao, w)) {
+                break;
+            }
+            continue;
+        }
+
+        snd_pcm_sframes_t delay;
+        if (!snd_pcm_delay(ao->pcm, &delay) && delay >= 0) {
+            sc_tick latency = (sc_tick) delay * SC_TICK_FREQ / ao->sample_rate;
+            atomic_store_explicit(&ao->latency, latency, memory_order_relaxed);
+        }
+    }
+
+    return 0;
+}
+
+static bool
+sc_audio_output_alsa_set_hw_params(struct sc_audio_output_alsa *ao,
+                            const struct sc_audio_output_params *params) {
+    snd_pcm_hw_params_t *hw;
+    snd_pcm_hw_params_alloca(&hw);
+
+    int r = snd_pcm_hw_params_any(ao->pcm, hw);
+    if (r < 0) {
+        goto error;
+    }
+
+    ao->mmap = !snd_pcm_hw_params_set_access(ao->pcm, hw,
+                                            SND_PCM_ACCESS_MMAP_INTERLEAVED);
+    if (!ao->mmap) {
+        r = snd_pcm_hw_params_set_access(ao->pcm, hw,
+                                         SND_PCM_ACCESS_RW_INTERLEAVED);
+        if (r < 0) {
+            goto error;
+        }
+    }
+
+    r = snd_pcm_hw_params_set_format(ao->pcm, hw, SND_PCM_FORMAT_FLOAT);
+    if (r < 0) {
+        goto error;
+    }
+
+    r = snd_pcm_hw_params_set_channels(ao->pcm, hw, params->channels);
+    if (r < 0) {
+        goto error;
+    }
+
+    r = snd_pcm_hw_params_set_rate_resample(ao->pcm, hw, 1);
+    if (r < 0) {
+        goto error;
+    }
+
+    r = snd_pcm_hw_params_set_rate(ao->pcm, hw, params->sample_rate, 0);
+    if (r < 0) {
+        goto error;
+    }
+
+    snd_pcm_uframes_t period = params->buffer_duration * params->sample_rate
+                                                       / SC_TICK_FREQ;
+    if (!period) {
+        period = 1;
+    }
+    r = snd_pcm_hw_params_set_period_size_near(ao->pcm, hw, &period, NULL);
+    if (r < 0) {
+        goto error;
+    }
+
+    snd_pcm_uframes_t buffer = period * SC_ALSA_PERIODS;
+    r = snd_pcm_hw_params_set_buffer_size_near(ao->pcm, hw, &buffer);
+    if (r < 0) {
+        goto error;
+    }
+
+    r = snd_pcm_hw_params(ao->pcm, hw);
+    if (r < 0) {
+        goto error;
+    }
+
+    // Read the values actually negotiated
+    snd_pcm_hw_params_get_period_size(hw, &ao->period_size, NULL);
+    snd_pcm_hw_params_get_buffer_size(hw, &ao->buffer_size);
+
+    return true;
+
+error:
+    LOGE("Could not configure ALSA device: %s", snd_strerror(r));
+    return false;
+}
+
+static bool
+sc_audio_output_alsa_set_sw_params(struct sc_audio_output_alsa *ao) {
+    snd_pcm_sw_params_t *sw;
+    snd_pcm_sw_params_alloca(&sw);
+
+    int r = snd_pcm_sw_params_current(ao->pcm, sw);
+    if (r < 0) {
+        goto error;
+    }
+
+    // Start as soon as one period is available, to minimize latency
+    r = snd_pcm_sw_params_set_start_threshold(ao->pcm, sw, ao->period_size);
+    if (r < 0) {
+        goto error;
+    }
+
+    r = snd_pcm_sw_params_set_avail_min(ao->pcm, sw, ao->period_size);
+    if (r < 0) {
+        goto error;
+    }
+
+    r = snd_pcm_sw_params(ao->pcm, sw);
+    if (r < 0) {
+        goto error;
+    }
+
+    return true;
+
+error:
+    LOGE("Could not configure ALSA device: %s", snd_strerror(r));
+    return false;
+}
+
+static bool
+sc_audio_output_alsa_open(struct sc_audio_output *ao_,
+                          const struct sc_audio_output_params *params) {
+    struct sc_audio_output_alsa *ao = DOWNCAST(ao_);
+
+    ao->sample_rate = params->sample_rate;
+    ao->sample_size = params->channels * sizeof(float);
+    ao->pull = params->pull;
+    ao->userdata = params->userdata;
+    ao->buf = NULL;
+    atomic_init(&ao->stopped, false);
+    atomic_init(&ao->latency, -1);
+
+    int r = snd_pcm_open(&ao->pcm, ao->device_name, SND_PCM_STREAM_PLAYBACK,
+                         0);
+    if (r < 0) {
+        LOGE("Could not open ALSA device %s: %s", ao->device_name,
+             snd_strerror(r));
+        return false;
+    }
+
+    if (!sc_audio_output_alsa_set_hw_params(ao, params)
+            || !sc_audio_output_alsa_set_sw_params(ao)) {
+        goto error_close_pcm;
+    }
+
+    if (!ao->mmap) {
+        ao->buf = sc_allocarray(ao->period_size, ao->sample_size);
+        if (!ao->buf) {
+            LOG_OOM();
+            goto error_close_pcm;
+        }
+    }
+
+    LOGI("ALSA audio output: period=%lu buffer=%lu samples (%s)",
+         (unsigned long) ao->period_size, (unsigned long) ao->buffer_size,
+         ao->mmap ? "mmap" : "rw");
+
+    bool ok = sc_thread_create(&ao->thread, run_audio_output_alsa,
+                               "scrcpy-aout", ao);
+    if (!ok) {
+        LOGE("Could not start audio output thread");
+        goto error_free_buf;
+    }
+
+    return true;
+
+error_free_buf:
+    free(ao->buf);
+error_close_pcm:
+    snd_pcm_close(ao->pcm);
+
+    return false;
+}
+
+static void
+sc_audio_output_alsa_close(struct sc_audio_output *ao_) {
+    struct sc_audio_output_alsa *ao = DOWNCAST(ao_);
+
+    // The output thread waits for at most SC_ALSA_WAIT_TIMEOUT_MS
+    atomic_store_explicit(&ao->stopped, true, memory_order_relaxed);
+    sc_thread_join(&ao->thread, NULL);
+
+    snd_pcm_drop(ao->pcm);
+    snd_pcm_close(ao->pcm);
+    free(ao->buf);
+}
+
+static sc_tick
+sc_audio_output_alsa_get_latency(struct sc_audio_output *ao_) {
+    struct sc_audio_output_alsa *ao = DOWNCAST(ao_);
+    return atomic_load_explicit(&ao->latency, memory_order_relaxed);
+}
+
+void
+sc_audio_output_alsa_init(struct sc_audio_output_alsa *ao,
+                          const char *device_name) {
+    ao->device_name = device_name;
+
+    static const struct sc_audio_output_ops ops = {
+        .open = sc_audio_output_alsa_open,
+        .close = sc_audio_output_alsa_close,
+        .get_latency = sc_audio_output_alsa_get_latency,
+    };
+
+    ao->audio_output.ops = &ops;
+}
@@ -0,0 +1,54 @@
+#ifndef SC_AUDIO_OUTPUT_ALSA_H
+#define SC_AUDIO_OUTPUT_ALSA_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <alsa/asoundlib.h>
+
+#include "trait/audio_output.h"
+#include "util/thread.h"
+
+/**
+ * Native ALSA audio output
+ *
+ * Contrary to SDL, it does not add any intermediate buffering: the samples
+ * are pulled directly into the device ring buffer (using mmap if supported),
+ * from a dedicated real-time thread.
+ */
+struct sc_audio_output_alsa {
+    struct sc_audio_output audio_output; // audio output trait
+
+    const char *device_name;
+    snd_pcm_t *pcm;
+    bool mmap;
+
+    sc_thread thread;
+    atomic_bool stopped;
+
+    uint32_t sample_rate;
+    size_t sample_size;
+    snd_pcm_uframes_t period_size;
+    snd_pcm_uframes_t buffer_size;
+    // Intermediate buffer, only used if mmap is not supported
+    uint8_t *buf;
+
+    // Measured after each write by the output thread
+    atomic_int_least64_t latency;
+
+    sc_audio_output_pull_fn pull;
+    void *userdata;
+};
+
+/**
+ * Initialize an ALSA audio output
+ *
+ * \param device_name the ALSA PCM name (the string is not copied, it must
+ *                    outlive the audio output)
+ */
+void
+sc_audio_output_alsa_init(struct sc_audio_output_alsa *ao,
+                          const char *device_name);
+
+#endif
@@ -0,0 +1,153 @@
+#include "audio_output_null.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "util/log.h"
+#include "util/memory.h"
+
+/** Downcast audio_output to sc_audio_output_null */
+#define DOWNCAST(AO) \
+    container_of(AO, struct sc_audio_output_null, audio_output)
+
+static int
+run_audio_output_null(void *data) {
+    struct sc_audio_output_null *ao = data;
+
+    sc_tick deadline = sc_tick_now();
+
+    for (;;) {
+        sc_mutex_lock(&ao->mutex);
+        bool timed_out = false;
+        while (!ao->stopped && !timed_out) {
+            timed_out = !sc_cond_timedwait(&ao->cond, &ao->mutex, deadline);
+        }
+        bool stopped = ao->stopped;
+        sc_mutex_unlock(&ao->mutex);
+
+        if (stopped) {
+            break;
+        }
+
+        ao->pull(ao->buf, ao->period, ao->userdata);
+
+        if (ao->file) {
+            size_t w = fwrite(ao->buf, ao->sample_size, ao->period, ao->file);
+            if (w != ao->period) {
+                LOGE("Could not write audio samples to %s", ao->filename);
+                // Keep consuming samples in real-time anyway
+                fclose(ao->file);
+                ao->file = NULL;
+            }
+        }
+
+        deadline += ao->period_duration;
+    }
+
+    return 0;
+}
+
+static bool
+sc_audio_output_null_open(struct sc_audio_output *ao_,
+                          const struct sc_audio_output_params *params) {
+    struct sc_audio_output_null *ao = DOWNCAST(ao_);
+
+    ao->period = params->buffer_duration * params->sample_rate / SC_TICK_FREQ;
+    if (!ao->period) {
+        ao->period = 1;
+    }
+    ao->period_duration = (sc_tick) ao->period * SC_TICK_FREQ
+                        / params->sample_rate;
+    ao->sample_size = params->channels * sizeof(float);
+    ao->pull = params->pull;
+    ao->userdata = params->userdata;
+    ao->stopped = false;
+
+    ao->buf = sc_allocarray(ao->period, ao->sample_size);
+    if (!ao->buf) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (ao->filename) {
+        ao->file = fopen(ao->filename, "wb");
+        if (!ao->file) {
+            LOGE("Could not open audio output file: %s", ao->filename);
+            goto error_free_buf;
+        }
+    } else {
+        ao->file = NULL;
+    }
+
+    bool ok = sc_mutex_init(&ao->mutex);
+    if (!ok) {
+        goto error_close_file;
+    }
+
+    ok = sc_cond_init(&ao->cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ok = sc_thread_create(&ao->thread, run_audio_output_null, "scrcpy-aout",
+                          ao);
+    if (!ok) {
+        LOGE("Could not start audio output thread");
+        goto error_destroy_cond;
+    }
+
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&ao->cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&ao->mutex);
+error_close_file:
+    if (ao->file) {
+        fclose(ao->file);
+    }
+error_free_buf:
+    free(ao->buf);
+
+    return false;
+}
+
+static void
+sc_audio_output_null_close(struct sc_audio_output *ao_) {
+    struct sc_audio_output_null *ao = DOWNCAST(ao_);
+
+    sc_mutex_lock(&ao->mutex);
+    ao->stopped = true;
+    sc_cond_signal(&ao->cond);
+    sc_mutex_unlock(&ao->mutex);
+
+    sc_thread_join(&ao->thread, NULL);
+
+    if (ao->file) {
+        fclose(ao->file);
+    }
+    sc_cond_destroy(&ao->cond);
+    sc_mutex_destroy(&ao->mutex);
+    free(ao->buf);
+}
+
+static sc_tick
+sc_audio_output_null_get_latency(struct sc_audio_output *ao_) {
+    (void) ao_;
+    // The samples are "played" as soon as they are pulled
+    return 0;
+}
+
+void
+sc_audio_output_null_init(struct sc_audio_output_null *ao,
+                          const char *filename) {
+    ao->filename = filename;
+
+    static const struct sc_audio_output_ops ops = {
+        .open = sc_audio_output_null_open,
+        .close = sc_audio_output_null_close,
+        .get_latency = sc_audio_output_null_get_latency,
+    };
+
+    ao->audio_output.ops = &ops;
+}
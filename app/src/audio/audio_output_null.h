@@ -0,0 +1,49 @@
+#ifndef SC_AUDIO_OUTPUT_NULL_H
+#define SC_AUDIO_OUTPUT_NULL_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "trait/audio_output.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Audio output consuming the samples in real-time without playing them
+ *
+ * If a filename is provided, the raw samples (interleaved 32-bit floats) are
+ * written to this file. This is mainly useful for testing.
+ */
+struct sc_audio_output_null {
+    struct sc_audio_output audio_output; // audio output trait
+
+    const char *filename; // may be NULL
+    FILE *file;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    uint32_t period; // in samples
+    sc_tick period_duration;
+    size_t sample_size;
+    uint8_t *buf;
+
+    sc_audio_output_pull_fn pull;
+    void *userdata;
+};
+
+/**
+ * Initialize a null audio output
+ *
+ * \param filename the file to write the samples to, or NULL (the string is not
+ *                 copied, it must outlive the audio output)
+ */
+void
+sc_audio_output_null_init(struct sc_audio_output_null *ao,
+                          const char *filename);
+
+#endif
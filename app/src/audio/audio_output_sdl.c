@@ -0,0 +1,89 @@
+#include "audio_output_sdl.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "util/log.h"
+
+/** Downcast audio_output to sc_audio_output_sdl */
+#define DOWNCAST(AO) container_of(AO, struct sc_audio_output_sdl, audio_output)
+
+#define SC_SDL_SAMPLE_FMT AUDIO_F32
+
+static void SDLCALL
+sc_audio_output_sdl_callback(void *userdata, uint8_t *stream, int len_int) {
+    struct sc_audio_output_sdl *ao = userdata;
+
+    assert(len_int > 0);
+    size_t len = len_int;
+
+    assert(len % ao->sample_size == 0);
+    uint32_t out_samples = len / ao->sample_size;
+
+    ao->pull(stream, out_samples, ao->userdata);
+}
+
+static bool
+sc_audio_output_sdl_open(struct sc_audio_output *ao_,
+                         const struct sc_audio_output_params *params) {
+    struct sc_audio_output_sdl *ao = DOWNCAST(ao_);
+
+    uint64_t aout_samples = params->buffer_duration * params->sample_rate
+                                                    / SC_TICK_FREQ;
+    assert(aout_samples <= 0xFFFF);
+
+    ao->sample_size = params->channels * sizeof(float);
+    ao->pull = params->pull;
+    ao->userdata = params->userdata;
+
+    SDL_AudioSpec desired = {
+        .freq = params->sample_rate,
+        .format = SC_SDL_SAMPLE_FMT,
+        .channels = params->channels,
+        .samples = aout_samples,
+        .callback = sc_audio_output_sdl_callback,
+        .userdata = ao,
+    };
+    SDL_AudioSpec obtained;
+
+    ao->device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
+    if (!ao->device) {
+        LOGE("Could not open audio device: %s", SDL_GetError());
+        return false;
+    }
+
+    // SDL may add its own buffering, this is only a lower bound
+    ao->latency = (sc_tick) obtained.samples * SC_TICK_FREQ
+                / params->sample_rate;
+    LOGD("[Audio] SDL audio output: %" PRIu16 " samples", obtained.samples);
+
+    SDL_PauseAudioDevice(ao->device, 0);
+
+    return true;
+}
+
+static void
+sc_audio_output_sdl_close(struct sc_audio_output *ao_) {
+    struct sc_audio_output_sdl *ao = DOWNCAST(ao_);
+
+    assert(ao->device);
+    SDL_PauseAudioDevice(ao->device, 1);
+    SDL_CloseAudioDevice(ao->device);
+}
+
+static sc_tick
+sc_audio_output_sdl_get_latency(struct sc_audio_output *ao_) {
+    struct sc_audio_output_sdl *ao = DOWNCAST(ao_);
+    return ao->latency;
+}
+
+void
+sc_audio_output_sdl_init(struct sc_audio_output_sdl *ao) {
+    static const struct sc_audio_output_ops ops = {
+        .open = sc_audio_output_sdl_open,
+        .close = sc_audio_output_sdl_close,
+        .get_latency = sc_audio_output_sdl_get_latency,
+    };
+
+    ao->audio_output.ops = &ops;
+}
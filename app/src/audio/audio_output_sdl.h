@@ -0,0 +1,25 @@
+#ifndef SC_AUDIO_OUTPUT_SDL_H
+#define SC_AUDIO_OUTPUT_SDL_H
+
+#include "common.h"
+
+#include <SDL2/SDL_audio.h>
+
+#include "trait/audio_output.h"
+
+struct sc_audio_output_sdl {
+    struct sc_audio_output audio_output; // audio output trait
+
+    SDL_AudioDeviceID device;
+    size_t sample_size;
+    // Output buffer duration obtained from SDL (a lower bound of the latency)
+    sc_tick latency;
+
+    sc_audio_output_pull_fn pull;
+    void *userdata;
+};
+
+void
+sc_audio_output_sdl_init(struct sc_audio_output_sdl *ao);
+
+#endif
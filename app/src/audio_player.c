@@ -1,23 +1,102 @@
 #include "audio_player.h"
 
+#include <assert.h>
+#include <inttypes.h>
+
 #include "util/log.h"
+#include "util/thread.h"
 
 /** Downcast frame_sink to sc_audio_player */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_audio_player, frame_sink)
+/** Downcast packet_sink to sc_audio_player */
+#define DOWNCAST_PACKET(SINK) \
+    container_of(SINK, struct sc_audio_player, packet_sink)
 
-#define SC_SDL_SAMPLE_FMT AUDIO_F32
+#define SC_AUDIO_PLAYER_REPORT_INTERVAL SC_TICK_FROM_SEC(10)
 
-static void SDLCALL
-sc_audio_player_sdl_callback(void *userdata, uint8_t *stream, int len_int) {
+static void
+sc_audio_player_pull(uint8_t *out, uint32_t samples, void *userdata) {
     struct sc_audio_player *ap = userdata;
 
-    assert(len_int > 0);
-    size_t len = len_int;
+    sc_tick start = sc_tick_now();
+    sc_audio_regulator_pull(&ap->audioreg, out, samples);
+    sc_histogram_record(&ap->callback_times, sc_tick_now() - start);
+}
+
+static void
+sc_audio_player_report(struct sc_audio_player *ap, bool final) {
+    // Cumulative since the audio output was opened
+    enum sc_log_level level = final ? SC_LOG_LEVEL_INFO : SC_LOG_LEVEL_DEBUG;
+
+    struct sc_histogram *h = &ap->callback_times;
+    uint32_t count = sc_histogram_count(h);
+    if (count) {
+        sc_tick p50 = sc_histogram_quantile(h, 500);
+        sc_tick p99 = sc_histogram_quantile(h, 990);
+        sc_tick p999 = sc_histogram_quantile(h, 999);
+        sc_tick max = sc_histogram_max(h);
+
+        LOG(level, "Audio callback: p50=%" PRItick "µs p99=%" PRItick
+            "µs p99.9=%" PRItick "µs max=%" PRItick "µs (%" PRIu32 " calls)",
+            p50, p99, p999, max, count);
+    }
+
+    struct sc_audio_regulator_stats stats;
+    sc_audio_regulator_get_stats(&ap->audioreg, &stats);
+    LOG(level, "Audio buffering: target=%.1fms avg=%.1fms glitches=%" PRIu32
+        " (silence=%.1fms) dropped=%.1fms",
+        stats.target_buffering / 1000.0, stats.avg_buffering / 1000.0,
+        stats.glitches, stats.silence / 1000.0, stats.skipped / 1000.0);
 
-    assert(len % ap->audioreg.sample_size == 0);
-    uint32_t out_samples = len / ap->audioreg.sample_size;
+    h = &ap->output_latencies;
+    if (sc_histogram_count(h)) {
+        sc_tick p50 = sc_histogram_quantile(h, 500);
+        sc_tick p99 = sc_histogram_quantile(h, 990);
+        sc_tick max = sc_histogram_max(h);
 
-    sc_audio_regulator_pull(&ap->audioreg, stream, out_samples);
+        LOG(level, "Audio output latency: p50=%.1fms p99=%.1fms max=%.1fms",
+            p50 / 1000.0, p99 / 1000.0, max / 1000.0);
+    }
+}
+
+static void
+sc_audio_player_update_stats(struct sc_audio_player *ap) {
+    const struct sc_audio_output_ops *ops = ap->output->ops;
+    if (ops->get_latency) {
+        sc_tick latency = ops->get_latency(ap->output);
+        if (latency >= 0) {
+            sc_histogram_record(&ap->output_latencies, latency);
+            ap->output_latency = latency;
+        }
+    }
+
+    sc_tick now = sc_tick_now();
+    if (now >= ap->next_report) {
+        sc_audio_player_report(ap, false);
+        ap->next_report = now + SC_AUDIO_PLAYER_REPORT_INTERVAL;
+    }
+}
+
+static void
+sc_audio_player_update_av_sync(struct sc_audio_player *ap) {
+    assert(ap->av_sync);
+
+    bool played = atomic_load_explicit(&ap->audioreg.played,
+                                       memory_order_relaxed);
+    if (!played) {
+        // Nothing is heard yet
+        return;
+    }
+
+    sc_tick pts = sc_audio_regulator_get_buffered_pts(&ap->audioreg);
+    if (pts < 0) {
+        return;
+    }
+
+    // The next sample pulled from the buffer will be heard after the output
+    // latency
+    sc_tick now = sc_tick_now();
+    sc_av_sync_push_audio(ap->av_sync, pts, now + ap->output_latency);
 }
 
 static bool
@@ -25,14 +104,49 @@ sc_audio_player_frame_sink_push(struct sc_frame_sink *sink,
                                 const AVFrame *frame) {
     struct sc_audio_player *ap = DOWNCAST(sink);
 
-    return sc_audio_regulator_push(&ap->audioreg, frame);
+    sc_audio_player_update_stats(ap);
+
+    bool ok = sc_audio_regulator_push(&ap->audioreg, frame);
+    if (ok && ap->av_sync) {
+        sc_audio_player_update_av_sync(ap);
+    }
+
+    return ok;
 }
 
 static bool
-sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
-                                const AVCodecContext *ctx) {
-    struct sc_audio_player *ap = DOWNCAST(sink);
+sc_audio_player_packet_sink_push(struct sc_packet_sink *sink,
+                                 const AVPacket *packet) {
+    struct sc_audio_player *ap = DOWNCAST_PACKET(sink);
+
+    bool is_config = packet->pts == AV_NOPTS_VALUE;
+    if (is_config) {
+        // nothing to do
+        return true;
+    }
+
+    // Raw packets contain interleaved signed 16-bit samples
+    size_t input_sample_size = ap->audioreg.sample_size / 2;
+    if (packet->size % input_sample_size) {
+        LOGE("Invalid raw audio packet size: %d", packet->size);
+        return false;
+    }
 
+    sc_audio_player_update_stats(ap);
+
+    const uint8_t *data[] = {packet->data};
+    uint32_t samples = packet->size / input_sample_size;
+    bool ok = sc_audio_regulator_push_samples(&ap->audioreg, data, samples,
+                                              packet->pts);
+    if (ok && ap->av_sync) {
+        sc_audio_player_update_av_sync(ap);
+    }
+
+    return ok;
+}
+
+static bool
+sc_audio_player_open(struct sc_audio_player *ap, const AVCodecContext *ctx) {
 #ifdef SCRCPY_LAVU_HAS_CHLAYOUT
     assert(ctx->ch_layout.nb_channels > 0 && ctx->ch_layout.nb_channels < 256);
     uint8_t nb_channels = ctx->ch_layout.nb_channels;
@@ -45,68 +159,106 @@ sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
     assert(ctx->sample_rate > 0);
     assert(!av_sample_fmt_is_planar(SC_AV_SAMPLE_FMT));
     int out_bytes_per_sample = av_get_bytes_per_sample(SC_AV_SAMPLE_FMT);
-    assert(out_bytes_per_sample > 0);
+    assert(out_bytes_per_sample == sizeof(float));
 
     uint32_t target_buffering_samples =
         ap->target_buffering_delay * ctx->sample_rate / SC_TICK_FREQ;
 
     size_t sample_size = nb_channels * out_bytes_per_sample;
     bool ok = sc_audio_regulator_init(&ap->audioreg, sample_size, ctx,
-                                      target_buffering_samples);
+                                      target_buffering_samples,
+                                      ap->adaptive_buffering);
     if (!ok) {
         return false;
     }
 
-    uint64_t aout_samples = ap->output_buffer_duration * ctx->sample_rate
-                                                       / SC_TICK_FREQ;
-    assert(aout_samples <= 0xFFFF);
+    sc_histogram_init(&ap->callback_times);
+    sc_histogram_init(&ap->output_latencies);
+    // Until the output reports its actual latency
+    ap->output_latency = ap->output_buffer_duration;
+    ap->next_report = sc_tick_now() + SC_AUDIO_PLAYER_REPORT_INTERVAL;
 
-    SDL_AudioSpec desired = {
-        .freq = ctx->sample_rate,
-        .format = SC_SDL_SAMPLE_FMT,
+    struct sc_audio_output_params params = {
+        .sample_rate = ctx->sample_rate,
         .channels = nb_channels,
-        .samples = aout_samples,
-        .callback = sc_audio_player_sdl_callback,
+        .buffer_duration = ap->output_buffer_duration,
+        .pull = sc_audio_player_pull,
         .userdata = ap,
     };
-    SDL_AudioSpec obtained;
 
-    ap->device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
-    if (!ap->device) {
-        LOGE("Could not open audio device: %s", SDL_GetError());
+    ok = ap->output->ops->open(ap->output, &params);
+    if (!ok) {
         sc_audio_regulator_destroy(&ap->audioreg);
         return false;
     }
 
     // The thread calling open() is the thread calling push(), which fills the
-    // audio buffer consumed by the SDL audio thread.
+    // audio buffer consumed by the audio output thread.
     ok = sc_thread_set_priority(SC_THREAD_PRIORITY_TIME_CRITICAL);
     if (!ok) {
         ok = sc_thread_set_priority(SC_THREAD_PRIORITY_HIGH);
         (void) ok; // We don't care if it worked, at least we tried
     }
 
-    SDL_PauseAudioDevice(ap->device, 0);
+    atomic_store_explicit(&ap->open, true, memory_order_release);
 
     return true;
 }
 
+static void
+sc_audio_player_close(struct sc_audio_player *ap) {
+    ap->output->ops->close(ap->output);
+
+    sc_audio_player_report(ap, true);
+
+    // The regulator statistics are atomics, they may still be read after
+    // sc_audio_regulator_destroy(), but they are not relevant anymore
+    atomic_store_explicit(&ap->open, false, memory_order_relaxed);
+
+    sc_audio_regulator_destroy(&ap->audioreg);
+}
+
+static bool
+sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
+                                const AVCodecContext *ctx) {
+    struct sc_audio_player *ap = DOWNCAST(sink);
+    return sc_audio_player_open(ap, ctx);
+}
+
 static void
 sc_audio_player_frame_sink_close(struct sc_frame_sink *sink) {
     struct sc_audio_player *ap = DOWNCAST(sink);
+    sc_audio_player_close(ap);
+}
 
-    assert(ap->device);
-    SDL_PauseAudioDevice(ap->device, 1);
-    SDL_CloseAudioDevice(ap->device);
+static bool
+sc_audio_player_packet_sink_open(struct sc_packet_sink *sink,
+                                 AVCodecContext *ctx) {
+    struct sc_audio_player *ap = DOWNCAST_PACKET(sink);
 
-    sc_audio_regulator_destroy(&ap->audioreg);
+    // Only raw packets may be played without decoding
+    assert(ctx->codec_id == AV_CODEC_ID_PCM_S16LE);
+    assert(ctx->sample_fmt == AV_SAMPLE_FMT_S16);
+    return sc_audio_player_open(ap, ctx);
+}
+
+static void
+sc_audio_player_packet_sink_close(struct sc_packet_sink *sink) {
+    struct sc_audio_player *ap = DOWNCAST_PACKET(sink);
+    sc_audio_player_close(ap);
 }
 
 void
-sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick output_buffer_duration) {
+sc_audio_player_init(struct sc_audio_player *ap, struct sc_audio_output *output,
+                     sc_tick target_buffering, bool adaptive_buffering,
+                     sc_tick output_buffer_duration,
+                     struct sc_av_sync *av_sync) {
+    ap->output = output;
+    ap->av_sync = av_sync;
     ap->target_buffering_delay = target_buffering;
+    ap->adaptive_buffering = adaptive_buffering;
     ap->output_buffer_duration = output_buffer_duration;
+    atomic_init(&ap->open, false);
 
     static const struct sc_frame_sink_ops ops = {
         .open = sc_audio_player_frame_sink_open,
@@ -115,4 +267,23 @@ sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
     };
 
     ap->frame_sink.ops = &ops;
+
+    static const struct sc_packet_sink_ops packet_ops = {
+        .open = sc_audio_player_packet_sink_open,
+        .close = sc_audio_player_packet_sink_close,
+        .push = sc_audio_player_packet_sink_push,
+    };
+
+    ap->packet_sink.ops = &packet_ops;
+}
+
+bool
+sc_audio_player_get_stats(struct sc_audio_player *ap,
+                          struct sc_audio_regulator_stats *stats) {
+    if (!atomic_load_explicit(&ap->open, memory_order_acquire)) {
+        return false;
+    }
+
+    sc_audio_regulator_get_stats(&ap->audioreg, stats);
+    return true;
 }
@@ -3,14 +3,21 @@
 
 #include "common.h"
 
-#include <SDL2/SDL_audio.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 
 #include "audio_regulator.h"
+#include "av_sync.h"
+#include "trait/audio_output.h"
 #include "trait/frame_sink.h"
+#include "trait/packet_sink.h"
+#include "util/histogram.h"
 #include "util/tick.h"
 
 struct sc_audio_player {
     struct sc_frame_sink frame_sink;
+    // Only for raw audio (signed 16-bit PCM), to bypass the decoder
+    struct sc_packet_sink packet_sink;
 
     // The target buffering between the producer and the consumer. This value
     // is directly use for compensation.
@@ -18,16 +25,45 @@ struct sc_audio_player {
     // blocks of 960 samples (20ms) or 1024 samples (~21.3ms), this target
     // value should be higher.
     sc_tick target_buffering_delay;
+    // If set, target_buffering_delay is the maximum, and the actual target is
+    // adapted to the observed underflows
+    bool adaptive_buffering;
 
-    // SDL audio output buffer size
+    // Audio output buffer size
     sc_tick output_buffer_duration;
 
-    SDL_AudioDeviceID device;
+    struct sc_audio_output *output;
     struct sc_audio_regulator audioreg;
+
+    // Execution time of the audio callback (written by the audio thread)
+    struct sc_histogram callback_times;
+    // Latency reported by the output (only used by the receiver thread)
+    struct sc_histogram output_latencies;
+    // Last latency reported by the output (only used by the receiver thread)
+    sc_tick output_latency;
+    // Next date to report the stats (only used by the receiver thread)
+    sc_tick next_report;
+
+    // A/V sync monitor to notify, may be NULL
+    struct sc_av_sync *av_sync;
+
+    // Set once the audio regulator is initialized, so that its statistics may
+    // be read from other threads
+    atomic_bool open;
 };
 
 void
-sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick audio_output_buffer);
+sc_audio_player_init(struct sc_audio_player *ap, struct sc_audio_output *output,
+                     sc_tick target_buffering, bool adaptive_buffering,
+                     sc_tick audio_output_buffer, struct sc_av_sync *av_sync);
+
+/**
+ * Get the audio buffering statistics (may be called from any thread)
+ *
+ * Return false if the audio player is not open yet.
+ */
+bool
+sc_audio_player_get_stats(struct sc_audio_player *ap,
+                          struct sc_audio_regulator_stats *stats);
 
 #endif
@@ -54,8 +54,17 @@
  * Therefore, the regulator doesn't drop any sample on underflow. The
  * compensation mechanism will absorb the delay introduced by the inserted
  * silence.
+ *
+ * With --audio-buffer=auto, the target buffering itself is adapted to the
+ * observed underflows (see sc_adaptive_audio_buffer): it is raised after
+ * clustered glitches, and slowly lowered during stable periods. The same
+ * compensation mechanism then converges to the new target.
  */
 
+// Initial and minimal target buffering in adaptive mode
+#define SC_AUDIO_REGULATOR_AUTO_INITIAL_MS 50
+#define SC_AUDIO_REGULATOR_AUTO_MIN_MS 10
+
 #define TO_BYTES(SAMPLES) sc_audiobuf_to_bytes(&ar->buf, (SAMPLES))
 #define TO_SAMPLES(BYTES) sc_audiobuf_to_samples(&ar->buf, (BYTES))
 
@@ -66,9 +75,10 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
     LOGD("[Audio] Audio regulator pulls %" PRIu32 " samples", out_samples);
 #endif
 
-    // A lock is necessary in the rare case where the producer needs to drop
-    // samples already pushed (when the buffer is full)
-    sc_mutex_lock(&ar->mutex);
+    // This function is called from the real-time audio thread, so it must be
+    // wait-free: it must never take a lock held by the producer. When the
+    // producer needs to drop samples already pushed, it requests the reader to
+    // skip them (see sc_audiobuf_request_skip()).
 
     bool played = atomic_load_explicit(&ar->played, memory_order_relaxed);
     if (!played) {
@@ -84,15 +94,13 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
             // whole buffer with silence (len is small compared to the
             // arbitrary margin value).
             memset(out, 0, out_samples * ar->sample_size);
-            sc_mutex_unlock(&ar->mutex);
             return;
         }
     }
 
+    // Also drops the samples requested to be skipped by the producer
     uint32_t read = sc_audiobuf_read(&ar->buf, out, out_samples);
 
-    sc_mutex_unlock(&ar->mutex);
-
     if (read < out_samples) {
         uint32_t silence = out_samples - read;
         // Insert silence. In theory, the inserted silent samples replace the
@@ -112,7 +120,16 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
             // Inserting additional samples immediately increases buffering
             atomic_fetch_add_explicit(&ar->underflow, silence,
                                       memory_order_relaxed);
+            atomic_fetch_add_explicit(&ar->silence_samples, silence,
+                                      memory_order_relaxed);
+            if (!ar->underflowing) {
+                atomic_fetch_add_explicit(&ar->glitches, 1,
+                                          memory_order_relaxed);
+                ar->underflowing = true;
+            }
         }
+    } else {
+        ar->underflowing = false;
     }
 
     atomic_store_explicit(&ar->played, true, memory_order_relaxed);
@@ -137,44 +154,43 @@ sc_audio_regulator_get_swr_buf(struct sc_audio_regulator *ar,
     return ar->swr_buf;
 }
 
-bool
-sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
-    SwrContext *swr_ctx = ar->swr_ctx;
-
-    uint32_t input_samples = frame->nb_samples;
+static void
+sc_audio_regulator_adapt_target(struct sc_audio_regulator *ar) {
+    assert(ar->adaptive);
 
-    assert(frame->pts >= 0);
-    int64_t pts = frame->pts;
-    if (ar->next_expected_pts && pts - ar->next_expected_pts > 100000) {
-        LOGV("[Audio] Discontinuity detected: %" PRIi64 "µs",
-             pts - ar->next_expected_pts);
-        // More than 100ms: consider it as a discontinuity
-        // (typically because silence packets were not captured)
-        uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
-        if (input_samples + can_read < ar->target_buffering) {
-            // Adjust buffering to the target value directly
-            uint32_t silence = ar->target_buffering - can_read - input_samples;
-            sc_audiobuf_write_silence(&ar->buf, silence);
+    uint32_t glitches = atomic_load_explicit(&ar->glitches,
+                                             memory_order_relaxed);
+    uint32_t new_glitches = glitches - ar->glitches_handled;
+    ar->glitches_handled = glitches;
+
+    uint32_t target =
+        sc_adaptive_audio_buffer_update(&ar->adaptive_buffer, new_glitches);
+    if (target != ar->target_buffering) {
+        if (target > ar->target_buffering) {
+            LOGI("Audio buffer increased to %" PRIu32 " ms after %" PRIu32
+                 " glitch(es)", target * 1000 / ar->sample_rate,
+                 new_glitches);
+        } else {
+            LOGV("[Audio] Target buffering lowered to %" PRIu32 " samples",
+                 target);
         }
-
-        // Reset state
-        ar->avg_buffering.avg = ar->target_buffering;
-        int ret = swr_set_compensation(swr_ctx, 0, 0);
-        (void) ret;
-        assert(!ret); // disabling compensation should never fail
-        ar->compensation_active = false;
-        ar->samples_since_resync = 0;
-        atomic_store_explicit(&ar->underflow, 0, memory_order_relaxed);
+        // The compensation will converge to the new target
+        ar->target_buffering = target;
+        atomic_store_explicit(&ar->target, target, memory_order_relaxed);
     }
+}
 
-    int64_t packet_duration = input_samples * INT64_C(1000000)
-                            / ar->sample_rate;
-    ar->next_expected_pts = pts + packet_duration;
+// Resample the input samples to the audio buffer, applying compensation
+static bool
+sc_audio_regulator_write_resampled(struct sc_audio_regulator *ar,
+                                   const uint8_t *const *data,
+                                   uint32_t input_samples, uint32_t *written) {
+    SwrContext *swr_ctx = ar->swr_ctx;
 
     int64_t swr_delay = swr_get_delay(swr_ctx, ar->sample_rate);
     // No need to av_rescale_rnd(), input and output sample rates are the same.
     // Add more space (256) for clock compensation.
-    int dst_nb_samples = swr_delay + frame->nb_samples + 256;
+    int dst_nb_samples = swr_delay + input_samples + 256;
 
     uint8_t *swr_buf = sc_audio_regulator_get_swr_buf(ar, dst_nb_samples);
     if (!swr_buf) {
@@ -182,12 +198,16 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
     }
 
     int ret = swr_convert(swr_ctx, &swr_buf, dst_nb_samples,
-                          (const uint8_t **) frame->data, frame->nb_samples);
+                          (const uint8_t **) data, input_samples);
     if (ret < 0) {
         LOGE("Resampling failed: %d", ret);
         return false;
     }
 
+    if (data) {
+        ar->swr_pending = true;
+    }
+
     // swr_convert() returns the number of samples which would have been
     // written if the buffer was big enough.
     uint32_t samples = MIN(ret, dst_nb_samples);
@@ -204,39 +224,112 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
         samples = cap;
     }
 
-    uint32_t skipped_samples = 0;
+    uint32_t w = sc_audiobuf_write(&ar->buf, swr_buf, samples);
+    if (w < samples) {
+        // The buffer is full. It is very unlikely, since it is far bigger than
+        // the maximum buffering (which is enforced below). Only the reader may
+        // drop old samples, so drop the remaining new samples instead.
+        LOGD("[Audio] Buffer full, dropping %" PRIu32 " samples", samples - w);
+    }
+
+    *written += w;
+    return true;
+}
+
+// Convert the input samples directly into the audio buffer (only for packed
+// signed 16-bit input, without compensation)
+static bool
+sc_audio_regulator_write_direct(struct sc_audio_regulator *ar,
+                                const uint8_t *data, uint32_t input_samples,
+                                uint32_t *written) {
+    assert(ar->direct_s16);
+    assert(!ar->compensation_active);
+
+    if (ar->swr_pending) {
+        // The resampler may still retain some samples since the compensation
+        // was disabled, flush them first to preserve the order
+        bool ok = sc_audio_regulator_write_resampled(ar, NULL, 0, written);
+        if (!ok) {
+            return false;
+        }
+
+        // Reset the resampler state after flushing
+        int ret = swr_init(ar->swr_ctx);
+        if (ret < 0) {
+            LOGE("Could not reset the resampling context: %d", ret);
+            return false;
+        }
+        ar->swr_pending = false;
+    }
+
+    uint32_t w = sc_audiobuf_write_s16(&ar->buf, (const int16_t *) data,
+                                       input_samples);
+    if (w < input_samples) {
+        // Same as in sc_audio_regulator_write_resampled()
+        LOGD("[Audio] Buffer full, dropping %" PRIu32 " samples",
+             input_samples - w);
+    }
+
+    *written += w;
+    return true;
+}
+
+bool
+sc_audio_regulator_push_samples(struct sc_audio_regulator *ar,
+                                const uint8_t *const *data,
+                                uint32_t input_samples, int64_t pts) {
+    SwrContext *swr_ctx = ar->swr_ctx;
 
-    uint32_t written = sc_audiobuf_write(&ar->buf, swr_buf, samples);
-    if (written < samples) {
-        uint32_t remaining = samples - written;
-
-        // All samples that could be written without locking have been written,
-        // now we need to lock to drop/consume old samples
-        sc_mutex_lock(&ar->mutex);
-
-        // Retry with the lock
-        written += sc_audiobuf_write(&ar->buf,
-                                     swr_buf + TO_BYTES(written),
-                                     remaining);
-        if (written < samples) {
-            remaining = samples - written;
-            // Still insufficient, drop old samples to make space
-            skipped_samples = sc_audiobuf_read(&ar->buf, NULL, remaining);
-            assert(skipped_samples == remaining);
+    assert(pts >= 0);
+    if (ar->next_expected_pts && pts - ar->next_expected_pts > 100000) {
+        LOGV("[Audio] Discontinuity detected: %" PRIi64 "µs",
+             pts - ar->next_expected_pts);
+        // More than 100ms: consider it as a discontinuity
+        // (typically because silence packets were not captured)
+        uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
+        if (input_samples + can_read < ar->target_buffering) {
+            // Adjust buffering to the target value directly
+            uint32_t silence = ar->target_buffering - can_read - input_samples;
+            sc_audiobuf_write_silence(&ar->buf, silence);
         }
 
-        sc_mutex_unlock(&ar->mutex);
+        // Reset state
+        ar->avg_buffering.avg = ar->target_buffering;
+        int ret = swr_set_compensation(swr_ctx, 0, 0);
+        (void) ret;
+        assert(!ret); // disabling compensation should never fail
+        ar->compensation_active = false;
+        ar->samples_since_resync = 0;
+        atomic_store_explicit(&ar->underflow, 0, memory_order_relaxed);
+    }
 
-        if (written < samples) {
-            // Now there is enough space
-            uint32_t w = sc_audiobuf_write(&ar->buf,
-                                           swr_buf + TO_BYTES(written),
-                                           remaining);
-            assert(w == remaining);
-            (void) w;
+    if (input_samples > ar->max_input_samples) {
+        ar->max_input_samples = input_samples;
+        if (ar->adaptive) {
+            // The target buffering must cover at least one packet
+            sc_adaptive_audio_buffer_set_min(&ar->adaptive_buffer,
+                                             input_samples);
         }
     }
 
+    int64_t packet_duration = input_samples * INT64_C(1000000)
+                            / ar->sample_rate;
+    ar->next_expected_pts = pts + packet_duration;
+
+    // The resampler is only necessary to apply compensation (or to convert
+    // other sample formats)
+    uint32_t written = 0;
+    bool ok = ar->direct_s16 && !ar->compensation_active
+            ? sc_audio_regulator_write_direct(ar, data[0], input_samples,
+                                              &written)
+            : sc_audio_regulator_write_resampled(ar, data, input_samples,
+                                                 &written);
+    if (!ok) {
+        return false;
+    }
+
+    uint32_t skipped_samples = 0;
+
     uint32_t underflow = 0;
     uint32_t max_buffered_samples;
     bool played = atomic_load_explicit(&ar->played, memory_order_relaxed);
@@ -257,29 +350,21 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
     uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
     if (can_read > max_buffered_samples) {
-        uint32_t skip_samples = 0;
-
-        sc_mutex_lock(&ar->mutex);
-        can_read = sc_audiobuf_can_read(&ar->buf);
-        if (can_read > max_buffered_samples) {
-            skip_samples = can_read - max_buffered_samples;
-            uint32_t r = sc_audiobuf_read(&ar->buf, NULL, skip_samples);
-            assert(r == skip_samples);
-            (void) r;
-            skipped_samples += skip_samples;
-        }
-        sc_mutex_unlock(&ar->mutex);
-
-        if (skip_samples) {
-            if (played) {
-                LOGD("[Audio] Buffering threshold exceeded, skipping %" PRIu32
-                     " samples", skip_samples);
+        uint32_t skip_samples = can_read - max_buffered_samples;
+        // The samples will be dropped by the reader on its next pull
+        sc_audiobuf_request_skip(&ar->buf, skip_samples);
+        skipped_samples = skip_samples;
+        atomic_fetch_add_explicit(&ar->skipped_samples, skip_samples,
+                                  memory_order_relaxed);
+
+        if (played) {
+            LOGD("[Audio] Buffering threshold exceeded, skipping %" PRIu32
+                 " samples", skip_samples);
 #ifdef SC_AUDIO_REGULATOR_DEBUG
-            } else {
-                LOGD("[Audio] Playback not started, skipping %" PRIu32
-                     " samples", skip_samples);
+        } else {
+            LOGD("[Audio] Playback not started, skipping %" PRIu32
+                 " samples", skip_samples);
 #endif
-            }
         }
     }
 
@@ -311,6 +396,8 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
     // However, the buffering level must be smoothed
     sc_average_push(&ar->avg_buffering, can_read);
+    float avg_buffering = sc_average_get(&ar->avg_buffering);
+    atomic_store_explicit(&ar->avg, avg_buffering, memory_order_relaxed);
 
 #ifdef SC_AUDIO_REGULATOR_DEBUG
     LOGD("[Audio] can_read=%" PRIu32 " avg_buffering=%f",
@@ -322,6 +409,10 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
         // Recompute compensation every second
         ar->samples_since_resync = 0;
 
+        if (ar->adaptive) {
+            sc_audio_regulator_adapt_target(ar);
+        }
+
         float avg = sc_average_get(&ar->avg_buffering);
         int diff = ar->target_buffering - avg;
 
@@ -362,9 +453,30 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
     return true;
 }
 
+sc_tick
+sc_audio_regulator_get_buffered_pts(struct sc_audio_regulator *ar) {
+    if (!ar->next_expected_pts) {
+        return -1;
+    }
+
+    // The buffer contains the last samples received (the resampler may also
+    // retain a few samples, ignore them)
+    uint32_t buffered = sc_audiobuf_can_read(&ar->buf);
+    return SC_TICK_FROM_US(ar->next_expected_pts)
+         - (sc_tick) buffered * SC_TICK_FREQ / ar->sample_rate;
+}
+
+bool
+sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
+    return sc_audio_regulator_push_samples(ar,
+                                           (const uint8_t *const *) frame->data,
+                                           frame->nb_samples, frame->pts);
+}
+
 bool
 sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
-                        const AVCodecContext *ctx, uint32_t target_buffering) {
+                        const AVCodecContext *ctx, uint32_t target_buffering,
+                        bool adaptive) {
     SwrContext *swr_ctx = swr_alloc();
     if (!swr_ctx) {
         LOG_OOM();
@@ -394,24 +506,40 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
         goto error_free_swr_ctx;
     }
 
-    bool ok = sc_mutex_init(&ar->mutex);
-    if (!ok) {
-        goto error_free_swr_ctx;
-    }
+    // Packed signed 16-bit samples (typically from a raw audio stream) may be
+    // converted directly to the audio buffer, without the resampler, as long
+    // as no compensation is applied
+    ar->direct_s16 = ctx->sample_fmt == AV_SAMPLE_FMT_S16;
+    ar->swr_pending = false;
 
-    ar->target_buffering = target_buffering;
     ar->sample_size = sample_size;
     ar->sample_rate = ctx->sample_rate;
 
-    // Use a ring-buffer of the target buffering size plus 1 second between the
-    // producer and the consumer. It's too big on purpose, to guarantee that
-    // the producer and the consumer will be able to access it in parallel
-    // without locking.
+    ar->adaptive = adaptive;
+    if (adaptive) {
+        // target_buffering is the maximum
+        uint32_t initial = ar->sample_rate * SC_AUDIO_REGULATOR_AUTO_INITIAL_MS
+                         / 1000;
+        uint32_t min = ar->sample_rate * SC_AUDIO_REGULATOR_AUTO_MIN_MS / 1000;
+        sc_adaptive_audio_buffer_init(&ar->adaptive_buffer, initial,
+                                      MIN(min, target_buffering),
+                                      target_buffering, ar->sample_rate);
+        ar->target_buffering = ar->adaptive_buffer.target;
+    } else {
+        ar->target_buffering = target_buffering;
+    }
+    ar->glitches_handled = 0;
+    ar->max_input_samples = 0;
+
+    // Use a ring-buffer of the (maximum) target buffering size plus 1 second
+    // between the producer and the consumer. It's too big on purpose, to
+    // guarantee that the producer and the consumer will be able to access it
+    // in parallel without locking.
     uint32_t audiobuf_samples = target_buffering + ar->sample_rate;
 
-    ok = sc_audiobuf_init(&ar->buf, sample_size, audiobuf_samples);
+    bool ok = sc_audiobuf_init(&ar->buf, sample_size, audiobuf_samples);
     if (!ok) {
-        goto error_destroy_mutex;
+        goto error_free_swr_ctx;
     }
 
     size_t initial_swr_buf_size = TO_BYTES(4096);
@@ -431,6 +559,12 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
     atomic_init(&ar->played, false);
     atomic_init(&ar->received, false);
     atomic_init(&ar->underflow, 0);
+    ar->underflowing = false;
+    atomic_init(&ar->glitches, 0);
+    atomic_init(&ar->silence_samples, 0);
+    atomic_init(&ar->skipped_samples, 0);
+    atomic_init(&ar->target, ar->target_buffering);
+    atomic_init(&ar->avg, 0);
     ar->underflow_report = 0;
     ar->compensation_active = false;
     ar->next_expected_pts = 0;
@@ -439,18 +573,34 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
 
 error_destroy_audiobuf:
     sc_audiobuf_destroy(&ar->buf);
-error_destroy_mutex:
-    sc_mutex_destroy(&ar->mutex);
 error_free_swr_ctx:
     swr_free(&ar->swr_ctx);
 
     return false;
 }
 
+void
+sc_audio_regulator_get_stats(struct sc_audio_regulator *ar,
+                             struct sc_audio_regulator_stats *stats) {
+#define TO_TICK(SAMPLES) ((sc_tick) (SAMPLES) * SC_TICK_FREQ / ar->sample_rate)
+    stats->target_buffering =
+        TO_TICK(atomic_load_explicit(&ar->target, memory_order_relaxed));
+    stats->avg_buffering =
+        TO_TICK(atomic_load_explicit(&ar->avg, memory_order_relaxed));
+    stats->glitches = atomic_load_explicit(&ar->glitches,
+                                           memory_order_relaxed);
+    stats->silence =
+        TO_TICK(atomic_load_explicit(&ar->silence_samples,
+                                     memory_order_relaxed));
+    stats->skipped =
+        TO_TICK(atomic_load_explicit(&ar->skipped_samples,
+                                     memory_order_relaxed));
+#undef TO_TICK
+}
+
 void
 sc_audio_regulator_destroy(struct sc_audio_regulator *ar) {
     free(ar->swr_buf);
     sc_audiobuf_destroy(&ar->buf);
-    sc_mutex_destroy(&ar->mutex);
     swr_free(&ar->swr_ctx);
 }
@@ -9,23 +9,38 @@
 #include <stdint.h>
 #include <libavcodec/avcodec.h>
 #include <libswresample/swresample.h>
+#include "adaptive_audio_buffer.h"
 #include "util/audiobuf.h"
 #include "util/average.h"
-#include "util/thread.h"
+#include "util/tick.h"
 
 #define SC_AV_SAMPLE_FMT AV_SAMPLE_FMT_FLT
 
 struct sc_audio_regulator {
-    sc_mutex mutex;
-
     // Target buffering between the producer and the consumer (in samples)
+    // If adaptive, it is updated by the receiver thread, but only once the
+    // player does not read it anymore (after playback started).
     uint32_t target_buffering;
 
+    // Adapt target_buffering to the observed underflows (only used by the
+    // receiver thread)
+    bool adaptive;
+    struct sc_adaptive_audio_buffer adaptive_buffer;
+    // Number of glitches already passed to adaptive_buffer
+    uint32_t glitches_handled;
+    // Largest input frame (in samples), the target should not be lower
+    uint32_t max_input_samples;
+
     // Audio buffer to communicate between the receiver and the player
     struct sc_audiobuf buf;
 
     // Resampler (only used from the receiver thread)
     struct SwrContext *swr_ctx;
+    // Convert the input samples directly when no compensation is applied
+    bool direct_s16;
+    // Set if the resampler may retain samples (only used from the receiver
+    // thread)
+    bool swr_pending;
 
     // The sample rate is the same for input and output
     uint32_t sample_rate;
@@ -49,6 +64,22 @@ struct sc_audio_regulator {
     // Number of silence samples inserted since the last log
     uint32_t underflow_report;
 
+    // Set if the last pull inserted silence (only used by the player thread)
+    bool underflowing;
+
+    // Counters, for statistics
+    // Number of underflow events (consecutive pulls inserting silence count
+    // for one glitch)
+    atomic_uint_least32_t glitches;
+    // Total number of silence samples inserted on underflow
+    atomic_uint_least64_t silence_samples;
+    // Total number of samples dropped on overflow
+    atomic_uint_least64_t skipped_samples;
+    // Copy of target_buffering, for other threads
+    atomic_uint_least32_t target;
+    // Last averaged buffering level (in samples)
+    atomic_uint_least32_t avg;
+
     // Non-zero compensation applied (only used by the receiver thread)
     bool compensation_active;
 
@@ -62,9 +93,25 @@ struct sc_audio_regulator {
     int64_t next_expected_pts;
 };
 
+struct sc_audio_regulator_stats {
+    sc_tick target_buffering;
+    sc_tick avg_buffering;
+    uint32_t glitches;
+    sc_tick silence; // total silence inserted on underflow
+    sc_tick skipped; // total samples dropped on overflow
+};
+
+/**
+ * Initialize an audio regulator
+ *
+ * \param target_buffering the target buffering (in samples), or the maximum
+ *                         target buffering if adaptive
+ * \param adaptive if true, adapt the target buffering to the underflows
+ */
 bool
 sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
-                        const AVCodecContext *ctx, uint32_t target_buffering);
+                        const AVCodecContext *ctx, uint32_t target_buffering,
+                        bool adaptive);
 
 void
 sc_audio_regulator_destroy(struct sc_audio_regulator *ar);
@@ -72,8 +119,34 @@ sc_audio_regulator_destroy(struct sc_audio_regulator *ar);
 bool
 sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame);
 
+/**
+ * Push input samples (in the input format of the codec context)
+ *
+ * \param data the samples, one pointer per plane
+ * \param samples the number of samples (per channel)
+ * \param pts the PTS of the first sample (in microseconds)
+ */
+bool
+sc_audio_regulator_push_samples(struct sc_audio_regulator *ar,
+                                const uint8_t *const *data, uint32_t samples,
+                                int64_t pts);
+
 void
 sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
                         uint32_t samples);
 
+/**
+ * Get the PTS of the next sample to be pulled from the buffer, or -1 if
+ * unknown (only from the receiver thread)
+ */
+sc_tick
+sc_audio_regulator_get_buffered_pts(struct sc_audio_regulator *ar);
+
+/**
+ * Get the regulator statistics (may be called from any thread)
+ */
+void
+sc_audio_regulator_get_stats(struct sc_audio_regulator *ar,
+                             struct sc_audio_regulator_stats *stats);
+
 #endif
@@ -0,0 +1,156 @@
+#include "av_sync.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "util/log.h"
+
+#define SC_AV_SYNC_AVERAGE_RANGE 32
+
+// Update the video delay correction once per second
+#define SC_AV_SYNC_UPDATE_INTERVAL SC_TICK_FROM_SEC(1)
+#define SC_AV_SYNC_REPORT_INTERVAL SC_TICK_FROM_SEC(10)
+
+// Do not correct small offsets, they are just noise
+#define SC_AV_SYNC_THRESHOLD SC_TICK_FROM_MS(5)
+// Never delay the video more than this value
+#define SC_AV_SYNC_MAX_VIDEO_DELAY SC_TICK_FROM_SEC(1)
+
+bool
+sc_av_sync_init(struct sc_av_sync *as, bool correct) {
+    bool ok = sc_mutex_init(&as->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    as->correct = correct;
+    as->has_ref = false;
+    as->ref = 0;
+    sc_average_init(&as->audio_offset, SC_AV_SYNC_AVERAGE_RANGE);
+    sc_average_init(&as->video_offset, SC_AV_SYNC_AVERAGE_RANGE);
+    as->offset = 0;
+    as->next_update = 0;
+    as->next_report = 0;
+    atomic_init(&as->video_delay, 0);
+
+    return true;
+}
+
+static bool
+sc_av_sync_is_valid(struct sc_av_sync *as) {
+    return as->audio_offset.count && as->video_offset.count;
+}
+
+static void
+sc_av_sync_report(struct sc_av_sync *as, bool final) {
+    sc_mutex_assert(&as->mutex);
+
+    if (!sc_av_sync_is_valid(as)) {
+        return;
+    }
+
+    sc_tick video_delay = sc_av_sync_get_video_delay(as);
+    if (final) {
+        LOGI("A/V offset: %+.1fms (video delay: %.1fms)",
+             as->offset / 1000.0, video_delay / 1000.0);
+    } else {
+        LOGD("A/V offset: %+.1fms (video delay: %.1fms)",
+             as->offset / 1000.0, video_delay / 1000.0);
+    }
+}
+
+void
+sc_av_sync_destroy(struct sc_av_sync *as) {
+    sc_mutex_lock(&as->mutex);
+    sc_av_sync_report(as, true);
+    sc_mutex_unlock(&as->mutex);
+
+    sc_mutex_destroy(&as->mutex);
+}
+
+static void
+sc_av_sync_push(struct sc_av_sync *as, struct sc_average *avg, sc_tick pts,
+                sc_tick date) {
+    sc_mutex_assert(&as->mutex);
+
+    sc_tick offset = date - pts;
+    if (!as->has_ref) {
+        as->ref = offset;
+        as->has_ref = true;
+    }
+
+    sc_average_push(avg, offset - as->ref);
+}
+
+static void
+sc_av_sync_update_correction(struct sc_av_sync *as) {
+    sc_mutex_assert(&as->mutex);
+    assert(as->correct);
+
+    if (llabs(as->offset) < SC_AV_SYNC_THRESHOLD) {
+        return;
+    }
+
+    sc_tick video_delay = sc_av_sync_get_video_delay(as);
+    // The offset is measured on the displayed frames, so it already includes
+    // the current video delay. Only apply half the difference, since the
+    // averages take time to converge.
+    sc_tick new_delay = video_delay - as->offset / 2;
+    new_delay = CLAMP(new_delay, 0, SC_AV_SYNC_MAX_VIDEO_DELAY);
+    if (new_delay != video_delay) {
+        LOGV("A/V sync: offset=%" PRItick "µs, video delay: %" PRItick "µs",
+             as->offset, new_delay);
+        atomic_store_explicit(&as->video_delay, new_delay,
+                              memory_order_relaxed);
+    }
+}
+
+void
+sc_av_sync_push_audio(struct sc_av_sync *as, sc_tick pts, sc_tick date) {
+    sc_mutex_lock(&as->mutex);
+    sc_av_sync_push(as, &as->audio_offset, pts, date);
+    sc_mutex_unlock(&as->mutex);
+}
+
+void
+sc_av_sync_push_video(struct sc_av_sync *as, sc_tick pts, sc_tick date) {
+    sc_mutex_lock(&as->mutex);
+
+    sc_av_sync_push(as, &as->video_offset, pts, date);
+
+    if (!sc_av_sync_is_valid(as)) {
+        sc_mutex_unlock(&as->mutex);
+        return;
+    }
+
+    as->offset = sc_average_get(&as->video_offset)
+               - sc_average_get(&as->audio_offset);
+
+    if (!as->next_update) {
+        // Let the averages converge before the first update
+        as->next_update = date + SC_AV_SYNC_UPDATE_INTERVAL;
+        as->next_report = date + SC_AV_SYNC_REPORT_INTERVAL;
+    }
+
+    if (as->correct && date >= as->next_update) {
+        sc_av_sync_update_correction(as);
+        as->next_update = date + SC_AV_SYNC_UPDATE_INTERVAL;
+    }
+
+    if (date >= as->next_report) {
+        sc_av_sync_report(as, false);
+        as->next_report = date + SC_AV_SYNC_REPORT_INTERVAL;
+    }
+
+    sc_mutex_unlock(&as->mutex);
+}
+
+void
+sc_av_sync_get_stats(struct sc_av_sync *as, struct sc_av_sync_stats *stats) {
+    sc_mutex_lock(&as->mutex);
+    stats->valid = sc_av_sync_is_valid(as);
+    stats->offset = as->offset;
+    stats->video_delay = sc_av_sync_get_video_delay(as);
+    sc_mutex_unlock(&as->mutex);
+}
@@ -0,0 +1,96 @@
+#ifndef SC_AV_SYNC_H
+#define SC_AV_SYNC_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/average.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Audio/video synchronization monitor.
+ *
+ * The audio and video PTS are generated from the same device clock. For each
+ * stream, the presentation offset is the difference between the date when a
+ * sample/frame is presented (heard or displayed) and its PTS.
+ *
+ * The A/V offset is the difference between the video and the audio
+ * presentation offsets: a positive value means that the video is late, a
+ * negative value means that the video is early.
+ *
+ * Since the audio cannot be accelerated without glitches, the only possible
+ * correction is to delay the video presentation (when the video is early).
+ */
+struct sc_av_sync {
+    sc_mutex mutex;
+
+    bool correct;
+
+    // The offsets are relative to a reference offset (the first offset
+    // measured), so that their values are small enough for a float average
+    sc_tick ref;
+    bool has_ref;
+    struct sc_average audio_offset;
+    struct sc_average video_offset;
+
+    // Current A/V offset, valid only if both averages are initialized
+    sc_tick offset;
+
+    sc_tick next_update;
+    sc_tick next_report;
+
+    // Delay to apply to the video presentation (read from other threads)
+    atomic_int_least64_t video_delay;
+};
+
+struct sc_av_sync_stats {
+    // false until both audio and video have been presented
+    bool valid;
+    // positive if the video is late, negative if the video is early
+    sc_tick offset;
+    // the delay currently added to the video presentation
+    sc_tick video_delay;
+};
+
+/**
+ * Initialize an A/V sync monitor
+ *
+ * \param correct if true, delay the video to compensate the A/V offset
+ */
+bool
+sc_av_sync_init(struct sc_av_sync *as, bool correct);
+
+void
+sc_av_sync_destroy(struct sc_av_sync *as);
+
+/**
+ * Register that the audio sample having the given PTS is heard at the given
+ * date
+ */
+void
+sc_av_sync_push_audio(struct sc_av_sync *as, sc_tick pts, sc_tick date);
+
+/**
+ * Register that the video frame having the given PTS is displayed at the
+ * given date
+ */
+void
+sc_av_sync_push_video(struct sc_av_sync *as, sc_tick pts, sc_tick date);
+
+/**
+ * Get the delay to add to the video presentation (may be called from any
+ * thread)
+ */
+static inline sc_tick
+sc_av_sync_get_video_delay(struct sc_av_sync *as) {
+    return atomic_load_explicit(&as->video_delay, memory_order_relaxed);
+}
+
+void
+sc_av_sync_get_stats(struct sc_av_sync *as, struct sc_av_sync_stats *stats);
+
+#endif
@@ -19,6 +19,8 @@
 #define STR_IMPL_(x) #x
 #define STR(x) STR_IMPL_(x)
 
+#define SC_DEFAULT_ADAPTIVE_BUFFER_MAX_MS 200
+
 enum {
     OPT_BIT_RATE = 1000,
     OPT_WINDOW_TITLE,
@@ -54,6 +56,10 @@ enum {
     OPT_DISPLAY_BUFFER,
     OPT_VIDEO_BUFFER,
     OPT_V4L2_BUFFER,
+    OPT_V4L2_FORMAT,
+    OPT_V4L2_SIZE,
+    OPT_V4L2_CROP,
+    OPT_V4L2_ORIENTATION,
     OPT_TUNNEL_HOST,
     OPT_TUNNEL_PORT,
     OPT_NO_CLIPBOARD_AUTOSYNC,
@@ -76,6 +82,7 @@ enum {
     OPT_REQUIRE_AUDIO,
     OPT_AUDIO_BUFFER,
     OPT_AUDIO_OUTPUT_BUFFER,
+    OPT_AUDIO_OUTPUT,
     OPT_NO_DISPLAY,
     OPT_NO_VIDEO,
     OPT_NO_AUDIO_PLAYBACK,
@@ -114,6 +121,22 @@ enum {
     OPT_NO_VD_SYSTEM_DECORATIONS,
     OPT_NO_VD_DESTROY_CONTENT,
     OPT_DISPLAY_IME_POLICY,
+    OPT_AV_SYNC,
+    OPT_MOUSE_MOTION_COALESCING,
+    OPT_GAMEPAD_DEADZONE,
+    OPT_GAMEPAD_REPORT_INTERVAL,
+    OPT_INPUT_SOCKET,
+    OPT_INPUT_RECORD,
+    OPT_INPUT_REPLAY,
+    OPT_INPUT_REPLAY_SPEED,
+    OPT_RECONNECT,
+    OPT_SERIALS,
+    OPT_WALL,
+    OPT_VIDEO_DECODE_MODE,
+    OPT_METRICS,
+    OPT_METRICS_INTERVAL,
+    OPT_RELAY,
+    OPT_RELAY_FORMAT,
 };
 
 struct sc_option {
@@ -177,6 +200,10 @@ static const struct sc_option options[] = {
         .text = "Configure the audio buffering delay (in milliseconds).\n"
                 "Lower values decrease the latency, but increase the "
                 "likelihood of buffer underrun (causing audio glitches).\n"
+                "If \"auto[:max]\" is passed, the delay is raised after "
+                "repeated glitches and slowly lowered while playback is "
+                "stable, up to max milliseconds ("
+                STR(SC_DEFAULT_ADAPTIVE_BUFFER_MAX_MS) " by default).\n"
                 "Default is 50.",
     },
     {
@@ -244,16 +271,38 @@ static const struct sc_option options[] = {
                 "microphone and the device playback.\n"
                 "Default is output.",
     },
+    {
+        .longopt_id = OPT_AUDIO_OUTPUT,
+        .longopt = "audio-output",
+        .argdesc = "backend",
+        .text = "Select the audio output backend.\n"
+                "Possible values are \"sdl\", \"alsa[:device]\" (Linux "
+                "only), \"null\" and \"file:path\".\n"
+                "\"alsa\" plays directly to an ALSA device (by default "
+                "\"default\"), without the additional buffering of SDL.\n"
+                "\"null\" consumes the samples in real-time without playing "
+                "them, and \"file:path\" also writes them to a file (raw "
+                "interleaved 32-bit float samples).\n"
+                "Default is sdl.",
+    },
     {
         .longopt_id = OPT_AUDIO_OUTPUT_BUFFER,
         .longopt = "audio-output-buffer",
         .argdesc = "ms",
-        .text = "Configure the size of the SDL audio output buffer (in "
+        .text = "Configure the size of the audio output buffer (in "
                 "milliseconds).\n"
                 "If you get \"robotic\" audio playback, you should test with "
                 "a higher value (10). Do not change this setting otherwise.\n"
                 "Default is 5.",
     },
+    {
+        .longopt_id = OPT_AV_SYNC,
+        .longopt = "av-sync",
+        .text = "Delay the video presentation to keep it synchronized with "
+                "the audio playback (the A/V offset is always measured and "
+                "reported in the logs).\n"
+                "It requires both video and audio playback.",
+    },
     {
         .shortopt = 'b',
         .longopt = "video-bit-rate",
@@ -454,11 +503,65 @@ static const struct sc_option options[] = {
                 "It may only work over USB.\n"
                 "Also see --keyboard and --mouse.",
     },
+    {
+        .longopt_id = OPT_GAMEPAD_DEADZONE,
+        .longopt = "gamepad-deadzone",
+        .argdesc = "percent",
+        .text = "Report the gamepad sticks as centered when their position is "
+                "within this deadzone (in percent of the range), to avoid "
+                "sending the noise of an idle stick.\n"
+                "Only applies to --gamepad=uhid and --gamepad=aoa.\n"
+                "Default is 0 (disabled).",
+    },
+    {
+        .longopt_id = OPT_GAMEPAD_REPORT_INTERVAL,
+        .longopt = "gamepad-report-interval",
+        .argdesc = "ms",
+        .text = "Send at most one gamepad report per interval (in "
+                "milliseconds) for axis changes. The latest state is sent at "
+                "the end of the interval. Button changes are always sent "
+                "immediately.\n"
+                "Only applies to --gamepad=uhid and --gamepad=aoa.\n"
+                "Default is 4.",
+    },
     {
         .shortopt = 'h',
         .longopt = "help",
         .text = "Print this help.",
     },
+    {
+        .longopt_id = OPT_INPUT_RECORD,
+        .longopt = "input-record",
+        .argdesc = "file",
+        .text = "Record all the control messages sent to the device, with "
+                "their timestamps, to a binary file (to be replayed by "
+                "--input-replay).",
+    },
+    {
+        .longopt_id = OPT_INPUT_REPLAY,
+        .longopt = "input-replay",
+        .argdesc = "file",
+        .text = "Replay the input events recorded by --input-record, with "
+                "their original timing, on start.\n"
+                "The scheduling jitter is reported at the end of the replay.",
+    },
+    {
+        .longopt_id = OPT_INPUT_REPLAY_SPEED,
+        .longopt = "input-replay-speed",
+        .argdesc = "percent",
+        .text = "Scale the timing of --input-replay (e.g. 200 to replay "
+                "twice as fast).\n"
+                "Default is 100.",
+    },
+    {
+        .longopt_id = OPT_INPUT_SOCKET,
+        .longopt = "input-socket",
+        .argdesc = "path",
+        .text = "Listen on a local Unix socket for scripted input commands "
+                "(taps, swipes, paths, keys and text), injected with precise "
+                "timing, bypassing the window event loop.\n"
+                "Not supported on Windows.",
+    },
     {
         .shortopt = 'K',
         .text = "Same as --keyboard=uhid, or --keyboard=aoa if --otg is set.",
@@ -563,6 +666,30 @@ static const struct sc_option options[] = {
         .text = "Limit the frame rate of screen capture (officially supported "
                 "since Android 10, but may work on earlier versions).",
     },
+    {
+        .longopt_id = OPT_METRICS,
+        .longopt = "metrics",
+        .argdesc = "target",
+        .text = "Export metrics for monitoring (bytes and packets received, "
+                "decoded and skipped frames, decoding errors, audio "
+                "underflows, control messages sent and dropped, recorder "
+                "queues and process memory).\n"
+                "Possible values are \"tcp:[<ip>:]<port>\" and "
+                "\"unix:<path>\" to serve them in the Prometheus text format "
+                "over HTTP (on a local TCP port or Unix socket), or "
+                "\"json:<path>\" to append them periodically as JSON lines to "
+                "a file (see --metrics-interval).\n"
+                "The default TCP address is 127.0.0.1 (localhost).\n"
+                "Unix sockets are not supported on Windows.",
+    },
+    {
+        .longopt_id = OPT_METRICS_INTERVAL,
+        .longopt = "metrics-interval",
+        .argdesc = "ms",
+        .text = "Set the interval between the metrics written to a file "
+                "(--metrics=json:<path>), in milliseconds.\n"
+                "Default is 10000 (10 seconds).",
+    },
     {
         .longopt_id = OPT_MOUSE,
         .longopt = "mouse",
@@ -607,6 +734,20 @@ static const struct sc_option options[] = {
                 "Default is 'bhsn:++++' for SDK mouse, and '++++:bhsn' for AOA "
                 "and UHID.",
     },
+    {
+        .longopt_id = OPT_MOUSE_MOTION_COALESCING,
+        .longopt = "mouse-motion-coalescing",
+        .argdesc = "value",
+        .text = "Merge consecutive mouse motion events, to avoid flooding the "
+                "device with high polling rate mice.\n"
+                "The value is either a time window (in milliseconds), or "
+                "\"frame\" to send the mouse motion once per displayed frame "
+                "(or per display refresh period).\n"
+                "Mouse button, wheel and keyboard events always send the "
+                "pending motion first, so clicks happen at the exact "
+                "position.\n"
+                "Default is 0 (disabled).",
+    },
     {
         .shortopt = 'n',
         .longopt = "no-control",
@@ -808,6 +949,15 @@ static const struct sc_option options[] = {
         .longopt = "raw-key-events",
         .text = "Inject key events for all input keys, and ignore text events."
     },
+    {
+        .longopt_id = OPT_RECONNECT,
+        .longopt = "reconnect",
+        .text = "Automatically reconnect when the device is disconnected, "
+                "keeping the window, the decoders and the recording alive. "
+                "The connection is retried (with a backoff) until the device "
+                "is reachable again.\n"
+                "Not supported with UHID or AOA input modes.",
+    },
     {
         .longopt_id = OPT_RECORD_FORMAT,
         .longopt = "record-format",
@@ -824,6 +974,30 @@ static const struct sc_option options[] = {
                 "the clockwise rotation in degrees.\n"
                 "Default is 0.",
     },
+    {
+        .longopt_id = OPT_RELAY,
+        .longopt = "relay",
+        .argdesc = "target",
+        .text = "Relay the encoded video and audio streams (without "
+                "re-encoding) to any number of local clients.\n"
+                "Possible values are \"tcp:[<ip>:]<port>\" and "
+                "\"unix:<path>\".\n"
+                "The default TCP address is 127.0.0.1 (localhost).\n"
+                "A new client receives the stream from the last video "
+                "keyframe. A client which does not read fast enough skips "
+                "to the next keyframe.\n"
+                "Unix sockets are not supported on Windows.",
+    },
+    {
+        .longopt_id = OPT_RELAY_FORMAT,
+        .longopt = "relay-format",
+        .argdesc = "format",
+        .text = "Set the container format of the relayed stream (see "
+                "--relay).\n"
+                "Possible values are \"mpegts\" (MPEG transport stream) and "
+                "\"fmp4\" (fragmented MP4).\n"
+                "Default is mpegts.",
+    },
     {
         .longopt_id = OPT_RENDER_DRIVER,
         .longopt = "render-driver",
@@ -854,6 +1028,17 @@ static const struct sc_option options[] = {
         .text = "The device serial number. Mandatory only if several devices "
                 "are connected to adb.",
     },
+    {
+        .longopt_id = OPT_SERIALS,
+        .longopt = "serials",
+        .argdesc = "serial1,serial2,...",
+        .text = "Mirror several devices (at most 16) from a single scrcpy "
+                "process, with one window per device.\n"
+                "The devices share the event loop, the adb server and a pool "
+                "of demuxing/decoding threads (one per CPU at most).\n"
+                "In this mode, audio is disabled, and recording, V4L2, "
+                "UHID/AOA input modes and gamepads are not supported.",
+    },
     {
         .shortopt = 'S',
         .longopt = "turn-screen-off",
@@ -950,6 +1135,9 @@ static const struct sc_option options[] = {
         .longopt = "verbosity",
         .argdesc = "value",
         .text = "Set the log level (verbose, debug, info, warn or error).\n"
+                "At verbose and debug levels, each line is prefixed by a "
+                "timestamp (in seconds) and the number of the logging "
+                "thread.\n"
 #ifndef NDEBUG
                 "Default is debug.",
 #else
@@ -970,10 +1158,51 @@ static const struct sc_option options[] = {
         .text = "Add a buffering delay (in milliseconds) before pushing "
                 "frames. This increases latency to compensate for jitter.\n"
                 "This option is similar to --video-buffer, but specific to "
-                "V4L2 sink.\n"
+                "V4L2 sink. It also accepts \"auto[:max]\".\n"
                 "Default is 0 (no buffering).\n"
                 "This option is only available on Linux.",
     },
+    {
+        .longopt_id = OPT_V4L2_FORMAT,
+        .longopt = "v4l2-format",
+        .argdesc = "format",
+        .text = "Select the pixel format of the V4L2 sink.\n"
+                "Possible values are \"yuv420\", \"nv12\" and \"yuyv\".\n"
+                "Default is yuv420.\n"
+                "This option is only available on Linux.",
+    },
+    {
+        .longopt_id = OPT_V4L2_CROP,
+        .longopt = "v4l2-crop",
+        .argdesc = "width:height:x:y",
+        .text = "Crop the frames output to the V4L2 sink (on the computer).\n"
+                "The values are expressed in the video frame coordinates "
+                "(before --v4l2-orientation is applied).\n"
+                "This option is only available on Linux.",
+    },
+    {
+        .longopt_id = OPT_V4L2_ORIENTATION,
+        .longopt = "v4l2-orientation",
+        .argdesc = "value",
+        .text = "Set the orientation of the frames output to the V4L2 sink.\n"
+                "Possible values are 0, 90, 180, 270, flip0, flip90, flip180 "
+                "and flip270. The number represents the clockwise rotation "
+                "in degrees; the \"flip\" keyword applies a horizontal flip "
+                "before the rotation.\n"
+                "Default is 0.\n"
+                "This option is only available on Linux.",
+    },
+    {
+        .longopt_id = OPT_V4L2_SIZE,
+        .longopt = "v4l2-size",
+        .argdesc = "widthxheight",
+        .text = "Scale the frames output to the V4L2 sink to a fixed size "
+                "(e.g. 1920x1080). The aspect ratio is preserved (black "
+                "borders are added if necessary), so that the output size "
+                "does not change on device rotation.\n"
+                "By default, the size of the video frames is used.\n"
+                "This option is only available on Linux.",
+    },
     {
         .longopt_id = OPT_VIDEO_BUFFER,
         .longopt = "video-buffer",
@@ -981,6 +1210,9 @@ static const struct sc_option options[] = {
         .text = "Add a buffering delay (in milliseconds) before displaying "
                 "video frames.\n"
                 "This increases latency to compensate for jitter.\n"
+                "If \"auto[:max]\" is passed, the delay is adapted "
+                "continuously to the measured jitter, up to max milliseconds "
+                "(" STR(SC_DEFAULT_ADAPTIVE_BUFFER_MAX_MS) " by default).\n"
                 "Default is 0 (no buffering).",
     },
     {
@@ -1002,6 +1234,24 @@ static const struct sc_option options[] = {
                 "Android documentation: "
                 "<https://d.android.com/reference/android/media/MediaFormat>",
     },
+    {
+        .longopt_id = OPT_VIDEO_DECODE_MODE,
+        .longopt = "video-decode-mode",
+        .argdesc = "mode",
+        .text = "Select how the video is decoded on the computer, to reduce "
+                "the CPU usage when monitoring many devices (full, "
+                "lowres[:N] or keyframes).\n"
+                "\"lowres\" decodes all the frames, but skips some decoding "
+                "steps at the cost of visual artifacts. N is the level of "
+                "degradation, from 1 to "
+                STR(SC_VIDEO_DECODE_LOWRES_MAX_LEVEL) " ("
+                STR(SC_VIDEO_DECODE_LOWRES_DEFAULT_LEVEL) " by default).\n"
+                "\"keyframes\" decodes only the key frames (the video is "
+                "refreshed only once every few seconds).\n"
+                "In wall mode (--wall), the device under the cursor (or "
+                "displayed alone) is always fully decoded.\n"
+                "Default is full.",
+    },
     {
         .longopt_id = OPT_VIDEO_ENCODER,
         .longopt = "video-encoder",
@@ -1024,6 +1274,15 @@ static const struct sc_option options[] = {
         .text = "Keep the device on while scrcpy is running, when the device "
                 "is plugged in.",
     },
+    {
+        .longopt_id = OPT_WALL,
+        .longopt = "wall",
+        .text = "In multi-device mode (--serials), display all the devices in "
+                "a grid in a single window, rendered at once.\n"
+                "Mouse and keyboard events are sent to the device under the "
+                "cursor. MOD+z displays the device under the cursor alone (or "
+                "goes back to the grid), MOD+f toggles fullscreen.",
+    },
     {
         .longopt_id = OPT_WINDOW_BORDERLESS,
         .longopt = "window-borderless",
@@ -1187,6 +1446,11 @@ static const struct sc_shortcut shortcuts[] = {
         .shortcuts = { "MOD+i" },
         .text = "Enable/disable FPS counter (print frames/second in logs)",
     },
+    {
+        .shortcuts = { "MOD+Shift+i" },
+        .text = "Show/hide the statistics overlay (bitrate, frame rates, "
+                "decoding time, latency, audio buffering and queues)",
+    },
     {
         .shortcuts = { "Ctrl+click-and-move" },
         .text = "Pinch-to-zoom and rotate from the center of the screen",
@@ -1633,6 +1897,33 @@ parse_buffering_time(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_adaptive_buffering(const char *s, sc_tick *tick, bool *adaptive) {
+    if (strncmp(s, "auto", 4) || (s[4] != '\0' && s[4] != ':')) {
+        *adaptive = false;
+        return parse_buffering_time(s, tick);
+    }
+
+    *adaptive = true;
+    if (s[4] == '\0') {
+        *tick = SC_TICK_FROM_MS(SC_DEFAULT_ADAPTIVE_BUFFER_MAX_MS);
+        return true;
+    }
+
+    sc_tick max;
+    if (!parse_buffering_time(s + 5, &max)) {
+        return false;
+    }
+
+    if (!max) {
+        LOGE("Maximum adaptive buffering time must be positive: %s", s);
+        return false;
+    }
+
+    *tick = max;
+    return true;
+}
+
 static bool
 parse_audio_output_buffer(const char *s, sc_tick *tick) {
     long value;
@@ -1646,6 +1937,107 @@ parse_audio_output_buffer(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_mouse_motion_coalescing(const char *s, sc_tick *tick) {
+    if (!strcmp(s, "frame")) {
+        *tick = SC_MOUSE_MOTION_COALESCING_FRAME;
+        return true;
+    }
+
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 1000,
+                                "mouse motion coalescing");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_MS(value);
+    return true;
+}
+
+static bool
+parse_input_replay_speed(const char *s, uint16_t *speed) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 10, 10000,
+                                "input replay speed");
+    if (!ok) {
+        return false;
+    }
+
+    *speed = (uint16_t) value;
+    return true;
+}
+
+static bool
+parse_gamepad_deadzone(const char *s, uint8_t *deadzone) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 50, "gamepad deadzone");
+    if (!ok) {
+        return false;
+    }
+
+    *deadzone = value;
+    return true;
+}
+
+static bool
+parse_gamepad_report_interval(const char *s, sc_tick *tick) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 100,
+                                "gamepad report interval");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_MS(value);
+    return true;
+}
+
+static bool
+parse_audio_output(const char *s, enum sc_audio_output_backend *backend,
+                   const char **target) {
+    if (!strcmp(s, "sdl")) {
+        *backend = SC_AUDIO_OUTPUT_BACKEND_SDL;
+        *target = NULL;
+        return true;
+    }
+
+    if (!strcmp(s, "alsa") || !strncmp(s, "alsa:", 5)) {
+#ifdef HAVE_ALSA
+        *backend = SC_AUDIO_OUTPUT_BACKEND_ALSA;
+        *target = s[4] ? s + 5 : NULL;
+        if (*target && !**target) {
+            LOGE("Empty ALSA device name: %s", s);
+            return false;
+        }
+        return true;
+#else
+        LOGE("ALSA audio output is disabled (built without libasound).");
+        return false;
+#endif
+    }
+
+    if (!strcmp(s, "null")) {
+        *backend = SC_AUDIO_OUTPUT_BACKEND_NULL;
+        *target = NULL;
+        return true;
+    }
+
+    if (!strncmp(s, "file:", 5)) {
+        if (!s[5]) {
+            LOGE("Empty audio output file name: %s", s);
+            return false;
+        }
+        *backend = SC_AUDIO_OUTPUT_BACKEND_FILE;
+        *target = s + 5;
+        return true;
+    }
+
+    LOGE("Unsupported audio output: %s (expected sdl, alsa[:device], null or "
+         "file:path)", s);
+    return false;
+}
+
 static bool
 parse_display_ime_policy(const char *s, enum sc_display_ime_policy *policy) {
     if (!strcmp(s, "local")) {
@@ -1792,6 +2184,29 @@ parse_port_range(const char *s, struct sc_port_range *port_range) {
     return true;
 }
 
+static bool
+parse_serials(const char *s) {
+    unsigned count = 0;
+    for (;;) {
+        const char *sep = strchr(s, ',');
+        size_t len = sep ? (size_t) (sep - s) : strlen(s);
+        if (!len) {
+            LOGE("Invalid serials (empty item)");
+            return false;
+        }
+
+        if (++count > SC_MAX_DEVICES) {
+            LOGE("Too many serials (at most %d)", SC_MAX_DEVICES);
+            return false;
+        }
+
+        if (!sep) {
+            return true;
+        }
+        s = sep + 1;
+    }
+}
+
 static bool
 parse_display_id(const char *s, uint32_t *display_id) {
     long value;
@@ -2037,6 +2452,43 @@ parse_video_source(const char *optarg, enum sc_video_source *source) {
     return false;
 }
 
+static bool
+parse_video_decode_mode(const char *s, enum sc_video_decode_mode *mode,
+                        uint8_t *lowres_level) {
+    if (!strcmp(s, "full")) {
+        *mode = SC_VIDEO_DECODE_MODE_FULL;
+        return true;
+    }
+
+    if (!strcmp(s, "keyframes")) {
+        *mode = SC_VIDEO_DECODE_MODE_KEYFRAMES;
+        return true;
+    }
+
+    if (!strncmp(s, "lowres", 6) && (s[6] == '\0' || s[6] == ':')) {
+        *mode = SC_VIDEO_DECODE_MODE_LOWRES;
+        if (s[6] == '\0') {
+            *lowres_level = SC_VIDEO_DECODE_LOWRES_DEFAULT_LEVEL;
+            return true;
+        }
+
+        long value;
+        bool ok = parse_integer_arg(s + 7, &value, false, 1,
+                                    SC_VIDEO_DECODE_LOWRES_MAX_LEVEL,
+                                    "lowres level");
+        if (!ok) {
+            return false;
+        }
+
+        *lowres_level = value;
+        return true;
+    }
+
+    LOGE("Unsupported video decode mode: %s (expected full, lowres[:N] or "
+         "keyframes)", s);
+    return false;
+}
+
 static bool
 parse_audio_source(const char *optarg, enum sc_audio_source *source) {
     if (!strcmp(optarg, "mic")) {
@@ -2101,6 +2553,81 @@ parse_audio_source(const char *optarg, enum sc_audio_source *source) {
     return false;
 }
 
+#ifdef HAVE_V4L2
+static bool
+parse_v4l2_format(const char *optarg, enum sc_v4l2_format *format) {
+    if (!strcmp(optarg, "yuv420")) {
+        *format = SC_V4L2_FORMAT_YUV420;
+        return true;
+    }
+
+    if (!strcmp(optarg, "nv12")) {
+        *format = SC_V4L2_FORMAT_NV12;
+        return true;
+    }
+
+    if (!strcmp(optarg, "yuyv")) {
+        *format = SC_V4L2_FORMAT_YUYV;
+        return true;
+    }
+
+    LOGE("Unsupported V4L2 format: %s (expected yuv420, nv12 or yuyv)",
+         optarg);
+    return false;
+}
+
+static bool
+parse_v4l2_size(const char *s, struct sc_size *size) {
+    long values[2];
+    size_t count = parse_integers_arg(s, 'x', 2, values, 2, 0xFFFF,
+                                      "V4L2 size");
+    if (!count) {
+        return false;
+    }
+
+    if (count != 2) {
+        LOGE("Invalid V4L2 size: %s (expected widthxheight)", s);
+        return false;
+    }
+
+    // YUV 4:2:0 requires even dimensions
+    if (values[0] % 2 || values[1] % 2) {
+        LOGE("V4L2 size must be even: %s", s);
+        return false;
+    }
+
+    size->width = values[0];
+    size->height = values[1];
+    return true;
+}
+
+static bool
+parse_v4l2_crop(const char *s, struct sc_rect *crop) {
+    long values[4];
+    size_t count = parse_integers_arg(s, ':', 4, values, 0, 0xFFFF,
+                                      "V4L2 crop");
+    if (!count) {
+        return false;
+    }
+
+    if (count != 4) {
+        LOGE("Invalid V4L2 crop: %s (expected width:height:x:y)", s);
+        return false;
+    }
+
+    if (values[0] < 2 || values[1] < 2) {
+        LOGE("V4L2 crop area too small: %s", s);
+        return false;
+    }
+
+    crop->size.width = values[0];
+    crop->size.height = values[1];
+    crop->point.x = values[2];
+    crop->point.y = values[3];
+    return true;
+}
+#endif
+
 static bool
 parse_camera_facing(const char *optarg, enum sc_camera_facing *facing) {
     if (!strcmp(optarg, "front")) {
@@ -2230,6 +2757,135 @@ parse_gamepad(const char *optarg, enum sc_gamepad_input_mode *mode) {
     return false;
 }
 
+// Parse "[<ip>:]<port>" (the host is left untouched if there is no ip)
+static bool
+parse_tcp_target(const char *s, uint32_t *host, uint16_t *port) {
+    const char *colon = strchr(s, ':');
+    if (colon) {
+        char ip[16]; // "xxx.xxx.xxx.xxx"
+        size_t len = colon - s;
+        if (len >= sizeof(ip)) {
+            LOGE("Invalid IPv4 address: %.*s", (int) len, s);
+            return false;
+        }
+        memcpy(ip, s, len);
+        ip[len] = '\0';
+        if (!parse_ip(ip, host)) {
+            return false;
+        }
+        s = colon + 1;
+    }
+
+    long value;
+    if (!parse_integer_arg(s, &value, false, 1, 0xFFFF, "port")) {
+        return false;
+    }
+
+    *port = (uint16_t) value;
+    return true;
+}
+
+static bool
+parse_metrics(const char *s, struct scrcpy_options *opts) {
+    if (!strncmp(s, "tcp:", 4)) {
+        if (!parse_tcp_target(s + 4, &opts->metrics_host,
+                              &opts->metrics_port)) {
+            return false;
+        }
+        opts->metrics_type = SC_METRICS_TYPE_TCP;
+        return true;
+    }
+
+    if (!strncmp(s, "unix:", 5)) {
+#ifndef _WIN32
+        if (!s[5]) {
+            LOGE("Empty metrics socket path");
+            return false;
+        }
+        opts->metrics_type = SC_METRICS_TYPE_UNIX;
+        opts->metrics_path = s + 5;
+        return true;
+#else
+        LOGE("--metrics=unix:<path> is not supported on Windows");
+        return false;
+#endif
+    }
+
+    if (!strncmp(s, "json:", 5)) {
+        if (!s[5]) {
+            LOGE("Empty metrics file path");
+            return false;
+        }
+        opts->metrics_type = SC_METRICS_TYPE_JSON;
+        opts->metrics_path = s + 5;
+        return true;
+    }
+
+    LOGE("Unsupported metrics target: %s (expected tcp:[<ip>:]<port>, "
+         "unix:<path> or json:<path>)", s);
+    return false;
+}
+
+static bool
+parse_relay(const char *s, struct scrcpy_options *opts) {
+    if (!strncmp(s, "tcp:", 4)) {
+        if (!parse_tcp_target(s + 4, &opts->relay_host, &opts->relay_port)) {
+            return false;
+        }
+        opts->relay_type = SC_RELAY_TYPE_TCP;
+        return true;
+    }
+
+    if (!strncmp(s, "unix:", 5)) {
+#ifndef _WIN32
+        if (!s[5]) {
+            LOGE("Empty relay socket path");
+            return false;
+        }
+        opts->relay_type = SC_RELAY_TYPE_UNIX;
+        opts->relay_path = s + 5;
+        return true;
+#else
+        LOGE("--relay=unix:<path> is not supported on Windows");
+        return false;
+#endif
+    }
+
+    LOGE("Unsupported relay target: %s (expected tcp:[<ip>:]<port> or "
+         "unix:<path>)", s);
+    return false;
+}
+
+static bool
+parse_relay_format(const char *s, enum sc_relay_format *format) {
+    if (!strcmp(s, "mpegts")) {
+        *format = SC_RELAY_FORMAT_MPEGTS;
+        return true;
+    }
+
+    if (!strcmp(s, "fmp4")) {
+        *format = SC_RELAY_FORMAT_FMP4;
+        return true;
+    }
+
+    LOGE("Unsupported relay format: %s (expected mpegts or fmp4)", s);
+    return false;
+}
+
+static bool
+parse_metrics_interval(const char *s, sc_tick *tick) {
+    long value;
+    // 1 day max
+    bool ok = parse_integer_arg(s, &value, false, 1, 86400000,
+                                "metrics interval");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_MS(value);
+    return true;
+}
+
 static bool
 parse_time_limit(const char *s, sc_tick *tick) {
     long value;
@@ -2353,6 +3009,22 @@ parse_mouse_bindings(const char *s, struct sc_mouse_bindings *mb) {
     return true;
 }
 
+// Return true if any audio option differs from its default value
+static bool
+has_explicit_audio_options(const struct scrcpy_options *opts) {
+    const struct scrcpy_options *def = &scrcpy_options_default;
+    return opts->require_audio != def->require_audio
+        || opts->audio_source != def->audio_source
+        || opts->audio_codec != def->audio_codec
+        || opts->audio_bit_rate != def->audio_bit_rate
+        || opts->audio_codec_options != def->audio_codec_options
+        || opts->audio_encoder != def->audio_encoder
+        || opts->audio_dup != def->audio_dup
+        || opts->audio_buffer != def->audio_buffer
+        || opts->audio_output_buffer != def->audio_output_buffer
+        || opts->audio_output != def->audio_output;
+}
+
 static bool
 parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                        const char *optstring, const struct option *longopts) {
@@ -2635,7 +3307,8 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                      "instead.");
                 return false;
             case OPT_VIDEO_BUFFER:
-                if (!parse_buffering_time(optarg, &opts->video_buffer)) {
+                if (!parse_adaptive_buffering(optarg, &opts->video_buffer,
+                                           &opts->video_buffer_auto)) {
                     return false;
                 }
                 break;
@@ -2673,6 +3346,32 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_VIDEO_DECODE_MODE:
+                if (!parse_video_decode_mode(optarg, &opts->video_decode_mode,
+                                           &opts->video_decode_lowres_level)) {
+                    return false;
+                }
+                break;
+            case OPT_METRICS:
+                if (!parse_metrics(optarg, opts)) {
+                    return false;
+                }
+                break;
+            case OPT_METRICS_INTERVAL:
+                if (!parse_metrics_interval(optarg, &opts->metrics_interval)) {
+                    return false;
+                }
+                break;
+            case OPT_RELAY:
+                if (!parse_relay(optarg, opts)) {
+                    return false;
+                }
+                break;
+            case OPT_RELAY_FORMAT:
+                if (!parse_relay_format(optarg, &opts->relay_format)) {
+                    return false;
+                }
+                break;
             case OPT_AUDIO_CODEC:
                 if (!parse_audio_codec(optarg, &opts->audio_codec)) {
                     return false;
@@ -2697,7 +3396,8 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
 #endif
             case OPT_V4L2_BUFFER:
 #ifdef HAVE_V4L2
-                if (!parse_buffering_time(optarg, &opts->v4l2_buffer)) {
+                if (!parse_adaptive_buffering(optarg, &opts->v4l2_buffer,
+                                           &opts->v4l2_buffer_auto)) {
                     return false;
                 }
                 break;
@@ -2705,6 +3405,50 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 LOGE("V4L2 (--v4l2-buffer) is disabled (or unsupported on this "
                      "platform).");
                 return false;
+#endif
+            case OPT_V4L2_FORMAT:
+#ifdef HAVE_V4L2
+                if (!parse_v4l2_format(optarg, &opts->v4l2_format)) {
+                    return false;
+                }
+                break;
+#else
+                LOGE("V4L2 (--v4l2-format) is disabled (or unsupported on this "
+                     "platform).");
+                return false;
+#endif
+            case OPT_V4L2_SIZE:
+#ifdef HAVE_V4L2
+                if (!parse_v4l2_size(optarg, &opts->v4l2_size)) {
+                    return false;
+                }
+                break;
+#else
+                LOGE("V4L2 (--v4l2-size) is disabled (or unsupported on this "
+                     "platform).");
+                return false;
+#endif
+            case OPT_V4L2_CROP:
+#ifdef HAVE_V4L2
+                if (!parse_v4l2_crop(optarg, &opts->v4l2_crop)) {
+                    return false;
+                }
+                break;
+#else
+                LOGE("V4L2 (--v4l2-crop) is disabled (or unsupported on this "
+                     "platform).");
+                return false;
+#endif
+            case OPT_V4L2_ORIENTATION:
+#ifdef HAVE_V4L2
+                if (!parse_orientation(optarg, &opts->v4l2_orientation)) {
+                    return false;
+                }
+                break;
+#else
+                LOGE("V4L2 (--v4l2-orientation) is disabled (or unsupported on "
+                     "this platform).");
+                return false;
 #endif
             case OPT_LIST_ENCODERS:
                 opts->list |= SC_OPTION_LIST_ENCODERS;
@@ -2725,7 +3469,8 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 opts->require_audio = true;
                 break;
             case OPT_AUDIO_BUFFER:
-                if (!parse_buffering_time(optarg, &opts->audio_buffer)) {
+                if (!parse_adaptive_buffering(optarg, &opts->audio_buffer,
+                                              &opts->audio_buffer_auto)) {
                     return false;
                 }
                 break;
@@ -2735,6 +3480,12 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_AUDIO_OUTPUT:
+                if (!parse_audio_output(optarg, &opts->audio_output,
+                                        &opts->audio_output_target)) {
+                    return false;
+                }
+                break;
             case OPT_VIDEO_SOURCE:
                 if (!parse_video_source(optarg, &opts->video_source)) {
                     return false;
@@ -2786,6 +3537,62 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_AUDIO_DUP:
                 opts->audio_dup = true;
                 break;
+            case OPT_AV_SYNC:
+                opts->av_sync = true;
+                break;
+            case OPT_MOUSE_MOTION_COALESCING:
+                if (!parse_mouse_motion_coalescing(
+                        optarg, &opts->mouse_motion_coalescing)) {
+                    return false;
+                }
+                break;
+            case OPT_GAMEPAD_DEADZONE:
+                if (!parse_gamepad_deadzone(optarg, &opts->gamepad_deadzone)) {
+                    return false;
+                }
+                break;
+            case OPT_GAMEPAD_REPORT_INTERVAL:
+                if (!parse_gamepad_report_interval(
+                        optarg, &opts->gamepad_report_interval)) {
+                    return false;
+                }
+                break;
+            case OPT_INPUT_RECORD:
+                opts->input_record_filename = optarg;
+                break;
+            case OPT_INPUT_REPLAY:
+                opts->input_replay_filename = optarg;
+                break;
+            case OPT_INPUT_REPLAY_SPEED:
+                if (!parse_input_replay_speed(optarg,
+                                              &opts->input_replay_speed)) {
+                    return false;
+                }
+                break;
+            case OPT_RECONNECT:
+                opts->reconnect = true;
+                break;
+            case OPT_SERIALS:
+                if (!parse_serials(optarg)) {
+                    return false;
+                }
+                opts->serials = optarg;
+                break;
+            case OPT_WALL:
+                opts->wall = true;
+                break;
+            case OPT_INPUT_SOCKET:
+#ifndef _WIN32
+                if (!*optarg) {
+                    LOGE("Empty input socket path");
+                    return false;
+                }
+                opts->input_socket = optarg;
+                break;
+#else
+                LOGE("--input-socket is not supported on Windows");
+                return false;
+#endif
             case 'G':
                 opts->gamepad_input_mode = SC_GAMEPAD_INPUT_MODE_UHID_OR_AOA;
                 break;
@@ -2837,20 +3644,35 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
     assert(opts->tcpip || !opts->tcpip_dst);
 
     unsigned selectors = !!opts->serial
+                       + !!opts->serials
                        + !!opts->tcpip_dst
                        + opts->select_tcpip
                        + opts->select_usb;
     if (selectors > 1) {
         LOGE("At most one device selector option may be passed, among:\n"
              "  --serial (-s)\n"
+             "  --serials\n"
              "  --select-usb (-d)\n"
              "  --select-tcpip (-e)\n"
              "  --tcpip=<addr> (with an argument)");
         return false;
     }
 
+    if (opts->serials && opts->audio) {
+        // The audio of several devices would be mixed, so audio is disabled by
+        // default, but explicit audio options must not be silently ignored
+        if (has_explicit_audio_options(opts)) {
+            LOGE("Multi-device mode: audio is not supported (remove the audio "
+                 "options)");
+            return false;
+        }
+        LOGI("Multi-device mode: audio disabled");
+        opts->audio = false;
+    }
+
     bool otg = false;
     bool v4l2 = false;
+    bool relay = opts->relay_type != SC_RELAY_TYPE_NONE;
 #ifdef HAVE_USB
     otg = opts->otg;
 #endif
@@ -2871,21 +3693,35 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         opts->power_on = false;
     }
 
+    if (opts->audio_output != SC_AUDIO_OUTPUT_BACKEND_SDL
+            && !opts->audio_playback) {
+        LOGE("--audio-output requires audio playback, but "
+             "--no-audio-playback was set.");
+        return false;
+    }
+
     if (!opts->audio) {
         opts->audio_playback = false;
     }
 
     if (opts->video && !opts->video_playback && !opts->record_filename
-            && !v4l2) {
-        LOGI("No video playback, no recording, no V4L2 sink: video disabled");
+            && !relay && !v4l2) {
+        LOGI("No video playback, no recording, no relay, no V4L2 sink: video "
+             "disabled");
         opts->video = false;
     }
 
-    if (opts->audio && !opts->audio_playback && !opts->record_filename) {
-        LOGI("No audio playback, no recording: audio disabled");
+    if (opts->audio && !opts->audio_playback && !opts->record_filename
+            && !relay) {
+        LOGI("No audio playback, no recording, no relay: audio disabled");
         opts->audio = false;
     }
 
+    if (opts->av_sync && (!opts->video_playback || !opts->audio_playback)) {
+        LOGE("--av-sync requires both video and audio playback");
+        return false;
+    }
+
     if (!opts->video && !opts->audio && !opts->control && !otg) {
         LOGE("No video, no audio, no control, no OTG: nothing to do");
         return false;
@@ -2916,16 +3752,31 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             return false;
         }
 
-        // V4L2 could not handle size change.
-        // Do not log because downsizing on error is the default behavior,
-        // not an explicit request from the user.
-        opts->downsize_on_error = false;
+        if (!opts->v4l2_size.width) {
+            // V4L2 consumers generally do not handle size change (the output
+            // size is fixed if --v4l2-size is set).
+            // Do not log because downsizing on error is the default behavior,
+            // not an explicit request from the user.
+            opts->downsize_on_error = false;
+        }
     }
 
     if (opts->v4l2_buffer && !opts->v4l2_device) {
         LOGE("V4L2 buffer value without V4L2 sink");
         return false;
     }
+
+    if (opts->v4l2_format != SC_V4L2_FORMAT_YUV420 && !opts->v4l2_device) {
+        LOGE("V4L2 format without V4L2 sink");
+        return false;
+    }
+
+    if ((opts->v4l2_size.width || opts->v4l2_crop.size.width
+            || opts->v4l2_orientation != SC_ORIENTATION_0)
+            && !opts->v4l2_device) {
+        LOGE("V4L2 size, crop or orientation without V4L2 sink");
+        return false;
+    }
 #endif
 
     if (opts->control) {
@@ -3229,6 +4080,35 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         }
     }
 
+    if (opts->relay_format != SC_RELAY_FORMAT_MPEGTS && !relay) {
+        LOGE("--relay-format requires --relay");
+        return false;
+    }
+
+    if (relay) {
+        if (!opts->video && !opts->audio) {
+            LOGE("Video and audio disabled, nothing to relay");
+            return false;
+        }
+
+        if (opts->relay_format == SC_RELAY_FORMAT_MPEGTS) {
+            if (opts->video && opts->video_codec == SC_CODEC_AV1) {
+                LOGE("MPEG-TS relay does not support AV1 video "
+                     "(try with --relay-format=fmp4)");
+                return false;
+            }
+            if (opts->audio && (opts->audio_codec == SC_CODEC_FLAC
+                             || opts->audio_codec == SC_CODEC_RAW)) {
+                LOGE("MPEG-TS relay does not support FLAC or RAW audio "
+                     "(try with --audio-codec=opus or --audio-codec=aac)");
+                return false;
+            }
+        } else if (opts->audio && opts->audio_codec == SC_CODEC_RAW) {
+            LOGE("Fragmented MP4 relay does not support RAW audio");
+            return false;
+        }
+    }
+
     if (opts->audio_codec == SC_CODEC_FLAC && opts->audio_bit_rate) {
         LOGW("--audio-bit-rate is ignored for FLAC audio codec");
     }
@@ -3245,6 +4125,31 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         }
     }
 
+    if (opts->input_replay_speed != 100 && !opts->input_replay_filename) {
+        LOGE("Input replay speed without input replay");
+        return false;
+    }
+
+    if (opts->metrics_interval != SC_METRICS_DEFAULT_INTERVAL
+            && opts->metrics_type != SC_METRICS_TYPE_JSON) {
+        LOGE("--metrics-interval requires --metrics=json:<path>");
+        return false;
+    }
+
+    if (opts->reconnect && !otg && opts->control) {
+        // The UHID devices are bound to the server, and the AOA devices to
+        // the USB connection: they would have to be recreated
+        if (opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_UHID
+                || opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_AOA
+                || opts->mouse_input_mode == SC_MOUSE_INPUT_MODE_UHID
+                || opts->mouse_input_mode == SC_MOUSE_INPUT_MODE_AOA
+                || opts->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_UHID
+                || opts->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_AOA) {
+            LOGE("--reconnect is not supported with UHID or AOA input modes");
+            return false;
+        }
+    }
+
     if (!opts->control) {
         if (opts->turn_screen_off) {
             LOGE("Cannot request to turn screen off if control is disabled");
@@ -3266,6 +4171,18 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGE("Cannot start an Android app if control is disabled");
             return false;
         }
+        if (opts->input_socket) {
+            LOGE("Cannot use an input socket if control is disabled");
+            return false;
+        }
+        if (opts->input_record_filename) {
+            LOGE("Cannot record input events if control is disabled");
+            return false;
+        }
+        if (opts->input_replay_filename) {
+            LOGE("Cannot replay input events if control is disabled");
+            return false;
+        }
     }
 
 # ifdef _WIN32
@@ -3315,6 +4232,105 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGE("OTG mode: could not sink to V4L2 device");
             return false;
         }
+        if (opts->input_socket) {
+            LOGE("OTG mode: could not use an input socket");
+            return false;
+        }
+        if (opts->input_record_filename || opts->input_replay_filename) {
+            LOGE("OTG mode: could not record or replay input events");
+            return false;
+        }
+        if (opts->reconnect) {
+            LOGE("OTG mode: could not reconnect");
+            return false;
+        }
+        if (opts->metrics_type != SC_METRICS_TYPE_NONE) {
+            LOGE("OTG mode: could not export metrics");
+            return false;
+        }
+        if (relay) {
+            LOGE("OTG mode: could not relay the stream");
+            return false;
+        }
+    }
+
+    if (opts->wall && !opts->serials) {
+        LOGE("--wall requires --serials");
+        return false;
+    }
+
+    if (opts->serials) {
+        // Multi-device mode only mirrors the devices (with SDK input)
+        if (otg) {
+            LOGE("Multi-device mode: incompatible with OTG mode");
+            return false;
+        }
+        if (opts->tcpip) {
+            LOGE("Multi-device mode: could not enable TCP/IP");
+            return false;
+        }
+        if (opts->list) {
+            LOGE("Multi-device mode: could not list device properties");
+            return false;
+        }
+        if (!opts->video_playback) {
+            LOGE("Multi-device mode: video playback is required");
+            return false;
+        }
+        if (opts->record_filename) {
+            LOGE("Multi-device mode: cannot record");
+            return false;
+        }
+        if (v4l2) {
+            LOGE("Multi-device mode: could not sink to V4L2 device");
+            return false;
+        }
+        if (opts->video_buffer) {
+            LOGE("Multi-device mode: could not buffer video");
+            return false;
+        }
+        if (opts->time_limit) {
+            LOGE("Multi-device mode: could not set a time limit");
+            return false;
+        }
+        if (opts->reconnect) {
+            LOGE("Multi-device mode: could not reconnect");
+            return false;
+        }
+        if (opts->start_app) {
+            LOGE("Multi-device mode: could not start an app");
+            return false;
+        }
+        if (opts->metrics_type != SC_METRICS_TYPE_NONE) {
+            LOGE("Multi-device mode: could not export metrics");
+            return false;
+        }
+        if (relay) {
+            LOGE("Multi-device mode: could not relay the stream");
+            return false;
+        }
+        if (opts->input_socket || opts->input_record_filename
+                || opts->input_replay_filename) {
+            LOGE("Multi-device mode: could not use an input socket, or record "
+                 "or replay input events");
+            return false;
+        }
+        if (opts->wall
+                && opts->display_orientation != SC_ORIENTATION_0) {
+            LOGE("Wall mode: could not set a display orientation");
+            return false;
+        }
+        if (opts->control
+                && (opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_UHID
+                || opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_AOA
+                || opts->mouse_input_mode == SC_MOUSE_INPUT_MODE_UHID
+                || opts->mouse_input_mode == SC_MOUSE_INPUT_MODE_AOA
+                || opts->gamepad_input_mode
+                    != SC_GAMEPAD_INPUT_MODE_DISABLED)) {
+            LOGE("Multi-device mode: only SDK keyboard and mouse input modes "
+                 "are supported");
+            return false;
+        }
     }
 
     return true;
@@ -1,38 +1,167 @@
 #include "clock.h"
 
 #include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
 
 #include "util/log.h"
 
 //#define SC_CLOCK_DEBUG // uncomment to debug
 
-#define SC_CLOCK_RANGE 32
+// Stream time span of a slot for drift estimation
+#define SC_CLOCK_SLOT_DURATION SC_TICK_FROM_SEC(1)
+
+// Minimal number of complete slots to estimate the drift
+#define SC_CLOCK_DRIFT_MIN_SLOTS 4
+
+// Maximal drift between the device clock and the computer clock (1000 ppm)
+#define SC_CLOCK_DRIFT_MAX 1e-3
+
+// Maximal rise rate of the estimation (10 ms per second of stream), so that
+// the release dates do not jump when the least delayed point leaves the
+// window or when the drift estimation changes
+#define SC_CLOCK_RISE_MAX_PPM 10000
 
 void
 sc_clock_init(struct sc_clock *clock) {
     clock->range = 0;
+    clock->head = 0;
+    clock->slot_count = 0;
+    clock->slot_head = 0;
+    clock->origin = 0;
     clock->offset = 0;
+    clock->drift = 0;
+}
+
+static inline sc_tick
+sc_clock_point_offset(const struct sc_clock_point *point) {
+    return point->system - point->stream;
+}
+
+static double
+sc_clock_estimate_drift(struct sc_clock *clock) {
+    unsigned n = clock->slot_count;
+    if (n < SC_CLOCK_DRIFT_MIN_SLOTS) {
+        // Not enough data to estimate the drift reliably
+        return 0;
+    }
+
+    // Least squares regression of the offset against the stream time,
+    // relative to the latest slot to keep the values small
+    unsigned latest = (clock->slot_head + SC_CLOCK_SLOTS - 1) % SC_CLOCK_SLOTS;
+    const struct sc_clock_point *ref = &clock->slots[latest];
+
+    double mean_x = 0;
+    double mean_y = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        const struct sc_clock_point *p = &clock->slots[i];
+        mean_x += p->stream - ref->stream;
+        mean_y += sc_clock_point_offset(p) - sc_clock_point_offset(ref);
+    }
+    mean_x /= n;
+    mean_y /= n;
+
+    double sxx = 0;
+    double sxy = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        const struct sc_clock_point *p = &clock->slots[i];
+        double dx = p->stream - ref->stream - mean_x;
+        double dy = sc_clock_point_offset(p) - sc_clock_point_offset(ref)
+                  - mean_y;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    if (sxx == 0) {
+        return 0;
+    }
+
+    double drift = sxy / sxx;
+    return CLAMP(drift, -SC_CLOCK_DRIFT_MAX, SC_CLOCK_DRIFT_MAX);
+}
+
+static void
+sc_clock_update_slots(struct sc_clock *clock, sc_tick system, sc_tick stream) {
+    struct sc_clock_point point = {
+        .system = system,
+        .stream = stream,
+    };
+
+    if (!clock->range) {
+        // First point
+        clock->slot_min = point;
+        clock->slot_end = stream + SC_CLOCK_SLOT_DURATION;
+        return;
+    }
+
+    if (stream < clock->slot_end) {
+        if (sc_clock_point_offset(&point)
+                < sc_clock_point_offset(&clock->slot_min)) {
+            clock->slot_min = point;
+        }
+        return;
+    }
+
+    // The current slot is complete
+    clock->slots[clock->slot_head] = clock->slot_min;
+    clock->slot_head = (clock->slot_head + 1) % SC_CLOCK_SLOTS;
+    if (clock->slot_count < SC_CLOCK_SLOTS) {
+        ++clock->slot_count;
+    }
+
+    clock->slot_min = point;
+    clock->slot_end = stream + SC_CLOCK_SLOT_DURATION;
+
+    clock->drift = sc_clock_estimate_drift(clock);
 }
 
 void
 sc_clock_update(struct sc_clock *clock, sc_tick system, sc_tick stream) {
-    if (clock->range < SC_CLOCK_RANGE) {
+    bool first = !clock->range;
+    sc_clock_update_slots(clock, system, stream);
+
+    clock->points[clock->head].system = system;
+    clock->points[clock->head].stream = stream;
+    clock->head = (clock->head + 1) % SC_CLOCK_WINDOW;
+    if (clock->range < SC_CLOCK_WINDOW) {
         ++clock->range;
     }
 
-    sc_tick offset = system - stream;
-    unsigned clock_weight = clock->range - 1;
-    unsigned value_weight = SC_CLOCK_RANGE - clock->range + 1;
-    clock->offset = (clock->offset * clock_weight + offset * value_weight)
-                  / SC_CLOCK_RANGE;
+    // Express the line relative to the latest point, to keep the values small
+    sc_tick origin = stream;
+
+    // Lower envelope: the line must not exceed any point in the window
+    sc_tick offset = 0;
+    for (unsigned i = 0; i < clock->range; ++i) {
+        const struct sc_clock_point *p = &clock->points[i];
+        sc_tick o = sc_clock_point_offset(p)
+                  - (sc_tick) (clock->drift * (p->stream - origin));
+        if (!i || o < offset) {
+            offset = o;
+        }
+    }
+
+    if (!first && stream > clock->origin) {
+        // A decrease is followed immediately (it is always safe to lower the
+        // envelope), but an increase is progressive
+        sc_tick elapsed = stream - clock->origin;
+        sc_tick prev = clock->offset + (sc_tick) (clock->drift * elapsed);
+        sc_tick max_rise = elapsed * SC_CLOCK_RISE_MAX_PPM / 1000000;
+        offset = MIN(offset, prev + max_rise);
+    }
+
+    clock->origin = origin;
+    clock->offset = offset;
 
 #ifdef SC_CLOCK_DEBUG
-    LOGD("Clock estimation: pts + %" PRItick, clock->offset);
+    LOGD("Clock estimation: pts + %" PRItick " (drift: %d ppm)",
+         clock->offset, (int) (clock->drift * 1000000));
 #endif
 }
 
 sc_tick
 sc_clock_to_system_time(struct sc_clock *clock, sc_tick stream) {
     assert(clock->range); // sc_clock_update() must have been called
-    return stream + clock->offset;
+    return stream + clock->offset
+                  + (sc_tick) (clock->drift * (stream - clock->origin));
 }
@@ -5,6 +5,9 @@
 
 #include "util/tick.h"
 
+#define SC_CLOCK_WINDOW 128
+#define SC_CLOCK_SLOTS 32
+
 struct sc_clock_point {
     sc_tick system;
     sc_tick stream;
@@ -16,19 +19,44 @@ struct sc_clock_point {
  *
  *     f(stream) = slope * stream + offset
  *
- * Theoretically, the slope encodes the drift between the device clock and the
- * computer clock. It is expected to be very close to 1.
+ * The slope encodes the drift between the device clock and the computer clock.
+ * It is expected to be very close to 1.
+ *
+ * The system time of each point is its arrival date, so it includes the
+ * transmission delay, which varies (jitter) and may be very large for some
+ * points (e.g. Wi-Fi bursts). Averaging the points would make the estimation
+ * lag or jump on such outliers.
  *
- * Since the clock is used to estimate very close points in the future (which
- * are reestimated on every clock update, see delay_buffer), the error caused
- * by clock drift is totally negligible, so it is better to assume that the
- * slope is 1 than to estimate it (the estimation error would be larger).
+ * Instead, the clock estimates the lower envelope of the points, i.e. the
+ * arrival dates of the frames transmitted with the minimal delay (the delayed
+ * points are rejected):
+ *  - the drift is estimated over a long period (tens of seconds), by a least
+ *    squares fit of the least delayed point of each second;
+ *  - the offset is the minimal offset (corrected by the drift) over the last
+ *    SC_CLOCK_WINDOW points, so that it quickly follows a change of the
+ *    minimal transmission delay (an increase is rate-limited, to avoid
+ *    jumps of the release dates).
  *
- * Therefore, only the offset is estimated.
+ * The drift is bounded, and assumed to be 0 until enough data is available.
  */
 struct sc_clock {
+    // number of points in the window
     unsigned range;
+    // ring buffer of the last points
+    struct sc_clock_point points[SC_CLOCK_WINDOW];
+    unsigned head;
+
+    // ring buffer of the least delayed point of each slot (1 second)
+    struct sc_clock_point slots[SC_CLOCK_SLOTS];
+    unsigned slot_count; // number of complete slots
+    unsigned slot_head;
+    sc_tick slot_end; // stream time at the end of the current slot
+    struct sc_clock_point slot_min; // least delayed point of the current slot
+
+    // f(stream) = stream + offset + drift * (stream - origin)
+    sc_tick origin;
     sc_tick offset;
+    double drift;
 };
 
 void
@@ -45,6 +45,14 @@
 # define SCRCPY_LAVF_HAS_AVFORMATCONTEXT_URL
 #endif
 
+// In ffmpeg/doc/APIchanges:
+// 2017-09-01 - lavf 57.80.100 - avio.h
+//   Add avio_context_free(). From now on it must be used for freeing
+//   AVIOContext.
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 80, 100)
+# define SCRCPY_LAVF_HAS_AVIO_CONTEXT_FREE
+#endif
+
 // Not documented in ffmpeg/doc/APIchanges, but the channel_layout API
 // has been replaced by chlayout in FFmpeg commit
 // f423497b455da06c1337846902c770028760e094.
@@ -61,6 +69,13 @@
 # define SCRCPY_LAVC_HAS_CODECPAR_CODEC_SIDEDATA
 #endif
 
+// Not documented in ffmpeg/doc/APIchanges, but the write_packet callback of
+// avio_alloc_context() takes a pointer-to-const buffer since lavf 61
+// (FF_API_AVIO_WRITE_NONCONST).
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+# define SCRCPY_LAVF_HAS_AVIO_WRITE_CONST
+#endif
+
 #if SDL_VERSION_ATLEAST(2, 0, 6)
 // <https://github.com/libsdl-org/SDL/commit/d7a318de563125e5bb465b1000d6bc9576fbc6fc>
 # define SCRCPY_SDL_HAS_HINT_TOUCH_MOUSE_EVENTS
@@ -192,6 +192,186 @@ sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf) {
     }
 }
 
+static void
+read_position(const uint8_t *buf, struct sc_position *position) {
+    position->point.x = (int32_t) sc_read32be(&buf[0]);
+    position->point.y = (int32_t) sc_read32be(&buf[4]);
+    position->screen_size.width = sc_read16be(&buf[8]);
+    position->screen_size.height = sc_read16be(&buf[10]);
+}
+
+static float
+u16fp_to_float(uint16_t u) {
+    // 0xffff is the representation of 1.0f
+    return u == 0xffff ? 1.0f : u / 0x1p16f;
+}
+
+static float
+i16fp_to_float(int16_t i) {
+    // 0x7fff is the representation of 1.0f
+    return i == 0x7fff ? 1.0f : i / 0x1p15f;
+}
+
+// Read a string of length len as an allocated null-terminated string
+static char *
+read_string(const uint8_t *buf, size_t len) {
+    char *s = malloc(len + 1);
+    if (!s) {
+        LOG_OOM();
+        return NULL;
+    }
+    memcpy(s, buf, len);
+    s[len] = '\0';
+    return s;
+}
+
+ssize_t
+sc_control_msg_deserialize(const uint8_t *buf, size_t len,
+                           struct sc_control_msg *msg) {
+    if (!len) {
+        return 0; // no message
+    }
+
+    msg->type = buf[0];
+    switch (msg->type) {
+        case SC_CONTROL_MSG_TYPE_INJECT_KEYCODE:
+            if (len < 14) {
+                return 0; // no complete message
+            }
+            msg->inject_keycode.action = buf[1];
+            msg->inject_keycode.keycode = sc_read32be(&buf[2]);
+            msg->inject_keycode.repeat = sc_read32be(&buf[6]);
+            msg->inject_keycode.metastate = sc_read32be(&buf[10]);
+            return 14;
+        case SC_CONTROL_MSG_TYPE_INJECT_TEXT: {
+            if (len < 5) {
+                return 0; // no complete message
+            }
+            size_t text_len = sc_read32be(&buf[1]);
+            if (text_len > len - 5) {
+                return 0; // no complete message
+            }
+            char *text = read_string(&buf[5], text_len);
+            if (!text) {
+                return -1;
+            }
+            msg->inject_text.text = text;
+            return 5 + text_len;
+        }
+        case SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT:
+            if (len < 32) {
+                return 0; // no complete message
+            }
+            msg->inject_touch_event.action = buf[1];
+            msg->inject_touch_event.pointer_id = sc_read64be(&buf[2]);
+            read_position(&buf[10], &msg->inject_touch_event.position);
+            msg->inject_touch_event.pressure =
+                u16fp_to_float(sc_read16be(&buf[22]));
+            msg->inject_touch_event.action_button = sc_read32be(&buf[24]);
+            msg->inject_touch_event.buttons = sc_read32be(&buf[28]);
+            return 32;
+        case SC_CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT:
+            if (len < 21) {
+                return 0; // no complete message
+            }
+            read_position(&buf[1], &msg->inject_scroll_event.position);
+            msg->inject_scroll_event.hscroll =
+                i16fp_to_float((int16_t) sc_read16be(&buf[13]));
+            msg->inject_scroll_event.vscroll =
+                i16fp_to_float((int16_t) sc_read16be(&buf[15]));
+            msg->inject_scroll_event.buttons = sc_read32be(&buf[17]);
+            return 21;
+        case SC_CONTROL_MSG_TYPE_BACK_OR_SCREEN_ON:
+            if (len < 2) {
+                return 0; // no complete message
+            }
+            msg->back_or_screen_on.action = buf[1];
+            return 2;
+        case SC_CONTROL_MSG_TYPE_GET_CLIPBOARD:
+            if (len < 2) {
+                return 0; // no complete message
+            }
+            msg->get_clipboard.copy_key = buf[1];
+            return 2;
+        case SC_CONTROL_MSG_TYPE_SET_CLIPBOARD: {
+            if (len < 14) {
+                return 0; // no complete message
+            }
+            size_t text_len = sc_read32be(&buf[10]);
+            if (text_len > len - 14) {
+                return 0; // no complete message
+            }
+            char *text = read_string(&buf[14], text_len);
+            if (!text) {
+                return -1;
+            }
+            msg->set_clipboard.sequence = sc_read64be(&buf[1]);
+            msg->set_clipboard.paste = buf[9];
+            msg->set_clipboard.text = text;
+            return 14 + text_len;
+        }
+        case SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER:
+            if (len < 2) {
+                return 0; // no complete message
+            }
+            msg->set_display_power.on = buf[1];
+            return 2;
+        case SC_CONTROL_MSG_TYPE_UHID_INPUT: {
+            if (len < 5) {
+                return 0; // no complete message
+            }
+            size_t size = sc_read16be(&buf[3]);
+            if (size > SC_HID_MAX_SIZE) {
+                LOGW("Invalid UHID input size: %zu", size);
+                return -1;
+            }
+            if (size > len - 5) {
+                return 0; // no complete message
+            }
+            msg->uhid_input.id = sc_read16be(&buf[1]);
+            msg->uhid_input.size = size;
+            memcpy(msg->uhid_input.data, &buf[5], size);
+            return 5 + size;
+        }
+        case SC_CONTROL_MSG_TYPE_UHID_DESTROY:
+            if (len < 3) {
+                return 0; // no complete message
+            }
+            msg->uhid_destroy.id = sc_read16be(&buf[1]);
+            return 3;
+        case SC_CONTROL_MSG_TYPE_START_APP: {
+            if (len < 2) {
+                return 0; // no complete message
+            }
+            size_t name_len = buf[1];
+            if (name_len > len - 2) {
+                return 0; // no complete message
+            }
+            char *name = read_string(&buf[2], name_len);
+            if (!name) {
+                return -1;
+            }
+            msg->start_app.name = name;
+            return 2 + name_len;
+        }
+        case SC_CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
+        case SC_CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
+        case SC_CONTROL_MSG_TYPE_COLLAPSE_PANELS:
+        case SC_CONTROL_MSG_TYPE_ROTATE_DEVICE:
+        case SC_CONTROL_MSG_TYPE_OPEN_HARD_KEYBOARD_SETTINGS:
+        case SC_CONTROL_MSG_TYPE_RESET_VIDEO:
+            // no additional data
+            return 1;
+        case SC_CONTROL_MSG_TYPE_UHID_CREATE:
+            // The name and the report descriptor must point to static data
+            LOGW("UHID create message cannot be deserialized");
+            return -1;
+        default:
+            LOGW("Unknown message type: %u", (unsigned) msg->type);
+            return -1;
+    }
+}
+
 void
 sc_control_msg_log(const struct sc_control_msg *msg) {
 #define LOG_CMSG(fmt, ...) LOGV("input: " fmt, ## __VA_ARGS__)
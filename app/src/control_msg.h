@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/types.h>
 
 #include "android/input.h"
 #include "android/keycodes.h"
@@ -119,6 +120,12 @@ struct sc_control_msg {
 size_t
 sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf);
 
+// Inverse of sc_control_msg_serialize() (UHID_CREATE is not supported)
+// return the number of bytes consumed (0 for no msg available, -1 on error)
+ssize_t
+sc_control_msg_deserialize(const uint8_t *buf, size_t len,
+                           struct sc_control_msg *msg);
+
 void
 sc_control_msg_log(const struct sc_control_msg *msg);
 
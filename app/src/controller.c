@@ -56,8 +56,21 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
         return false;
     }
 
+    ok = sc_cond_init(&controller->space_cond);
+    if (!ok) {
+        sc_receiver_destroy(&controller->receiver);
+        sc_cond_destroy(&controller->msg_cond);
+        sc_mutex_destroy(&controller->mutex);
+        sc_vecdeque_destroy(&controller->queue);
+        return false;
+    }
+
     controller->control_socket = control_socket;
     controller->stopped = false;
+    controller->input_recorder = NULL;
+
+    atomic_init(&controller->sent_msgs, 0);
+    atomic_init(&controller->dropped_msgs, 0);
 
     assert(cbs && cbs->on_ended);
     controller->cbs = cbs;
@@ -69,13 +82,16 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
 void
 sc_controller_configure(struct sc_controller *controller,
                         struct sc_acksync *acksync,
-                        struct sc_uhid_devices *uhid_devices) {
+                        struct sc_uhid_devices *uhid_devices,
+                        struct sc_input_recorder *input_recorder) {
     controller->receiver.acksync = acksync;
     controller->receiver.uhid_devices = uhid_devices;
+    controller->input_recorder = input_recorder;
 }
 
 void
 sc_controller_destroy(struct sc_controller *controller) {
+    sc_cond_destroy(&controller->space_cond);
     sc_cond_destroy(&controller->msg_cond);
     sc_mutex_destroy(&controller->mutex);
 
@@ -89,6 +105,23 @@ sc_controller_destroy(struct sc_controller *controller) {
     sc_receiver_destroy(&controller->receiver);
 }
 
+void
+sc_controller_reset(struct sc_controller *controller,
+                    sc_socket control_socket) {
+    sc_mutex_lock(&controller->mutex);
+    while (!sc_vecdeque_is_empty(&controller->queue)) {
+        struct sc_control_msg *msg = sc_vecdeque_popref(&controller->queue);
+        assert(msg);
+        sc_control_msg_destroy(msg);
+    }
+    controller->control_socket = control_socket;
+    controller->stopped = false;
+    sc_mutex_unlock(&controller->mutex);
+
+    // The receiver thread is joined
+    controller->receiver.control_socket = control_socket;
+}
+
 bool
 sc_controller_push_msg(struct sc_controller *controller,
                        const struct sc_control_msg *msg) {
@@ -120,9 +153,43 @@ sc_controller_push_msg(struct sc_controller *controller,
 
     sc_mutex_unlock(&controller->mutex);
 
+    if (!pushed) {
+        atomic_fetch_add_explicit(&controller->dropped_msgs, 1,
+                                  memory_order_relaxed);
+    }
+
     return pushed;
 }
 
+bool
+sc_controller_push_msg_blocking(struct sc_controller *controller,
+                                const struct sc_control_msg *msg) {
+    if (sc_get_log_level() <= SC_LOG_LEVEL_VERBOSE) {
+        sc_control_msg_log(msg);
+    }
+
+    sc_mutex_lock(&controller->mutex);
+    while (!controller->stopped
+            && sc_vecdeque_size(&controller->queue)
+                >= SC_CONTROL_MSG_QUEUE_LIMIT) {
+        sc_cond_wait(&controller->space_cond, &controller->mutex);
+    }
+
+    if (controller->stopped) {
+        sc_mutex_unlock(&controller->mutex);
+        return false;
+    }
+
+    bool was_empty = sc_vecdeque_is_empty(&controller->queue);
+    sc_vecdeque_push_noresize(&controller->queue, *msg);
+    if (was_empty) {
+        sc_cond_signal(&controller->msg_cond);
+    }
+    sc_mutex_unlock(&controller->mutex);
+
+    return true;
+}
+
 static bool
 process_msg(struct sc_controller *controller,
             const struct sc_control_msg *msg, bool *eos) {
@@ -133,6 +200,11 @@ process_msg(struct sc_controller *controller,
         return false;
     }
 
+    if (controller->input_recorder) {
+        sc_input_recorder_write(controller->input_recorder, sc_tick_now(),
+                                serialized_msg, length);
+    }
+
     ssize_t w =
         net_send_all(controller->control_socket, serialized_msg, length);
     if ((size_t) w != length) {
@@ -140,6 +212,8 @@ process_msg(struct sc_controller *controller,
         return false;
     }
 
+    atomic_fetch_add_explicit(&controller->sent_msgs, 1, memory_order_relaxed);
+
     return true;
 }
 
@@ -163,7 +237,12 @@ run_controller(void *data) {
         }
 
         assert(!sc_vecdeque_is_empty(&controller->queue));
+        size_t size = sc_vecdeque_size(&controller->queue);
         struct sc_control_msg msg = sc_vecdeque_pop(&controller->queue);
+        if (size == SC_CONTROL_MSG_QUEUE_LIMIT) {
+            // A blocking push may be waiting for space
+            sc_cond_signal(&controller->space_cond);
+        }
         sc_mutex_unlock(&controller->mutex);
 
         bool eos;
@@ -178,6 +257,12 @@ run_controller(void *data) {
         }
     }
 
+    // Do not let a blocking push wait forever
+    sc_mutex_lock(&controller->mutex);
+    controller->stopped = true;
+    sc_cond_broadcast(&controller->space_cond);
+    sc_mutex_unlock(&controller->mutex);
+
     controller->cbs->on_ended(controller, error, controller->cbs_userdata);
 
     return 0;
@@ -208,6 +293,7 @@ sc_controller_stop(struct sc_controller *controller) {
     sc_mutex_lock(&controller->mutex);
     controller->stopped = true;
     sc_cond_signal(&controller->msg_cond);
+    sc_cond_broadcast(&controller->space_cond);
     sc_mutex_unlock(&controller->mutex);
 }
 
@@ -216,3 +302,16 @@ sc_controller_join(struct sc_controller *controller) {
     sc_thread_join(&controller->thread, NULL);
     sc_receiver_join(&controller->receiver);
 }
+
+void
+sc_controller_get_stats(struct sc_controller *controller,
+                        struct sc_controller_stats *stats) {
+    sc_mutex_lock(&controller->mutex);
+    stats->queued = sc_vecdeque_size(&controller->queue);
+    sc_mutex_unlock(&controller->mutex);
+
+    stats->sent = atomic_load_explicit(&controller->sent_msgs,
+                                       memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&controller->dropped_msgs,
+                                          memory_order_relaxed);
+}
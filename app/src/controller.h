@@ -3,9 +3,13 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "control_msg.h"
+#include "input_record.h"
 #include "receiver.h"
 #include "util/acksync.h"
 #include "util/net.h"
@@ -19,14 +23,28 @@ struct sc_controller {
     sc_thread thread;
     sc_mutex mutex;
     sc_cond msg_cond;
+    // signaled when the queue is no longer full (for blocking pushes)
+    sc_cond space_cond;
     bool stopped;
     struct sc_control_msg_queue queue;
     struct sc_receiver receiver;
+    // if set, record all the messages sent to the device
+    struct sc_input_recorder *input_recorder;
+
+    atomic_uint_least32_t sent_msgs;
+    // messages discarded (queue full or out of memory)
+    atomic_uint_least32_t dropped_msgs;
 
     const struct sc_controller_callbacks *cbs;
     void *cbs_userdata;
 };
 
+struct sc_controller_stats {
+    size_t queued;
+    uint32_t sent;
+    uint32_t dropped;
+};
+
 struct sc_controller_callbacks {
     void (*on_ended)(struct sc_controller *controller, bool error,
                      void *userdata);
@@ -40,11 +58,22 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
 void
 sc_controller_configure(struct sc_controller *controller,
                         struct sc_acksync *acksync,
-                        struct sc_uhid_devices *uhid_devices);
+                        struct sc_uhid_devices *uhid_devices,
+                        struct sc_input_recorder *input_recorder);
 
 void
 sc_controller_destroy(struct sc_controller *controller);
 
+/**
+ * Reset the controller on a new control socket (on reconnection)
+ *
+ * Must be called once the controller is joined. The messages pushed while
+ * disconnected are discarded.
+ */
+void
+sc_controller_reset(struct sc_controller *controller,
+                    sc_socket control_socket);
+
 bool
 sc_controller_start(struct sc_controller *controller);
 
@@ -58,4 +87,22 @@ bool
 sc_controller_push_msg(struct sc_controller *controller,
                        const struct sc_control_msg *msg);
 
+/**
+ * Push a message, waiting for space in the queue if it is full, rather than
+ * dropping it
+ *
+ * Return false if the controller is stopped (the message is not pushed).
+ */
+bool
+sc_controller_push_msg_blocking(struct sc_controller *controller,
+                                const struct sc_control_msg *msg);
+
+/**
+ * Get the number of messages waiting to be sent to the device, and the number
+ * of messages sent and dropped so far (may be called from any thread)
+ */
+void
+sc_controller_get_stats(struct sc_controller *controller,
+                        struct sc_controller_stats *stats);
+
 #endif
@@ -13,6 +13,11 @@ struct sc_point {
     int32_t y;
 };
 
+struct sc_rect {
+    struct sc_point point; // top-left corner
+    struct sc_size size;
+};
+
 struct sc_position {
     // The video screen size may be different from the real device screen size,
     // so store to which size the absolute position apply, to scale it
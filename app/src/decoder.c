@@ -1,5 +1,6 @@
 #include "decoder.h"
 
+#include <assert.h>
 #include <errno.h>
 #include <libavcodec/packet.h>
 #include <libavutil/avutil.h>
@@ -9,6 +10,13 @@
 /** Downcast packet_sink to decoder */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_decoder, packet_sink)
 
+// Encode a mode and its lowres level in a single (atomic) value
+#define SC_DECODER_MODE(MODE, LEVEL) \
+    ((unsigned) (MODE) | (unsigned) (LEVEL) << 8)
+#define SC_DECODER_MODE_GET(VALUE) \
+    ((enum sc_video_decode_mode) ((VALUE) & 0xFF))
+#define SC_DECODER_MODE_GET_LEVEL(VALUE) ((uint8_t) ((VALUE) >> 8))
+
 static bool
 sc_decoder_open(struct sc_decoder *decoder, AVCodecContext *ctx) {
     decoder->frame = av_frame_alloc();
@@ -23,6 +31,9 @@ sc_decoder_open(struct sc_decoder *decoder, AVCodecContext *ctx) {
     }
 
     decoder->ctx = ctx;
+    // The mode requested is applied on the first packet
+    decoder->mode = SC_DECODER_MODE(SC_VIDEO_DECODE_MODE_FULL, 0);
+    decoder->wait_key_frame = false;
 
     return true;
 }
@@ -33,6 +44,76 @@ sc_decoder_close(struct sc_decoder *decoder) {
     av_frame_free(&decoder->frame);
 }
 
+static const char *
+sc_decoder_get_mode_name(enum sc_video_decode_mode mode) {
+    switch (mode) {
+        case SC_VIDEO_DECODE_MODE_LOWRES:
+            return "lowres";
+        case SC_VIDEO_DECODE_MODE_KEYFRAMES:
+            return "keyframes";
+        default:
+            assert(mode == SC_VIDEO_DECODE_MODE_FULL);
+            return "full";
+    }
+}
+
+static void
+sc_decoder_apply_mode(struct sc_decoder *decoder) {
+    unsigned requested = atomic_load_explicit(&decoder->requested_mode,
+                                              memory_order_relaxed);
+    if (requested == decoder->mode) {
+        return;
+    }
+
+    enum sc_video_decode_mode mode = SC_DECODER_MODE_GET(requested);
+    uint8_t level = SC_DECODER_MODE_GET_LEVEL(requested);
+    enum sc_video_decode_mode old_mode = SC_DECODER_MODE_GET(decoder->mode);
+
+    // These fields may be changed between packets
+    AVCodecContext *ctx = decoder->ctx;
+    ctx->skip_frame = AVDISCARD_DEFAULT;
+    ctx->skip_loop_filter = AVDISCARD_DEFAULT;
+    ctx->flags2 &= ~AV_CODEC_FLAG2_FAST;
+
+    if (mode == SC_VIDEO_DECODE_MODE_KEYFRAMES) {
+        ctx->skip_frame = AVDISCARD_NONKEY;
+    } else if (mode == SC_VIDEO_DECODE_MODE_LOWRES) {
+        assert(level >= 1 && level <= SC_VIDEO_DECODE_LOWRES_MAX_LEVEL);
+        ctx->skip_loop_filter = level >= 2 ? AVDISCARD_ALL : AVDISCARD_NONKEY;
+        if (level >= 3) {
+            ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+        }
+    }
+
+    if (old_mode == SC_VIDEO_DECODE_MODE_KEYFRAMES
+            && mode != SC_VIDEO_DECODE_MODE_KEYFRAMES) {
+        decoder->wait_key_frame = true;
+    }
+
+    if (mode == SC_VIDEO_DECODE_MODE_LOWRES) {
+        LOGD("Decoder '%s': lowres decoding (level %u)", decoder->name,
+             (unsigned) level);
+    } else {
+        LOGD("Decoder '%s': %s decoding", decoder->name,
+             sc_decoder_get_mode_name(mode));
+    }
+
+    decoder->mode = requested;
+}
+
+static void
+sc_decoder_record_packet_date(struct sc_decoder *decoder, int64_t pts,
+                              sc_tick date) {
+    unsigned i = decoder->packet_dates_index++ % SC_DECODER_PACKET_DATES;
+
+    // Invalidate the entry while the date is written, so that a concurrent
+    // reader never associates a date to the wrong PTS (the atomics are
+    // sequentially consistent)
+    atomic_store(&decoder->packet_dates[i].pts, AV_NOPTS_VALUE);
+    atomic_store(&decoder->packet_dates[i].date, date);
+    atomic_store(&decoder->packet_dates[i].pts, pts);
+}
+
 static bool
 sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
     bool is_config = packet->pts == AV_NOPTS_VALUE;
@@ -41,15 +122,35 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         return true;
     }
 
+    sc_decoder_apply_mode(decoder);
+
+    if (packet->flags & AV_PKT_FLAG_KEY) {
+        decoder->wait_key_frame = false;
+    } else if (decoder->wait_key_frame
+            || SC_DECODER_MODE_GET(decoder->mode)
+                    == SC_VIDEO_DECODE_MODE_KEYFRAMES) {
+        // Do not even parse the packet
+        return true;
+    }
+
+    sc_tick start = sc_tick_now();
+    sc_decoder_record_packet_date(decoder, packet->pts, start);
+
     int ret = avcodec_send_packet(decoder->ctx, packet);
+    // Time spent in the decoder, not yet reported
+    sc_tick decode_time = sc_tick_now() - start;
     if (ret < 0 && ret != AVERROR(EAGAIN)) {
         LOGE("Decoder '%s': could not send video packet: %d",
              decoder->name, ret);
+        atomic_fetch_add_explicit(&decoder->decode_errors, 1,
+                                  memory_order_relaxed);
         return false;
     }
 
     for (;;) {
+        start = sc_tick_now();
         ret = avcodec_receive_frame(decoder->ctx, decoder->frame);
+        decode_time += sc_tick_now() - start;
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break;
         }
@@ -57,10 +158,18 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         if (ret) {
             LOGE("Decoder '%s', could not receive video frame: %d",
                  decoder->name, ret);
+            atomic_fetch_add_explicit(&decoder->decode_errors, 1,
+                                      memory_order_relaxed);
             return false;
         }
 
         // a frame was received
+        atomic_fetch_add_explicit(&decoder->decode_time, decode_time,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&decoder->decoded_frames, 1,
+                                  memory_order_relaxed);
+        decode_time = 0;
+
         bool ok = sc_frame_source_sinks_push(&decoder->frame_source,
                                              decoder->frame);
         av_frame_unref(decoder->frame);
@@ -70,6 +179,9 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         }
     }
 
+    atomic_fetch_add_explicit(&decoder->decode_time, decode_time,
+                              memory_order_relaxed);
+
     return true;
 }
 
@@ -104,4 +216,59 @@ sc_decoder_init(struct sc_decoder *decoder, const char *name) {
     };
 
     decoder->packet_sink.ops = &ops;
+
+    atomic_init(&decoder->requested_mode,
+                SC_DECODER_MODE(SC_VIDEO_DECODE_MODE_FULL, 0));
+
+    atomic_init(&decoder->decoded_frames, 0);
+    atomic_init(&decoder->decode_time, 0);
+    atomic_init(&decoder->decode_errors, 0);
+
+    for (unsigned i = 0; i < SC_DECODER_PACKET_DATES; ++i) {
+        atomic_init(&decoder->packet_dates[i].pts, AV_NOPTS_VALUE);
+        atomic_init(&decoder->packet_dates[i].date, 0);
+    }
+    decoder->packet_dates_index = 0;
+}
+
+void
+sc_decoder_set_mode(struct sc_decoder *decoder,
+                    enum sc_video_decode_mode mode, uint8_t lowres_level) {
+    if (mode != SC_VIDEO_DECODE_MODE_LOWRES) {
+        // The level is meaningless, so that the modes compare equal
+        lowres_level = 0;
+    }
+
+    atomic_store_explicit(&decoder->requested_mode,
+                          SC_DECODER_MODE(mode, lowres_level),
+                          memory_order_relaxed);
+}
+
+void
+sc_decoder_get_stats(struct sc_decoder *decoder,
+                     struct sc_decoder_stats *stats) {
+    stats->frames = atomic_load_explicit(&decoder->decoded_frames,
+                                         memory_order_relaxed);
+    stats->decode_time = atomic_load_explicit(&decoder->decode_time,
+                                              memory_order_relaxed);
+    stats->errors = atomic_load_explicit(&decoder->decode_errors,
+                                         memory_order_relaxed);
+}
+
+sc_tick
+sc_decoder_get_packet_date(struct sc_decoder *decoder, int64_t pts) {
+    assert(pts != AV_NOPTS_VALUE);
+
+    for (unsigned i = 0; i < SC_DECODER_PACKET_DATES; ++i) {
+        if (atomic_load(&decoder->packet_dates[i].pts) == pts) {
+            sc_tick date = atomic_load(&decoder->packet_dates[i].date);
+            // The entry may have been overwritten meanwhile
+            if (atomic_load(&decoder->packet_dates[i].pts) != pts) {
+                return -1;
+            }
+            return date;
+        }
+    }
+
+    return -1;
 }
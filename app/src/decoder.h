@@ -3,10 +3,18 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <libavcodec/avcodec.h>
 
+#include "options.h"
 #include "trait/frame_source.h"
 #include "trait/packet_sink.h"
+#include "util/tick.h"
+
+// Number of packet reception dates kept to measure the latency of the frames
+#define SC_DECODER_PACKET_DATES 32
 
 struct sc_decoder {
     struct sc_packet_sink packet_sink; // packet sink trait
@@ -16,10 +24,79 @@ struct sc_decoder {
 
     AVCodecContext *ctx;
     AVFrame *frame;
+
+    // The mode requested by sc_decoder_set_mode() (from any thread), encoded
+    // with its lowres level, applied by the decoding thread before the next
+    // packet
+    atomic_uint requested_mode;
+
+    // accessed only from the decoding thread
+    unsigned mode;
+    // the key frames were the only frames decoded, the next frames must be
+    // dropped until the next key frame (their references are missing)
+    bool wait_key_frame;
+
+    // Statistics, written by the decoding thread, may be read from any thread
+    atomic_uint_least32_t decoded_frames;
+    atomic_uint_least64_t decode_time; // total time spent in the decoder
+    atomic_uint_least32_t decode_errors;
+
+    // Reception date of the last packets, indexed by PTS (see
+    // sc_decoder_get_packet_date())
+    struct {
+        atomic_int_least64_t pts;
+        atomic_int_least64_t date;
+    } packet_dates[SC_DECODER_PACKET_DATES];
+    unsigned packet_dates_index; // accessed only from the decoding thread
+};
+
+struct sc_decoder_stats {
+    uint32_t frames;
+    sc_tick decode_time;
+    uint32_t errors;
 };
 
 // The name must be statically allocated (e.g. a string literal)
 void
 sc_decoder_init(struct sc_decoder *decoder, const char *name);
 
+/**
+ * Change the decoding mode (video only), for the next packets
+ *
+ * SC_VIDEO_DECODE_MODE_KEYFRAMES drops the packets which are not key frames,
+ * so the decoding cost depends only on the key frame interval.
+ *
+ * SC_VIDEO_DECODE_MODE_LOWRES decodes all the frames, but skips some work,
+ * with visible artifacts, according to the level (from 1 to
+ * SC_VIDEO_DECODE_LOWRES_MAX_LEVEL):
+ *  1. skip the deblocking filter except for key frames;
+ *  2. skip the deblocking filter for all frames;
+ *  3. also enable the non-spec-compliant speedups of the decoder.
+ *
+ * This function may be called from any thread.
+ */
+void
+sc_decoder_set_mode(struct sc_decoder *decoder,
+                    enum sc_video_decode_mode mode, uint8_t lowres_level);
+
+/**
+ * Get the number of frames decoded, the total time spent to decode them and
+ * the number of decoding errors (may be called from any thread)
+ */
+void
+sc_decoder_get_stats(struct sc_decoder *decoder,
+                     struct sc_decoder_stats *stats);
+
+/**
+ * Get the date when the packet having the given PTS has been received by the
+ * decoder (i.e. just after demuxing), or -1 if it is not known anymore
+ *
+ * Only the dates of the last SC_DECODER_PACKET_DATES packets are kept, this is
+ * intended to measure the latency of the frames just presented.
+ *
+ * This function may be called from any thread.
+ */
+sc_tick
+sc_decoder_get_packet_date(struct sc_decoder *decoder, int64_t pts);
+
 #endif
@@ -1,6 +1,8 @@
 #include "delay_buffer.h"
 
 #include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <libavcodec/avcodec.h>
 
@@ -9,225 +11,455 @@
 /** Downcast frame_sink to sc_delay_buffer */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_delay_buffer, frame_sink)
 
-static bool
-sc_delayed_frame_init(struct sc_delayed_frame *dframe, const AVFrame *frame) {
-    dframe->frame = av_frame_alloc();
-    if (!dframe->frame) {
-        LOG_OOM();
-        return false;
+#define SC_DELAY_BUFFER_UNSCHEDULED SIZE_MAX
+
+#define SC_DELAY_BUFFER_REPORT_INTERVAL SC_TICK_FROM_SEC(10)
+
+static AVFrame *
+sc_delay_buffer_take_frame(struct sc_delay_buffer *db) {
+    if (db->pool.size) {
+        return db->pool.data[--db->pool.size];
     }
 
-    if (av_frame_ref(dframe->frame, frame)) {
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
         LOG_OOM();
+        return NULL;
+    }
+
+    return frame;
+}
+
+static void
+sc_delay_buffer_recycle_frame(struct sc_delay_buffer *db, AVFrame *frame) {
+    // The frame must already be unreferenced
+    bool ok = sc_vector_push(&db->pool, frame);
+    if (!ok) {
+        // Not fatal, the frame just cannot be reused
+        av_frame_free(&frame);
+    }
+}
+
+static void
+sc_delay_buffer_clear(struct sc_delay_buffer *db) {
+    while (!sc_vecdeque_is_empty(&db->queue)) {
+        struct sc_delayed_frame *dframe = sc_vecdeque_popref(&db->queue);
+        av_frame_unref(dframe->frame);
         av_frame_free(&dframe->frame);
-        return false;
+    }
+    sc_vecdeque_destroy(&db->queue);
+
+    for (size_t i = 0; i < db->pool.size; ++i) {
+        av_frame_free(&db->pool.data[i]);
+    }
+    sc_vector_destroy(&db->pool);
+}
+
+static inline bool
+sc_delay_scheduler_heap_less(struct sc_delay_scheduler *ds, size_t i,
+                             size_t j) {
+    return ds->heap.data[i]->deadline < ds->heap.data[j]->deadline;
+}
+
+static void
+sc_delay_scheduler_heap_swap(struct sc_delay_scheduler *ds, size_t i,
+                             size_t j) {
+    struct sc_delay_buffer *tmp = ds->heap.data[i];
+    ds->heap.data[i] = ds->heap.data[j];
+    ds->heap.data[j] = tmp;
+    ds->heap.data[i]->heap_index = i;
+    ds->heap.data[j]->heap_index = j;
+}
+
+static void
+sc_delay_scheduler_heap_sift_up(struct sc_delay_scheduler *ds, size_t i) {
+    while (i) {
+        size_t parent = (i - 1) / 2;
+        if (!sc_delay_scheduler_heap_less(ds, i, parent)) {
+            break;
+        }
+        sc_delay_scheduler_heap_swap(ds, i, parent);
+        i = parent;
+    }
+}
+
+static void
+sc_delay_scheduler_heap_sift_down(struct sc_delay_scheduler *ds, size_t i) {
+    for (;;) {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t min = i;
+        if (left < ds->heap.size
+                && sc_delay_scheduler_heap_less(ds, left, min)) {
+            min = left;
+        }
+        if (right < ds->heap.size
+                && sc_delay_scheduler_heap_less(ds, right, min)) {
+            min = right;
+        }
+        if (min == i) {
+            break;
+        }
+        sc_delay_scheduler_heap_swap(ds, i, min);
+        i = min;
+    }
+}
+
+static void
+sc_delay_scheduler_unschedule(struct sc_delay_scheduler *ds,
+                              struct sc_delay_buffer *db) {
+    sc_mutex_assert(&ds->mutex);
+
+    size_t i = db->heap_index;
+    if (i == SC_DELAY_BUFFER_UNSCHEDULED) {
+        return;
+    }
+
+    assert(i < ds->heap.size && ds->heap.data[i] == db);
+    size_t last = ds->heap.size - 1;
+    if (i != last) {
+        sc_delay_scheduler_heap_swap(ds, i, last);
+    }
+    --ds->heap.size;
+    db->heap_index = SC_DELAY_BUFFER_UNSCHEDULED;
+
+    if (i != last) {
+        sc_delay_scheduler_heap_sift_up(ds, i);
+        sc_delay_scheduler_heap_sift_down(ds, ds->heap.data[i]->heap_index);
+    }
+}
+
+/**
+ * Recompute the deadline of the head frame of a delay buffer, and update its
+ * position in the heap accordingly
+ */
+static bool
+sc_delay_scheduler_reschedule(struct sc_delay_scheduler *ds,
+                              struct sc_delay_buffer *db) {
+    sc_mutex_assert(&ds->mutex);
+
+    if (sc_vecdeque_is_empty(&db->queue)) {
+        sc_delay_scheduler_unschedule(ds, db);
+        return true;
+    }
+
+    struct sc_delayed_frame *head = sc_vecdeque_peekref(&db->queue);
+    // PTS (written by the server) are expressed in microseconds
+    sc_tick pts = SC_TICK_FROM_US(head->frame->pts);
+    sc_tick deadline = sc_clock_to_system_time(&db->clock, pts) + db->delay
+                     + db->av_sync_delay;
+    if (deadline > db->max_deadline) {
+        deadline = db->max_deadline;
+    }
+    db->deadline = deadline;
+
+    if (db->heap_index == SC_DELAY_BUFFER_UNSCHEDULED) {
+        bool ok = sc_vector_push(&ds->heap, db);
+        if (!ok) {
+            LOG_OOM();
+            return false;
+        }
+        db->heap_index = ds->heap.size - 1;
+    }
+
+    sc_delay_scheduler_heap_sift_up(ds, db->heap_index);
+    sc_delay_scheduler_heap_sift_down(ds, db->heap_index);
+
+    if (db->heap_index == 0) {
+        // The earliest deadline may have changed
+        sc_cond_signal(&ds->cond);
     }
 
     return true;
 }
 
 static void
-sc_delayed_frame_destroy(struct sc_delayed_frame *dframe) {
-    av_frame_unref(dframe->frame);
-    av_frame_free(&dframe->frame);
+sc_delay_buffer_stop(struct sc_delay_buffer *db) {
+    struct sc_delay_scheduler *ds = db->scheduler;
+    sc_mutex_assert(&ds->mutex);
+
+    // Prevent to push any new frame
+    db->stopped = true;
+    sc_delay_scheduler_unschedule(ds, db);
 }
 
 static int
-run_buffering(void *data) {
-    struct sc_delay_buffer *db = data;
+run_delay_scheduler(void *data) {
+    struct sc_delay_scheduler *ds = data;
 
-    assert(db->delay > 0);
+    sc_mutex_lock(&ds->mutex);
 
     for (;;) {
-        sc_mutex_lock(&db->mutex);
+        while (!ds->stopped && !ds->heap.size) {
+            sc_cond_wait(&ds->cond, &ds->mutex);
+        }
 
-        while (!db->stopped && sc_vecdeque_is_empty(&db->queue)) {
-            sc_cond_wait(&db->queue_cond, &db->mutex);
+        if (ds->stopped) {
+            break;
         }
 
-        if (db->stopped) {
-            sc_mutex_unlock(&db->mutex);
-            goto stopped;
+        struct sc_delay_buffer *db = ds->heap.data[0];
+        if (sc_tick_now() < db->deadline) {
+            sc_cond_timedwait(&ds->cond, &ds->mutex, db->deadline);
+            // The heap may have changed in the meantime, re-evaluate
+            continue;
         }
 
         struct sc_delayed_frame dframe = sc_vecdeque_pop(&db->queue);
 
-        sc_tick max_deadline = sc_tick_now() + db->delay;
-        // PTS (written by the server) are expressed in microseconds
-        sc_tick pts = SC_TICK_FROM_US(dframe.frame->pts);
-
-        bool timed_out = false;
-        while (!db->stopped && !timed_out) {
-            sc_tick deadline = sc_clock_to_system_time(&db->clock, pts)
-                             + db->delay;
-            if (deadline > max_deadline) {
-                deadline = max_deadline;
-            }
-
-            timed_out =
-                !sc_cond_timedwait(&db->wait_cond, &db->mutex, deadline);
+        // The next frame becomes the head
+        db->max_deadline = sc_tick_now() + db->delay + db->av_sync_delay;
+        if (!sc_delay_scheduler_reschedule(ds, db)) {
+            sc_delay_buffer_stop(db);
         }
 
-        bool stopped = db->stopped;
-        sc_mutex_unlock(&db->mutex);
-
-        if (stopped) {
-            sc_delayed_frame_destroy(&dframe);
-            goto stopped;
-        }
+        // The sinks are called outside the lock, but the delay buffer may not
+        // be closed in the meantime
+        ds->current = db;
+        sc_mutex_unlock(&ds->mutex);
 
 #ifdef SC_BUFFERING_DEBUG
         LOGD("Buffering: %" PRItick ";%" PRItick ";%" PRItick,
-             pts, dframe.push_date, sc_tick_now());
+             SC_TICK_FROM_US(dframe.frame->pts), dframe.push_date,
+             sc_tick_now());
 #endif
 
         bool ok = sc_frame_source_sinks_push(&db->frame_source, dframe.frame);
-        sc_delayed_frame_destroy(&dframe);
+        av_frame_unref(dframe.frame);
+
+        sc_mutex_lock(&ds->mutex);
+        sc_delay_buffer_recycle_frame(db, dframe.frame);
+        ds->current = NULL;
+        sc_cond_broadcast(&ds->release_cond);
+
         if (!ok) {
             LOGE("Delayed frame could not be pushed, stopping");
-            sc_mutex_lock(&db->mutex);
-            // Prevent to push any new frame
-            db->stopped = true;
-            sc_mutex_unlock(&db->mutex);
-            goto stopped;
+            sc_delay_buffer_stop(db);
         }
     }
 
-stopped:
-    assert(db->stopped);
-
-    // Flush queue
-    while (!sc_vecdeque_is_empty(&db->queue)) {
-        struct sc_delayed_frame *dframe = sc_vecdeque_popref(&db->queue);
-        sc_delayed_frame_destroy(dframe);
-    }
+    sc_mutex_unlock(&ds->mutex);
 
-    LOGD("Buffering thread ended");
+    LOGD("Delay scheduler thread ended");
 
     return 0;
 }
 
-static bool
-sc_delay_buffer_frame_sink_open(struct sc_frame_sink *sink,
-                                const AVCodecContext *ctx) {
-    struct sc_delay_buffer *db = DOWNCAST(sink);
-    (void) ctx;
-
-    bool ok = sc_mutex_init(&db->mutex);
+bool
+sc_delay_scheduler_init(struct sc_delay_scheduler *ds) {
+    bool ok = sc_mutex_init(&ds->mutex);
     if (!ok) {
         return false;
     }
 
-    ok = sc_cond_init(&db->queue_cond);
+    ok = sc_cond_init(&ds->cond);
     if (!ok) {
         goto error_destroy_mutex;
     }
 
-    ok = sc_cond_init(&db->wait_cond);
+    ok = sc_cond_init(&ds->release_cond);
     if (!ok) {
-        goto error_destroy_queue_cond;
+        goto error_destroy_cond;
     }
 
-    sc_clock_init(&db->clock);
-    sc_vecdeque_init(&db->queue);
-    db->stopped = false;
+    sc_vector_init(&ds->heap);
+    ds->current = NULL;
+    ds->stopped = false;
 
-    if (!sc_frame_source_sinks_open(&db->frame_source, ctx)) {
-        goto error_destroy_wait_cond;
-    }
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&ds->cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&ds->mutex);
+
+    return false;
+}
+
+void
+sc_delay_scheduler_destroy(struct sc_delay_scheduler *ds) {
+    // All the delay buffers must have been closed
+    assert(!ds->heap.size);
+    sc_vector_destroy(&ds->heap);
+    sc_cond_destroy(&ds->release_cond);
+    sc_cond_destroy(&ds->cond);
+    sc_mutex_destroy(&ds->mutex);
+}
+
+bool
+sc_delay_scheduler_start(struct sc_delay_scheduler *ds) {
+    LOGD("Starting delay scheduler thread");
 
-    ok = sc_thread_create(&db->thread, run_buffering, "scrcpy-dbuf", db);
+    bool ok = sc_thread_create(&ds->thread, run_delay_scheduler,
+                               "scrcpy-dbuf", ds);
     if (!ok) {
-        LOGE("Could not start buffering thread");
-        goto error_close_sinks;
+        LOGE("Could not start delay scheduler thread");
+        return false;
     }
 
     return true;
+}
 
-error_close_sinks:
-    sc_frame_source_sinks_close(&db->frame_source);
-error_destroy_wait_cond:
-    sc_cond_destroy(&db->wait_cond);
-error_destroy_queue_cond:
-    sc_cond_destroy(&db->queue_cond);
-error_destroy_mutex:
-    sc_mutex_destroy(&db->mutex);
+void
+sc_delay_scheduler_stop(struct sc_delay_scheduler *ds) {
+    sc_mutex_lock(&ds->mutex);
+    ds->stopped = true;
+    sc_cond_signal(&ds->cond);
+    sc_mutex_unlock(&ds->mutex);
+}
 
-    return false;
+void
+sc_delay_scheduler_join(struct sc_delay_scheduler *ds) {
+    sc_thread_join(&ds->thread, NULL);
+}
+
+static bool
+sc_delay_buffer_frame_sink_open(struct sc_frame_sink *sink,
+                                const AVCodecContext *ctx) {
+    struct sc_delay_buffer *db = DOWNCAST(sink);
+
+    if (db->adaptive) {
+        sc_adaptive_delay_init(&db->adaptive_delay, db->max_delay);
+        db->delay = 0;
+    } else {
+        db->delay = db->max_delay;
+    }
+    db->av_sync_delay = 0;
+    db->late_frames = 0;
+    db->next_report = sc_tick_now() + SC_DELAY_BUFFER_REPORT_INTERVAL;
+
+    sc_clock_init(&db->clock);
+    sc_vecdeque_init(&db->queue);
+    sc_vector_init(&db->pool);
+    db->heap_index = SC_DELAY_BUFFER_UNSCHEDULED;
+    db->stopped = false;
+
+    if (!sc_frame_source_sinks_open(&db->frame_source, ctx)) {
+        return false;
+    }
+
+    return true;
 }
 
 static void
 sc_delay_buffer_frame_sink_close(struct sc_frame_sink *sink) {
     struct sc_delay_buffer *db = DOWNCAST(sink);
+    struct sc_delay_scheduler *ds = db->scheduler;
 
-    sc_mutex_lock(&db->mutex);
-    db->stopped = true;
-    sc_cond_signal(&db->queue_cond);
-    sc_cond_signal(&db->wait_cond);
-    sc_mutex_unlock(&db->mutex);
+    sc_mutex_lock(&ds->mutex);
+    sc_delay_buffer_stop(db);
+    // Wait until the scheduler does not push a frame from this delay buffer
+    while (ds->current == db) {
+        sc_cond_wait(&ds->release_cond, &ds->mutex);
+    }
+    sc_mutex_unlock(&ds->mutex);
 
-    sc_thread_join(&db->thread, NULL);
+    LOGD("Delay buffer '%s': %u late frames", db->name, db->late_frames);
 
-    sc_frame_source_sinks_close(&db->frame_source);
+    // The scheduler does not reference the delay buffer anymore
+    sc_delay_buffer_clear(db);
 
-    sc_cond_destroy(&db->wait_cond);
-    sc_cond_destroy(&db->queue_cond);
-    sc_mutex_destroy(&db->mutex);
+    sc_frame_source_sinks_close(&db->frame_source);
 }
 
 static bool
 sc_delay_buffer_frame_sink_push(struct sc_frame_sink *sink,
                                 const AVFrame *frame) {
     struct sc_delay_buffer *db = DOWNCAST(sink);
+    struct sc_delay_scheduler *ds = db->scheduler;
 
-    sc_mutex_lock(&db->mutex);
+    sc_mutex_lock(&ds->mutex);
 
-    if (db->stopped) {
-        sc_mutex_unlock(&db->mutex);
+    if (db->stopped || ds->stopped) {
+        sc_mutex_unlock(&ds->mutex);
         return false;
     }
 
+    sc_tick now = sc_tick_now();
     sc_tick pts = SC_TICK_FROM_US(frame->pts);
-    sc_clock_update(&db->clock, sc_tick_now(), pts);
-    sc_cond_signal(&db->wait_cond);
+    sc_clock_update(&db->clock, now, pts);
+
+    // Difference between the actual and the expected arrival dates
+    sc_tick lateness = now - sc_clock_to_system_time(&db->clock, pts);
+    if (lateness > db->delay) {
+        ++db->late_frames;
+    }
+
+    if (db->adaptive) {
+        db->delay = sc_adaptive_delay_push(&db->adaptive_delay, lateness);
+        if (now >= db->next_report) {
+            LOGI("Delay buffer '%s': %" PRItick " ms (%u late frames)",
+                 db->name, SC_TICK_TO_MS(db->delay), db->late_frames);
+            db->next_report = now + SC_DELAY_BUFFER_REPORT_INTERVAL;
+        }
+    }
+
+    if (db->av_sync) {
+        db->av_sync_delay = sc_av_sync_get_video_delay(db->av_sync);
+    }
 
     if (db->first_frame_asap && db->clock.range == 1) {
-        sc_mutex_unlock(&db->mutex);
+        sc_mutex_unlock(&ds->mutex);
         return sc_frame_source_sinks_push(&db->frame_source, frame);
     }
 
     struct sc_delayed_frame dframe;
-    bool ok = sc_delayed_frame_init(&dframe, frame);
-    if (!ok) {
-        sc_mutex_unlock(&db->mutex);
+    dframe.frame = sc_delay_buffer_take_frame(db);
+    if (!dframe.frame) {
+        sc_mutex_unlock(&ds->mutex);
+        return false;
+    }
+
+    if (av_frame_ref(dframe.frame, frame)) {
+        LOG_OOM();
+        sc_delay_buffer_recycle_frame(db, dframe.frame);
+        sc_mutex_unlock(&ds->mutex);
         return false;
     }
 
 #ifdef SC_BUFFERING_DEBUG
-    dframe.push_date = sc_tick_now();
+    dframe.push_date = now;
 #endif
 
-    ok = sc_vecdeque_push(&db->queue, dframe);
+    bool ok = sc_vecdeque_push(&db->queue, dframe);
     if (!ok) {
-        sc_mutex_unlock(&db->mutex);
+        av_frame_unref(dframe.frame);
+        sc_delay_buffer_recycle_frame(db, dframe.frame);
+        sc_mutex_unlock(&ds->mutex);
         LOG_OOM();
         return false;
     }
 
-    sc_cond_signal(&db->queue_cond);
+    if (sc_vecdeque_size(&db->queue) == 1) {
+        // The new frame is the head
+        db->max_deadline = now + db->delay + db->av_sync_delay;
+    }
+
+    // The clock has been updated, so the deadline of the head frame changed
+    ok = sc_delay_scheduler_reschedule(ds, db);
+    if (!ok) {
+        sc_delay_buffer_stop(db);
+    }
 
-    sc_mutex_unlock(&db->mutex);
+    sc_mutex_unlock(&ds->mutex);
 
-    return true;
+    return ok;
 }
 
 void
-sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
-                     bool first_frame_asap) {
-    assert(delay > 0);
-
-    db->delay = delay;
+sc_delay_buffer_init(struct sc_delay_buffer *db,
+                     struct sc_delay_scheduler *scheduler, const char *name,
+                     sc_tick delay, bool adaptive, bool first_frame_asap,
+                     struct sc_av_sync *av_sync) {
+    assert(scheduler);
+    assert(delay > 0 || (!delay && av_sync));
+
+    db->scheduler = scheduler;
+    db->name = name; // statically allocated
+    db->max_delay = delay;
+    db->adaptive = adaptive;
     db->first_frame_asap = first_frame_asap;
+    db->av_sync = av_sync;
 
     sc_frame_source_init(&db->frame_source);
 
@@ -4,14 +4,18 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <libavutil/frame.h>
 
+#include "adaptive_delay.h"
+#include "av_sync.h"
 #include "clock.h"
 #include "trait/frame_source.h"
 #include "trait/frame_sink.h"
 #include "util/thread.h"
 #include "util/tick.h"
 #include "util/vecdeque.h"
+#include "util/vector.h"
 
 //#define SC_BUFFERING_DEBUG // uncomment to debug
 
@@ -26,21 +30,64 @@ struct sc_delayed_frame {
 };
 
 struct sc_delayed_frame_queue SC_VECDEQUE(struct sc_delayed_frame);
+struct sc_delay_buffer_frame_pool SC_VECTOR(AVFrame *);
+struct sc_delay_scheduler_heap SC_VECTOR(struct sc_delay_buffer *);
+
+/**
+ * Delay scheduler shared by all the delay buffers.
+ *
+ * A single thread releases the delayed frames of all the delay buffers, in
+ * deadline order. The delay buffers having pending frames are stored in a
+ * min-heap, ordered by the deadline of their head frame.
+ */
+struct sc_delay_scheduler {
+    sc_thread thread;
+    sc_mutex mutex;
+    // signaled when the earliest deadline changes
+    sc_cond cond;
+    // signaled when a released frame has been pushed to the sinks
+    sc_cond release_cond;
+
+    struct sc_delay_scheduler_heap heap;
+    // the delay buffer whose frame is being pushed (outside the lock), if any
+    struct sc_delay_buffer *current;
+    bool stopped;
+};
 
 struct sc_delay_buffer {
     struct sc_frame_source frame_source; // frame source trait
     struct sc_frame_sink frame_sink; // frame sink trait
 
-    sc_tick delay;
+    struct sc_delay_scheduler *scheduler;
+    const char *name; // must be statically allocated (e.g. a string literal)
+    sc_tick max_delay;
+    bool adaptive;
     bool first_frame_asap;
+    // if set, add the video delay requested for A/V sync
+    struct sc_av_sync *av_sync;
 
-    sc_thread thread;
-    sc_mutex mutex;
-    sc_cond queue_cond;
-    sc_cond wait_cond;
+    // All the fields below are protected by scheduler->mutex
+
+    // fixed, or updated on every frame if adaptive
+    sc_tick delay;
+    // additional delay for A/V sync, updated on every frame
+    sc_tick av_sync_delay;
+    struct sc_adaptive_delay adaptive_delay;
+    // number of frames received after their deadline
+    unsigned late_frames;
+    sc_tick next_report;
 
     struct sc_clock clock;
     struct sc_delayed_frame_queue queue;
+    // unreferenced frames, reused to avoid an allocation per frame
+    struct sc_delay_buffer_frame_pool pool;
+
+    // release date of the head frame (valid only if scheduled)
+    sc_tick deadline;
+    // the head frame may not be delayed more than this date
+    sc_tick max_deadline;
+    // index in the scheduler heap, SIZE_MAX if not scheduled
+    size_t heap_index;
     bool stopped;
 };
 
@@ -49,15 +96,39 @@ struct sc_delay_buffer_callbacks {
                          void *userdata);
 };
 
+bool
+sc_delay_scheduler_init(struct sc_delay_scheduler *ds);
+
+void
+sc_delay_scheduler_destroy(struct sc_delay_scheduler *ds);
+
+bool
+sc_delay_scheduler_start(struct sc_delay_scheduler *ds);
+
+void
+sc_delay_scheduler_stop(struct sc_delay_scheduler *ds);
+
+void
+sc_delay_scheduler_join(struct sc_delay_scheduler *ds);
+
 /**
  * Initialize a delay buffer.
  *
- * \param delay a (strictly) positive delay
+ * \param scheduler the scheduler releasing the delayed frames (it must be
+ *                  started before the delay buffer is opened)
+ * \param name the name, used for logging (must be statically allocated)
+ * \param delay a (strictly) positive delay, or the maximum delay if adaptive
+ *              (it may be 0 if av_sync is set)
+ * \param adaptive if true, adapt the delay to the measured jitter
  * \param first_frame_asap if true, do not delay the first frame (useful for
                            a video stream).
+ * \param av_sync if not NULL, also apply the video delay requested to
+ *                synchronize with the audio playback
  */
 void
-sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
-                     bool first_frame_asap);
+sc_delay_buffer_init(struct sc_delay_buffer *db,
+                     struct sc_delay_scheduler *scheduler, const char *name,
+                     sc_tick delay, bool adaptive, bool first_frame_asap,
+                     struct sc_av_sync *av_sync);
 
 #endif
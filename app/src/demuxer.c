@@ -77,28 +77,43 @@ sc_demuxer_recv_video_size(struct sc_demuxer *demuxer, uint32_t *width,
     return true;
 }
 
+// The video and audio streams contain a sequence of raw packets (as provided
+// by MediaCodec), each prefixed with a "meta" header.
+//
+// The "meta" header length is 12 bytes:
+// [. . . . . . . .|. . . .]. . . . . . . . . . . . . . . ...
+//  <-------------> <-----> <-----------------------------...
+//        PTS        packet        raw packet
+//                    size
+//
+// It is followed by <packet_size> bytes containing the packet/frame.
+//
+// The most significant bits of the PTS are used for packet flags:
+//
+//  byte 7   byte 6   byte 5   byte 4   byte 3   byte 2   byte 1   byte 0
+// CK...... ........ ........ ........ ........ ........ ........ ........
+// ^^<------------------------------------------------------------------->
+// ||                                PTS
+// | `- key frame
+//  `-- config packet
+
+static void
+sc_demuxer_set_packet_flags(AVPacket *packet, uint64_t pts_flags) {
+    if (pts_flags & SC_PACKET_FLAG_CONFIG) {
+        packet->pts = AV_NOPTS_VALUE;
+    } else {
+        packet->pts = pts_flags & SC_PACKET_PTS_MASK;
+    }
+
+    if (pts_flags & SC_PACKET_FLAG_KEY_FRAME) {
+        packet->flags |= AV_PKT_FLAG_KEY;
+    }
+
+    packet->dts = packet->pts;
+}
+
 static bool
 sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
-    // The video and audio streams contain a sequence of raw packets (as
-    // provided by MediaCodec), each prefixed with a "meta" header.
-    //
-    // The "meta" header length is 12 bytes:
-    // [. . . . . . . .|. . . .]. . . . . . . . . . . . . . . ...
-    //  <-------------> <-----> <-----------------------------...
-    //        PTS        packet        raw packet
-    //                    size
-    //
-    // It is followed by <packet_size> bytes containing the packet/frame.
-    //
-    // The most significant bits of the PTS are used for packet flags:
-    //
-    //  byte 7   byte 6   byte 5   byte 4   byte 3   byte 2   byte 1   byte 0
-    // CK...... ........ ........ ........ ........ ........ ........ ........
-    // ^^<------------------------------------------------------------------->
-    // ||                                PTS
-    // | `- key frame
-    //  `-- config packet
-
     uint8_t header[SC_PACKET_HEADER_SIZE];
     ssize_t r = net_recv_all(demuxer->socket, header, SC_PACKET_HEADER_SIZE);
     if (r < SC_PACKET_HEADER_SIZE) {
@@ -120,47 +135,27 @@ sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
         return false;
     }
 
-    if (pts_flags & SC_PACKET_FLAG_CONFIG) {
-        packet->pts = AV_NOPTS_VALUE;
-    } else {
-        packet->pts = pts_flags & SC_PACKET_PTS_MASK;
-    }
-
-    if (pts_flags & SC_PACKET_FLAG_KEY_FRAME) {
-        packet->flags |= AV_PKT_FLAG_KEY;
-    }
-
-    packet->dts = packet->pts;
+    sc_demuxer_set_packet_flags(packet, pts_flags);
     return true;
 }
 
-static int
-run_demuxer(void *data) {
-    struct sc_demuxer *demuxer = data;
-
-    // Flag to report end-of-stream (i.e. device disconnected)
-    enum sc_demuxer_status status = SC_DEMUXER_STATUS_ERROR;
-
-    uint32_t raw_codec_id;
-    bool ok = sc_demuxer_recv_codec_id(demuxer, &raw_codec_id);
-    if (!ok) {
-        LOGE("Demuxer '%s': stream disabled due to connection error",
-             demuxer->name);
-        goto end;
-    }
+// Check the codec id received from the device and allocate the codec context
+static bool
+sc_demuxer_configure(struct sc_demuxer *demuxer, uint32_t raw_codec_id) {
+    assert(!demuxer->codec_ctx);
 
     if (raw_codec_id == 0) {
         LOGW("Demuxer '%s': stream explicitly disabled by the device",
              demuxer->name);
         sc_packet_source_sinks_disable(&demuxer->packet_source);
-        status = SC_DEMUXER_STATUS_DISABLED;
-        goto end;
+        demuxer->status = SC_DEMUXER_STATUS_DISABLED;
+        return false;
     }
 
     if (raw_codec_id == 1) {
         LOGE("Demuxer '%s': stream configuration error on the device",
              demuxer->name);
-        goto end;
+        return false;
     }
 
     enum AVCodecID codec_id = sc_demuxer_to_avcodec_id(raw_codec_id);
@@ -168,7 +163,7 @@ run_demuxer(void *data) {
         LOGE("Demuxer '%s': stream disabled due to unsupported codec",
              demuxer->name);
         sc_packet_source_sinks_disable(&demuxer->packet_source);
-        goto end;
+        return false;
     }
 
     const AVCodec *codec = avcodec_find_decoder(codec_id);
@@ -176,25 +171,32 @@ run_demuxer(void *data) {
         LOGE("Demuxer '%s': stream disabled due to missing decoder",
              demuxer->name);
         sc_packet_source_sinks_disable(&demuxer->packet_source);
-        goto end;
+        return false;
     }
 
     AVCodecContext *codec_ctx = avcodec_alloc_context3(codec);
     if (!codec_ctx) {
         LOG_OOM();
-        goto end;
+        return false;
     }
 
+    // Released by sc_demuxer_finish()
+    demuxer->codec_ctx = codec_ctx;
+
     codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
 
-    if (codec->type == AVMEDIA_TYPE_VIDEO) {
-        uint32_t width;
-        uint32_t height;
-        ok = sc_demuxer_recv_video_size(demuxer, &width, &height);
-        if (!ok) {
-            goto finally_free_context;
-        }
+    return true;
+}
 
+// Open the codec and the sinks (the size is only used for a video stream)
+static bool
+sc_demuxer_open(struct sc_demuxer *demuxer, uint32_t raw_codec_id,
+                uint32_t width, uint32_t height) {
+    AVCodecContext *codec_ctx = demuxer->codec_ctx;
+    assert(codec_ctx);
+    const AVCodec *codec = codec_ctx->codec;
+
+    if (codec->type == AVMEDIA_TYPE_VIDEO) {
         codec_ctx->width = width;
         codec_ctx->height = height;
         codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
@@ -214,70 +216,259 @@ run_demuxer(void *data) {
         }
     }
 
+    enum sc_startup_phase open_phase = codec->type == AVMEDIA_TYPE_VIDEO
+                                     ? SC_STARTUP_PHASE_VIDEO_DECODER_OPEN
+                                     : SC_STARTUP_PHASE_AUDIO_DECODER_OPEN;
+    if (demuxer->startup_timing) {
+        sc_startup_timing_begin(demuxer->startup_timing, open_phase);
+    }
+
     if (avcodec_open2(codec_ctx, codec, NULL) < 0) {
         LOGE("Demuxer '%s': could not open codec", demuxer->name);
-        goto finally_free_context;
+        return false;
     }
 
     if (!sc_packet_source_sinks_open(&demuxer->packet_source, codec_ctx)) {
-        goto finally_free_context;
+        return false;
+    }
+    demuxer->sinks_open = true;
+
+    if (demuxer->startup_timing) {
+        sc_startup_timing_end(demuxer->startup_timing, open_phase);
     }
 
     // Config packets must be merged with the next non-config packet only for
     // H.26x
-    bool must_merge_config_packet = raw_codec_id == SC_CODEC_ID_H264
-                                 || raw_codec_id == SC_CODEC_ID_H265;
-
-    struct sc_packet_merger merger;
+    demuxer->must_merge_config_packet = raw_codec_id == SC_CODEC_ID_H264
+                                     || raw_codec_id == SC_CODEC_ID_H265;
 
-    if (must_merge_config_packet) {
-        sc_packet_merger_init(&merger);
+    if (demuxer->must_merge_config_packet) {
+        sc_packet_merger_init(&demuxer->merger);
     }
 
-    AVPacket *packet = av_packet_alloc();
-    if (!packet) {
+    demuxer->packet = av_packet_alloc();
+    if (!demuxer->packet) {
         LOG_OOM();
-        goto finally_close_sinks;
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_demuxer_prepare(struct sc_demuxer *demuxer) {
+    assert(!demuxer->codec_ctx);
+    assert(!demuxer->packet);
+    assert(!demuxer->sinks_open);
+
+    // Flag to report end-of-stream (i.e. device disconnected)
+    demuxer->status = SC_DEMUXER_STATUS_ERROR;
+
+    uint32_t raw_codec_id;
+    bool ok = sc_demuxer_recv_codec_id(demuxer, &raw_codec_id);
+    if (!ok) {
+        LOGE("Demuxer '%s': stream disabled due to connection error",
+             demuxer->name);
+        return false;
     }
 
-    for (;;) {
-        bool ok = sc_demuxer_recv_packet(demuxer, packet);
+    if (!sc_demuxer_configure(demuxer, raw_codec_id)) {
+        return false;
+    }
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (demuxer->codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        ok = sc_demuxer_recv_video_size(demuxer, &width, &height);
         if (!ok) {
-            // end of stream
-            status = SC_DEMUXER_STATUS_EOS;
-            break;
+            return false;
         }
+    }
+
+    return sc_demuxer_open(demuxer, raw_codec_id, width, height);
+}
+
+// Push a complete packet to the sinks (the packet is unref'ed)
+static bool
+sc_demuxer_push_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
+    atomic_fetch_add_explicit(&demuxer->received_bytes, packet->size,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&demuxer->received_packets, 1,
+                              memory_order_relaxed);
+
+    if (demuxer->must_merge_config_packet) {
+        // Prepend any config packet to the next media packet
+        bool ok = sc_packet_merger_merge(&demuxer->merger, packet);
+        if (!ok) {
+            av_packet_unref(packet);
+            return false;
+        }
+    }
+
+    bool ok = sc_packet_source_sinks_push(&demuxer->packet_source, packet);
+    av_packet_unref(packet);
+    if (!ok) {
+        // The sink already logged its concrete error
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_demuxer_process(struct sc_demuxer *demuxer) {
+    assert(demuxer->packet);
+
+    AVPacket *packet = demuxer->packet;
+    bool ok = sc_demuxer_recv_packet(demuxer, packet);
+    if (!ok) {
+        // end of stream
+        demuxer->status = SC_DEMUXER_STATUS_EOS;
+        return false;
+    }
 
-        if (must_merge_config_packet) {
-            // Prepend any config packet to the next media packet
-            ok = sc_packet_merger_merge(&merger, packet);
-            if (!ok) {
-                av_packet_unref(packet);
-                break;
+    return sc_demuxer_push_packet(demuxer, packet);
+}
+
+// Size of the header to receive in the given incremental state
+static size_t
+sc_demuxer_recv_header_size(enum sc_demuxer_recv_state state) {
+    switch (state) {
+        case SC_DEMUXER_RECV_CODEC_ID:
+            return 4;
+        case SC_DEMUXER_RECV_VIDEO_SIZE:
+            return 8;
+        case SC_DEMUXER_RECV_PACKET_HEADER:
+            return SC_PACKET_HEADER_SIZE;
+        default:
+            assert(!"unexpected receive state");
+            return 0;
+    }
+}
+
+// Handle a complete header received incrementally
+static bool
+sc_demuxer_handle_header(struct sc_demuxer *demuxer) {
+    const uint8_t *header = demuxer->recv_header;
+
+    switch (demuxer->recv_state) {
+        case SC_DEMUXER_RECV_CODEC_ID: {
+            uint32_t raw_codec_id = sc_read32be(header);
+            if (!sc_demuxer_configure(demuxer, raw_codec_id)) {
+                return false;
+            }
+            demuxer->recv_codec_id = raw_codec_id;
+            if (demuxer->codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+                demuxer->recv_state = SC_DEMUXER_RECV_VIDEO_SIZE;
+                return true;
             }
+            demuxer->recv_state = SC_DEMUXER_RECV_PACKET_HEADER;
+            return sc_demuxer_open(demuxer, raw_codec_id, 0, 0);
         }
+        case SC_DEMUXER_RECV_VIDEO_SIZE: {
+            uint32_t width = sc_read32be(header);
+            uint32_t height = sc_read32be(header + 4);
+            demuxer->recv_state = SC_DEMUXER_RECV_PACKET_HEADER;
+            return sc_demuxer_open(demuxer, demuxer->recv_codec_id, width,
+                                   height);
+        }
+        case SC_DEMUXER_RECV_PACKET_HEADER: {
+            uint32_t len = sc_read32be(&header[8]);
+            assert(len);
+            if (av_new_packet(demuxer->packet, len)) {
+                LOG_OOM();
+                return false;
+            }
+            demuxer->recv_pts_flags = sc_read64be(header);
+            demuxer->recv_state = SC_DEMUXER_RECV_PACKET_DATA;
+            return true;
+        }
+        default:
+            assert(!"unexpected receive state");
+            return false;
+    }
+}
 
-        ok = sc_packet_source_sinks_push(&demuxer->packet_source, packet);
-        av_packet_unref(packet);
-        if (!ok) {
-            // The sink already logged its concrete error
-            break;
+bool
+sc_demuxer_process_available(struct sc_demuxer *demuxer) {
+    enum sc_demuxer_recv_state state = demuxer->recv_state;
+
+    uint8_t *buf;
+    size_t len;
+    if (state == SC_DEMUXER_RECV_PACKET_DATA) {
+        buf = demuxer->packet->data;
+        len = demuxer->packet->size;
+    } else {
+        buf = demuxer->recv_header;
+        len = sc_demuxer_recv_header_size(state);
+    }
+    assert(demuxer->recv_offset < len);
+
+    // A single call: it does not block if the socket is readable
+    ssize_t r = net_recv(demuxer->socket, buf + demuxer->recv_offset,
+                         len - demuxer->recv_offset);
+    if (r <= 0) {
+        if (state == SC_DEMUXER_RECV_CODEC_ID) {
+            LOGE("Demuxer '%s': stream disabled due to connection error",
+                 demuxer->name);
+        } else if (state != SC_DEMUXER_RECV_VIDEO_SIZE) {
+            // end of stream
+            demuxer->status = SC_DEMUXER_STATUS_EOS;
         }
+        return false;
     }
 
-    LOGD("Demuxer '%s': end of frames", demuxer->name);
+    demuxer->recv_offset += r;
+    if (demuxer->recv_offset < len) {
+        // Partial header or packet, wait for the remaining bytes
+        return true;
+    }
 
-    if (must_merge_config_packet) {
-        sc_packet_merger_destroy(&merger);
+    demuxer->recv_offset = 0;
+
+    if (state == SC_DEMUXER_RECV_PACKET_DATA) {
+        AVPacket *packet = demuxer->packet;
+        sc_demuxer_set_packet_flags(packet, demuxer->recv_pts_flags);
+        demuxer->recv_state = SC_DEMUXER_RECV_PACKET_HEADER;
+        return sc_demuxer_push_packet(demuxer, packet);
     }
 
-    av_packet_free(&packet);
-finally_close_sinks:
-    sc_packet_source_sinks_close(&demuxer->packet_source);
-finally_free_context:
-    avcodec_free_context(&codec_ctx);
-end:
-    demuxer->cbs->on_ended(demuxer, status, demuxer->cbs_userdata);
+    return sc_demuxer_handle_header(demuxer);
+}
+
+void
+sc_demuxer_finish(struct sc_demuxer *demuxer) {
+    if (demuxer->packet) {
+        LOGD("Demuxer '%s': end of frames", demuxer->name);
+        av_packet_free(&demuxer->packet);
+    }
+
+    if (demuxer->sinks_open) {
+        if (demuxer->must_merge_config_packet) {
+            sc_packet_merger_destroy(&demuxer->merger);
+        }
+        sc_packet_source_sinks_close(&demuxer->packet_source);
+        demuxer->sinks_open = false;
+    }
+
+    if (demuxer->codec_ctx) {
+        avcodec_free_context(&demuxer->codec_ctx);
+    }
+
+    demuxer->cbs->on_ended(demuxer, demuxer->status, demuxer->cbs_userdata);
+}
+
+static int
+run_demuxer(void *data) {
+    struct sc_demuxer *demuxer = data;
+
+    if (sc_demuxer_prepare(demuxer)) {
+        while (sc_demuxer_process(demuxer)) {
+            // continue
+        }
+    }
+
+    sc_demuxer_finish(demuxer);
 
     return 0;
 }
@@ -295,6 +486,24 @@ sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
 
     demuxer->cbs = cbs;
     demuxer->cbs_userdata = cbs_userdata;
+
+    demuxer->startup_timing = NULL;
+    demuxer->codec_ctx = NULL;
+    demuxer->recv_state = SC_DEMUXER_RECV_CODEC_ID;
+    demuxer->recv_offset = 0;
+    demuxer->packet = NULL;
+    demuxer->sinks_open = false;
+    demuxer->must_merge_config_packet = false;
+    demuxer->status = SC_DEMUXER_STATUS_ERROR;
+
+    atomic_init(&demuxer->received_bytes, 0);
+    atomic_init(&demuxer->received_packets, 0);
+}
+
+void
+sc_demuxer_set_startup_timing(struct sc_demuxer *demuxer,
+                              struct sc_startup_timing *startup_timing) {
+    demuxer->startup_timing = startup_timing;
 }
 
 bool
@@ -314,3 +523,12 @@ void
 sc_demuxer_join(struct sc_demuxer *demuxer) {
     sc_thread_join(&demuxer->thread, NULL);
 }
+
+void
+sc_demuxer_get_stats(struct sc_demuxer *demuxer,
+                     struct sc_demuxer_stats *stats) {
+    stats->bytes = atomic_load_explicit(&demuxer->received_bytes,
+                                        memory_order_relaxed);
+    stats->packets = atomic_load_explicit(&demuxer->received_packets,
+                                          memory_order_relaxed);
+}
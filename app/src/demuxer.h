@@ -3,12 +3,31 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
 
+#include "packet_merger.h"
+#include "startup_timing.h"
 #include "trait/packet_source.h"
 #include "util/net.h"
 #include "util/thread.h"
 
+enum sc_demuxer_status {
+    SC_DEMUXER_STATUS_EOS,
+    SC_DEMUXER_STATUS_DISABLED,
+    SC_DEMUXER_STATUS_ERROR,
+};
+
+// What sc_demuxer_process_available() is currently receiving
+enum sc_demuxer_recv_state {
+    SC_DEMUXER_RECV_CODEC_ID,
+    SC_DEMUXER_RECV_VIDEO_SIZE,
+    SC_DEMUXER_RECV_PACKET_HEADER,
+    SC_DEMUXER_RECV_PACKET_DATA,
+};
+
 struct sc_demuxer {
     struct sc_packet_source packet_source; // packet source trait
 
@@ -17,30 +36,86 @@ struct sc_demuxer {
     sc_socket socket;
     sc_thread thread;
 
+    // Stream state, accessed only from the thread running the demuxer
+    AVCodecContext *codec_ctx;
+    AVPacket *packet;
+    bool sinks_open;
+    bool must_merge_config_packet;
+    struct sc_packet_merger merger;
+    enum sc_demuxer_status status;
+
+    // Partially received header or packet (only used by
+    // sc_demuxer_process_available())
+    enum sc_demuxer_recv_state recv_state;
+    uint8_t recv_header[12];
+    size_t recv_offset; // in recv_header, or in packet->data
+    uint32_t recv_codec_id;
+    uint64_t recv_pts_flags;
+
+    // Statistics, written by the thread running the demuxer, may be read from
+    // any thread
+    atomic_uint_least64_t received_bytes;
+    atomic_uint_least32_t received_packets;
+
+    struct sc_startup_timing *startup_timing; // may be NULL
+
     const struct sc_demuxer_callbacks *cbs;
     void *cbs_userdata;
 };
 
-enum sc_demuxer_status {
-    SC_DEMUXER_STATUS_EOS,
-    SC_DEMUXER_STATUS_DISABLED,
-    SC_DEMUXER_STATUS_ERROR,
-};
-
 struct sc_demuxer_callbacks {
     void (*on_ended)(struct sc_demuxer *demuxer, enum sc_demuxer_status,
                      void *userdata);
 };
 
+struct sc_demuxer_stats {
+    uint64_t bytes; // payload of the packets received
+    uint32_t packets;
+};
+
 // The name must be statically allocated (e.g. a string literal)
 void
 sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
                 const struct sc_demuxer_callbacks *cbs, void *cbs_userdata);
 
+/**
+ * Measure the opening of the decoder in the startup timeline
+ *
+ * Must be called before the demuxer is started.
+ */
+void
+sc_demuxer_set_startup_timing(struct sc_demuxer *demuxer,
+                              struct sc_startup_timing *startup_timing);
+
 bool
 sc_demuxer_start(struct sc_demuxer *demuxer);
 
+/**
+ * Run the demuxer step by step, without its own thread (see sc_demuxer_pool)
+ *
+ * Each call performs a single receive call (so it does not block once the
+ * socket is reported readable), and keeps any partial header or packet until
+ * the next call. The stream header is handled and the packets are pushed to
+ * the sinks only once they are complete.
+ *
+ * Return false once the stream is ended, then sc_demuxer_finish() must be
+ * called to close the sinks and report the end of the stream.
+ */
+bool
+sc_demuxer_process_available(struct sc_demuxer *demuxer);
+
+void
+sc_demuxer_finish(struct sc_demuxer *demuxer);
+
 void
 sc_demuxer_join(struct sc_demuxer *demuxer);
 
+/**
+ * Get the number of packets and bytes received since sc_demuxer_init() (may be
+ * called from any thread)
+ */
+void
+sc_demuxer_get_stats(struct sc_demuxer *demuxer,
+                     struct sc_demuxer_stats *stats);
+
 #endif
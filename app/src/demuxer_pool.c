@@ -0,0 +1,127 @@
+#include "demuxer_pool.h"
+
+#include <assert.h>
+
+#include "util/log.h"
+#include "util/net.h"
+
+static int
+run_demuxer_pool_worker(void *data) {
+    struct sc_demuxer_pool_worker *worker = data;
+
+    // The streams still running, compacted on removal
+    struct sc_demuxer *demuxers[SC_DEMUXER_POOL_MAX_DEMUXERS];
+    sc_socket sockets[SC_DEMUXER_POOL_MAX_DEMUXERS];
+    bool ready[SC_DEMUXER_POOL_MAX_DEMUXERS];
+
+    unsigned count = worker->count;
+    for (unsigned i = 0; i < count; ++i) {
+        demuxers[i] = worker->demuxers[i];
+        sockets[i] = demuxers[i]->socket;
+    }
+
+    while (count) {
+        bool ok = net_wait_readable(sockets, ready, count, true);
+        if (!ok) {
+            // On Windows and macOS, an interrupted socket is closed, so it
+            // makes select() fail: find the failing socket(s), which are
+            // "ready" (the next receive call will fail)
+            for (unsigned i = 0; i < count; ++i) {
+                if (!net_wait_readable(&sockets[i], &ready[i], 1, false)) {
+                    ready[i] = true;
+                }
+            }
+        }
+
+        unsigned i = 0;
+        while (i < count) {
+            if (!ready[i]) {
+                ++i;
+                continue;
+            }
+
+            // Only receive what is available: a stream sending a large packet
+            // slowly must not delay the other streams of the worker
+            struct sc_demuxer *demuxer = demuxers[i];
+            if (sc_demuxer_process_available(demuxer)) {
+                ++i;
+                continue;
+            }
+
+            sc_demuxer_finish(demuxer);
+
+            // Move the last stream at index i (it is handled by the next
+            // iteration if it is ready)
+            --count;
+            demuxers[i] = demuxers[count];
+            sockets[i] = sockets[count];
+            ready[i] = ready[count];
+        }
+    }
+
+    return 0;
+}
+
+void
+sc_demuxer_pool_init(struct sc_demuxer_pool *pool, unsigned worker_count) {
+    assert(worker_count);
+    pool->worker_count = MIN(worker_count, SC_DEMUXER_POOL_MAX_WORKERS);
+    for (unsigned i = 0; i < pool->worker_count; ++i) {
+        pool->workers[i].count = 0;
+    }
+    pool->demuxer_count = 0;
+    pool->started_count = 0;
+}
+
+void
+sc_demuxer_pool_add(struct sc_demuxer_pool *pool, struct sc_demuxer *demuxer) {
+    assert(!pool->started_count);
+
+    // Round-robin
+    struct sc_demuxer_pool_worker *worker =
+        &pool->workers[pool->demuxer_count % pool->worker_count];
+    assert(worker->count < SC_DEMUXER_POOL_MAX_DEMUXERS);
+    worker->demuxers[worker->count++] = demuxer;
+    ++pool->demuxer_count;
+}
+
+bool
+sc_demuxer_pool_start(struct sc_demuxer_pool *pool) {
+    assert(!pool->started_count);
+
+    LOGD("Demuxer pool: %u streams on %u threads", pool->demuxer_count,
+         MIN(pool->demuxer_count, pool->worker_count));
+
+    for (unsigned i = 0; i < pool->worker_count; ++i) {
+        struct sc_demuxer_pool_worker *worker = &pool->workers[i];
+        if (!worker->count) {
+            // Fewer streams than workers
+            break;
+        }
+
+        bool ok = sc_thread_create(&worker->thread, run_demuxer_pool_worker,
+                                   "scrcpy-demux", worker);
+        if (!ok) {
+            LOGE("Demuxer pool: could not start thread");
+            // The streams of the workers not started are never run: report
+            // their end, so that their sinks are released
+            for (unsigned j = i; j < pool->worker_count; ++j) {
+                struct sc_demuxer_pool_worker *w = &pool->workers[j];
+                for (unsigned k = 0; k < w->count; ++k) {
+                    sc_demuxer_finish(w->demuxers[k]);
+                }
+            }
+            return false;
+        }
+        pool->started_count = i + 1;
+    }
+
+    return true;
+}
+
+void
+sc_demuxer_pool_join(struct sc_demuxer_pool *pool) {
+    for (unsigned i = 0; i < pool->started_count; ++i) {
+        sc_thread_join(&pool->workers[i].thread, NULL);
+    }
+}
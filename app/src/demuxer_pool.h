@@ -0,0 +1,53 @@
+#ifndef SC_DEMUXER_POOL_H
+#define SC_DEMUXER_POOL_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "demuxer.h"
+#include "util/thread.h"
+
+#define SC_DEMUXER_POOL_MAX_WORKERS 16
+#define SC_DEMUXER_POOL_MAX_DEMUXERS 64
+
+struct sc_demuxer_pool_worker {
+    sc_thread thread;
+    struct sc_demuxer *demuxers[SC_DEMUXER_POOL_MAX_DEMUXERS];
+    unsigned count;
+};
+
+/**
+ * Run many demuxers from a fixed number of worker threads.
+ *
+ * Each demuxer is assigned to a worker, which waits until any of its sockets
+ * is readable, then receives the data available on each ready stream, without
+ * blocking. The partial packets are kept by each demuxer, and only complete
+ * packets are pushed to the sinks (so the sinks, including the decoders, run
+ * on the worker threads). This replaces one thread per stream when mirroring
+ * several devices.
+ *
+ * Like a single demuxer, a worker terminates by itself once all its streams
+ * are ended (the sockets must be interrupted to stop them).
+ */
+struct sc_demuxer_pool {
+    struct sc_demuxer_pool_worker workers[SC_DEMUXER_POOL_MAX_WORKERS];
+    unsigned worker_count;
+    unsigned demuxer_count;
+    unsigned started_count;
+};
+
+void
+sc_demuxer_pool_init(struct sc_demuxer_pool *pool, unsigned worker_count);
+
+// The demuxer must be initialized, but not started
+void
+sc_demuxer_pool_add(struct sc_demuxer_pool *pool, struct sc_demuxer *demuxer);
+
+bool
+sc_demuxer_pool_start(struct sc_demuxer_pool *pool);
+
+void
+sc_demuxer_pool_join(struct sc_demuxer_pool *pool);
+
+#endif
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <libavutil/pixfmt.h>
 
+#include "hud.h"
 #include "util/log.h"
 
 static bool
@@ -37,6 +38,7 @@ sc_display_init(struct sc_display *display, SDL_Window *window,
         LOGE("Could not create renderer: %s", SDL_GetError());
         return false;
     }
+    display->owns_renderer = true;
 
     SDL_RendererInfo renderer_info;
     int r = SDL_GetRendererInfo(display->renderer, &renderer_info);
@@ -95,6 +97,7 @@ sc_display_init(struct sc_display *display, SDL_Window *window,
     display->pending.flags = 0;
     display->pending.frame = NULL;
     display->has_frame = false;
+    display->hud = NULL;
 
     if (icon_novideo) {
         // Without video, set a static scrcpy icon as window content
@@ -111,18 +114,41 @@ sc_display_init(struct sc_display *display, SDL_Window *window,
     return true;
 }
 
+void
+sc_display_init_shared(struct sc_display *display,
+                       const struct sc_display *owner) {
+    assert(owner->owns_renderer);
+
+    display->renderer = owner->renderer;
+    display->owns_renderer = false;
+    // The OpenGL functions are loaded once per context
+    display->gl = owner->gl;
+#ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
+    display->gl_context = NULL;
+#endif
+    display->mipmaps = owner->mipmaps;
+
+    display->texture = NULL;
+    display->pending.flags = 0;
+    display->pending.frame = NULL;
+    display->has_frame = false;
+    display->hud = NULL;
+}
+
 void
 sc_display_destroy(struct sc_display *display) {
     if (display->pending.frame) {
         av_frame_free(&display->pending.frame);
     }
-#ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
-    SDL_GL_DeleteContext(display->gl_context);
-#endif
     if (display->texture) {
         SDL_DestroyTexture(display->texture);
     }
-    SDL_DestroyRenderer(display->renderer);
+    if (display->owns_renderer) {
+#ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
+        SDL_GL_DeleteContext(display->gl_context);
+#endif
+        SDL_DestroyRenderer(display->renderer);
+    }
 }
 
 static SDL_Texture *
@@ -292,10 +318,8 @@ sc_display_update_texture(struct sc_display *display, const AVFrame *frame) {
 }
 
 enum sc_display_result
-sc_display_render(struct sc_display *display, const SDL_Rect *geometry,
-                  enum sc_orientation orientation) {
-    SDL_RenderClear(display->renderer);
-
+sc_display_draw(struct sc_display *display, const SDL_Rect *geometry,
+                enum sc_orientation orientation) {
     if (display->pending.flags) {
         bool ok = sc_display_apply_pending(display);
         if (!ok) {
@@ -339,6 +363,25 @@ sc_display_render(struct sc_display *display, const SDL_Rect *geometry,
         }
     }
 
+    return SC_DISPLAY_RESULT_OK;
+}
+
+enum sc_display_result
+sc_display_render(struct sc_display *display, const SDL_Rect *geometry,
+                  enum sc_orientation orientation) {
+    SDL_RenderClear(display->renderer);
+
+    enum sc_display_result res =
+        sc_display_draw(display, geometry, orientation);
+    if (res != SC_DISPLAY_RESULT_OK) {
+        return res;
+    }
+
+    if (display->hud && sc_hud_is_enabled(display->hud)) {
+        // In the same present as the frame
+        sc_hud_draw(display->hud, display->renderer);
+    }
+
     SDL_RenderPresent(display->renderer);
     return SC_DISPLAY_RESULT_OK;
 }
@@ -12,6 +12,8 @@
 #include "opengl.h"
 #include "options.h"
 
+struct sc_hud;
+
 #ifdef __APPLE__
 # define SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
 #endif
@@ -19,6 +21,9 @@
 struct sc_display {
     SDL_Renderer *renderer;
     SDL_Texture *texture;
+    // false if the renderer belongs to another display (see
+    // sc_display_init_shared())
+    bool owns_renderer;
 
     struct sc_opengl gl;
 #ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
@@ -36,6 +41,9 @@ struct sc_display {
     } pending;
 
     bool has_frame;
+
+    // Overlay drawn by sc_display_render() if enabled, may be NULL
+    struct sc_hud *hud;
 };
 
 enum sc_display_result {
@@ -48,6 +56,16 @@ bool
 sc_display_init(struct sc_display *display, SDL_Window *window,
                 SDL_Surface *icon_novideo, bool mipmaps);
 
+/**
+ * Initialize a display rendering to the renderer of another display, to
+ * compose several textures in a single window
+ *
+ * The owner must be destroyed after all its shared displays.
+ */
+void
+sc_display_init_shared(struct sc_display *display,
+                       const struct sc_display *owner);
+
 void
 sc_display_destroy(struct sc_display *display);
 
@@ -61,4 +79,11 @@ enum sc_display_result
 sc_display_render(struct sc_display *display, const SDL_Rect *geometry,
                   enum sc_orientation orientation);
 
+/**
+ * Copy the texture to the renderer, without clearing nor presenting
+ */
+enum sc_display_result
+sc_display_draw(struct sc_display *display, const SDL_Rect *geometry,
+                enum sc_orientation orientation);
+
 #endif
@@ -6,9 +6,13 @@
 #include "util/thread.h"
 
 bool
-sc_push_event_impl(uint32_t type, const char *name) {
-    SDL_Event event;
-    event.type = type;
+sc_push_event_impl(uint32_t type, void *data, const char *name) {
+    SDL_Event event = {
+        .user = {
+            .type = type,
+            .data1 = data,
+        },
+    };
     int ret = SDL_PushEvent(&event);
     // ret < 0: error (queue full)
     // ret == 0: event was filtered
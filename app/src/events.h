@@ -20,12 +20,16 @@ enum {
     SC_EVENT_TIME_LIMIT_REACHED,
     SC_EVENT_CONTROLLER_ERROR,
     SC_EVENT_AOA_OPEN_ERROR,
+    SC_EVENT_SCREEN_HUD_REFRESH,
 };
 
+// The data is available in event.user.data1
 bool
-sc_push_event_impl(uint32_t type, const char *name);
+sc_push_event_impl(uint32_t type, void *data, const char *name);
 
-#define sc_push_event(TYPE) sc_push_event_impl(TYPE, # TYPE)
+#define sc_push_event(TYPE) sc_push_event_impl(TYPE, NULL, # TYPE)
+#define sc_push_event_with_data(TYPE, DATA) \
+    sc_push_event_impl(TYPE, DATA, # TYPE)
 
 typedef void (*sc_runnable_fn)(void *userdata);
 
@@ -22,6 +22,8 @@ sc_fps_counter_init(struct sc_fps_counter *counter) {
 
     counter->thread_started = false;
     atomic_init(&counter->started, 0);
+    atomic_init(&counter->total_rendered, 0);
+    atomic_init(&counter->total_skipped, 0);
     // no need to initialize the other fields, they are unused until started
 
     return true;
@@ -161,6 +163,9 @@ sc_fps_counter_join(struct sc_fps_counter *counter) {
 
 void
 sc_fps_counter_add_rendered_frame(struct sc_fps_counter *counter) {
+    atomic_fetch_add_explicit(&counter->total_rendered, 1,
+                              memory_order_relaxed);
+
     if (!is_started(counter)) {
         return;
     }
@@ -174,6 +179,9 @@ sc_fps_counter_add_rendered_frame(struct sc_fps_counter *counter) {
 
 void
 sc_fps_counter_add_skipped_frame(struct sc_fps_counter *counter) {
+    atomic_fetch_add_explicit(&counter->total_skipped, 1,
+                              memory_order_relaxed);
+
     if (!is_started(counter)) {
         return;
     }
@@ -184,3 +192,12 @@ sc_fps_counter_add_skipped_frame(struct sc_fps_counter *counter) {
     ++counter->nr_skipped;
     sc_mutex_unlock(&counter->mutex);
 }
+
+void
+sc_fps_counter_get_stats(struct sc_fps_counter *counter,
+                         struct sc_fps_counter_stats *stats) {
+    stats->rendered = atomic_load_explicit(&counter->total_rendered,
+                                           memory_order_relaxed);
+    stats->skipped = atomic_load_explicit(&counter->total_skipped,
+                                          memory_order_relaxed);
+}
@@ -5,6 +5,7 @@
 
 #include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "util/thread.h"
 #include "util/tick.h"
@@ -25,6 +26,16 @@ struct sc_fps_counter {
     unsigned nr_rendered;
     unsigned nr_skipped;
     sc_tick next_timestamp;
+
+    // Total number of frames, counted even if the FPS counter is stopped (may
+    // be read from any thread)
+    atomic_uint_least32_t total_rendered;
+    atomic_uint_least32_t total_skipped;
+};
+
+struct sc_fps_counter_stats {
+    uint32_t rendered;
+    uint32_t skipped;
 };
 
 bool
@@ -56,4 +67,12 @@ sc_fps_counter_add_rendered_frame(struct sc_fps_counter *counter);
 void
 sc_fps_counter_add_skipped_frame(struct sc_fps_counter *counter);
 
+/**
+ * Get the total number of frames rendered and skipped (may be called from any
+ * thread)
+ */
+void
+sc_fps_counter_get_stats(struct sc_fps_counter *counter,
+                         struct sc_fps_counter_stats *stats);
+
 #endif
@@ -0,0 +1,250 @@
+#include "frame_transform.h"
+
+#include <assert.h>
+#include <string.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+
+#include "util/log.h"
+#include "util/yuv.h"
+
+bool
+sc_frame_transform_init(struct sc_frame_transform *ft,
+                        const struct sc_rect *crop,
+                        enum sc_orientation orientation,
+                        const struct sc_size *size) {
+    ft->crop = *crop;
+    ft->orientation = orientation;
+    ft->size = *size;
+
+    ft->sws_ctx = NULL;
+
+    ft->scaled = av_frame_alloc();
+    if (!ft->scaled) {
+        LOG_OOM();
+        return false;
+    }
+
+    ft->output = av_frame_alloc();
+    if (!ft->output) {
+        LOG_OOM();
+        av_frame_free(&ft->scaled);
+        return false;
+    }
+
+    memset(&ft->content, 0, sizeof(ft->content));
+    ft->crop_warned = false;
+
+    return true;
+}
+
+void
+sc_frame_transform_destroy(struct sc_frame_transform *ft) {
+    sws_freeContext(ft->sws_ctx);
+    av_frame_free(&ft->output);
+    av_frame_free(&ft->scaled);
+}
+
+bool
+sc_frame_transform_is_identity(const struct sc_frame_transform *ft) {
+    return !ft->crop.size.width
+        && ft->orientation == SC_ORIENTATION_0
+        && !ft->size.width;
+}
+
+// Compute the crop area in the frame (aligned on chroma samples)
+static struct sc_rect
+sc_frame_transform_get_crop(struct sc_frame_transform *ft,
+                            const AVFrame *frame) {
+    struct sc_rect full = {
+        .point = {0, 0},
+        .size = {frame->width, frame->height},
+    };
+
+    if (!ft->crop.size.width) {
+        return full;
+    }
+
+    int32_t x = ft->crop.point.x & ~1;
+    int32_t y = ft->crop.point.y & ~1;
+    int32_t w = MIN(ft->crop.size.width, frame->width - x) & ~1;
+    int32_t h = MIN(ft->crop.size.height, frame->height - y) & ~1;
+    if (w <= 0 || h <= 0) {
+        // May happen if the frame size changes (e.g. on device rotation)
+        if (!ft->crop_warned) {
+            LOGW("V4L2 crop area outside the %dx%d frame, ignored",
+                 frame->width, frame->height);
+            ft->crop_warned = true;
+        }
+        return full;
+    }
+
+    struct sc_rect rect = {
+        .point = {x, y},
+        .size = {w, h},
+    };
+    return rect;
+}
+
+static inline bool
+sc_rect_equals(const struct sc_rect *a, const struct sc_rect *b) {
+    return a->point.x == b->point.x && a->point.y == b->point.y
+        && a->size.width == b->size.width && a->size.height == b->size.height;
+}
+
+static bool
+sc_frame_transform_prepare(AVFrame *frame, unsigned width, unsigned height) {
+    if (frame->data[0] && (unsigned) frame->width == width
+            && (unsigned) frame->height == height) {
+        // Already allocated
+        return true;
+    }
+
+    av_frame_unref(frame);
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        LOG_OOM();
+        return false;
+    }
+
+    return true;
+}
+
+static void
+sc_frame_transform_fill_black(AVFrame *frame) {
+    unsigned cw = (frame->width + 1) / 2;
+    unsigned ch = (frame->height + 1) / 2;
+    for (int i = 0; i < frame->height; ++i) {
+        memset(frame->data[0] + i * frame->linesize[0], 16, frame->width);
+    }
+    for (unsigned i = 0; i < ch; ++i) {
+        memset(frame->data[1] + i * frame->linesize[1], 128, cw);
+        memset(frame->data[2] + i * frame->linesize[2], 128, cw);
+    }
+}
+
+static inline void
+sc_frame_transform_get_planes(const AVFrame *frame, const struct sc_rect *rect,
+                              uint8_t *planes[3]) {
+    // rect coordinates are even
+    int32_t x = rect->point.x;
+    int32_t y = rect->point.y;
+    planes[0] = frame->data[0] + y * frame->linesize[0] + x;
+    planes[1] = frame->data[1] + y / 2 * frame->linesize[1] + x / 2;
+    planes[2] = frame->data[2] + y / 2 * frame->linesize[2] + x / 2;
+}
+
+const AVFrame *
+sc_frame_transform_apply(struct sc_frame_transform *ft, const AVFrame *frame) {
+    assert(frame->format == AV_PIX_FMT_YUV420P);
+
+    struct sc_rect crop = sc_frame_transform_get_crop(ft, frame);
+    unsigned cw = crop.size.width;
+    unsigned ch = crop.size.height;
+
+    bool swap = sc_orientation_is_swap(ft->orientation);
+    unsigned ow = swap ? ch : cw;
+    unsigned oh = swap ? cw : ch;
+
+    // Output size, and size of the content in the output
+    unsigned tw;
+    unsigned th;
+    unsigned fw;
+    unsigned fh;
+    if (ft->size.width) {
+        tw = ft->size.width;
+        th = ft->size.height;
+        // Fit the content, preserving the aspect ratio
+        if ((uint64_t) ow * th > (uint64_t) oh * tw) {
+            fw = tw;
+            fh = (uint64_t) oh * tw / ow;
+        } else {
+            fw = (uint64_t) ow * th / oh;
+            fh = th;
+        }
+        fw = MAX(fw & ~1, 2);
+        fh = MAX(fh & ~1, 2);
+    } else {
+        tw = fw = ow;
+        th = fh = oh;
+    }
+
+    if (!sc_frame_transform_prepare(ft->output, tw, th)) {
+        return NULL;
+    }
+
+    struct sc_rect content = {
+        .point = {((tw - fw) / 2) & ~1, ((th - fh) / 2) & ~1},
+        .size = {fw, fh},
+    };
+    if (!sc_rect_equals(&content, &ft->content)) {
+        // The black borders are only written when the content area changes
+        sc_frame_transform_fill_black(ft->output);
+        ft->content = content;
+    }
+
+    uint8_t *src[3];
+    sc_frame_transform_get_planes(frame, &crop, src);
+    const int *src_stride = frame->linesize;
+
+    uint8_t *dst[3];
+    sc_frame_transform_get_planes(ft->output, &content, dst);
+
+    // Size before orientation
+    unsigned sw = swap ? fh : fw;
+    unsigned sh = swap ? fw : fh;
+
+    if (sw != cw || sh != ch) {
+        // Scale directly to the output if there is no orientation to apply
+        bool direct = ft->orientation == SC_ORIENTATION_0;
+
+        ft->sws_ctx = sws_getCachedContext(ft->sws_ctx,
+                                           cw, ch, AV_PIX_FMT_YUV420P,
+                                           sw, sh, AV_PIX_FMT_YUV420P,
+                                           SWS_BILINEAR, NULL, NULL, NULL);
+        if (!ft->sws_ctx) {
+            LOGE("Could not create the scaling context");
+            return NULL;
+        }
+
+        uint8_t *const *scaled;
+        const int *scaled_stride;
+        if (direct) {
+            scaled = dst;
+            scaled_stride = ft->output->linesize;
+        } else {
+            if (!sc_frame_transform_prepare(ft->scaled, sw, sh)) {
+                return NULL;
+            }
+            scaled = ft->scaled->data;
+            scaled_stride = ft->scaled->linesize;
+        }
+
+        sws_scale(ft->sws_ctx, (const uint8_t *const *) src, src_stride, 0, ch,
+                  scaled, scaled_stride);
+
+        if (direct) {
+            ft->output->pts = frame->pts;
+            return ft->output;
+        }
+
+        // The orientation is applied from the scaled frame
+        memcpy(src, ft->scaled->data, sizeof(src));
+        src_stride = ft->scaled->linesize;
+    }
+
+    unsigned rotation = sc_orientation_get_rotation(ft->orientation);
+    bool hflip = sc_orientation_is_mirror(ft->orientation);
+    for (unsigned i = 0; i < 3; ++i) {
+        // Chroma planes are subsampled by 2 in both dimensions
+        unsigned w = i ? (sw + 1) / 2 : sw;
+        unsigned h = i ? (sh + 1) / 2 : sh;
+        sc_yuv_orient_plane(dst[i], ft->output->linesize[i], src[i],
+                            src_stride[i], w, h, rotation, hflip);
+    }
+
+    ft->output->pts = frame->pts;
+    return ft->output;
+}
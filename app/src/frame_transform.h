@@ -0,0 +1,66 @@
+#ifndef SC_FRAME_TRANSFORM_H
+#define SC_FRAME_TRANSFORM_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <libavutil/frame.h>
+
+#include "coords.h"
+#include "options.h"
+
+// forward declarations
+struct SwsContext;
+
+/**
+ * Crop, orient and scale YUV420P frames.
+ *
+ * The crop is applied first (in the frame coordinates), then the orientation.
+ * If a target size is set, the result is scaled to fit it (the aspect ratio is
+ * preserved, the remaining area is filled with black), so that the output
+ * size does not change when the input size changes (e.g. on device
+ * rotation). Otherwise, the output size is the size of the cropped and
+ * oriented frame.
+ *
+ * The scaling is applied before the orientation, so that the orientation is
+ * applied on the smallest image when downscaling.
+ */
+struct sc_frame_transform {
+    struct sc_rect crop; // no crop if the size is 0
+    enum sc_orientation orientation;
+    struct sc_size size; // no scaling if 0
+
+    struct SwsContext *sws_ctx; // cached
+    AVFrame *scaled; // scaled, before orientation
+    AVFrame *output;
+
+    // area of the output containing the frame (the rest is black)
+    struct sc_rect content;
+    bool crop_warned;
+};
+
+bool
+sc_frame_transform_init(struct sc_frame_transform *ft,
+                        const struct sc_rect *crop,
+                        enum sc_orientation orientation,
+                        const struct sc_size *size);
+
+void
+sc_frame_transform_destroy(struct sc_frame_transform *ft);
+
+/**
+ * Return true if the transformation does nothing
+ */
+bool
+sc_frame_transform_is_identity(const struct sc_frame_transform *ft);
+
+/**
+ * Transform a YUV420P frame
+ *
+ * The returned frame is owned by the transform, and valid until the next
+ * call. Return NULL on error.
+ */
+const AVFrame *
+sc_frame_transform_apply(struct sc_frame_transform *ft, const AVFrame *frame);
+
+#endif
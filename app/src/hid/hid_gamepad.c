@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "util/binary.h"
@@ -208,6 +210,10 @@ sc_hid_gamepad_slot_init(struct sc_hid_gamepad_slot *slot,
     slot->axis_right_y = AXIS_RESCALE(0);
     slot->axis_left_trigger = 0;
     slot->axis_right_trigger = 0;
+    slot->pending = false;
+    slot->last_report = 0;
+    slot->axis_events = 0;
+    slot->reports = 0;
 }
 
 static ssize_t
@@ -223,10 +229,18 @@ sc_hid_gamepad_slot_find(struct sc_hid_gamepad *hid, uint32_t gamepad_id) {
 }
 
 void
-sc_hid_gamepad_init(struct sc_hid_gamepad *hid) {
+sc_hid_gamepad_init(struct sc_hid_gamepad *hid, sc_tick report_interval,
+                    uint8_t deadzone) {
+    assert(report_interval >= 0);
+    assert(deadzone < 100);
+
     for (size_t i = 0; i < SC_MAX_GAMEPADS; ++i) {
         hid->slots[i].gamepad_id = SC_GAMEPAD_ID_INVALID;
     }
+
+    hid->report_interval = report_interval;
+    // percentage of the stick range -> [0 to 32767]
+    hid->deadzone = deadzone * 0x7FFF / 100;
 }
 
 static inline uint16_t
@@ -267,7 +281,12 @@ sc_hid_gamepad_generate_close(struct sc_hid_gamepad *hid,
         return false;
     }
 
-    hid->slots[slot_idx].gamepad_id = SC_GAMEPAD_ID_INVALID;
+    struct sc_hid_gamepad_slot *slot = &hid->slots[slot_idx];
+    if (slot->axis_events) {
+        LOGD("Gamepad %" PRIu32 ": %" PRIu32 " axis events, %" PRIu32
+             " reports", gamepad_id, slot->axis_events, slot->reports);
+    }
+    slot->gamepad_id = SC_GAMEPAD_ID_INVALID;
 
     uint16_t hid_id = sc_hid_gamepad_slot_get_id(slot_idx);
     hid_close->hid_id = hid_id;
@@ -328,6 +347,20 @@ sc_hid_gamepad_event_from_slot(uint16_t hid_id,
     data[14] = sc_hid_gamepad_get_dpad_value(slot->buttons);
 }
 
+static void
+sc_hid_gamepad_generate_report(struct sc_hid_gamepad *hid, size_t slot_idx,
+                               struct sc_hid_input *hid_input, sc_tick now) {
+    struct sc_hid_gamepad_slot *slot = &hid->slots[slot_idx];
+
+    uint16_t hid_id = sc_hid_gamepad_slot_get_id(slot_idx);
+    sc_hid_gamepad_event_from_slot(hid_id, slot, hid_input);
+
+    // The report contains the whole state, including pending changes
+    slot->pending = false;
+    slot->last_report = now;
+    ++slot->reports;
+}
+
 static uint32_t
 sc_hid_gamepad_get_button_id(enum sc_gamepad_button button) {
     switch (button) {
@@ -400,12 +433,20 @@ sc_hid_gamepad_generate_input_from_button(struct sc_hid_gamepad *hid,
         slot->buttons &= ~button;
     }
 
-    uint16_t hid_id = sc_hid_gamepad_slot_get_id(slot_idx);
-    sc_hid_gamepad_event_from_slot(hid_id, slot, hid_input);
+    // Button edges are always reported immediately
+    sc_hid_gamepad_generate_report(hid, slot_idx, hid_input, sc_tick_now());
 
     return true;
 }
 
+static uint16_t
+sc_hid_gamepad_stick_value(struct sc_hid_gamepad *hid, int16_t value) {
+    if (abs(value) <= hid->deadzone) {
+        value = 0;
+    }
+    return AXIS_RESCALE(value);
+}
+
 bool
 sc_hid_gamepad_generate_input_from_axis(struct sc_hid_gamepad *hid,
                                         struct sc_hid_input *hid_input,
@@ -422,33 +463,106 @@ sc_hid_gamepad_generate_input_from_axis(struct sc_hid_gamepad *hid,
 
     struct sc_hid_gamepad_slot *slot = &hid->slots[slot_idx];
 
+    uint16_t *axis;
+    uint16_t value;
     switch (event->axis) {
         case SC_GAMEPAD_AXIS_LEFTX:
-            slot->axis_left_x = AXIS_RESCALE(event->value);
+            axis = &slot->axis_left_x;
+            value = sc_hid_gamepad_stick_value(hid, event->value);
             break;
         case SC_GAMEPAD_AXIS_LEFTY:
-            slot->axis_left_y = AXIS_RESCALE(event->value);
+            axis = &slot->axis_left_y;
+            value = sc_hid_gamepad_stick_value(hid, event->value);
             break;
         case SC_GAMEPAD_AXIS_RIGHTX:
-            slot->axis_right_x = AXIS_RESCALE(event->value);
+            axis = &slot->axis_right_x;
+            value = sc_hid_gamepad_stick_value(hid, event->value);
             break;
         case SC_GAMEPAD_AXIS_RIGHTY:
-            slot->axis_right_y = AXIS_RESCALE(event->value);
+            axis = &slot->axis_right_y;
+            value = sc_hid_gamepad_stick_value(hid, event->value);
             break;
         case SC_GAMEPAD_AXIS_LEFT_TRIGGER:
+            axis = &slot->axis_left_trigger;
             // Trigger is always positive between 0 and 32767
-            slot->axis_left_trigger = MAX(0, event->value);
+            value = MAX(0, event->value);
             break;
         case SC_GAMEPAD_AXIS_RIGHT_TRIGGER:
+            axis = &slot->axis_right_trigger;
             // Trigger is always positive between 0 and 32767
-            slot->axis_right_trigger = MAX(0, event->value);
+            value = MAX(0, event->value);
             break;
         default:
             return false;
     }
 
-    uint16_t hid_id = sc_hid_gamepad_slot_get_id(slot_idx);
-    sc_hid_gamepad_event_from_slot(hid_id, slot, hid_input);
+    ++slot->axis_events;
+
+    if (*axis == value) {
+        // Nothing to report (typically, a motion within the deadzone)
+        return false;
+    }
+
+    *axis = value;
+
+    sc_tick now = sc_tick_now();
+    if (slot->last_report && now < slot->last_report + hid->report_interval) {
+        // Too early, the state will be reported on deadline
+        slot->pending = true;
+        return false;
+    }
+
+    sc_hid_gamepad_generate_report(hid, slot_idx, hid_input, now);
+
+    return true;
+}
+
+sc_tick
+sc_hid_gamepad_get_deadline(const struct sc_hid_gamepad *hid) {
+    sc_tick deadline = 0;
+    for (size_t i = 0; i < SC_MAX_GAMEPADS; ++i) {
+        const struct sc_hid_gamepad_slot *slot = &hid->slots[i];
+        if (slot->gamepad_id != SC_GAMEPAD_ID_INVALID && slot->pending) {
+            sc_tick slot_deadline = slot->last_report + hid->report_interval;
+            if (!deadline || slot_deadline < deadline) {
+                deadline = slot_deadline;
+            }
+        }
+    }
+
+    return deadline;
+}
+
+bool
+sc_hid_gamepad_generate_pending_input(struct sc_hid_gamepad *hid,
+                                      struct sc_hid_input *hid_input,
+                                      sc_tick now) {
+    for (size_t i = 0; i < SC_MAX_GAMEPADS; ++i) {
+        struct sc_hid_gamepad_slot *slot = &hid->slots[i];
+        if (slot->gamepad_id != SC_GAMEPAD_ID_INVALID && slot->pending
+                && now >= slot->last_report + hid->report_interval) {
+            sc_hid_gamepad_generate_report(hid, i, hid_input, now);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+sc_hid_gamepad_merge_input(struct sc_hid_input *dst,
+                           const struct sc_hid_input *src) {
+    assert(dst->hid_id == src->hid_id);
+    assert(dst->size == SC_HID_GAMEPAD_EVENT_SIZE);
+    assert(src->size == SC_HID_GAMEPAD_EVENT_SIZE);
+
+    // Button and dpad transitions must be preserved
+    if (memcmp(dst->data + 12, src->data + 12, 3)) {
+        return false;
+    }
 
+    // The axes values are absolute, the most recent report supersedes the
+    // previous one
+    memcpy(dst->data, src->data, SC_HID_GAMEPAD_EVENT_SIZE);
     return true;
 }
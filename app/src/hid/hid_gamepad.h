@@ -8,6 +8,7 @@
 
 #include "hid/hid_event.h"
 #include "input_events.h"
+#include "util/tick.h"
 
 #define SC_MAX_GAMEPADS 8
 #define SC_HID_ID_GAMEPAD_FIRST 3
@@ -22,14 +23,38 @@ struct sc_hid_gamepad_slot {
     uint16_t axis_right_y;
     uint16_t axis_left_trigger;
     uint16_t axis_right_trigger;
+
+    // the state changed since the last report
+    bool pending;
+    // date of the last report (0 if none)
+    sc_tick last_report;
+
+    // statistics, to report the reduction ratio
+    uint32_t axis_events;
+    uint32_t reports;
 };
 
 struct sc_hid_gamepad {
     struct sc_hid_gamepad_slot slots[SC_MAX_GAMEPADS];
+    // minimum interval between two reports caused by axis changes
+    sc_tick report_interval;
+    // stick values below this threshold (in [0 to 32767]) are centered
+    uint16_t deadzone;
 };
 
+/**
+ * Initialize the gamepads state
+ *
+ * Axis changes are reported at most once per report_interval (the pending
+ * state must be reported on deadline, see sc_hid_gamepad_get_deadline()).
+ * Button changes are always reported immediately.
+ *
+ * \param report_interval the minimum interval between reports, or 0
+ * \param deadzone the stick deadzone, in percent of the range
+ */
 void
-sc_hid_gamepad_init(struct sc_hid_gamepad *hid);
+sc_hid_gamepad_init(struct sc_hid_gamepad *hid, sc_tick report_interval,
+                    uint8_t deadzone);
 
 bool
 sc_hid_gamepad_generate_open(struct sc_hid_gamepad *hid,
@@ -51,4 +76,30 @@ sc_hid_gamepad_generate_input_from_axis(struct sc_hid_gamepad *hid,
                                         struct sc_hid_input *hid_input,
                                 const struct sc_gamepad_axis_event *event);
 
+/**
+ * Return the date when a pending state must be reported, or 0 if there is
+ * none
+ */
+sc_tick
+sc_hid_gamepad_get_deadline(const struct sc_hid_gamepad *hid);
+
+/**
+ * Generate a report for a pending state whose deadline is reached
+ *
+ * Return false if there is none. It must be called until it returns false.
+ */
+bool
+sc_hid_gamepad_generate_pending_input(struct sc_hid_gamepad *hid,
+                                      struct sc_hid_input *hid_input,
+                                      sc_tick now);
+
+/**
+ * Replace dst by src if they only differ by their axes values
+ *
+ * Return true if src has been merged (so it must not be sent anymore).
+ */
+bool
+sc_hid_gamepad_merge_input(struct sc_hid_input *dst,
+                           const struct sc_hid_input *src);
+
 #endif
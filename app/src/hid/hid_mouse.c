@@ -1,5 +1,6 @@
 #include "hid_mouse.h"
 
+#include <assert.h>
 #include <stdint.h>
 
 // 1 byte for buttons + padding, 1 byte for X position, 1 byte for Y position,
@@ -199,3 +200,34 @@ void sc_hid_mouse_generate_open(struct sc_hid_open *hid_open) {
 void sc_hid_mouse_generate_close(struct sc_hid_close *hid_close) {
     hid_close->hid_id = SC_HID_ID_MOUSE;
 }
+
+bool
+sc_hid_mouse_merge_input(struct sc_hid_input *dst,
+                         const struct sc_hid_input *src) {
+    assert(dst->hid_id == SC_HID_ID_MOUSE);
+    assert(src->hid_id == SC_HID_ID_MOUSE);
+    assert(dst->size == SC_HID_MOUSE_INPUT_SIZE);
+    assert(src->size == SC_HID_MOUSE_INPUT_SIZE);
+
+    // Button transitions and scrolling must be preserved
+    if (dst->data[0] != src->data[0] || dst->data[3] || src->data[3]) {
+        return false;
+    }
+
+    // A report without motion is a click, the motion must not be moved
+    // before it
+    if ((!dst->data[1] && !dst->data[2]) || (!src->data[1] && !src->data[2])) {
+        return false;
+    }
+
+    int x = (int8_t) dst->data[1] + (int8_t) src->data[1];
+    int y = (int8_t) dst->data[2] + (int8_t) src->data[2];
+    if (x < -127 || x > 127 || y < -127 || y > 127) {
+        // The merged motion would not fit in a single report
+        return false;
+    }
+
+    dst->data[1] = x;
+    dst->data[2] = y;
+    return true;
+}
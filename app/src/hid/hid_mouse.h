@@ -3,6 +3,8 @@
 
 #include "common.h"
 
+#include <stdbool.h>
+
 #include "hid/hid_event.h"
 #include "input_events.h"
 
@@ -26,4 +28,14 @@ void
 sc_hid_mouse_generate_input_from_scroll(struct sc_hid_input *hid_input,
                                     const struct sc_mouse_scroll_event *event);
 
+/**
+ * Merge the relative motion of src into dst, if both are motion reports with
+ * the same buttons state
+ *
+ * Return true if src has been merged (so it must not be sent anymore).
+ */
+bool
+sc_hid_mouse_merge_input(struct sc_hid_input *dst,
+                         const struct sc_hid_input *src);
+
 #endif
@@ -0,0 +1,474 @@
+#include "hud.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <libavutil/avutil.h>
+
+#include "util/log.h"
+
+#define SC_HUD_UPDATE_INTERVAL SC_TICK_FROM_SEC(1)
+
+#define SC_HUD_FIRST_CHAR ' '
+#define SC_HUD_LAST_CHAR '~'
+#define SC_HUD_CHAR_COUNT (SC_HUD_LAST_CHAR - SC_HUD_FIRST_CHAR + 1)
+
+#define SC_HUD_GLYPH_SIZE 8 // in pixels, before scaling
+#define SC_HUD_ATLAS_COLS 16
+#define SC_HUD_ATLAS_ROWS \
+    ((SC_HUD_CHAR_COUNT + SC_HUD_ATLAS_COLS - 1) / SC_HUD_ATLAS_COLS)
+#define SC_HUD_MARGIN 4 // in pixels, before scaling
+#define SC_HUD_MAX_COLS 80
+
+// The counters may restart from 0 (e.g. the demuxer on reconnection)
+#define SC_HUD_DELTA(CUR, LAST) ((CUR) >= (LAST) ? (CUR) - (LAST) : (CUR))
+
+// 8x8 bitmap font for the printable ASCII characters (public domain, from the
+// IBM VGA fonts), one byte per row, the least significant bit is the leftmost
+// pixel
+static const uint8_t sc_hud_font[SC_HUD_CHAR_COUNT][SC_HUD_GLYPH_SIZE] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // '!'
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // '#'
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // '$'
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // '%'
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // '&'
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '\''
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // '('
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // ')'
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // '*'
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ','
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // '.'
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // '/'
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // '0'
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // '1'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // '2'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // '3'
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // '4'
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // '5'
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // '6'
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // '7'
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // '8'
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ';'
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // '<'
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // '='
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // '>'
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // '?'
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // '@'
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // 'A'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // 'B'
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // 'C'
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // 'D'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // 'E'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // 'F'
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // 'G'
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // 'H'
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'I'
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // 'J'
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // 'K'
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // 'L'
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // 'M'
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // 'N'
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // 'O'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // 'P'
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // 'Q'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // 'R'
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // 'S'
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'T'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // 'U'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'V'
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // 'W'
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // 'X'
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // 'Y'
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // 'Z'
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // '['
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // '\\'
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ']'
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // '_'
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '`'
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // 'a'
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // 'b'
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // 'c'
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // 'd'
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // 'e'
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // 'f'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'g'
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // 'h'
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'i'
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // 'j'
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // 'k'
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'l'
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // 'm'
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // 'n'
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // 'o'
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // 'p'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // 'q'
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // 'r'
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // 's'
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // 't'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // 'u'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'v'
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // 'w'
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // 'x'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'y'
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // 'z'
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // '{'
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // '|'
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // '}'
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '~'
+};
+
+static SDL_Texture *
+sc_hud_create_atlas(SDL_Renderer *renderer) {
+    SDL_Surface *surface =
+        SDL_CreateRGBSurfaceWithFormat(0,
+                                       SC_HUD_ATLAS_COLS * SC_HUD_GLYPH_SIZE,
+                                       SC_HUD_ATLAS_ROWS * SC_HUD_GLYPH_SIZE,
+                                       32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        LOGE("Could not create HUD font surface: %s", SDL_GetError());
+        return NULL;
+    }
+
+    // The surface is initialized with transparent pixels
+    uint32_t white = SDL_MapRGBA(surface->format, 0xFF, 0xFF, 0xFF, 0xFF);
+    uint8_t *pixels = surface->pixels;
+    for (unsigned i = 0; i < SC_HUD_CHAR_COUNT; ++i) {
+        unsigned x0 = (i % SC_HUD_ATLAS_COLS) * SC_HUD_GLYPH_SIZE;
+        unsigned y0 = (i / SC_HUD_ATLAS_COLS) * SC_HUD_GLYPH_SIZE;
+        for (unsigned y = 0; y < SC_HUD_GLYPH_SIZE; ++y) {
+            uint32_t *line =
+                (uint32_t *) (pixels + (y0 + y) * surface->pitch) + x0;
+            uint8_t bits = sc_hud_font[i][y];
+            for (unsigned x = 0; x < SC_HUD_GLYPH_SIZE; ++x) {
+                if (bits & (1 << x)) {
+                    line[x] = white;
+                }
+            }
+        }
+    }
+
+    SDL_Texture *atlas = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (!atlas) {
+        LOGE("Could not create HUD font texture: %s", SDL_GetError());
+        return NULL;
+    }
+
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+    // The glyphs are scaled by an integer factor, keep them sharp
+    SDL_SetTextureScaleMode(atlas, SDL_ScaleModeNearest);
+#endif
+
+    return atlas;
+}
+
+void
+sc_hud_init(struct sc_hud *hud) {
+    hud->sources = (struct sc_hud_sources) {0};
+    hud->enabled = false;
+    hud->atlas = NULL;
+    hud->atlas_failed = false;
+    hud->glyph_count = 0;
+    hud->cols = 0;
+    hud->rows = 0;
+}
+
+void
+sc_hud_destroy(struct sc_hud *hud) {
+    if (hud->atlas) {
+        SDL_DestroyTexture(hud->atlas);
+    }
+}
+
+void
+sc_hud_reset(struct sc_hud *hud) {
+    if (hud->atlas) {
+        SDL_DestroyTexture(hud->atlas);
+        hud->atlas = NULL;
+    }
+    // The renderer may be usable again, retry
+    hud->atlas_failed = false;
+}
+
+void
+sc_hud_set_sources(struct sc_hud *hud, const struct sc_hud_sources *sources) {
+    hud->sources = *sources;
+}
+
+static void
+sc_hud_get_counters(struct sc_hud *hud, sc_tick now,
+                    struct sc_hud_counters *counters) {
+    const struct sc_hud_sources *sources = &hud->sources;
+
+    *counters = (struct sc_hud_counters) {.date = now};
+
+    if (sources->video_demuxer) {
+        struct sc_demuxer_stats stats;
+        sc_demuxer_get_stats(sources->video_demuxer, &stats);
+        counters->bytes = stats.bytes;
+        counters->packets = stats.packets;
+    }
+
+    if (sources->video_decoder) {
+        struct sc_decoder_stats stats;
+        sc_decoder_get_stats(sources->video_decoder, &stats);
+        counters->decoded = stats.frames;
+        counters->decode_time = stats.decode_time;
+    }
+
+    if (sources->fps_counter) {
+        struct sc_fps_counter_stats stats;
+        sc_fps_counter_get_stats(sources->fps_counter, &stats);
+        counters->rendered = stats.rendered;
+        counters->skipped = stats.skipped;
+    }
+}
+
+static void
+sc_hud_clear_text(struct sc_hud *hud) {
+    hud->glyph_count = 0;
+    hud->cols = 0;
+    hud->rows = 0;
+}
+
+static void
+sc_hud_add_line(struct sc_hud *hud, const char *fmt, ...) {
+    char line[SC_HUD_MAX_COLS + 1];
+
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+
+    if (len < 0) {
+        return;
+    }
+    if (len > SC_HUD_MAX_COLS) {
+        len = SC_HUD_MAX_COLS;
+    }
+
+    unsigned row = hud->rows++;
+    for (int col = 0; col < len; ++col) {
+        char c = line[col];
+        if (c <= SC_HUD_FIRST_CHAR || c > SC_HUD_LAST_CHAR) {
+            // Nothing to draw for spaces (and unsupported characters)
+            continue;
+        }
+
+        if (hud->glyph_count == SC_HUD_MAX_GLYPHS) {
+            break;
+        }
+
+        struct sc_hud_glyph *glyph = &hud->glyphs[hud->glyph_count++];
+        glyph->index = c - SC_HUD_FIRST_CHAR;
+        glyph->col = col;
+        glyph->row = row;
+    }
+
+    hud->cols = MAX(hud->cols, (unsigned) len);
+}
+
+static void
+sc_hud_update(struct sc_hud *hud, sc_tick now) {
+    const struct sc_hud_sources *sources = &hud->sources;
+
+    struct sc_hud_counters counters;
+    sc_hud_get_counters(hud, now, &counters);
+
+    struct sc_hud_counters *last = &hud->last;
+    assert(counters.date > last->date);
+    double seconds = (double) (counters.date - last->date) / SC_TICK_FREQ;
+
+    sc_hud_clear_text(hud);
+
+    if (sources->video_demuxer) {
+        uint64_t bytes = SC_HUD_DELTA(counters.bytes, last->bytes);
+        uint32_t packets = SC_HUD_DELTA(counters.packets, last->packets);
+        sc_hud_add_line(hud, "video    %.2f Mbps  %.0f packets/s",
+                        bytes * 8 / seconds / 1000000, packets / seconds);
+    }
+
+    uint32_t decoded = SC_HUD_DELTA(counters.decoded, last->decoded);
+    if (sources->fps_counter) {
+        uint32_t rendered = SC_HUD_DELTA(counters.rendered, last->rendered);
+        uint32_t skipped = SC_HUD_DELTA(counters.skipped, last->skipped);
+        if (sources->video_decoder) {
+            sc_hud_add_line(hud, "fps      %.0f decoded  %.0f rendered  "
+                                 "%.0f skipped", decoded / seconds,
+                            rendered / seconds, skipped / seconds);
+        } else {
+            sc_hud_add_line(hud, "fps      %.0f rendered  %.0f skipped",
+                            rendered / seconds, skipped / seconds);
+        }
+    }
+
+    if (sources->video_decoder) {
+        if (decoded) {
+            sc_tick decode_time =
+                SC_HUD_DELTA(counters.decode_time, last->decode_time);
+            sc_hud_add_line(hud, "decode   %.2f ms/frame",
+                            (double) decode_time / decoded / 1000);
+        } else {
+            sc_hud_add_line(hud, "decode   -");
+        }
+
+        if (hud->latency_count) {
+            sc_tick avg = hud->latency_sum / hud->latency_count;
+            sc_hud_add_line(hud, "latency  %.1f ms (max %.1f ms)",
+                            avg / 1000.0, hud->latency_max / 1000.0);
+        } else {
+            sc_hud_add_line(hud, "latency  -");
+        }
+    }
+
+    struct sc_audio_regulator_stats audio_stats;
+    if (sources->audio_player
+            && sc_audio_player_get_stats(sources->audio_player,
+                                         &audio_stats)) {
+        sc_hud_add_line(hud, "audio    %.1f/%.1f ms buffered  %" PRIu32
+                             " underflows",
+                        audio_stats.avg_buffering / 1000.0,
+                        audio_stats.target_buffering / 1000.0,
+                        audio_stats.glitches);
+    }
+
+    if (sources->controller) {
+        struct sc_controller_stats stats;
+        sc_controller_get_stats(sources->controller, &stats);
+        sc_hud_add_line(hud, "control  %u queued  %" PRIu32 " dropped",
+                        (unsigned) stats.queued, stats.dropped);
+    }
+
+    if (sources->recorder) {
+        struct sc_recorder_stats stats;
+        sc_recorder_get_stats(sources->recorder, &stats);
+        sc_hud_add_line(hud, "record   %u video  %u audio queued",
+                        (unsigned) stats.video_queued,
+                        (unsigned) stats.audio_queued);
+    }
+
+    *last = counters;
+    hud->latency_sum = 0;
+    hud->latency_max = 0;
+    hud->latency_count = 0;
+}
+
+void
+sc_hud_set_enabled(struct sc_hud *hud, bool enabled) {
+    if (enabled == hud->enabled) {
+        return;
+    }
+
+    hud->enabled = enabled;
+
+    if (enabled) {
+        // The rates are computed from the counters on the next update
+        sc_tick now = sc_tick_now();
+        sc_hud_get_counters(hud, now, &hud->last);
+        hud->latency_sum = 0;
+        hud->latency_max = 0;
+        hud->latency_count = 0;
+        hud->next_update = now + SC_HUD_UPDATE_INTERVAL;
+
+        sc_hud_clear_text(hud);
+        sc_hud_add_line(hud, "collecting statistics...");
+    }
+}
+
+void
+sc_hud_push_presented_frame(struct sc_hud *hud, int64_t pts) {
+    struct sc_decoder *decoder = hud->sources.video_decoder;
+    if (!hud->enabled || !decoder || pts == AV_NOPTS_VALUE) {
+        return;
+    }
+
+    sc_tick date = sc_decoder_get_packet_date(decoder, pts);
+    if (date < 0) {
+        return;
+    }
+
+    sc_tick latency = sc_tick_now() - date;
+    hud->latency_sum += latency;
+    hud->latency_max = MAX(hud->latency_max, latency);
+    ++hud->latency_count;
+}
+
+void
+sc_hud_draw(struct sc_hud *hud, SDL_Renderer *renderer) {
+    assert(hud->enabled);
+
+    sc_tick now = sc_tick_now();
+    if (now >= hud->next_update) {
+        sc_hud_update(hud, now);
+        hud->next_update = now + SC_HUD_UPDATE_INTERVAL;
+    }
+
+    if (!hud->atlas) {
+        if (hud->atlas_failed) {
+            // Do not retry on every frame (the error is already logged)
+            return;
+        }
+
+        hud->atlas = sc_hud_create_atlas(renderer);
+        if (!hud->atlas) {
+            hud->atlas_failed = true;
+            return;
+        }
+    }
+
+    // Scale the glyphs for large (typically HiDPI) windows
+    int output_width;
+    int output_height;
+    if (SDL_GetRendererOutputSize(renderer, &output_width, &output_height)) {
+        output_height = 0;
+    }
+    int scale = 1 + output_height / 1000;
+    int cell = SC_HUD_GLYPH_SIZE * scale;
+    int margin = SC_HUD_MARGIN * scale;
+
+    SDL_Rect background = {
+        .x = 0,
+        .y = 0,
+        .w = hud->cols * cell + 2 * margin,
+        .h = hud->rows * cell + 2 * margin,
+    };
+
+    // Restore the draw color afterwards, it is used to clear the renderer
+    uint8_t r, g, b, a;
+    SDL_BlendMode blend_mode;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+    SDL_GetRenderDrawBlendMode(renderer, &blend_mode);
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xA0);
+    SDL_RenderFillRect(renderer, &background);
+
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+    SDL_SetRenderDrawBlendMode(renderer, blend_mode);
+
+    for (unsigned i = 0; i < hud->glyph_count; ++i) {
+        const struct sc_hud_glyph *glyph = &hud->glyphs[i];
+        SDL_Rect src = {
+            .x = (glyph->index % SC_HUD_ATLAS_COLS) * SC_HUD_GLYPH_SIZE,
+            .y = (glyph->index / SC_HUD_ATLAS_COLS) * SC_HUD_GLYPH_SIZE,
+            .w = SC_HUD_GLYPH_SIZE,
+            .h = SC_HUD_GLYPH_SIZE,
+        };
+        SDL_Rect dst = {
+            .x = margin + glyph->col * cell,
+            .y = margin + glyph->row * cell,
+            .w = cell,
+            .h = cell,
+        };
+        SDL_RenderCopy(renderer, hud->atlas, &src, &dst);
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef SC_HUD_H
+#define SC_HUD_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#include "audio_player.h"
+#include "controller.h"
+#include "decoder.h"
+#include "demuxer.h"
+#include "fps_counter.h"
+#include "recorder.h"
+#include "util/tick.h"
+
+#define SC_HUD_MAX_GLYPHS 512
+
+/**
+ * The components to report the statistics of (any of them may be NULL)
+ */
+struct sc_hud_sources {
+    struct sc_demuxer *video_demuxer;
+    struct sc_decoder *video_decoder;
+    struct sc_fps_counter *fps_counter;
+    struct sc_audio_player *audio_player;
+    struct sc_controller *controller;
+    struct sc_recorder *recorder;
+};
+
+struct sc_hud_counters {
+    sc_tick date;
+    uint64_t bytes;
+    uint32_t packets;
+    uint32_t decoded;
+    sc_tick decode_time;
+    uint32_t rendered;
+    uint32_t skipped;
+};
+
+/**
+ * On-screen overlay showing the stream statistics (HUD)
+ *
+ * The statistics are collected (mostly from atomic counters) and the text is
+ * laid out once per second, when the HUD is drawn. The glyphs are copied from
+ * a texture atlas created once, so drawing the HUD on each frame costs a
+ * single rectangle fill and one texture copy per character (batched by the
+ * renderer).
+ *
+ * All the functions must be called from the main thread.
+ */
+struct sc_hud {
+    struct sc_hud_sources sources;
+    bool enabled;
+
+    // Font texture, created on the first draw (for the renderer of the first
+    // draw), and recreated after sc_hud_reset()
+    SDL_Texture *atlas;
+    bool atlas_failed;
+
+    // Layout of the current text (in character cells)
+    struct sc_hud_glyph {
+        uint8_t index; // in the atlas
+        uint8_t col;
+        uint8_t row;
+    } glyphs[SC_HUD_MAX_GLYPHS];
+    unsigned glyph_count;
+    unsigned cols;
+    unsigned rows;
+
+    sc_tick next_update;
+    // Counters on the last update, to compute the rates
+    struct sc_hud_counters last;
+
+    // Demux-to-present latency of the frames presented since the last update
+    sc_tick latency_sum;
+    sc_tick latency_max;
+    uint32_t latency_count;
+};
+
+void
+sc_hud_init(struct sc_hud *hud);
+
+/**
+ * Destroy the HUD
+ *
+ * It must be called before the renderer is destroyed.
+ */
+void
+sc_hud_destroy(struct sc_hud *hud);
+
+/**
+ * Recreate the font texture on the next draw
+ *
+ * It must be called when the renderer textures are lost
+ * (SDL_RENDER_TARGETS_RESET or SDL_RENDER_DEVICE_RESET).
+ */
+void
+sc_hud_reset(struct sc_hud *hud);
+
+void
+sc_hud_set_sources(struct sc_hud *hud, const struct sc_hud_sources *sources);
+
+void
+sc_hud_set_enabled(struct sc_hud *hud, bool enabled);
+
+static inline bool
+sc_hud_is_enabled(struct sc_hud *hud) {
+    return hud->enabled;
+}
+
+/**
+ * Register that the frame having the given PTS has just been presented (to
+ * measure the latency)
+ */
+void
+sc_hud_push_presented_frame(struct sc_hud *hud, int64_t pts);
+
+/**
+ * Draw the HUD over the current content, without presenting
+ */
+void
+sc_hud_draw(struct sc_hud *hud, SDL_Renderer *renderer);
+
+#endif
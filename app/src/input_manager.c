@@ -1,6 +1,7 @@
 #include "input_manager.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <SDL2/SDL.h>
@@ -12,6 +13,8 @@
 #include "shortcut_mod.h"
 #include "util/log.h"
 
+#define SC_MOUSE_MOTION_REPORT_INTERVAL SC_TICK_FROM_SEC(10)
+
 void
 sc_input_manager_init(struct sc_input_manager *im,
                       const struct sc_input_manager_params *params) {
@@ -41,6 +44,13 @@ sc_input_manager_init(struct sc_input_manager *im,
 
     im->mouse_buttons_state = 0;
 
+    im->mouse_motion_coalescing = params->mouse_motion_coalescing;
+    im->mouse_motion_pending = false;
+    im->mouse_motion_deadline = 0;
+    im->mouse_motion_received = 0;
+    im->mouse_motion_sent = 0;
+    im->next_mouse_motion_report = 0;
+
     im->last_keycode = SDLK_UNKNOWN;
     im->last_mod = 0;
     im->key_repeat = 0;
@@ -521,8 +531,12 @@ sc_input_manager_process_key(struct sc_input_manager *im,
                 }
                 return;
             case SDLK_i:
-                if (video && !shift && !repeat && down) {
-                    switch_fps_counter_state(im);
+                if (video && !repeat && down) {
+                    if (shift) {
+                        sc_screen_toggle_hud(im->screen);
+                    } else {
+                        switch_fps_counter_state(im);
+                    }
                 }
                 return;
             case SDLK_n:
@@ -630,12 +644,9 @@ sc_input_manager_get_position(struct sc_input_manager *im, int32_t x,
 }
 
 static void
-sc_input_manager_process_mouse_motion(struct sc_input_manager *im,
-                                      const SDL_MouseMotionEvent *event) {
-    if (event->which == SDL_TOUCH_MOUSEID) {
-        // simulated from touch events, so it's a duplicate
-        return;
-    }
+sc_input_manager_send_mouse_motion(struct sc_input_manager *im,
+                                   const SDL_MouseMotionEvent *event) {
+    ++im->mouse_motion_sent;
 
     struct sc_mouse_motion_event evt = {
         .position = sc_input_manager_get_position(im, event->x, event->y),
@@ -664,6 +675,135 @@ sc_input_manager_process_mouse_motion(struct sc_input_manager *im,
     }
 }
 
+static void
+sc_input_manager_report_mouse_motion(struct sc_input_manager *im,
+                                     sc_tick now) {
+    if (!im->next_mouse_motion_report) {
+        im->next_mouse_motion_report = now + SC_MOUSE_MOTION_REPORT_INTERVAL;
+        return;
+    }
+
+    if (now < im->next_mouse_motion_report) {
+        return;
+    }
+
+    uint32_t received = im->mouse_motion_received;
+    uint32_t sent = im->mouse_motion_sent;
+    if (sent) {
+        LOGD("Mouse motion coalescing: %" PRIu32 " events -> %" PRIu32
+             " (ratio %.1f)", received, sent, (float) received / sent);
+    }
+
+    im->mouse_motion_received = 0;
+    im->mouse_motion_sent = 0;
+    im->next_mouse_motion_report = now + SC_MOUSE_MOTION_REPORT_INTERVAL;
+}
+
+void
+sc_input_manager_flush_mouse_motion(struct sc_input_manager *im) {
+    if (!im->mouse_motion_pending) {
+        return;
+    }
+
+    im->mouse_motion_pending = false;
+    sc_input_manager_send_mouse_motion(im, &im->pending_motion);
+}
+
+sc_tick
+sc_input_manager_get_deadline(const struct sc_input_manager *im) {
+    sc_tick deadline = im->mouse_motion_pending ? im->mouse_motion_deadline
+                                                : 0;
+
+    if (im->gp && im->gp->ops->get_deadline) {
+        sc_tick gamepad_deadline = im->gp->ops->get_deadline(im->gp);
+        if (gamepad_deadline && (!deadline || gamepad_deadline < deadline)) {
+            deadline = gamepad_deadline;
+        }
+    }
+
+    return deadline;
+}
+
+void
+sc_input_manager_handle_deadline(struct sc_input_manager *im) {
+    sc_tick now = sc_tick_now();
+
+    if (im->mouse_motion_pending && now >= im->mouse_motion_deadline) {
+        sc_input_manager_flush_mouse_motion(im);
+    }
+
+    if (im->gp && im->gp->ops->get_deadline) {
+        sc_tick gamepad_deadline = im->gp->ops->get_deadline(im->gp);
+        if (gamepad_deadline && now >= gamepad_deadline) {
+            assert(im->gp->ops->process_deadline);
+            im->gp->ops->process_deadline(im->gp);
+        }
+    }
+}
+
+void
+sc_input_manager_handle_frame(struct sc_input_manager *im) {
+    if (im->mouse_motion_coalescing == SC_MOUSE_MOTION_COALESCING_FRAME) {
+        sc_input_manager_flush_mouse_motion(im);
+    }
+}
+
+static sc_tick
+sc_input_manager_get_coalescing_window(struct sc_input_manager *im) {
+    if (im->mouse_motion_coalescing != SC_MOUSE_MOTION_COALESCING_FRAME) {
+        return im->mouse_motion_coalescing;
+    }
+
+    // Send the motion on the next frame, but at least once per refresh period
+    // of the display (the device may not send any new frame)
+    int refresh_rate = 60;
+    int index = SDL_GetWindowDisplayIndex(im->screen->window);
+    SDL_DisplayMode mode;
+    if (index >= 0 && !SDL_GetCurrentDisplayMode(index, &mode)
+            && mode.refresh_rate > 0) {
+        refresh_rate = mode.refresh_rate;
+    }
+
+    return SC_TICK_FREQ / refresh_rate;
+}
+
+static void
+sc_input_manager_process_mouse_motion(struct sc_input_manager *im,
+                                      const SDL_MouseMotionEvent *event) {
+    if (event->which == SDL_TOUCH_MOUSEID) {
+        // simulated from touch events, so it's a duplicate
+        return;
+    }
+
+    ++im->mouse_motion_received;
+
+    if (!im->mouse_motion_coalescing) {
+        sc_input_manager_send_mouse_motion(im, event);
+        return;
+    }
+
+    sc_tick now = sc_tick_now();
+    sc_input_manager_report_mouse_motion(im, now);
+
+    if (im->mouse_motion_pending) {
+        // Keep the last absolute position, but accumulate the relative motion
+        int32_t xrel = im->pending_motion.xrel;
+        int32_t yrel = im->pending_motion.yrel;
+        im->pending_motion = *event;
+        im->pending_motion.xrel += xrel;
+        im->pending_motion.yrel += yrel;
+    } else {
+        im->pending_motion = *event;
+        im->mouse_motion_pending = true;
+        im->mouse_motion_deadline =
+            now + sc_input_manager_get_coalescing_window(im);
+    }
+
+    if (now >= im->mouse_motion_deadline) {
+        sc_input_manager_flush_mouse_motion(im);
+    }
+}
+
 static void
 sc_input_manager_process_touch(struct sc_input_manager *im,
                                const SDL_TouchFingerEvent *event) {
@@ -1010,9 +1150,34 @@ sc_input_manager_process_file(struct sc_input_manager *im,
     }
 }
 
+static bool
+is_ordered_input_event(uint32_t type) {
+    switch (type) {
+        case SDL_TEXTINPUT:
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        case SDL_MOUSEWHEEL:
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+        case SDL_FINGERMOTION:
+        case SDL_FINGERDOWN:
+        case SDL_FINGERUP:
+            return true;
+        default:
+            return false;
+    }
+}
+
 void
 sc_input_manager_handle_event(struct sc_input_manager *im,
                               const SDL_Event *event) {
+    if (im->mouse_motion_pending && is_ordered_input_event(event->type)) {
+        // The pending motion must be sent before any other input event, so
+        // that button transitions (and other events) happen at the exact
+        // position
+        sc_input_manager_flush_mouse_motion(im);
+    }
+
     bool control = im->controller;
     bool paused = im->screen->paused;
     switch (event->type) {
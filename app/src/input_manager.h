@@ -14,6 +14,7 @@
 #include "trait/gamepad_processor.h"
 #include "trait/key_processor.h"
 #include "trait/mouse_processor.h"
+#include "util/tick.h"
 
 struct sc_input_manager {
     struct sc_controller *controller;
@@ -36,6 +37,20 @@ struct sc_input_manager {
 
     uint8_t mouse_buttons_state; // OR of enum sc_mouse_button values
 
+    // Merge consecutive mouse motion events: 0 if disabled, a time window,
+    // or SC_MOUSE_MOTION_COALESCING_FRAME
+    sc_tick mouse_motion_coalescing;
+    // The last motion event not sent yet (with the accumulated relative
+    // motion), valid only if mouse_motion_pending
+    SDL_MouseMotionEvent pending_motion;
+    bool mouse_motion_pending;
+    // The date when the pending motion must be sent
+    sc_tick mouse_motion_deadline;
+    // Statistics, to report the reduction ratio
+    uint32_t mouse_motion_received;
+    uint32_t mouse_motion_sent;
+    sc_tick next_mouse_motion_report;
+
     // Tracks the number of identical consecutive shortcut key down events.
     // Not to be confused with event->repeat, which counts the number of
     // system-generated repeated key presses.
@@ -58,6 +73,7 @@ struct sc_input_manager_params {
     bool legacy_paste;
     bool clipboard_autosync;
     uint8_t shortcut_mods; // OR of enum sc_shortcut_mod values
+    sc_tick mouse_motion_coalescing;
 };
 
 void
@@ -68,4 +84,29 @@ void
 sc_input_manager_handle_event(struct sc_input_manager *im,
                               const SDL_Event *event);
 
+/**
+ * Return the date when the pending mouse motion or gamepad state must be
+ * sent, or 0 if there is nothing pending
+ */
+sc_tick
+sc_input_manager_get_deadline(const struct sc_input_manager *im);
+
+/**
+ * Send the pending mouse motion or gamepad state whose deadline is reached
+ */
+void
+sc_input_manager_handle_deadline(struct sc_input_manager *im);
+
+/**
+ * Send the pending mouse motion, if any
+ */
+void
+sc_input_manager_flush_mouse_motion(struct sc_input_manager *im);
+
+/**
+ * Notify that a new frame has been displayed
+ */
+void
+sc_input_manager_handle_frame(struct sc_input_manager *im);
+
 #endif
@@ -0,0 +1,153 @@
+#include "input_record.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "control_msg.h"
+#include "util/binary.h"
+#include "util/log.h"
+
+#define SC_INPUT_RECORD_MAGIC "SCIR"
+#define SC_INPUT_RECORD_HEADER_SIZE 8
+#define SC_INPUT_RECORD_ENTRY_HEADER_SIZE 8
+
+bool
+sc_input_recorder_open(struct sc_input_recorder *ir, const char *filename) {
+    ir->file = fopen(filename, "wb");
+    if (!ir->file) {
+        LOGE("Could not open input record file %s: %s", filename,
+             strerror(errno));
+        return false;
+    }
+
+    uint8_t header[SC_INPUT_RECORD_HEADER_SIZE];
+    memcpy(header, SC_INPUT_RECORD_MAGIC, 4);
+    sc_write32be(&header[4], SC_INPUT_RECORD_VERSION);
+    if (fwrite(header, sizeof(header), 1, ir->file) != 1) {
+        LOGE("Could not write input record header");
+        fclose(ir->file);
+        return false;
+    }
+
+    ir->last = sc_tick_now();
+    ir->count = 0;
+    ir->failed = false;
+
+    LOGI("Recording input events to %s", filename);
+
+    return true;
+}
+
+void
+sc_input_recorder_close(struct sc_input_recorder *ir) {
+    if (fclose(ir->file)) {
+        LOGE("Could not close input record file: %s", strerror(errno));
+        ir->failed = true;
+    }
+
+    if (!ir->failed) {
+        LOGI("Input events recorded: %u", ir->count);
+    }
+}
+
+void
+sc_input_recorder_write(struct sc_input_recorder *ir, sc_tick date,
+                        const uint8_t *data, size_t len) {
+    if (ir->failed) {
+        return;
+    }
+
+    assert(date >= ir->last);
+    sc_tick delay = date - ir->last;
+    ir->last = date;
+
+    uint8_t header[SC_INPUT_RECORD_ENTRY_HEADER_SIZE];
+    sc_write32be(&header[0], SC_TICK_TO_US(MIN(delay, UINT32_MAX)));
+    sc_write32be(&header[4], len);
+
+    // The file is buffered, this does not block on I/O for every message
+    if (fwrite(header, sizeof(header), 1, ir->file) != 1
+            || fwrite(data, len, 1, ir->file) != 1) {
+        LOGE("Could not write input record, recording stopped");
+        ir->failed = true;
+        return;
+    }
+
+    ++ir->count;
+}
+
+bool
+sc_input_record_reader_open(struct sc_input_record_reader *reader,
+                            const char *filename) {
+    reader->file = fopen(filename, "rb");
+    if (!reader->file) {
+        LOGE("Could not open input record file %s: %s", filename,
+             strerror(errno));
+        return false;
+    }
+
+    uint8_t header[SC_INPUT_RECORD_HEADER_SIZE];
+    if (fread(header, sizeof(header), 1, reader->file) != 1
+            || memcmp(header, SC_INPUT_RECORD_MAGIC, 4)) {
+        LOGE("Not an input record file: %s", filename);
+        goto error;
+    }
+
+    uint32_t version = sc_read32be(&header[4]);
+    if (version != SC_INPUT_RECORD_VERSION) {
+        LOGE("Unsupported input record version: %" PRIu32, version);
+        goto error;
+    }
+
+    reader->buf = malloc(SC_CONTROL_MSG_MAX_SIZE);
+    if (!reader->buf) {
+        LOG_OOM();
+        goto error;
+    }
+
+    return true;
+
+error:
+    fclose(reader->file);
+    return false;
+}
+
+void
+sc_input_record_reader_close(struct sc_input_record_reader *reader) {
+    free(reader->buf);
+    fclose(reader->file);
+}
+
+int
+sc_input_record_reader_next(struct sc_input_record_reader *reader,
+                            sc_tick *delay, const uint8_t **data,
+                            size_t *len) {
+    uint8_t header[SC_INPUT_RECORD_ENTRY_HEADER_SIZE];
+    size_t r = fread(header, 1, sizeof(header), reader->file);
+    if (!r && feof(reader->file)) {
+        return 0; // end of file
+    }
+    if (r != sizeof(header)) {
+        LOGE("Truncated input record file");
+        return -1;
+    }
+
+    uint32_t size = sc_read32be(&header[4]);
+    if (!size || size > SC_CONTROL_MSG_MAX_SIZE) {
+        LOGE("Invalid input record entry size: %" PRIu32, size);
+        return -1;
+    }
+
+    if (fread(reader->buf, size, 1, reader->file) != 1) {
+        LOGE("Truncated input record file");
+        return -1;
+    }
+
+    *delay = SC_TICK_FROM_US(sc_read32be(&header[0]));
+    *data = reader->buf;
+    *len = size;
+    return 1;
+}
@@ -0,0 +1,81 @@
+#ifndef SC_INPUT_RECORD_H
+#define SC_INPUT_RECORD_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "util/tick.h"
+
+/**
+ * Input record file format
+ *
+ * The file starts with a header:
+ *
+ *     magic "SCIR" (4 bytes), version (4 bytes)
+ *
+ * followed by one entry per control message sent to the device:
+ *
+ *     delay since the previous entry in microseconds (4 bytes)
+ *     length (4 bytes)
+ *     serialized control message (length bytes)
+ *
+ * All the integers are big-endian. A delay longer than UINT32_MAX (more than
+ * one hour) is recorded as UINT32_MAX.
+ */
+#define SC_INPUT_RECORD_VERSION 1
+
+/**
+ * Write the control messages sent to the device to a file
+ *
+ * The functions must be called from a single thread at a time.
+ */
+struct sc_input_recorder {
+    FILE *file;
+    // date of the previous entry
+    sc_tick last;
+    unsigned count;
+    bool failed;
+};
+
+bool
+sc_input_recorder_open(struct sc_input_recorder *ir, const char *filename);
+
+void
+sc_input_recorder_close(struct sc_input_recorder *ir);
+
+/**
+ * Append a serialized control message, sent at the given date
+ */
+void
+sc_input_recorder_write(struct sc_input_recorder *ir, sc_tick date,
+                        const uint8_t *data, size_t len);
+
+struct sc_input_record_reader {
+    FILE *file;
+    uint8_t *buf; // SC_CONTROL_MSG_MAX_SIZE bytes
+};
+
+bool
+sc_input_record_reader_open(struct sc_input_record_reader *reader,
+                            const char *filename);
+
+void
+sc_input_record_reader_close(struct sc_input_record_reader *reader);
+
+/**
+ * Read the next entry
+ *
+ * The data remains valid until the next call.
+ *
+ * Return 1 if an entry has been read, 0 at end of file, -1 on error.
+ */
+int
+sc_input_record_reader_next(struct sc_input_record_reader *reader,
+                            sc_tick *delay, const uint8_t **data,
+                            size_t *len);
+
+#endif
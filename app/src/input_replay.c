@@ -0,0 +1,168 @@
+#include "input_replay.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "control_msg.h"
+#include "util/log.h"
+
+bool
+sc_input_replayer_init(struct sc_input_replayer *replayer,
+                       const char *filename, unsigned speed,
+                       struct sc_controller *controller) {
+    assert(speed);
+
+    bool ok = sc_input_record_reader_open(&replayer->reader, filename);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_mutex_init(&replayer->mutex);
+    if (!ok) {
+        sc_input_record_reader_close(&replayer->reader);
+        return false;
+    }
+
+    ok = sc_cond_init(&replayer->cond);
+    if (!ok) {
+        sc_mutex_destroy(&replayer->mutex);
+        sc_input_record_reader_close(&replayer->reader);
+        return false;
+    }
+
+    replayer->controller = controller;
+    replayer->speed = speed;
+    replayer->stopped = false;
+    replayer->skipped = 0;
+    sc_histogram_init(&replayer->jitter);
+
+    return true;
+}
+
+void
+sc_input_replayer_destroy(struct sc_input_replayer *replayer) {
+    sc_cond_destroy(&replayer->cond);
+    sc_mutex_destroy(&replayer->mutex);
+    sc_input_record_reader_close(&replayer->reader);
+}
+
+// Return false if stopped
+static bool
+sc_input_replayer_wait_until(struct sc_input_replayer *replayer,
+                             sc_tick deadline) {
+    sc_mutex_lock(&replayer->mutex);
+    bool timed_out = false;
+    while (!replayer->stopped && !timed_out) {
+        timed_out = !sc_cond_timedwait(&replayer->cond, &replayer->mutex,
+                                       deadline);
+    }
+    bool stopped = replayer->stopped;
+    sc_mutex_unlock(&replayer->mutex);
+
+    return !stopped;
+}
+
+static bool
+is_replayable(uint8_t type) {
+    // The UHID devices are created and destroyed by the current session
+    return type != SC_CONTROL_MSG_TYPE_UHID_CREATE
+        && type != SC_CONTROL_MSG_TYPE_UHID_DESTROY;
+}
+
+static void
+sc_input_replayer_report(struct sc_input_replayer *replayer) {
+    struct sc_histogram *h = &replayer->jitter;
+    uint32_t count = sc_histogram_count(h);
+    if (!count) {
+        LOGI("Input replay: no events replayed");
+        return;
+    }
+
+    LOGI("Input replay: %" PRIu32 " events (%u skipped), scheduling jitter: "
+         "p50=%" PRItick "us p99=%" PRItick "us max=%" PRItick "us",
+         count, replayer->skipped, sc_histogram_quantile(h, 500),
+         sc_histogram_quantile(h, 990), sc_histogram_max(h));
+}
+
+static int
+run_input_replayer(void *data) {
+    struct sc_input_replayer *replayer = data;
+
+    sc_tick start = sc_tick_now();
+    // original date of the current entry, relative to the start
+    sc_tick t = 0;
+
+    for (;;) {
+        sc_tick delay;
+        const uint8_t *buf;
+        size_t len;
+        int r = sc_input_record_reader_next(&replayer->reader, &delay, &buf,
+                                            &len);
+        if (r <= 0) {
+            // End of file or error (already logged)
+            break;
+        }
+
+        t += delay;
+        sc_tick deadline = start + t * 100 / replayer->speed;
+        if (!sc_input_replayer_wait_until(replayer, deadline)) {
+            LOGD("Input replay interrupted");
+            break;
+        }
+
+        if (!is_replayable(buf[0])) {
+            ++replayer->skipped;
+            continue;
+        }
+
+        struct sc_control_msg msg;
+        ssize_t consumed = sc_control_msg_deserialize(buf, len, &msg);
+        if (consumed != (ssize_t) len) {
+            if (consumed > 0) {
+                sc_control_msg_destroy(&msg);
+            }
+            LOGW("Invalid control message in input record, skipped");
+            ++replayer->skipped;
+            continue;
+        }
+
+        if (!sc_controller_push_msg_blocking(replayer->controller, &msg)) {
+            // The controller is stopped
+            sc_control_msg_destroy(&msg);
+            break;
+        }
+
+        sc_histogram_record(&replayer->jitter, sc_tick_now() - deadline);
+    }
+
+    sc_input_replayer_report(replayer);
+
+    return 0;
+}
+
+bool
+sc_input_replayer_start(struct sc_input_replayer *replayer) {
+    LOGD("Starting input replayer thread");
+
+    bool ok = sc_thread_create(&replayer->thread, run_input_replayer,
+                               "scrcpy-replay", replayer);
+    if (!ok) {
+        LOGE("Could not start input replayer thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_input_replayer_stop(struct sc_input_replayer *replayer) {
+    sc_mutex_lock(&replayer->mutex);
+    replayer->stopped = true;
+    sc_cond_signal(&replayer->cond);
+    sc_mutex_unlock(&replayer->mutex);
+}
+
+void
+sc_input_replayer_join(struct sc_input_replayer *replayer) {
+    sc_thread_join(&replayer->thread, NULL);
+}
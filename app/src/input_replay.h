@@ -0,0 +1,62 @@
+#ifndef SC_INPUT_REPLAY_H
+#define SC_INPUT_REPLAY_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "controller.h"
+#include "input_record.h"
+#include "util/histogram.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Reinject the control messages of an input record file, with their original
+ * timing (possibly time-scaled)
+ *
+ * The UHID device creation and destruction messages are skipped: the UHID
+ * devices belong to the current session.
+ *
+ * The scheduling jitter (the delay between the scheduled date and the actual
+ * push to the controller) is measured and reported at the end.
+ */
+struct sc_input_replayer {
+    struct sc_controller *controller;
+    struct sc_input_record_reader reader;
+    // in percent of the original speed
+    unsigned speed;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    struct sc_histogram jitter;
+    unsigned skipped;
+};
+
+/**
+ * Initialize an input replayer
+ *
+ * \param speed the replay speed, in percent of the original speed (e.g. 200
+ *              to replay twice as fast)
+ */
+bool
+sc_input_replayer_init(struct sc_input_replayer *replayer,
+                       const char *filename, unsigned speed,
+                       struct sc_controller *controller);
+
+void
+sc_input_replayer_destroy(struct sc_input_replayer *replayer);
+
+bool
+sc_input_replayer_start(struct sc_input_replayer *replayer);
+
+void
+sc_input_replayer_stop(struct sc_input_replayer *replayer);
+
+void
+sc_input_replayer_join(struct sc_input_replayer *replayer);
+
+#endif
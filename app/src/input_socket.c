@@ -0,0 +1,599 @@
+#include "input_socket.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "control_msg.h"
+#include "util/log.h"
+
+// Interval between the interpolated move events of a swipe
+#define SC_INPUT_SOCKET_SWIPE_INTERVAL SC_TICK_FROM_MS(5)
+// Maximum number of keycodes in a single "key" command
+#define SC_INPUT_SOCKET_MAX_KEYCODES 64
+
+struct sc_path_point {
+    sc_tick t;
+    struct sc_point point;
+};
+
+bool
+sc_input_socket_init(struct sc_input_socket *is, const char *path,
+                     struct sc_controller *controller) {
+    // Backlog of 1: a single client is served at a time
+    if (!net_unix_listen(&is->listener, path, 1, "input")) {
+        return false;
+    }
+
+    bool ok = sc_mutex_init(&is->mutex);
+    if (!ok) {
+        goto error_close_listener;
+    }
+
+    ok = sc_cond_init(&is->cond);
+    if (!ok) {
+        sc_mutex_destroy(&is->mutex);
+        goto error_close_listener;
+    }
+
+    is->controller = controller;
+    is->stopped = false;
+
+    LOGI("Input socket listening on %s", path);
+
+    return true;
+
+error_close_listener:
+    net_unix_close(&is->listener);
+
+    return false;
+}
+
+void
+sc_input_socket_destroy(struct sc_input_socket *is) {
+    sc_cond_destroy(&is->cond);
+    sc_mutex_destroy(&is->mutex);
+    net_unix_close(&is->listener);
+}
+
+static void
+sc_input_socket_reply(int fd, const char *fmt, ...) {
+    char line[256];
+
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+    va_end(ap);
+
+    if (len < 0) {
+        return;
+    }
+    if ((size_t) len > sizeof(line) - 2) {
+        len = sizeof(line) - 2;
+    }
+    line[len++] = '\n';
+
+    // Ignore errors: a disconnection is detected by the next read
+    net_unix_send_all(fd, line, len);
+}
+
+// Return false if interrupted
+static bool
+sc_input_socket_wait_until(struct sc_input_socket *is, sc_tick deadline) {
+    sc_mutex_lock(&is->mutex);
+    bool timed_out = false;
+    while (!is->stopped && !timed_out) {
+        timed_out = !sc_cond_timedwait(&is->cond, &is->mutex, deadline);
+    }
+    bool stopped = is->stopped;
+    sc_mutex_unlock(&is->mutex);
+
+    return !stopped;
+}
+
+// Return false if interrupted
+static bool
+sc_input_socket_wait(struct sc_input_socket *is, sc_tick delay) {
+    is->cursor += delay;
+    if (is->cursor <= sc_tick_now()) {
+        // Late, do not wait
+        return true;
+    }
+    return sc_input_socket_wait_until(is, is->cursor);
+}
+
+static bool
+sc_input_socket_push(struct sc_input_socket *is,
+                     const struct sc_control_msg *msg) {
+    // Never drop scripted events: block until the controller accepts it
+    return sc_controller_push_msg_blocking(is->controller, msg);
+}
+
+static bool
+sc_input_socket_push_touch(struct sc_input_socket *is,
+                           enum android_motionevent_action action,
+                           struct sc_point point, uint64_t pointer_id) {
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT;
+    msg.inject_touch_event.action = action;
+    msg.inject_touch_event.position.screen_size = is->size;
+    msg.inject_touch_event.position.point = point;
+    msg.inject_touch_event.pointer_id = pointer_id;
+    msg.inject_touch_event.pressure =
+        action == AMOTION_EVENT_ACTION_UP ? 0.0f : 1.0f;
+    msg.inject_touch_event.action_button = 0;
+    msg.inject_touch_event.buttons = 0;
+
+    return sc_input_socket_push(is, &msg);
+}
+
+static bool
+sc_input_socket_push_key(struct sc_input_socket *is,
+                         enum android_keyevent_action action,
+                         enum android_keycode keycode) {
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_INJECT_KEYCODE;
+    msg.inject_keycode.action = action;
+    msg.inject_keycode.keycode = keycode;
+    msg.inject_keycode.repeat = 0;
+    msg.inject_keycode.metastate = 0;
+
+    return sc_input_socket_push(is, &msg);
+}
+
+static char *
+next_token(char **s) {
+    char *p = *s;
+    while (*p == ' ' || *p == '\t') {
+        ++p;
+    }
+    if (!*p) {
+        *s = p;
+        return NULL;
+    }
+
+    char *token = p;
+    while (*p && *p != ' ' && *p != '\t') {
+        ++p;
+    }
+    if (*p) {
+        *p++ = '\0';
+    }
+    *s = p;
+    return token;
+}
+
+static bool
+parse_long(const char *s, long min, long max, long *out) {
+    if (!s) {
+        return false;
+    }
+
+    char *endptr;
+    errno = 0;
+    long value = strtol(s, &endptr, 10);
+    if (errno || endptr == s || *endptr || value < min || value > max) {
+        return false;
+    }
+
+    *out = value;
+    return true;
+}
+
+static bool
+parse_coord(const char *s, int32_t *out) {
+    long value;
+    if (!parse_long(s, INT32_MIN, INT32_MAX, &value)) {
+        return false;
+    }
+
+    *out = value;
+    return true;
+}
+
+static bool
+parse_point(char **s, struct sc_point *out) {
+    return parse_coord(next_token(s), &out->x)
+        && parse_coord(next_token(s), &out->y);
+}
+
+static bool
+parse_duration(const char *s, sc_tick *out) {
+    long ms;
+    // Up to 1 hour
+    if (!parse_long(s, 0, 3600000, &ms)) {
+        return false;
+    }
+
+    *out = SC_TICK_FROM_MS(ms);
+    return true;
+}
+
+// Parse the next "T,X,Y" item from a path (without modifying the string)
+static bool
+parse_path_point(const char **s, struct sc_path_point *out) {
+    const char *p = *s;
+    long values[3];
+    for (int i = 0; i < 3; ++i) {
+        char *endptr;
+        errno = 0;
+        values[i] = strtol(p, &endptr, 10);
+        if (errno || endptr == p) {
+            return false;
+        }
+        char expected = i < 2 ? ',' : '\0';
+        if (expected && *endptr != expected) {
+            return false;
+        }
+        if (!expected && *endptr && *endptr != ' ' && *endptr != '\t') {
+            return false;
+        }
+        p = expected ? endptr + 1 : endptr;
+    }
+
+    if (values[0] < 0 || values[0] > 3600000
+            || values[1] < INT32_MIN || values[1] > INT32_MAX
+            || values[2] < INT32_MIN || values[2] > INT32_MAX) {
+        return false;
+    }
+
+    out->t = SC_TICK_FROM_MS(values[0]);
+    out->point.x = values[1];
+    out->point.y = values[2];
+
+    while (*p == ' ' || *p == '\t') {
+        ++p;
+    }
+    *s = p;
+    return true;
+}
+
+static bool
+sc_input_socket_swipe(struct sc_input_socket *is, struct sc_point from,
+                      struct sc_point to, sc_tick duration) {
+    uint64_t id = SC_POINTER_ID_GENERIC_FINGER;
+    if (!sc_input_socket_push_touch(is, AMOTION_EVENT_ACTION_DOWN, from, id)) {
+        return false;
+    }
+
+    sc_tick start = is->cursor;
+    sc_tick t = 0;
+    while (t < duration) {
+        t = MIN(t + SC_INPUT_SOCKET_SWIPE_INTERVAL, duration);
+        is->cursor = start;
+        if (!sc_input_socket_wait(is, t)) {
+            return false;
+        }
+
+        struct sc_point point = {
+            .x = from.x + (int64_t) (to.x - from.x) * t / duration,
+            .y = from.y + (int64_t) (to.y - from.y) * t / duration,
+        };
+        if (!sc_input_socket_push_touch(is, AMOTION_EVENT_ACTION_MOVE, point,
+                                        id)) {
+            return false;
+        }
+    }
+
+    return sc_input_socket_push_touch(is, AMOTION_EVENT_ACTION_UP, to, id);
+}
+
+static bool
+sc_input_socket_path(struct sc_input_socket *is, int fd, const char *args) {
+    // Validate the whole path first, so that an invalid point never leaves a
+    // finger down
+    struct sc_path_point p;
+    sc_tick prev = 0;
+    unsigned count = 0;
+    for (const char *s = args; *s; ++count) {
+        if (!parse_path_point(&s, &p) || p.t < prev) {
+            sc_input_socket_reply(fd, "error invalid path point #%u", count);
+            return true;
+        }
+        prev = p.t;
+    }
+
+    if (count < 2) {
+        sc_input_socket_reply(fd, "error a path requires at least 2 points");
+        return true;
+    }
+
+    uint64_t id = SC_POINTER_ID_GENERIC_FINGER;
+    sc_tick start = is->cursor;
+    unsigned i = 0;
+    for (const char *s = args; *s; ++i) {
+        bool ok = parse_path_point(&s, &p);
+        assert(ok);
+        (void) ok;
+
+        is->cursor = start;
+        if (!sc_input_socket_wait(is, p.t)) {
+            return false;
+        }
+
+        enum android_motionevent_action action =
+            i == 0 ? AMOTION_EVENT_ACTION_DOWN
+                   : i == count - 1 ? AMOTION_EVENT_ACTION_UP
+                                    : AMOTION_EVENT_ACTION_MOVE;
+        if (!sc_input_socket_push_touch(is, action, p.point, id)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Return false if the session must be interrupted
+static bool
+sc_input_socket_process_line(struct sc_input_socket *is, int fd, char *line) {
+    char *s = line;
+    char *cmd = next_token(&s);
+    if (!cmd) {
+        // Empty line
+        return true;
+    }
+
+    if (!strcmp(cmd, "ping")) {
+        // All the previous commands have already been pushed
+        const char *token = next_token(&s);
+        sc_input_socket_reply(fd, "pong %s", token ? token : "");
+        return true;
+    }
+
+    if (!strcmp(cmd, "wait")) {
+        sc_tick delay;
+        if (!parse_duration(next_token(&s), &delay)) {
+            sc_input_socket_reply(fd, "error invalid wait duration");
+            return true;
+        }
+        return sc_input_socket_wait(is, delay);
+    }
+
+    if (!strcmp(cmd, "size")) {
+        long w, h;
+        if (!parse_long(next_token(&s), 1, 0xFFFF, &w)
+                || !parse_long(next_token(&s), 1, 0xFFFF, &h)) {
+            sc_input_socket_reply(fd, "error invalid size");
+            return true;
+        }
+        is->size.width = w;
+        is->size.height = h;
+        return true;
+    }
+
+    if (!strcmp(cmd, "text")) {
+        while (*s == ' ' || *s == '\t') {
+            ++s;
+        }
+        if (!*s) {
+            sc_input_socket_reply(fd, "error empty text");
+            return true;
+        }
+
+        struct sc_control_msg msg;
+        msg.type = SC_CONTROL_MSG_TYPE_INJECT_TEXT;
+        msg.inject_text.text = strdup(s);
+        if (!msg.inject_text.text) {
+            LOG_OOM();
+            return false;
+        }
+        if (!sc_input_socket_push(is, &msg)) {
+            free(msg.inject_text.text);
+            return false;
+        }
+        return true;
+    }
+
+    if (!strcmp(cmd, "key")) {
+        // Parse all the keycodes before pushing anything
+        enum android_keycode keycodes[SC_INPUT_SOCKET_MAX_KEYCODES];
+        unsigned count = 0;
+        for (char *t = next_token(&s); t; t = next_token(&s)) {
+            long keycode;
+            if (!parse_long(t, 0, INT32_MAX, &keycode)) {
+                sc_input_socket_reply(fd, "error invalid keycode: %s", t);
+                return true;
+            }
+            if (count == SC_INPUT_SOCKET_MAX_KEYCODES) {
+                sc_input_socket_reply(fd, "error too many keycodes");
+                return true;
+            }
+            keycodes[count++] = keycode;
+        }
+        if (!count) {
+            sc_input_socket_reply(fd, "error missing keycode");
+            return true;
+        }
+
+        for (unsigned i = 0; i < count; ++i) {
+            enum android_keycode keycode = keycodes[i];
+            if (!sc_input_socket_push_key(is, AKEY_EVENT_ACTION_DOWN, keycode)
+                    || !sc_input_socket_push_key(is, AKEY_EVENT_ACTION_UP,
+                                                 keycode)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // All the remaining commands are touch events
+    if (!is->size.width) {
+        sc_input_socket_reply(fd, "error size not set");
+        return true;
+    }
+
+    if (!strcmp(cmd, "path")) {
+        return sc_input_socket_path(is, fd, s);
+    }
+
+    if (strcmp(cmd, "down") && strcmp(cmd, "move") && strcmp(cmd, "up")
+            && strcmp(cmd, "tap") && strcmp(cmd, "swipe")) {
+        sc_input_socket_reply(fd, "error unknown command: %s", cmd);
+        return true;
+    }
+
+    struct sc_point point;
+    if (!parse_point(&s, &point)) {
+        sc_input_socket_reply(fd, "error invalid position");
+        return true;
+    }
+
+    enum android_motionevent_action action;
+    if (!strcmp(cmd, "down")) {
+        action = AMOTION_EVENT_ACTION_DOWN;
+    } else if (!strcmp(cmd, "move")) {
+        action = AMOTION_EVENT_ACTION_MOVE;
+    } else if (!strcmp(cmd, "up")) {
+        action = AMOTION_EVENT_ACTION_UP;
+    } else if (!strcmp(cmd, "tap")) {
+        sc_tick duration = 0;
+        const char *arg = next_token(&s);
+        if (arg && !parse_duration(arg, &duration)) {
+            sc_input_socket_reply(fd, "error invalid tap duration");
+            return true;
+        }
+
+        uint64_t id = SC_POINTER_ID_GENERIC_FINGER;
+        return sc_input_socket_push_touch(is, AMOTION_EVENT_ACTION_DOWN, point,
+                                          id)
+            && sc_input_socket_wait(is, duration)
+            && sc_input_socket_push_touch(is, AMOTION_EVENT_ACTION_UP, point,
+                                          id);
+    } else {
+        assert(!strcmp(cmd, "swipe"));
+        struct sc_point to;
+        sc_tick duration;
+        if (!parse_point(&s, &to)) {
+            sc_input_socket_reply(fd, "error invalid position");
+            return true;
+        }
+        if (!parse_duration(next_token(&s), &duration)) {
+            sc_input_socket_reply(fd, "error invalid swipe duration");
+            return true;
+        }
+        return sc_input_socket_swipe(is, point, to, duration);
+    }
+
+    uint64_t id = SC_POINTER_ID_GENERIC_FINGER;
+    const char *arg = next_token(&s);
+    if (arg) {
+        char *endptr;
+        errno = 0;
+        id = strtoull(arg, &endptr, 10);
+        if (errno || endptr == arg || *endptr) {
+            sc_input_socket_reply(fd, "error invalid pointer id");
+            return true;
+        }
+    }
+
+    return sc_input_socket_push_touch(is, action, point, id);
+}
+
+static void
+sc_input_socket_process_client(struct sc_input_socket *is, int fd) {
+    // Reset the session state
+    is->size.width = 0;
+    is->size.height = 0;
+    is->cursor = sc_tick_now();
+
+    size_t len = 0;
+    for (;;) {
+        bool blocked;
+        if (!net_unix_wait_readable(&is->listener, fd, 0, &blocked)) {
+            return;
+        }
+
+        ssize_t r = recv(fd, is->buf + len, sizeof(is->buf) - len, 0);
+        if (r <= 0) {
+            // Disconnected
+            return;
+        }
+        len += r;
+
+        sc_tick now = sc_tick_now();
+        if (blocked && is->cursor < now) {
+            // The client was idle: restart the timeline from now (otherwise,
+            // keep the schedule of the batch being processed)
+            is->cursor = now;
+        }
+
+        char *line = is->buf;
+        char *end = is->buf + len;
+        char *eol;
+        while ((eol = memchr(line, '\n', end - line))) {
+            *eol = '\0';
+            if (eol > line && eol[-1] == '\r') {
+                eol[-1] = '\0';
+            }
+            if (!sc_input_socket_process_line(is, fd, line)) {
+                return;
+            }
+            line = eol + 1;
+        }
+
+        len = end - line;
+        if (len == sizeof(is->buf)) {
+            sc_input_socket_reply(fd, "error line too long");
+            LOGW("Input socket: line too long, disconnecting client");
+            return;
+        }
+        memmove(is->buf, line, len);
+    }
+}
+
+static int
+run_input_socket(void *data) {
+    struct sc_input_socket *is = data;
+
+    for (;;) {
+        int fd = net_unix_accept(&is->listener);
+        if (fd == -1) {
+            // Interrupted or failed
+            break;
+        }
+
+        LOGI("Input socket client connected");
+        sc_input_socket_process_client(is, fd);
+        close(fd);
+        LOGI("Input socket client disconnected");
+    }
+
+    LOGD("Input socket thread ended");
+
+    return 0;
+}
+
+bool
+sc_input_socket_start(struct sc_input_socket *is) {
+    LOGD("Starting input socket thread");
+
+    bool ok = sc_thread_create(&is->thread, run_input_socket,
+                               "scrcpy-input", is);
+    if (!ok) {
+        LOGE("Could not start input socket thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_input_socket_stop(struct sc_input_socket *is) {
+    sc_mutex_lock(&is->mutex);
+    is->stopped = true;
+    sc_cond_signal(&is->cond);
+    sc_mutex_unlock(&is->mutex);
+
+    net_unix_interrupt(&is->listener);
+}
+
+void
+sc_input_socket_join(struct sc_input_socket *is) {
+    sc_thread_join(&is->thread, NULL);
+}
@@ -0,0 +1,74 @@
+#ifndef SC_INPUT_SOCKET_H
+#define SC_INPUT_SOCKET_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "controller.h"
+#include "coords.h"
+#include "util/net_unix.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define SC_INPUT_SOCKET_BUFFER_SIZE 0x10000 // max line length
+
+/**
+ * Local Unix-domain socket accepting scripted input commands.
+ *
+ * A client (one at a time) sends newline-separated text commands, which are
+ * converted to control messages and pushed to the controller directly (they
+ * bypass the SDL event loop). Timed commands are scheduled relative to the
+ * end of the previous command, so that a batch sent at once is replayed with
+ * precise timing.
+ *
+ * Commands:
+ *
+ *     size WIDTH HEIGHT             set the video size the coordinates refer to
+ *     down|move|up X Y [ID]         inject a touch event for pointer ID
+ *     tap X Y [MS]                  press and release (after MS)
+ *     swipe X1 Y1 X2 Y2 MS          linear swipe lasting MS
+ *     path T,X,Y T,X,Y...           swipe along points, T in ms from start
+ *     key KEYCODE...                press and release Android keycodes
+ *     text TEXT                     inject text
+ *     wait MS                       delay the next command
+ *     ping TOKEN                    reply "pong TOKEN" once all previous
+ *                                   commands have been pushed
+ *
+ * On error, the command is ignored and "error MESSAGE" is replied.
+ */
+struct sc_input_socket {
+    struct sc_controller *controller;
+
+    struct sc_unix_listener listener;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    // signaled on stop to interrupt the scheduled waits
+    sc_cond cond;
+    bool stopped;
+
+    // Session state, accessed only from the input socket thread
+    struct sc_size size;
+    // date of the next timed command
+    sc_tick cursor;
+    char buf[SC_INPUT_SOCKET_BUFFER_SIZE];
+};
+
+bool
+sc_input_socket_init(struct sc_input_socket *is, const char *path,
+                     struct sc_controller *controller);
+
+void
+sc_input_socket_destroy(struct sc_input_socket *is);
+
+bool
+sc_input_socket_start(struct sc_input_socket *is);
+
+void
+sc_input_socket_stop(struct sc_input_socket *is);
+
+void
+sc_input_socket_join(struct sc_input_socket *is);
+
+#endif
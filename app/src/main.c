@@ -1,15 +1,13 @@
 #include "common.h"
 
 #include <stdbool.h>
-#ifdef HAVE_V4L2
-# include <libavdevice/avdevice.h>
-#endif
 #define SDL_MAIN_HANDLED // avoid link error on Linux Windows Subsystem
 #include <SDL2/SDL.h>
 
 #include "cli.h"
 #include "options.h"
 #include "scrcpy.h"
+#include "scrcpy_multi.h"
 #include "usb/scrcpy_otg.h"
 #include "util/log.h"
 #include "util/net.h"
@@ -72,26 +70,28 @@ main_scrcpy(int argc, char *argv[]) {
     av_register_all();
 #endif
 
-#ifdef HAVE_V4L2
-    if (args.opts.v4l2_device) {
-        avdevice_register_all();
-    }
-#endif
-
     if (!net_init()) {
         ret = SCRCPY_EXIT_FAILURE;
         goto end;
     }
 
     sc_log_configure();
+    // On error, the logs are written synchronously
+    sc_log_start_async();
 
+    if (args.opts.serials) {
+        ret = scrcpy_multi(&args.opts);
+    } else {
 #ifdef HAVE_USB
-    ret = args.opts.otg ? scrcpy_otg(&args.opts) : scrcpy(&args.opts);
+        ret = args.opts.otg ? scrcpy_otg(&args.opts) : scrcpy(&args.opts);
 #else
-    ret = scrcpy(&args.opts);
+        ret = scrcpy(&args.opts);
 #endif
+    }
 
 end:
+    sc_log_stop_async();
+
     if (args.pause_on_exit == SC_PAUSE_ON_EXIT_TRUE ||
             (args.pause_on_exit == SC_PAUSE_ON_EXIT_IF_ERROR &&
                 ret != SCRCPY_EXIT_SUCCESS)) {
@@ -0,0 +1,493 @@
+#include "metrics.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+#include "util/log.h"
+#include "util/net_intr.h"
+#include "util/process.h"
+
+// Maximum size of an HTTP request header
+#define SC_METRICS_REQUEST_MAX_SIZE 4096
+// Maximum time to receive a request, so that a client which never completes
+// its request does not block the (single) metrics thread
+#define SC_METRICS_REQUEST_TIMEOUT SC_TICK_FROM_SEC(2)
+
+#define SC_METRICS_HTTP_HEADER \
+    "HTTP/1.0 200 OK\r\n" \
+    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n" \
+    "Connection: close\r\n" \
+    "Content-Length: "
+
+static void
+sc_metrics_collect(struct sc_metrics *metrics,
+                   struct sc_metrics_snapshot *snapshot) {
+    const struct sc_metrics_sources *sources = &metrics->sources;
+
+    *snapshot = (struct sc_metrics_snapshot) {
+        .time = (int64_t) time(NULL),
+        .uptime = sc_tick_now() - metrics->start_date,
+    };
+
+    struct {
+        struct sc_demuxer *demuxer;
+        struct sc_decoder *decoder;
+        struct sc_metrics_stream *stream;
+    } streams[] = {
+        {sources->video_demuxer, sources->video_decoder, &snapshot->video},
+        {sources->audio_demuxer, sources->audio_decoder, &snapshot->audio},
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(streams); ++i) {
+        struct sc_metrics_stream *stream = streams[i].stream;
+
+        if (streams[i].demuxer) {
+            struct sc_demuxer_stats stats;
+            sc_demuxer_get_stats(streams[i].demuxer, &stats);
+            stream->received = true;
+            stream->bytes = stats.bytes;
+            stream->packets = stats.packets;
+        }
+
+        if (streams[i].decoder) {
+            struct sc_decoder_stats stats;
+            sc_decoder_get_stats(streams[i].decoder, &stats);
+            stream->decoded = true;
+            stream->decoded_frames = stats.frames;
+            stream->decode_errors = stats.errors;
+            stream->decode_time = stats.decode_time;
+        }
+    }
+
+    if (sources->fps_counter) {
+        struct sc_fps_counter_stats stats;
+        sc_fps_counter_get_stats(sources->fps_counter, &stats);
+        snapshot->has_display = true;
+        snapshot->rendered_frames = stats.rendered;
+        snapshot->skipped_frames = stats.skipped;
+    }
+
+    struct sc_audio_regulator_stats audio_stats;
+    if (sources->audio_player
+            && sc_audio_player_get_stats(sources->audio_player,
+                                         &audio_stats)) {
+        snapshot->has_audio_player = true;
+        snapshot->audio_underflows = audio_stats.glitches;
+        snapshot->audio_silence = audio_stats.silence;
+        snapshot->audio_skipped = audio_stats.skipped;
+        snapshot->audio_buffering = audio_stats.avg_buffering;
+    }
+
+    if (sources->controller) {
+        struct sc_controller_stats stats;
+        sc_controller_get_stats(sources->controller, &stats);
+        snapshot->has_controller = true;
+        snapshot->control_queued = stats.queued;
+        snapshot->control_sent = stats.sent;
+        snapshot->control_dropped = stats.dropped;
+    }
+
+    if (sources->recorder) {
+        struct sc_recorder_stats stats;
+        sc_recorder_get_stats(sources->recorder, &stats);
+        snapshot->has_recorder = true;
+        snapshot->record_video_queued = stats.video_queued;
+        snapshot->record_audio_queued = stats.audio_queued;
+        snapshot->record_video_written = stats.video_written;
+        snapshot->record_audio_written = stats.audio_written;
+    }
+
+    snapshot->has_rss = sc_process_get_rss(&snapshot->rss);
+}
+
+static bool
+sc_metrics_init_tcp(struct sc_metrics *metrics, uint32_t host,
+                    uint16_t port) {
+    if (!sc_intr_init(&metrics->intr)) {
+        return false;
+    }
+
+    metrics->server_socket = net_socket();
+    if (metrics->server_socket == SC_SOCKET_NONE) {
+        LOGE("Could not create metrics socket");
+        goto error_destroy_intr;
+    }
+
+    if (!net_listen(metrics->server_socket, host, port, 4)) {
+        LOGE("Could not listen on metrics port %" PRIu16, port);
+        goto error_close_socket;
+    }
+
+    LOGI("Metrics served on %" PRIu32 ".%" PRIu32 ".%" PRIu32 ".%" PRIu32
+         ":%" PRIu16, (host >> 24) & 0xFF, (host >> 16) & 0xFF,
+         (host >> 8) & 0xFF, host & 0xFF, port);
+
+    return true;
+
+error_close_socket:
+    net_close(metrics->server_socket);
+error_destroy_intr:
+    sc_intr_destroy(&metrics->intr);
+
+    return false;
+}
+
+#ifndef _WIN32
+static bool
+sc_metrics_init_unix(struct sc_metrics *metrics, const char *path) {
+    if (!net_unix_listen(&metrics->listener, path, 4, "metrics")) {
+        return false;
+    }
+
+    LOGI("Metrics served on %s", path);
+
+    return true;
+}
+#endif
+
+static bool
+sc_metrics_init_json(struct sc_metrics *metrics, const char *path) {
+    metrics->file = fopen(path, "a");
+    if (!metrics->file) {
+        LOGE("Could not open metrics file: %s", path);
+        return false;
+    }
+
+    LOGI("Metrics written to %s", path);
+
+    return true;
+}
+
+bool
+sc_metrics_init(struct sc_metrics *metrics,
+                const struct sc_metrics_params *params,
+                const struct sc_metrics_sources *sources) {
+    assert(params->type != SC_METRICS_TYPE_NONE);
+
+    bool ok = sc_mutex_init(&metrics->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&metrics->cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    switch (params->type) {
+        case SC_METRICS_TYPE_TCP:
+            ok = sc_metrics_init_tcp(metrics, params->host, params->port);
+            break;
+#ifndef _WIN32
+        case SC_METRICS_TYPE_UNIX:
+            ok = sc_metrics_init_unix(metrics, params->path);
+            break;
+#endif
+        default:
+            assert(params->type == SC_METRICS_TYPE_JSON);
+            ok = sc_metrics_init_json(metrics, params->path);
+            break;
+    }
+    if (!ok) {
+        goto error_destroy_cond;
+    }
+
+    metrics->sources = *sources;
+    metrics->type = params->type;
+    metrics->interval = params->interval;
+    metrics->start_date = sc_tick_now();
+    metrics->stopped = false;
+
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&metrics->cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&metrics->mutex);
+
+    return false;
+}
+
+void
+sc_metrics_destroy(struct sc_metrics *metrics) {
+    switch (metrics->type) {
+        case SC_METRICS_TYPE_TCP:
+            net_close(metrics->server_socket);
+            sc_intr_destroy(&metrics->intr);
+            break;
+#ifndef _WIN32
+        case SC_METRICS_TYPE_UNIX:
+            net_unix_close(&metrics->listener);
+            break;
+#endif
+        default:
+            assert(metrics->type == SC_METRICS_TYPE_JSON);
+            fclose(metrics->file);
+            break;
+    }
+
+    sc_cond_destroy(&metrics->cond);
+    sc_mutex_destroy(&metrics->mutex);
+}
+
+// Format the HTTP response in metrics->buf, and return its length (or 0 on
+// error)
+static size_t
+sc_metrics_format_response(struct sc_metrics *metrics) {
+    struct sc_metrics_snapshot snapshot;
+    sc_metrics_collect(metrics, &snapshot);
+
+    // Write the body after the room reserved for the header
+    char *buf = metrics->buf;
+    size_t header_room = sizeof(SC_METRICS_HTTP_HEADER) + 16;
+    ssize_t body_len =
+        sc_metrics_format_prometheus(&snapshot, buf + header_room,
+                                     sizeof(metrics->buf) - header_room);
+    if (body_len < 0) {
+        LOGW("Metrics truncated");
+        return 0;
+    }
+
+    int header_len = snprintf(buf, header_room, SC_METRICS_HTTP_HEADER
+                              "%u\r\n\r\n", (unsigned) body_len);
+    assert(header_len > 0 && (size_t) header_len < header_room);
+
+    memmove(buf + header_len, buf + header_room, body_len);
+    return header_len + body_len;
+}
+
+static bool
+sc_metrics_is_request_complete(const char *buf, size_t len) {
+    // The request has no body, wait for the end of the header
+    for (size_t i = 3; i < len; ++i) {
+        if (buf[i - 3] == '\r' && buf[i - 2] == '\n' && buf[i - 1] == '\r'
+                && buf[i] == '\n') {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+sc_metrics_serve_tcp(struct sc_metrics *metrics, sc_socket socket) {
+    sc_tick deadline = sc_tick_now() + SC_METRICS_REQUEST_TIMEOUT;
+
+    // The request is read into the buffer, then overwritten by the response
+    char *buf = metrics->buf;
+    size_t len = 0;
+    do {
+        if (len == SC_METRICS_REQUEST_MAX_SIZE) {
+            LOGW("Metrics request too large");
+            return;
+        }
+
+        sc_tick now = sc_tick_now();
+        if (now >= deadline
+                || !net_set_recv_timeout(socket, deadline - now)) {
+            LOGW("Metrics request timed out");
+            return;
+        }
+
+        ssize_t r = net_recv_intr(&metrics->intr, socket, buf + len,
+                                  SC_METRICS_REQUEST_MAX_SIZE - len);
+        if (r <= 0) {
+            if (sc_tick_now() >= deadline) {
+                LOGW("Metrics request timed out");
+            }
+            return;
+        }
+        len += r;
+    } while (!sc_metrics_is_request_complete(buf, len));
+
+    len = sc_metrics_format_response(metrics);
+    if (len) {
+        // Ignore errors: the client may have disconnected
+        net_send_all_intr(&metrics->intr, socket, buf, len);
+    }
+}
+
+static int
+run_metrics_tcp(struct sc_metrics *metrics) {
+    for (;;) {
+        sc_socket socket =
+            net_accept_intr(&metrics->intr, metrics->server_socket);
+        if (socket == SC_SOCKET_NONE) {
+            if (!sc_intr_is_interrupted(&metrics->intr)) {
+                LOGE("Metrics socket accept failed");
+            }
+            break;
+        }
+
+        sc_metrics_serve_tcp(metrics, socket);
+        net_close(socket);
+    }
+
+    return 0;
+}
+
+#ifndef _WIN32
+static void
+sc_metrics_serve_unix(struct sc_metrics *metrics, int fd) {
+    sc_tick deadline = sc_tick_now() + SC_METRICS_REQUEST_TIMEOUT;
+
+    // The request is read into the buffer, then overwritten by the response
+    char *buf = metrics->buf;
+    size_t len = 0;
+    do {
+        if (len == SC_METRICS_REQUEST_MAX_SIZE) {
+            LOGW("Metrics request too large");
+            return;
+        }
+
+        if (!net_unix_wait_readable(&metrics->listener, fd, deadline,
+                                    NULL)) {
+            if (sc_tick_now() >= deadline) {
+                LOGW("Metrics request timed out");
+            }
+            return;
+        }
+
+        ssize_t r = recv(fd, buf + len, SC_METRICS_REQUEST_MAX_SIZE - len, 0);
+        if (r <= 0) {
+            return;
+        }
+        len += r;
+    } while (!sc_metrics_is_request_complete(buf, len));
+
+    len = sc_metrics_format_response(metrics);
+    if (len) {
+        // Ignore errors: the client may have disconnected
+        net_unix_send_all(fd, buf, len);
+    }
+}
+
+static int
+run_metrics_unix(struct sc_metrics *metrics) {
+    for (;;) {
+        int fd = net_unix_accept(&metrics->listener);
+        if (fd == -1) {
+            // Interrupted or failed
+            break;
+        }
+
+        sc_metrics_serve_unix(metrics, fd);
+        close(fd);
+    }
+
+    return 0;
+}
+#endif
+
+static void
+sc_metrics_write_json(struct sc_metrics *metrics) {
+    struct sc_metrics_snapshot snapshot;
+    sc_metrics_collect(metrics, &snapshot);
+
+    ssize_t len = sc_metrics_format_json(&snapshot, metrics->buf,
+                                         sizeof(metrics->buf));
+    if (len < 0) {
+        LOGW("Metrics truncated");
+        return;
+    }
+
+    if (fwrite(metrics->buf, 1, len, metrics->file) != (size_t) len
+            || fflush(metrics->file)) {
+        LOGW("Could not write metrics");
+    }
+}
+
+static int
+run_metrics_json(struct sc_metrics *metrics) {
+    sc_tick deadline = sc_tick_now();
+    for (;;) {
+        sc_mutex_lock(&metrics->mutex);
+        bool timed_out = false;
+        while (!metrics->stopped && !timed_out) {
+            timed_out = !sc_cond_timedwait(&metrics->cond, &metrics->mutex,
+                                           deadline);
+        }
+        bool stopped = metrics->stopped;
+        sc_mutex_unlock(&metrics->mutex);
+
+        // Also write the final values on stop
+        sc_metrics_write_json(metrics);
+
+        if (stopped) {
+            break;
+        }
+
+        deadline += metrics->interval;
+    }
+
+    return 0;
+}
+
+static int
+run_metrics(void *data) {
+    struct sc_metrics *metrics = data;
+
+    switch (metrics->type) {
+        case SC_METRICS_TYPE_TCP:
+            run_metrics_tcp(metrics);
+            break;
+#ifndef _WIN32
+        case SC_METRICS_TYPE_UNIX:
+            run_metrics_unix(metrics);
+            break;
+#endif
+        default:
+            assert(metrics->type == SC_METRICS_TYPE_JSON);
+            run_metrics_json(metrics);
+            break;
+    }
+
+    LOGD("Metrics thread ended");
+
+    return 0;
+}
+
+bool
+sc_metrics_start(struct sc_metrics *metrics) {
+    LOGD("Starting metrics thread");
+
+    bool ok = sc_thread_create(&metrics->thread, run_metrics, "scrcpy-metrics",
+                               metrics);
+    if (!ok) {
+        LOGE("Could not start metrics thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_metrics_stop(struct sc_metrics *metrics) {
+    sc_mutex_lock(&metrics->mutex);
+    metrics->stopped = true;
+    sc_cond_signal(&metrics->cond);
+    sc_mutex_unlock(&metrics->mutex);
+
+    switch (metrics->type) {
+        case SC_METRICS_TYPE_TCP:
+            sc_intr_interrupt(&metrics->intr);
+            break;
+#ifndef _WIN32
+        case SC_METRICS_TYPE_UNIX:
+            net_unix_interrupt(&metrics->listener);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+void
+sc_metrics_join(struct sc_metrics *metrics) {
+    sc_thread_join(&metrics->thread, NULL);
+}
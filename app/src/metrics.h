@@ -0,0 +1,99 @@
+#ifndef SC_METRICS_H
+#define SC_METRICS_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "audio_player.h"
+#include "controller.h"
+#include "decoder.h"
+#include "demuxer.h"
+#include "fps_counter.h"
+#include "metrics_format.h"
+#include "options.h"
+#include "recorder.h"
+#include "util/intr.h"
+#include "util/net.h"
+#ifndef _WIN32
+# include "util/net_unix.h"
+#endif
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * The components to report the metrics of (any of them may be NULL)
+ */
+struct sc_metrics_sources {
+    struct sc_demuxer *video_demuxer;
+    struct sc_demuxer *audio_demuxer;
+    struct sc_decoder *video_decoder;
+    struct sc_decoder *audio_decoder;
+    struct sc_fps_counter *fps_counter;
+    struct sc_audio_player *audio_player;
+    struct sc_controller *controller;
+    struct sc_recorder *recorder;
+};
+
+struct sc_metrics_params {
+    enum sc_metrics_type type;
+    const char *path; // for SC_METRICS_TYPE_UNIX and SC_METRICS_TYPE_JSON
+    uint32_t host; // for SC_METRICS_TYPE_TCP
+    uint16_t port; // for SC_METRICS_TYPE_TCP
+    sc_tick interval; // for SC_METRICS_TYPE_JSON
+};
+
+/**
+ * Metrics exporter, for monitoring
+ *
+ * The metrics are read (mostly from atomic counters updated by the existing
+ * threads) only when they are exported, from a separate thread:
+ *  - on each HTTP request (one at a time) on a local TCP or Unix socket, in
+ *    the Prometheus text format;
+ *  - or periodically, as JSON lines appended to a file.
+ */
+struct sc_metrics {
+    struct sc_metrics_sources sources;
+    enum sc_metrics_type type;
+    sc_tick interval;
+    sc_tick start_date;
+
+    // for SC_METRICS_TYPE_TCP
+    sc_socket server_socket;
+    struct sc_intr intr;
+#ifndef _WIN32
+    // for SC_METRICS_TYPE_UNIX
+    struct sc_unix_listener listener;
+#endif
+    // for SC_METRICS_TYPE_JSON
+    FILE *file;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    // accessed only from the metrics thread
+    char buf[SC_METRICS_FORMAT_BUFFER_SIZE];
+};
+
+bool
+sc_metrics_init(struct sc_metrics *metrics,
+                const struct sc_metrics_params *params,
+                const struct sc_metrics_sources *sources);
+
+void
+sc_metrics_destroy(struct sc_metrics *metrics);
+
+bool
+sc_metrics_start(struct sc_metrics *metrics);
+
+void
+sc_metrics_stop(struct sc_metrics *metrics);
+
+void
+sc_metrics_join(struct sc_metrics *metrics);
+
+#endif
@@ -0,0 +1,301 @@
+#include "metrics_format.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+struct sc_metrics_writer {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+};
+
+static void
+sc_metrics_writer_init(struct sc_metrics_writer *w, char *buf, size_t size) {
+    assert(size);
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = false;
+    buf[0] = '\0';
+}
+
+static ssize_t
+sc_metrics_writer_end(struct sc_metrics_writer *w) {
+    return w->overflow ? -1 : (ssize_t) w->len;
+}
+
+static void
+sc_metrics_printf(struct sc_metrics_writer *w, const char *fmt, ...) {
+    if (w->overflow) {
+        return;
+    }
+
+    size_t avail = w->size - w->len;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int r = vsnprintf(w->buf + w->len, avail, fmt, ap);
+    va_end(ap);
+
+    if (r < 0 || (size_t) r >= avail) {
+        w->overflow = true;
+        return;
+    }
+
+    w->len += r;
+}
+
+static inline double
+sc_metrics_seconds(sc_tick tick) {
+    return (double) tick / SC_TICK_FREQ;
+}
+
+static void
+sc_metrics_prom_family(struct sc_metrics_writer *w, const char *name,
+                       const char *type, const char *help) {
+    sc_metrics_printf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name,
+                      type);
+}
+
+static void
+sc_metrics_prom_value(struct sc_metrics_writer *w, const char *name,
+                      uint64_t value) {
+    sc_metrics_printf(w, "%s %" PRIu64 "\n", name, value);
+}
+
+static void
+sc_metrics_prom_seconds(struct sc_metrics_writer *w, const char *name,
+                        sc_tick value) {
+    sc_metrics_printf(w, "%s %.6f\n", name, sc_metrics_seconds(value));
+}
+
+static void
+sc_metrics_prom_stream_value(struct sc_metrics_writer *w, const char *name,
+                             const char *stream, uint64_t value) {
+    sc_metrics_printf(w, "%s{stream=\"%s\"} %" PRIu64 "\n", name, stream,
+                      value);
+}
+
+ssize_t
+sc_metrics_format_prometheus(const struct sc_metrics_snapshot *snapshot,
+                             char *buf, size_t size) {
+    struct sc_metrics_writer w;
+    sc_metrics_writer_init(&w, buf, size);
+
+    const struct sc_metrics_stream *video = &snapshot->video;
+    const struct sc_metrics_stream *audio = &snapshot->audio;
+
+    if (video->received || audio->received) {
+        const char *name = "scrcpy_received_bytes_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Bytes of the packets received from the "
+                               "device.");
+        if (video->received) {
+            sc_metrics_prom_stream_value(&w, name, "video", video->bytes);
+        }
+        if (audio->received) {
+            sc_metrics_prom_stream_value(&w, name, "audio", audio->bytes);
+        }
+
+        name = "scrcpy_received_packets_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Packets received from the device.");
+        if (video->received) {
+            sc_metrics_prom_stream_value(&w, name, "video", video->packets);
+        }
+        if (audio->received) {
+            sc_metrics_prom_stream_value(&w, name, "audio", audio->packets);
+        }
+    }
+
+    if (video->decoded || audio->decoded) {
+        const char *name = "scrcpy_decoded_frames_total";
+        sc_metrics_prom_family(&w, name, "counter", "Frames decoded.");
+        if (video->decoded) {
+            sc_metrics_prom_stream_value(&w, name, "video",
+                                         video->decoded_frames);
+        }
+        if (audio->decoded) {
+            sc_metrics_prom_stream_value(&w, name, "audio",
+                                         audio->decoded_frames);
+        }
+
+        name = "scrcpy_decode_errors_total";
+        sc_metrics_prom_family(&w, name, "counter", "Decoding errors.");
+        if (video->decoded) {
+            sc_metrics_prom_stream_value(&w, name, "video",
+                                         video->decode_errors);
+        }
+        if (audio->decoded) {
+            sc_metrics_prom_stream_value(&w, name, "audio",
+                                         audio->decode_errors);
+        }
+
+        name = "scrcpy_decode_seconds_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Time spent in the decoder.");
+        if (video->decoded) {
+            sc_metrics_printf(&w, "%s{stream=\"video\"} %.6f\n", name,
+                              sc_metrics_seconds(video->decode_time));
+        }
+        if (audio->decoded) {
+            sc_metrics_printf(&w, "%s{stream=\"audio\"} %.6f\n", name,
+                              sc_metrics_seconds(audio->decode_time));
+        }
+    }
+
+    if (snapshot->has_display) {
+        const char *name = "scrcpy_rendered_frames_total";
+        sc_metrics_prom_family(&w, name, "counter", "Frames rendered.");
+        sc_metrics_prom_value(&w, name, snapshot->rendered_frames);
+
+        name = "scrcpy_skipped_frames_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Decoded frames skipped (replaced by a more "
+                               "recent frame before being rendered).");
+        sc_metrics_prom_value(&w, name, snapshot->skipped_frames);
+    }
+
+    if (snapshot->has_audio_player) {
+        const char *name = "scrcpy_audio_underflows_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Audio playback underflows.");
+        sc_metrics_prom_value(&w, name, snapshot->audio_underflows);
+
+        name = "scrcpy_audio_silence_seconds_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Silence inserted on audio underflow.");
+        sc_metrics_prom_seconds(&w, name, snapshot->audio_silence);
+
+        name = "scrcpy_audio_skipped_seconds_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Audio samples dropped on overflow.");
+        sc_metrics_prom_seconds(&w, name, snapshot->audio_skipped);
+
+        name = "scrcpy_audio_buffering_seconds";
+        sc_metrics_prom_family(&w, name, "gauge",
+                               "Average audio buffering.");
+        sc_metrics_prom_seconds(&w, name, snapshot->audio_buffering);
+    }
+
+    if (snapshot->has_controller) {
+        const char *name = "scrcpy_control_queued_messages";
+        sc_metrics_prom_family(&w, name, "gauge",
+                               "Control messages waiting to be sent.");
+        sc_metrics_prom_value(&w, name, snapshot->control_queued);
+
+        name = "scrcpy_control_sent_messages_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Control messages sent to the device.");
+        sc_metrics_prom_value(&w, name, snapshot->control_sent);
+
+        name = "scrcpy_control_dropped_messages_total";
+        sc_metrics_prom_family(&w, name, "counter",
+                               "Control messages dropped.");
+        sc_metrics_prom_value(&w, name, snapshot->control_dropped);
+    }
+
+    if (snapshot->has_recorder) {
+        const char *name = "scrcpy_recorder_queued_packets";
+        sc_metrics_prom_family(&w, name, "gauge",
+                               "Packets waiting to be recorded.");
+        sc_metrics_prom_stream_value(&w, name, "video",
+                                     snapshot->record_video_queued);
+        sc_metrics_prom_stream_value(&w, name, "audio",
+                                     snapshot->record_audio_queued);
+
+        name = "scrcpy_recorder_written_packets_total";
+        sc_metrics_prom_family(&w, name, "counter", "Packets recorded.");
+        sc_metrics_prom_stream_value(&w, name, "video",
+                                     snapshot->record_video_written);
+        sc_metrics_prom_stream_value(&w, name, "audio",
+                                     snapshot->record_audio_written);
+    }
+
+    if (snapshot->has_rss) {
+        // Standard name, for consistency with the other exporters
+        const char *name = "process_resident_memory_bytes";
+        sc_metrics_prom_family(&w, name, "gauge",
+                               "Resident memory size in bytes.");
+        sc_metrics_prom_value(&w, name, snapshot->rss);
+    }
+
+    return sc_metrics_writer_end(&w);
+}
+
+static void
+sc_metrics_json_stream(struct sc_metrics_writer *w, const char *key,
+                       const struct sc_metrics_stream *stream) {
+    sc_metrics_printf(w, ",\"%s\":{\"bytes\":%" PRIu64 ",\"packets\":%"
+                         PRIu32, key, stream->bytes, stream->packets);
+    if (stream->decoded) {
+        sc_metrics_printf(w, ",\"decoded_frames\":%" PRIu32
+                             ",\"decode_errors\":%" PRIu32
+                             ",\"decode_time_us\":%" PRItick,
+                          stream->decoded_frames, stream->decode_errors,
+                          stream->decode_time);
+    }
+    sc_metrics_printf(w, "}");
+}
+
+ssize_t
+sc_metrics_format_json(const struct sc_metrics_snapshot *snapshot, char *buf,
+                       size_t size) {
+    struct sc_metrics_writer w;
+    sc_metrics_writer_init(&w, buf, size);
+
+    sc_metrics_printf(&w, "{\"time\":%" PRIi64 ",\"uptime_us\":%" PRItick,
+                      snapshot->time, snapshot->uptime);
+
+    if (snapshot->video.received) {
+        sc_metrics_json_stream(&w, "video", &snapshot->video);
+    }
+    if (snapshot->audio.received) {
+        sc_metrics_json_stream(&w, "audio", &snapshot->audio);
+    }
+
+    if (snapshot->has_display) {
+        sc_metrics_printf(&w, ",\"display\":{\"rendered_frames\":%" PRIu32
+                              ",\"skipped_frames\":%" PRIu32 "}",
+                          snapshot->rendered_frames, snapshot->skipped_frames);
+    }
+
+    if (snapshot->has_audio_player) {
+        sc_metrics_printf(&w, ",\"audio_player\":{\"underflows\":%" PRIu32
+                              ",\"silence_us\":%" PRItick
+                              ",\"skipped_us\":%" PRItick
+                              ",\"buffering_us\":%" PRItick "}",
+                          snapshot->audio_underflows, snapshot->audio_silence,
+                          snapshot->audio_skipped, snapshot->audio_buffering);
+    }
+
+    if (snapshot->has_controller) {
+        sc_metrics_printf(&w, ",\"control\":{\"queued\":%" PRIu32
+                              ",\"sent\":%" PRIu32 ",\"dropped\":%" PRIu32
+                              "}",
+                          snapshot->control_queued, snapshot->control_sent,
+                          snapshot->control_dropped);
+    }
+
+    if (snapshot->has_recorder) {
+        sc_metrics_printf(&w, ",\"recorder\":{\"video_queued\":%" PRIu32
+                              ",\"audio_queued\":%" PRIu32
+                              ",\"video_written\":%" PRIu32
+                              ",\"audio_written\":%" PRIu32 "}",
+                          snapshot->record_video_queued,
+                          snapshot->record_audio_queued,
+                          snapshot->record_video_written,
+                          snapshot->record_audio_written);
+    }
+
+    if (snapshot->has_rss) {
+        sc_metrics_printf(&w, ",\"rss_bytes\":%" PRIu64, snapshot->rss);
+    }
+
+    sc_metrics_printf(&w, "}\n");
+
+    return sc_metrics_writer_end(&w);
+}
@@ -0,0 +1,87 @@
+#ifndef SC_METRICS_FORMAT_H
+#define SC_METRICS_FORMAT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "util/tick.h"
+
+// Large enough for all the metrics in any format
+#define SC_METRICS_FORMAT_BUFFER_SIZE 8192
+
+struct sc_metrics_stream {
+    bool received; // a demuxer is present
+    uint64_t bytes;
+    uint32_t packets;
+
+    bool decoded; // a decoder is present
+    uint32_t decoded_frames;
+    uint32_t decode_errors;
+    sc_tick decode_time;
+};
+
+/**
+ * Values of all the metrics at a given time
+ *
+ * The counters are cumulative (they may restart from 0 on reconnection). The
+ * has_* flags indicate whether the corresponding component exists (otherwise,
+ * its metrics are not reported).
+ */
+struct sc_metrics_snapshot {
+    int64_t time; // Unix time, in seconds
+    sc_tick uptime;
+
+    struct sc_metrics_stream video;
+    struct sc_metrics_stream audio;
+
+    bool has_display;
+    uint32_t rendered_frames;
+    uint32_t skipped_frames;
+
+    bool has_audio_player;
+    uint32_t audio_underflows;
+    sc_tick audio_silence; // total silence inserted on underflow
+    sc_tick audio_skipped; // total samples dropped on overflow
+    sc_tick audio_buffering; // average buffering
+
+    bool has_controller;
+    uint32_t control_queued;
+    uint32_t control_sent;
+    uint32_t control_dropped;
+
+    bool has_recorder;
+    uint32_t record_video_queued;
+    uint32_t record_audio_queued;
+    uint32_t record_video_written;
+    uint32_t record_audio_written;
+
+    bool has_rss;
+    uint64_t rss; // in bytes
+};
+
+/**
+ * Format the metrics in the Prometheus text exposition format
+ *
+ * Return the length of the text (without the final '\0'), or -1 if the buffer
+ * is too small.
+ */
+ssize_t
+sc_metrics_format_prometheus(const struct sc_metrics_snapshot *snapshot,
+                             char *buf, size_t size);
+
+/**
+ * Format the metrics as a single JSON object, on a single line terminated by
+ * '\n'
+ *
+ * Return the length of the text (without the final '\0'), or -1 if the buffer
+ * is too small.
+ */
+ssize_t
+sc_metrics_format_json(const struct sc_metrics_snapshot *snapshot, char *buf,
+                       size_t size);
+
+#endif
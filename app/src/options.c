@@ -2,6 +2,8 @@
 
 #include <stddef.h>
 
+#include "util/net.h"
+
 const struct scrcpy_options scrcpy_options_default = {
     .serial = NULL,
     .crop = NULL,
@@ -21,6 +23,8 @@ const struct scrcpy_options scrcpy_options_default = {
     .video_codec = SC_CODEC_H264,
     .audio_codec = SC_CODEC_OPUS,
     .video_source = SC_VIDEO_SOURCE_DISPLAY,
+    .video_decode_mode = SC_VIDEO_DECODE_MODE_FULL,
+    .video_decode_lowres_level = SC_VIDEO_DECODE_LOWRES_DEFAULT_LEVEL,
     .audio_source = SC_AUDIO_SOURCE_AUTO,
     .record_format = SC_RECORD_FORMAT_AUTO,
     .keyboard_input_mode = SC_KEYBOARD_INPUT_MODE_AUTO,
@@ -63,13 +67,28 @@ const struct scrcpy_options scrcpy_options_default = {
     .window_height = 0,
     .display_id = 0,
     .video_buffer = 0,
+    .video_buffer_auto = false,
     .audio_buffer = -1, // depends on the audio format,
+    .audio_buffer_auto = false,
     .audio_output_buffer = SC_TICK_FROM_MS(5),
+    .audio_output = SC_AUDIO_OUTPUT_BACKEND_SDL,
+    .audio_output_target = NULL,
     .time_limit = 0,
     .screen_off_timeout = -1,
 #ifdef HAVE_V4L2
     .v4l2_device = NULL,
     .v4l2_buffer = 0,
+    .v4l2_buffer_auto = false,
+    .v4l2_format = SC_V4L2_FORMAT_YUV420,
+    .v4l2_crop = {
+        .point = {.x = 0, .y = 0},
+        .size = {.width = 0, .height = 0},
+    },
+    .v4l2_orientation = SC_ORIENTATION_0,
+    .v4l2_size = {
+        .width = 0,
+        .height = 0,
+    },
 #endif
 #ifdef HAVE_USB
     .otg = false,
@@ -107,7 +126,28 @@ const struct scrcpy_options scrcpy_options_default = {
     .list = 0,
     .window = true,
     .mouse_hover = true,
+    .mouse_motion_coalescing = 0,
+    .gamepad_report_interval = SC_TICK_FROM_MS(4),
+    .gamepad_deadzone = 0,
+    .input_socket = NULL,
+    .input_record_filename = NULL,
+    .input_replay_filename = NULL,
+    .input_replay_speed = 100,
+    .reconnect = false,
+    .serials = NULL,
+    .wall = false,
+    .metrics_type = SC_METRICS_TYPE_NONE,
+    .metrics_path = NULL,
+    .metrics_host = IPV4_LOCALHOST,
+    .metrics_port = 0,
+    .metrics_interval = SC_METRICS_DEFAULT_INTERVAL,
+    .relay_type = SC_RELAY_TYPE_NONE,
+    .relay_path = NULL,
+    .relay_host = IPV4_LOCALHOST,
+    .relay_port = 0,
+    .relay_format = SC_RELAY_FORMAT_MPEGTS,
     .audio_dup = false,
+    .av_sync = false,
     .new_display = NULL,
     .start_app = NULL,
     .angle = NULL,
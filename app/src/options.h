@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "coords.h"
 #include "util/tick.h"
 
 enum sc_log_level {
@@ -54,6 +55,37 @@ enum sc_video_source {
     SC_VIDEO_SOURCE_CAMERA,
 };
 
+enum sc_video_decode_mode {
+    SC_VIDEO_DECODE_MODE_FULL,
+    // cheaper but degraded decoding (see sc_decoder_set_mode())
+    SC_VIDEO_DECODE_MODE_LOWRES,
+    // decode (and display) only the key frames
+    SC_VIDEO_DECODE_MODE_KEYFRAMES,
+};
+
+#define SC_VIDEO_DECODE_LOWRES_MAX_LEVEL 3
+#define SC_VIDEO_DECODE_LOWRES_DEFAULT_LEVEL 2
+
+enum sc_metrics_type {
+    SC_METRICS_TYPE_NONE,
+    SC_METRICS_TYPE_TCP, // Prometheus text format over HTTP
+    SC_METRICS_TYPE_UNIX, // Prometheus text format over HTTP
+    SC_METRICS_TYPE_JSON, // JSON lines appended to a file
+};
+
+#define SC_METRICS_DEFAULT_INTERVAL SC_TICK_FROM_SEC(10)
+
+enum sc_relay_type {
+    SC_RELAY_TYPE_NONE,
+    SC_RELAY_TYPE_TCP,
+    SC_RELAY_TYPE_UNIX,
+};
+
+enum sc_relay_format {
+    SC_RELAY_FORMAT_MPEGTS,
+    SC_RELAY_FORMAT_FMP4, // fragmented MP4
+};
+
 enum sc_audio_source {
     SC_AUDIO_SOURCE_AUTO, // OUTPUT for video DISPLAY, MIC for video CAMERA
     SC_AUDIO_SOURCE_OUTPUT,
@@ -69,6 +101,19 @@ enum sc_audio_source {
     SC_AUDIO_SOURCE_VOICE_PERFORMANCE,
 };
 
+enum sc_audio_output_backend {
+    SC_AUDIO_OUTPUT_BACKEND_SDL,
+    SC_AUDIO_OUTPUT_BACKEND_ALSA,
+    SC_AUDIO_OUTPUT_BACKEND_NULL,
+    SC_AUDIO_OUTPUT_BACKEND_FILE,
+};
+
+enum sc_v4l2_format {
+    SC_V4L2_FORMAT_YUV420,
+    SC_V4L2_FORMAT_NV12,
+    SC_V4L2_FORMAT_YUYV,
+};
+
 enum sc_camera_facing {
     SC_CAMERA_FACING_ANY,
     SC_CAMERA_FACING_FRONT,
@@ -227,6 +272,12 @@ struct sc_port_range {
 
 #define SC_WINDOW_POSITION_UNDEFINED (-0x8000)
 
+// Coalesce the mouse motion events per display frame
+#define SC_MOUSE_MOTION_COALESCING_FRAME (-1)
+
+// Maximum number of devices mirrored at once (--serials)
+#define SC_MAX_DEVICES 16
+
 struct scrcpy_options {
     const char *serial;
     const char *crop;
@@ -246,6 +297,8 @@ struct scrcpy_options {
     enum sc_codec video_codec;
     enum sc_codec audio_codec;
     enum sc_video_source video_source;
+    enum sc_video_decode_mode video_decode_mode;
+    uint8_t video_decode_lowres_level; // for SC_VIDEO_DECODE_MODE_LOWRES
     enum sc_audio_source audio_source;
     enum sc_record_format record_format;
     enum sc_keyboard_input_mode keyboard_input_mode;
@@ -272,14 +325,24 @@ struct scrcpy_options {
     uint16_t window_width;
     uint16_t window_height;
     uint32_t display_id;
-    sc_tick video_buffer;
-    sc_tick audio_buffer;
+    sc_tick video_buffer; // maximum delay if video_buffer_auto
+    bool video_buffer_auto;
+    sc_tick audio_buffer; // maximum target if audio_buffer_auto
+    bool audio_buffer_auto;
     sc_tick audio_output_buffer;
+    enum sc_audio_output_backend audio_output;
+    // ALSA PCM name or file path, depending on audio_output (may be NULL)
+    const char *audio_output_target;
     sc_tick time_limit;
     sc_tick screen_off_timeout;
 #ifdef HAVE_V4L2
     const char *v4l2_device;
-    sc_tick v4l2_buffer;
+    sc_tick v4l2_buffer; // maximum delay if v4l2_buffer_auto
+    bool v4l2_buffer_auto;
+    enum sc_v4l2_format v4l2_format;
+    struct sc_rect v4l2_crop; // no crop if the size is 0
+    enum sc_orientation v4l2_orientation;
+    struct sc_size v4l2_size; // keep the frame size if 0
 #endif
 #ifdef HAVE_USB
     bool otg;
@@ -322,7 +385,29 @@ struct scrcpy_options {
     uint8_t list;
     bool window;
     bool mouse_hover;
+    // 0 to disable, or SC_MOUSE_MOTION_COALESCING_FRAME
+    sc_tick mouse_motion_coalescing;
+    sc_tick gamepad_report_interval;
+    uint8_t gamepad_deadzone; // in percent
+    const char *input_socket;
+    const char *input_record_filename;
+    const char *input_replay_filename;
+    uint16_t input_replay_speed; // in percent
+    bool reconnect;
+    const char *serials; // comma-separated list, for multi-device mode
+    bool wall; // multi-device mode: a single window for all the devices
+    enum sc_metrics_type metrics_type;
+    const char *metrics_path; // for SC_METRICS_TYPE_UNIX and _JSON
+    uint32_t metrics_host; // for SC_METRICS_TYPE_TCP
+    uint16_t metrics_port; // for SC_METRICS_TYPE_TCP
+    sc_tick metrics_interval; // for SC_METRICS_TYPE_JSON
+    enum sc_relay_type relay_type;
+    const char *relay_path; // for SC_RELAY_TYPE_UNIX
+    uint32_t relay_host; // for SC_RELAY_TYPE_TCP
+    uint16_t relay_port; // for SC_RELAY_TYPE_TCP
+    enum sc_relay_format relay_format;
     bool audio_dup;
+    bool av_sync;
     const char *new_display; // [<width>x<height>][/<dpi>] parsed by the server
     const char *start_app;
     bool vd_destroy_content;
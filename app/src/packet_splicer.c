@@ -0,0 +1,197 @@
+#include "packet_splicer.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "util/log.h"
+
+/** Downcast packet_sink to packet_splicer */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_packet_splicer, packet_sink)
+
+static AVCodecContext *
+sc_packet_splicer_copy_context(const AVCodecContext *ctx) {
+    const AVCodec *codec = ctx->codec;
+    assert(codec);
+
+    AVCodecContext *copy = avcodec_alloc_context3(codec);
+    if (!copy) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    AVCodecParameters *par = avcodec_parameters_alloc();
+    if (!par) {
+        LOG_OOM();
+        avcodec_free_context(&copy);
+        return NULL;
+    }
+
+    if (avcodec_parameters_from_context(par, ctx) < 0
+            || avcodec_parameters_to_context(copy, par) < 0) {
+        LOGE("Could not copy codec parameters");
+        avcodec_parameters_free(&par);
+        avcodec_free_context(&copy);
+        return NULL;
+    }
+
+    avcodec_parameters_free(&par);
+
+    copy->flags = ctx->flags;
+
+    if (avcodec_open2(copy, codec, NULL) < 0) {
+        LOGE("Could not open codec");
+        avcodec_free_context(&copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+static bool
+sc_packet_splicer_open(struct sc_packet_splicer *splicer,
+                       AVCodecContext *ctx) {
+    if (splicer->ctx) {
+        // A new session on the same sinks
+        if (ctx->codec_id != splicer->ctx->codec_id) {
+            LOGE("Splicer '%s': the codec changed on reconnection",
+                 splicer->name);
+            return false;
+        }
+
+        LOGD("Splicer '%s': new session", splicer->name);
+        splicer->session_start = true;
+        return true;
+    }
+
+    // The demuxer codec context is freed at the end of the session
+    AVCodecContext *copy = sc_packet_splicer_copy_context(ctx);
+    if (!copy) {
+        return false;
+    }
+
+    if (!sc_packet_source_sinks_open(&splicer->packet_source, copy)) {
+        avcodec_free_context(&copy);
+        return false;
+    }
+
+    splicer->ctx = copy;
+    splicer->session_start = true;
+    return true;
+}
+
+static bool
+sc_packet_splicer_push(struct sc_packet_splicer *splicer,
+                       const AVPacket *packet) {
+    if (packet->pts == AV_NOPTS_VALUE) {
+        // Config packet
+        return sc_packet_source_sinks_push(&splicer->packet_source, packet);
+    }
+
+    sc_tick now = sc_tick_now();
+
+    if (splicer->session_start) {
+        splicer->session_start = false;
+        if (splicer->last_pts == AV_NOPTS_VALUE) {
+            // First session
+            splicer->pts_offset = 0;
+        } else {
+            // PTS are expressed in microseconds, like sc_tick
+            int64_t gap = MAX(now - splicer->last_date, 1);
+            splicer->pts_offset = splicer->last_pts + gap - packet->pts;
+            LOGD("Splicer '%s': PTS offset %" PRIi64 " after a %" PRItick
+                 " ms gap", splicer->name, splicer->pts_offset,
+                 SC_TICK_TO_MS(gap));
+        }
+    }
+
+    splicer->last_pts = packet->pts + splicer->pts_offset;
+    splicer->last_date = now;
+
+    if (!splicer->pts_offset) {
+        return sc_packet_source_sinks_push(&splicer->packet_source, packet);
+    }
+
+    if (av_packet_ref(splicer->packet, packet)) {
+        LOG_OOM();
+        return false;
+    }
+
+    splicer->packet->pts += splicer->pts_offset;
+    splicer->packet->dts = splicer->packet->pts;
+
+    bool ok = sc_packet_source_sinks_push(&splicer->packet_source,
+                                          splicer->packet);
+    av_packet_unref(splicer->packet);
+    return ok;
+}
+
+static bool
+sc_packet_splicer_packet_sink_open(struct sc_packet_sink *sink,
+                                   AVCodecContext *ctx) {
+    struct sc_packet_splicer *splicer = DOWNCAST(sink);
+    return sc_packet_splicer_open(splicer, ctx);
+}
+
+static void
+sc_packet_splicer_packet_sink_close(struct sc_packet_sink *sink) {
+    (void) sink;
+    // The sinks are kept open for the next session
+}
+
+static bool
+sc_packet_splicer_packet_sink_push(struct sc_packet_sink *sink,
+                                   const AVPacket *packet) {
+    struct sc_packet_splicer *splicer = DOWNCAST(sink);
+    return sc_packet_splicer_push(splicer, packet);
+}
+
+static void
+sc_packet_splicer_packet_sink_disable(struct sc_packet_sink *sink) {
+    struct sc_packet_splicer *splicer = DOWNCAST(sink);
+    if (splicer->ctx || splicer->disabled) {
+        // The sinks must not be disabled once open, nor twice
+        return;
+    }
+
+    splicer->disabled = true;
+    sc_packet_source_sinks_disable(&splicer->packet_source);
+}
+
+bool
+sc_packet_splicer_init(struct sc_packet_splicer *splicer, const char *name) {
+    splicer->packet = av_packet_alloc();
+    if (!splicer->packet) {
+        LOG_OOM();
+        return false;
+    }
+
+    splicer->name = name;
+    splicer->ctx = NULL;
+    splicer->disabled = false;
+    splicer->pts_offset = 0;
+    splicer->session_start = false;
+    splicer->last_pts = AV_NOPTS_VALUE;
+    splicer->last_date = 0;
+
+    sc_packet_source_init(&splicer->packet_source);
+
+    static const struct sc_packet_sink_ops ops = {
+        .open = sc_packet_splicer_packet_sink_open,
+        .close = sc_packet_splicer_packet_sink_close,
+        .push = sc_packet_splicer_packet_sink_push,
+        .disable = sc_packet_splicer_packet_sink_disable,
+    };
+
+    splicer->packet_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_packet_splicer_destroy(struct sc_packet_splicer *splicer) {
+    if (splicer->ctx) {
+        sc_packet_source_sinks_close(&splicer->packet_source);
+        avcodec_free_context(&splicer->ctx);
+    }
+    av_packet_free(&splicer->packet);
+}
@@ -0,0 +1,62 @@
+#ifndef SC_PACKET_SPLICER_H
+#define SC_PACKET_SPLICER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+
+#include "trait/packet_sink.h"
+#include "trait/packet_source.h"
+#include "util/tick.h"
+
+/**
+ * Splice the streams of successive sessions into a single stream.
+ *
+ * On reconnection, a new demuxer is started for each stream. The splicer is
+ * a sink of each successive demuxer, and it keeps its own sinks (decoder,
+ * recorder...) open across sessions: they are opened on the first session and
+ * closed only on sc_packet_splicer_destroy().
+ *
+ * The PTS of each new session are offset so that the output timeline
+ * continues from the last packet of the previous session, plus the duration
+ * of the disconnection.
+ *
+ * The sessions are sequential: a demuxer is joined before the next one is
+ * started, so no lock is necessary.
+ */
+struct sc_packet_splicer {
+    struct sc_packet_source packet_source; // packet source trait
+    struct sc_packet_sink packet_sink; // packet sink trait
+
+    const char *name; // must be statically allocated (e.g. a string literal)
+
+    // The codec context exposed to the sinks, which must outlive the codec
+    // context of each session (NULL until the first session is open)
+    AVCodecContext *ctx;
+    bool disabled;
+
+    AVPacket *packet;
+    // added to the PTS of the current session
+    int64_t pts_offset;
+    // true until the first media packet of the current session
+    bool session_start;
+    // last PTS sent to the sinks
+    int64_t last_pts;
+    sc_tick last_date;
+};
+
+// The name must be statically allocated (e.g. a string literal)
+bool
+sc_packet_splicer_init(struct sc_packet_splicer *splicer, const char *name);
+
+/**
+ * Close the sinks (if they were open) and release the resources
+ *
+ * Must be called once the last demuxer is joined.
+ */
+void
+sc_packet_splicer_destroy(struct sc_packet_splicer *splicer);
+
+#endif
@@ -117,7 +117,13 @@ sc_recorder_write_stream(struct sc_recorder *recorder,
     } else {
         st->last_pts = packet->pts;
     }
-    return av_interleaved_write_frame(recorder->ctx, packet) >= 0;
+
+    if (av_interleaved_write_frame(recorder->ctx, packet) < 0) {
+        return false;
+    }
+
+    atomic_fetch_add_explicit(&st->written, 1, memory_order_relaxed);
+    return true;
 }
 
 static inline bool
@@ -740,6 +746,7 @@ static void
 sc_recorder_stream_init(struct sc_recorder_stream *stream) {
     stream->index = -1;
     stream->last_pts = AV_NOPTS_VALUE;
+    atomic_init(&stream->written, 0);
 }
 
 bool
@@ -851,3 +858,19 @@ sc_recorder_destroy(struct sc_recorder *recorder) {
     sc_mutex_destroy(&recorder->mutex);
     free(recorder->filename);
 }
+
+void
+sc_recorder_get_stats(struct sc_recorder *recorder,
+                      struct sc_recorder_stats *stats) {
+    sc_mutex_lock(&recorder->mutex);
+    stats->video_queued = sc_vecdeque_size(&recorder->video_queue);
+    stats->audio_queued = sc_vecdeque_size(&recorder->audio_queue);
+    sc_mutex_unlock(&recorder->mutex);
+
+    stats->video_written =
+        atomic_load_explicit(&recorder->video_stream.written,
+                             memory_order_relaxed);
+    stats->audio_written =
+        atomic_load_explicit(&recorder->audio_stream.written,
+                             memory_order_relaxed);
+}
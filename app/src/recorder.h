@@ -3,7 +3,9 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <libavcodec/packet.h>
 #include <libavformat/avformat.h>
@@ -18,6 +20,7 @@ struct sc_recorder_queue SC_VECDEQUE(AVPacket *);
 struct sc_recorder_stream {
     int index;
     int64_t last_pts;
+    atomic_uint_least32_t written; // number of packets written
 };
 
 struct sc_recorder {
@@ -62,6 +65,13 @@ struct sc_recorder {
     void *cbs_userdata;
 };
 
+struct sc_recorder_stats {
+    size_t video_queued;
+    size_t audio_queued;
+    uint32_t video_written;
+    uint32_t audio_written;
+};
+
 struct sc_recorder_callbacks {
     void (*on_ended)(struct sc_recorder *recorder, bool success,
                      void *userdata);
@@ -85,4 +95,12 @@ sc_recorder_join(struct sc_recorder *recorder);
 void
 sc_recorder_destroy(struct sc_recorder *recorder);
 
+/**
+ * Get the number of video and audio packets waiting to be written, and the
+ * number of packets written so far (may be called from any thread)
+ */
+void
+sc_recorder_get_stats(struct sc_recorder *recorder,
+                      struct sc_recorder_stats *stats);
+
 #endif
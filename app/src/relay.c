@@ -0,0 +1,1035 @@
+#include "relay.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+#include "util/log.h"
+#include "util/net_intr.h"
+
+/** Downcast packet sinks to relay */
+#define DOWNCAST_VIDEO(SINK) \
+    container_of(SINK, struct sc_relay, video_packet_sink)
+#define DOWNCAST_AUDIO(SINK) \
+    container_of(SINK, struct sc_relay, audio_packet_sink)
+
+// Value of AVPacket.stream_index for the queued packets
+#define SC_RELAY_STREAM_VIDEO 0
+#define SC_RELAY_STREAM_AUDIO 1
+
+// Maximum size of the packets kept since the last keyframe
+#define SC_RELAY_CACHE_MAX_SIZE (8 << 20)
+// Maximum size of the packets waiting to be sent to a client. It must be
+// larger than the cache, which is queued at once for a new client.
+#define SC_RELAY_CLIENT_MAX_QUEUE_SIZE (16 << 20)
+
+#define SC_RELAY_IO_BUFFER_SIZE 65536
+
+static const AVRational SCRCPY_TIME_BASE = {1, 1000000}; // timestamps in us
+
+/**
+ * The muxer of a client
+ *
+ * Every client has its own muxer, so that it receives a complete stream
+ * (including the header) whenever it connects.
+ */
+struct sc_relay_muxer {
+    AVFormatContext *ctx;
+    // index of the muxer stream for SC_RELAY_STREAM_* (-1 if none)
+    int index[2];
+    // in the muxer stream time base
+    int64_t last_pts[2];
+    // in SCRCPY_TIME_BASE
+    int64_t pts_origin;
+};
+
+static AVPacket *
+sc_relay_packet_ref(const AVPacket *packet) {
+    AVPacket *p = av_packet_alloc();
+    if (!p) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    if (av_packet_ref(p, packet)) {
+        av_packet_free(&p);
+        return NULL;
+    }
+
+    return p;
+}
+
+static void
+sc_relay_queue_clear(struct sc_relay_queue *queue) {
+    while (!sc_vecdeque_is_empty(queue)) {
+        AVPacket *p = sc_vecdeque_pop(queue);
+        av_packet_free(&p);
+    }
+}
+
+static const char *
+sc_relay_get_format_name(enum sc_relay_format format) {
+    switch (format) {
+        case SC_RELAY_FORMAT_MPEGTS:
+            return "mpegts";
+        case SC_RELAY_FORMAT_FMP4:
+            return "mp4";
+        default:
+            return NULL;
+    }
+}
+
+// Must be called with the mutex locked
+static bool
+sc_relay_is_ready(struct sc_relay *relay) {
+    if (relay->video && (!relay->video_codecpar || !relay->video_config)) {
+        return false;
+    }
+
+    if (!relay->audio_init) {
+        return false;
+    }
+
+    if (relay->audio && relay->audio_expects_config_packet
+            && !relay->audio_config) {
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_relay_client_send(struct sc_relay_client *client, const uint8_t *buf,
+                     size_t len) {
+#ifndef _WIN32
+    if (client->relay->type == SC_RELAY_TYPE_UNIX) {
+        return net_unix_send_all(client->fd, buf, len);
+    }
+#endif
+
+    return net_send_all(client->socket, buf, len) == (ssize_t) len;
+}
+
+static void
+sc_relay_client_interrupt(struct sc_relay_client *client) {
+#ifndef _WIN32
+    if (client->relay->type == SC_RELAY_TYPE_UNIX) {
+        shutdown(client->fd, SHUT_RDWR);
+        return;
+    }
+#endif
+
+    net_interrupt(client->socket);
+}
+
+static void
+sc_relay_client_close(struct sc_relay_client *client) {
+#ifndef _WIN32
+    if (client->relay->type == SC_RELAY_TYPE_UNIX) {
+        close(client->fd);
+        return;
+    }
+#endif
+
+    net_close(client->socket);
+}
+
+#ifdef SCRCPY_LAVF_HAS_AVIO_WRITE_CONST
+static int
+sc_relay_client_write_packet(void *opaque, const uint8_t *buf, int buf_size) {
+#else
+static int
+sc_relay_client_write_packet(void *opaque, uint8_t *buf, int buf_size) {
+#endif
+    struct sc_relay_client *client = opaque;
+
+    if (!sc_relay_client_send(client, buf, buf_size)) {
+        // The client is disconnected (or the relay is stopped)
+        return AVERROR(EPIPE);
+    }
+
+    return buf_size;
+}
+
+static bool
+sc_relay_muxer_add_stream(struct sc_relay_muxer *muxer,
+                          const AVCodecParameters *codecpar,
+                          const AVPacket *config) {
+    AVStream *stream = avformat_new_stream(muxer->ctx, NULL);
+    if (!stream) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (avcodec_parameters_copy(stream->codecpar, codecpar) < 0) {
+        return false;
+    }
+
+    stream->time_base = SCRCPY_TIME_BASE;
+
+    if (config) {
+        // The config packet is the extradata (as for recording)
+        uint8_t *extradata =
+            av_mallocz(config->size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!extradata) {
+            LOG_OOM();
+            return false;
+        }
+        memcpy(extradata, config->data, config->size);
+
+        av_free(stream->codecpar->extradata);
+        stream->codecpar->extradata = extradata;
+        stream->codecpar->extradata_size = config->size;
+    }
+
+    return true;
+}
+
+static void
+sc_relay_muxer_free(struct sc_relay_muxer *muxer) {
+    AVIOContext *pb = muxer->ctx->pb;
+    if (pb) {
+        // The buffer may have been reallocated by AVIO
+        av_freep(&pb->buffer);
+#ifdef SCRCPY_LAVF_HAS_AVIO_CONTEXT_FREE
+        avio_context_free(&pb);
+#else
+        av_free(pb);
+#endif
+        muxer->ctx->pb = NULL;
+    }
+    avformat_free_context(muxer->ctx);
+}
+
+static bool
+sc_relay_muxer_open(struct sc_relay_muxer *muxer,
+                    struct sc_relay_client *client) {
+    struct sc_relay *relay = client->relay;
+
+    // The codec parameters are immutable once the relay is ready, but the
+    // config packets may be replaced concurrently
+    sc_mutex_lock(&relay->mutex);
+    bool audio = relay->audio;
+    AVPacket *video_config = NULL;
+    AVPacket *audio_config = NULL;
+    bool ok = true;
+    if (relay->video_config) {
+        video_config = sc_relay_packet_ref(relay->video_config);
+        ok = video_config;
+    }
+    if (ok && audio && relay->audio_config) {
+        audio_config = sc_relay_packet_ref(relay->audio_config);
+        ok = audio_config;
+    }
+    sc_mutex_unlock(&relay->mutex);
+
+    if (!ok) {
+        goto error_free_configs;
+    }
+
+    const char *format_name = sc_relay_get_format_name(relay->format);
+    assert(format_name);
+
+    muxer->ctx = NULL;
+    int r = avformat_alloc_output_context2(&muxer->ctx, NULL, format_name,
+                                           NULL);
+    if (r < 0) {
+        LOGE("Could not find %s muxer", format_name);
+        goto error_free_configs;
+    }
+
+    uint8_t *buffer = av_malloc(SC_RELAY_IO_BUFFER_SIZE);
+    if (!buffer) {
+        LOG_OOM();
+        goto error_free_muxer;
+    }
+
+    muxer->ctx->pb = avio_alloc_context(buffer, SC_RELAY_IO_BUFFER_SIZE, 1,
+                                        client, NULL,
+                                        sc_relay_client_write_packet, NULL);
+    if (!muxer->ctx->pb) {
+        LOG_OOM();
+        av_free(buffer);
+        goto error_free_muxer;
+    }
+
+    muxer->index[SC_RELAY_STREAM_VIDEO] = -1;
+    muxer->index[SC_RELAY_STREAM_AUDIO] = -1;
+
+    if (relay->video) {
+        if (!sc_relay_muxer_add_stream(muxer, relay->video_codecpar,
+                                       video_config)) {
+            goto error_free_muxer;
+        }
+        muxer->index[SC_RELAY_STREAM_VIDEO] = muxer->ctx->nb_streams - 1;
+    }
+
+    if (audio) {
+        if (!sc_relay_muxer_add_stream(muxer, relay->audio_codecpar,
+                                       audio_config)) {
+            goto error_free_muxer;
+        }
+        muxer->index[SC_RELAY_STREAM_AUDIO] = muxer->ctx->nb_streams - 1;
+    }
+
+    if (!muxer->ctx->nb_streams) {
+        // The audio has been disabled, and there is no video
+        LOGW("Nothing to relay");
+        goto error_free_muxer;
+    }
+
+    AVDictionary *opts = NULL;
+    if (relay->format == SC_RELAY_FORMAT_FMP4) {
+        // Write the init segment immediately, then one fragment per
+        // av_write_frame(ctx, NULL)
+        av_dict_set(&opts, "movflags",
+                    "empty_moov+default_base_moof+frag_custom", 0);
+    }
+
+    r = avformat_write_header(muxer->ctx, &opts);
+    av_dict_free(&opts);
+    if (r < 0) {
+        LOGW("Relay client #%u: could not write header", client->id);
+        goto error_free_muxer;
+    }
+    avio_flush(muxer->ctx->pb);
+
+    muxer->last_pts[SC_RELAY_STREAM_VIDEO] = AV_NOPTS_VALUE;
+    muxer->last_pts[SC_RELAY_STREAM_AUDIO] = AV_NOPTS_VALUE;
+    muxer->pts_origin = AV_NOPTS_VALUE;
+
+    av_packet_free(&video_config);
+    av_packet_free(&audio_config);
+
+    return true;
+
+error_free_muxer:
+    sc_relay_muxer_free(muxer);
+error_free_configs:
+    av_packet_free(&video_config);
+    av_packet_free(&audio_config);
+
+    return false;
+}
+
+static void
+sc_relay_muxer_close(struct sc_relay_muxer *muxer) {
+    // The stream is live, the trailer is useless for the client, but writing
+    // it releases the muxer resources (the client may already be gone)
+    av_write_trailer(muxer->ctx);
+    sc_relay_muxer_free(muxer);
+}
+
+static bool
+sc_relay_muxer_write(struct sc_relay_muxer *muxer, AVPacket *packet) {
+    int id = packet->stream_index;
+    assert(id == SC_RELAY_STREAM_VIDEO || id == SC_RELAY_STREAM_AUDIO);
+
+    int index = muxer->index[id];
+    if (index < 0) {
+        // Not relayed to this client
+        return true;
+    }
+
+    if (muxer->pts_origin == AV_NOPTS_VALUE) {
+        // The first packet of a client is a keyframe
+        muxer->pts_origin = packet->pts;
+    }
+
+    if (packet->pts < muxer->pts_origin) {
+        // An audio packet captured before the first keyframe
+        return true;
+    }
+
+    AVStream *stream = muxer->ctx->streams[index];
+
+    packet->pts -= muxer->pts_origin;
+    packet->dts = packet->pts;
+    packet->duration = 0;
+    av_packet_rescale_ts(packet, SCRCPY_TIME_BASE, stream->time_base);
+
+    int64_t last_pts = muxer->last_pts[id];
+    if (last_pts != AV_NOPTS_VALUE) {
+        if (packet->pts <= last_pts) {
+            packet->pts = last_pts + 1;
+            packet->dts = packet->pts;
+        }
+        // The duration of a packet is only known once the next one is
+        // received: assume that it is the same as the previous one
+        packet->duration = packet->pts - last_pts;
+    }
+    muxer->last_pts[id] = packet->pts;
+
+    packet->stream_index = index;
+
+    if (av_write_frame(muxer->ctx, packet) < 0) {
+        return false;
+    }
+
+    // Send the packet immediately (for fragmented MP4, this writes a fragment)
+    if (av_write_frame(muxer->ctx, NULL) < 0) {
+        return false;
+    }
+    avio_flush(muxer->ctx->pb);
+
+    return !muxer->ctx->pb->error;
+}
+
+static void
+sc_relay_client_stream(struct sc_relay_client *client) {
+    struct sc_relay *relay = client->relay;
+
+    sc_mutex_lock(&relay->mutex);
+    while (!relay->stopped && !sc_relay_is_ready(relay)) {
+        sc_cond_wait(&relay->cond, &relay->mutex);
+    }
+    bool stopped = relay->stopped;
+    sc_mutex_unlock(&relay->mutex);
+
+    if (stopped) {
+        return;
+    }
+
+    struct sc_relay_muxer muxer;
+    if (!sc_relay_muxer_open(&muxer, client)) {
+        return;
+    }
+
+    for (;;) {
+        sc_mutex_lock(&relay->mutex);
+        while (!relay->stopped && sc_vecdeque_is_empty(&client->queue)) {
+            sc_cond_wait(&relay->cond, &relay->mutex);
+        }
+
+        if (relay->stopped) {
+            sc_mutex_unlock(&relay->mutex);
+            break;
+        }
+
+        AVPacket *packet = sc_vecdeque_pop(&client->queue);
+        client->queue_size -= packet->size;
+        sc_mutex_unlock(&relay->mutex);
+
+        bool ok = sc_relay_muxer_write(&muxer, packet);
+        av_packet_free(&packet);
+        if (!ok) {
+            // The client is disconnected
+            break;
+        }
+    }
+
+    sc_relay_muxer_close(&muxer);
+}
+
+static int
+run_relay_client(void *data) {
+    struct sc_relay_client *client = data;
+    struct sc_relay *relay = client->relay;
+
+    sc_relay_client_stream(client);
+
+    sc_mutex_lock(&relay->mutex);
+    // From now on, the socket is not interrupted by sc_relay_stop()
+    client->ended = true;
+    sc_relay_queue_clear(&client->queue);
+    client->queue_size = 0;
+    sc_mutex_unlock(&relay->mutex);
+
+    sc_relay_client_close(client);
+
+    LOGI("Relay client #%u disconnected", client->id);
+
+    return 0;
+}
+
+// Must be called with the mutex locked
+static bool
+sc_relay_client_push(struct sc_relay_client *client, const AVPacket *packet,
+                     bool keyframe) {
+    if (client->waiting_sync) {
+        if (!keyframe) {
+            return true;
+        }
+        client->waiting_sync = false;
+    }
+
+    if (client->queue_size + packet->size > SC_RELAY_CLIENT_MAX_QUEUE_SIZE) {
+        LOGW("Relay client #%u too slow, dropping packets until the next "
+             "keyframe", client->id);
+        sc_relay_queue_clear(&client->queue);
+        client->queue_size = 0;
+        if (!keyframe) {
+            client->waiting_sync = true;
+            return true;
+        }
+    }
+
+    AVPacket *p = sc_relay_packet_ref(packet);
+    if (!p) {
+        return false;
+    }
+
+    if (!sc_vecdeque_push(&client->queue, p)) {
+        LOG_OOM();
+        av_packet_free(&p);
+        return false;
+    }
+
+    client->queue_size += packet->size;
+    return true;
+}
+
+// Must be called with the mutex locked
+static bool
+sc_relay_cache_push(struct sc_relay *relay, const AVPacket *packet,
+                    bool keyframe) {
+    if (keyframe) {
+        sc_relay_queue_clear(&relay->cache);
+        relay->cache_size = 0;
+        relay->cache_valid = true;
+    }
+
+    if (!relay->cache_valid) {
+        return true;
+    }
+
+    if (relay->cache_size + packet->size > SC_RELAY_CACHE_MAX_SIZE) {
+        // New clients will wait for the next keyframe
+        sc_relay_queue_clear(&relay->cache);
+        relay->cache_size = 0;
+        relay->cache_valid = false;
+        return true;
+    }
+
+    AVPacket *p = sc_relay_packet_ref(packet);
+    if (!p) {
+        return false;
+    }
+
+    if (!sc_vecdeque_push(&relay->cache, p)) {
+        LOG_OOM();
+        av_packet_free(&p);
+        return false;
+    }
+
+    relay->cache_size += packet->size;
+    return true;
+}
+
+static bool
+sc_relay_push(struct sc_relay *relay, const AVPacket *packet, int stream) {
+    sc_mutex_lock(&relay->mutex);
+
+    if (relay->stopped) {
+        // Never fail the other sinks of the packet source
+        sc_mutex_unlock(&relay->mutex);
+        return true;
+    }
+
+    AVPacket *p = sc_relay_packet_ref(packet);
+    if (!p) {
+        sc_mutex_unlock(&relay->mutex);
+        return false;
+    }
+
+    p->stream_index = stream;
+
+    if (p->pts == AV_NOPTS_VALUE) {
+        // Config packet, for the header of the new clients. The next media
+        // packet has the config packet data prepended, so it is not relayed.
+        AVPacket **config = stream == SC_RELAY_STREAM_VIDEO
+                          ? &relay->video_config
+                          : &relay->audio_config;
+        av_packet_free(config);
+        *config = p;
+
+        // The relay may be ready
+        sc_cond_broadcast(&relay->cond);
+        sc_mutex_unlock(&relay->mutex);
+        return true;
+    }
+
+    // Without video, a client may start from any audio packet
+    bool keyframe = stream == SC_RELAY_STREAM_VIDEO
+                  ? p->flags & AV_PKT_FLAG_KEY
+                  : !relay->video;
+
+    bool ok = sc_relay_cache_push(relay, p, keyframe);
+
+    for (size_t i = 0; ok && i < SC_RELAY_MAX_CLIENTS; ++i) {
+        struct sc_relay_client *client = &relay->clients[i];
+        if (client->active && !client->ended) {
+            ok = sc_relay_client_push(client, p, keyframe);
+        }
+    }
+
+    sc_cond_broadcast(&relay->cond);
+    sc_mutex_unlock(&relay->mutex);
+
+    av_packet_free(&p);
+
+    return ok;
+}
+
+static bool
+sc_relay_open_stream(struct sc_relay *relay, AVCodecParameters **codecpar,
+                     AVCodecContext *ctx) {
+    AVCodecParameters *par = avcodec_parameters_alloc();
+    if (!par) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (avcodec_parameters_from_context(par, ctx) < 0) {
+        avcodec_parameters_free(&par);
+        return false;
+    }
+
+    sc_mutex_lock(&relay->mutex);
+    assert(!*codecpar);
+    *codecpar = par;
+    if (codecpar == &relay->audio_codecpar) {
+        // A config packet is provided for all supported formats except raw
+        // audio
+        relay->audio_expects_config_packet =
+            ctx->codec_id != AV_CODEC_ID_PCM_S16LE;
+        relay->audio_init = true;
+    }
+    sc_cond_broadcast(&relay->cond);
+    sc_mutex_unlock(&relay->mutex);
+
+    return true;
+}
+
+static bool
+sc_relay_video_packet_sink_open(struct sc_packet_sink *sink,
+                                AVCodecContext *ctx) {
+    struct sc_relay *relay = DOWNCAST_VIDEO(sink);
+    assert(relay->video);
+
+    return sc_relay_open_stream(relay, &relay->video_codecpar, ctx);
+}
+
+static void
+sc_relay_video_packet_sink_close(struct sc_packet_sink *sink) {
+    // The clients are disconnected by sc_relay_stop()
+    (void) sink;
+}
+
+static bool
+sc_relay_video_packet_sink_push(struct sc_packet_sink *sink,
+                                const AVPacket *packet) {
+    struct sc_relay *relay = DOWNCAST_VIDEO(sink);
+    return sc_relay_push(relay, packet, SC_RELAY_STREAM_VIDEO);
+}
+
+static bool
+sc_relay_audio_packet_sink_open(struct sc_packet_sink *sink,
+                                AVCodecContext *ctx) {
+    struct sc_relay *relay = DOWNCAST_AUDIO(sink);
+    return sc_relay_open_stream(relay, &relay->audio_codecpar, ctx);
+}
+
+static void
+sc_relay_audio_packet_sink_close(struct sc_packet_sink *sink) {
+    // The clients are disconnected by sc_relay_stop()
+    (void) sink;
+}
+
+static bool
+sc_relay_audio_packet_sink_push(struct sc_packet_sink *sink,
+                                const AVPacket *packet) {
+    struct sc_relay *relay = DOWNCAST_AUDIO(sink);
+    return sc_relay_push(relay, packet, SC_RELAY_STREAM_AUDIO);
+}
+
+static void
+sc_relay_audio_packet_sink_disable(struct sc_packet_sink *sink) {
+    struct sc_relay *relay = DOWNCAST_AUDIO(sink);
+
+    LOGW("Audio stream relay disabled");
+
+    sc_mutex_lock(&relay->mutex);
+    relay->audio = false;
+    relay->audio_init = true;
+    sc_cond_broadcast(&relay->cond);
+    sc_mutex_unlock(&relay->mutex);
+}
+
+// Join the threads of the disconnected clients, to reuse their slots
+static void
+sc_relay_reap_clients(struct sc_relay *relay) {
+    for (size_t i = 0; i < SC_RELAY_MAX_CLIENTS; ++i) {
+        struct sc_relay_client *client = &relay->clients[i];
+
+        // The active flag is only written by the relay thread
+        if (!client->active) {
+            continue;
+        }
+
+        sc_mutex_lock(&relay->mutex);
+        bool ended = client->ended;
+        sc_mutex_unlock(&relay->mutex);
+
+        if (ended) {
+            sc_thread_join(&client->thread, NULL);
+            sc_vecdeque_destroy(&client->queue);
+
+            sc_mutex_lock(&relay->mutex);
+            client->active = false;
+            sc_mutex_unlock(&relay->mutex);
+        }
+    }
+}
+
+static struct sc_relay_client *
+sc_relay_get_free_client(struct sc_relay *relay) {
+    sc_relay_reap_clients(relay);
+
+    for (size_t i = 0; i < SC_RELAY_MAX_CLIENTS; ++i) {
+        struct sc_relay_client *client = &relay->clients[i];
+        if (!client->active) {
+            return client;
+        }
+    }
+
+    LOGW("Too many relay clients (max %d), connection rejected",
+         SC_RELAY_MAX_CLIENTS);
+    return NULL;
+}
+
+// The client socket must be set by the caller (and closed on error)
+static bool
+sc_relay_start_client(struct sc_relay *relay, struct sc_relay_client *client) {
+    client->relay = relay;
+    client->id = relay->next_client_id++;
+    client->ended = false;
+    sc_vecdeque_init(&client->queue);
+    client->queue_size = 0;
+    client->waiting_sync = true;
+
+    sc_mutex_lock(&relay->mutex);
+
+    // Start from the last keyframe
+    bool ok = true;
+    if (relay->cache_valid) {
+        size_t size = sc_vecdeque_size(&relay->cache);
+        for (size_t i = 0; ok && i < size; ++i) {
+            AVPacket *packet = *sc_vecdeque_getref(&relay->cache, i);
+            // The cache starts with a keyframe
+            ok = sc_relay_client_push(client, packet, i == 0);
+        }
+    }
+
+    // From now on, the client receives the new packets
+    client->active = ok;
+
+    sc_mutex_unlock(&relay->mutex);
+
+    if (!ok) {
+        goto error_destroy_queue;
+    }
+
+    ok = sc_thread_create(&client->thread, run_relay_client,
+                          "scrcpy-relay-cl", client);
+    if (!ok) {
+        LOGE("Could not start relay client thread");
+        sc_mutex_lock(&relay->mutex);
+        client->active = false;
+        sc_mutex_unlock(&relay->mutex);
+        goto error_destroy_queue;
+    }
+
+    LOGI("Relay client #%u connected", client->id);
+
+    return true;
+
+error_destroy_queue:
+    sc_relay_queue_clear(&client->queue);
+    sc_vecdeque_destroy(&client->queue);
+
+    return false;
+}
+
+// Return false if the relay must stop accepting clients
+static bool
+sc_relay_accept_tcp(struct sc_relay *relay) {
+    sc_socket socket = net_accept_intr(&relay->intr, relay->server_socket);
+    if (socket == SC_SOCKET_NONE) {
+        if (!sc_intr_is_interrupted(&relay->intr)) {
+            LOGE("Relay socket accept failed");
+        }
+        return false;
+    }
+
+    struct sc_relay_client *client = sc_relay_get_free_client(relay);
+    if (!client) {
+        net_close(socket);
+        return true;
+    }
+
+    client->socket = socket;
+    if (!sc_relay_start_client(relay, client)) {
+        net_close(socket);
+    }
+
+    return true;
+}
+
+#ifndef _WIN32
+// Return false if the relay must stop accepting clients
+static bool
+sc_relay_accept_unix(struct sc_relay *relay) {
+    int fd = net_unix_accept(&relay->listener);
+    if (fd == -1) {
+        // Interrupted or failed
+        return false;
+    }
+
+    struct sc_relay_client *client = sc_relay_get_free_client(relay);
+    if (!client) {
+        close(fd);
+        return true;
+    }
+
+    client->fd = fd;
+    if (!sc_relay_start_client(relay, client)) {
+        close(fd);
+    }
+
+    return true;
+}
+#endif
+
+static int
+run_relay(void *data) {
+    struct sc_relay *relay = data;
+
+    for (;;) {
+        bool ok;
+#ifndef _WIN32
+        if (relay->type == SC_RELAY_TYPE_UNIX) {
+            ok = sc_relay_accept_unix(relay);
+        } else
+#endif
+        {
+            ok = sc_relay_accept_tcp(relay);
+        }
+
+        if (!ok) {
+            break;
+        }
+    }
+
+    LOGD("Relay thread ended");
+
+    return 0;
+}
+
+static bool
+sc_relay_init_tcp(struct sc_relay *relay, uint32_t host, uint16_t port) {
+    if (!sc_intr_init(&relay->intr)) {
+        return false;
+    }
+
+    relay->server_socket = net_socket();
+    if (relay->server_socket == SC_SOCKET_NONE) {
+        LOGE("Could not create relay socket");
+        goto error_destroy_intr;
+    }
+
+    if (!net_listen(relay->server_socket, host, port, 4)) {
+        LOGE("Could not listen on relay port %" PRIu16, port);
+        goto error_close_socket;
+    }
+
+    LOGI("Stream relayed on %" PRIu32 ".%" PRIu32 ".%" PRIu32 ".%" PRIu32
+         ":%" PRIu16, (host >> 24) & 0xFF, (host >> 16) & 0xFF,
+         (host >> 8) & 0xFF, host & 0xFF, port);
+
+    return true;
+
+error_close_socket:
+    net_close(relay->server_socket);
+error_destroy_intr:
+    sc_intr_destroy(&relay->intr);
+
+    return false;
+}
+
+#ifndef _WIN32
+static bool
+sc_relay_init_unix(struct sc_relay *relay, const char *path) {
+    if (!net_unix_listen(&relay->listener, path, 4, "relay")) {
+        return false;
+    }
+
+    LOGI("Stream relayed on %s", path);
+
+    return true;
+}
+#endif
+
+bool
+sc_relay_init(struct sc_relay *relay, const struct sc_relay_params *params) {
+    assert(params->type != SC_RELAY_TYPE_NONE);
+    assert(params->video || params->audio);
+
+    bool ok = sc_mutex_init(&relay->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&relay->cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+#ifndef _WIN32
+    if (params->type == SC_RELAY_TYPE_UNIX) {
+        ok = sc_relay_init_unix(relay, params->path);
+    } else
+#endif
+    {
+        assert(params->type == SC_RELAY_TYPE_TCP);
+        ok = sc_relay_init_tcp(relay, params->host, params->port);
+    }
+    if (!ok) {
+        goto error_destroy_cond;
+    }
+
+    relay->type = params->type;
+    relay->format = params->format;
+    relay->stopped = false;
+
+    relay->video = params->video;
+    relay->audio = params->audio;
+    relay->video_codecpar = NULL;
+    relay->audio_codecpar = NULL;
+    // Without audio, there is nothing to wait for
+    relay->audio_init = !params->audio;
+    relay->audio_expects_config_packet = false;
+    relay->video_config = NULL;
+    relay->audio_config = NULL;
+
+    sc_vecdeque_init(&relay->cache);
+    relay->cache_size = 0;
+    relay->cache_valid = false;
+
+    for (size_t i = 0; i < SC_RELAY_MAX_CLIENTS; ++i) {
+        relay->clients[i].active = false;
+    }
+    relay->next_client_id = 0;
+
+    if (params->video) {
+        static const struct sc_packet_sink_ops video_ops = {
+            .open = sc_relay_video_packet_sink_open,
+            .close = sc_relay_video_packet_sink_close,
+            .push = sc_relay_video_packet_sink_push,
+        };
+
+        relay->video_packet_sink.ops = &video_ops;
+    }
+
+    if (params->audio) {
+        static const struct sc_packet_sink_ops audio_ops = {
+            .open = sc_relay_audio_packet_sink_open,
+            .close = sc_relay_audio_packet_sink_close,
+            .push = sc_relay_audio_packet_sink_push,
+            .disable = sc_relay_audio_packet_sink_disable,
+        };
+
+        relay->audio_packet_sink.ops = &audio_ops;
+    }
+
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&relay->cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&relay->mutex);
+
+    return false;
+}
+
+void
+sc_relay_destroy(struct sc_relay *relay) {
+#ifndef _WIN32
+    if (relay->type == SC_RELAY_TYPE_UNIX) {
+        net_unix_close(&relay->listener);
+    } else
+#endif
+    {
+        net_close(relay->server_socket);
+        sc_intr_destroy(&relay->intr);
+    }
+
+    sc_relay_queue_clear(&relay->cache);
+    sc_vecdeque_destroy(&relay->cache);
+    av_packet_free(&relay->video_config);
+    av_packet_free(&relay->audio_config);
+    avcodec_parameters_free(&relay->video_codecpar);
+    avcodec_parameters_free(&relay->audio_codecpar);
+
+    sc_cond_destroy(&relay->cond);
+    sc_mutex_destroy(&relay->mutex);
+}
+
+bool
+sc_relay_start(struct sc_relay *relay) {
+    LOGD("Starting relay thread");
+
+    bool ok = sc_thread_create(&relay->thread, run_relay, "scrcpy-relay",
+                               relay);
+    if (!ok) {
+        LOGE("Could not start relay thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_relay_stop(struct sc_relay *relay) {
+    sc_mutex_lock(&relay->mutex);
+    relay->stopped = true;
+    sc_cond_broadcast(&relay->cond);
+
+    // Unblock the clients blocked on send()
+    for (size_t i = 0; i < SC_RELAY_MAX_CLIENTS; ++i) {
+        struct sc_relay_client *client = &relay->clients[i];
+        if (client->active && !client->ended) {
+            sc_relay_client_interrupt(client);
+        }
+    }
+    sc_mutex_unlock(&relay->mutex);
+
+#ifndef _WIN32
+    if (relay->type == SC_RELAY_TYPE_UNIX) {
+        net_unix_interrupt(&relay->listener);
+    } else
+#endif
+    {
+        sc_intr_interrupt(&relay->intr);
+    }
+}
+
+void
+sc_relay_join(struct sc_relay *relay) {
+    sc_thread_join(&relay->thread, NULL);
+
+    // The relay thread is terminated, no client may be added anymore
+    for (size_t i = 0; i < SC_RELAY_MAX_CLIENTS; ++i) {
+        struct sc_relay_client *client = &relay->clients[i];
+        if (client->active) {
+            sc_thread_join(&client->thread, NULL);
+            sc_vecdeque_destroy(&client->queue);
+            client->active = false;
+        }
+    }
+}
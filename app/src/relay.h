@@ -0,0 +1,134 @@
+#ifndef SC_RELAY_H
+#define SC_RELAY_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+
+#include "options.h"
+#include "trait/packet_sink.h"
+#include "util/intr.h"
+#include "util/net.h"
+#ifndef _WIN32
+# include "util/net_unix.h"
+#endif
+#include "util/thread.h"
+#include "util/vecdeque.h"
+
+#define SC_RELAY_MAX_CLIENTS 16
+
+struct sc_relay_queue SC_VECDEQUE(AVPacket *);
+
+struct sc_relay_client {
+    struct sc_relay *relay;
+    unsigned id;
+
+    // for SC_RELAY_TYPE_TCP
+    sc_socket socket;
+#ifndef _WIN32
+    // for SC_RELAY_TYPE_UNIX
+    int fd;
+#endif
+
+    sc_thread thread;
+
+    // The fields below are protected by relay->mutex
+
+    // the slot is used (the thread must be joined)
+    bool active;
+    // the client thread is terminating (its socket must not be interrupted)
+    bool ended;
+
+    struct sc_relay_queue queue;
+    size_t queue_size; // total size of the queued packets, in bytes
+    // drop the packets until the next keyframe (because the client is late)
+    bool waiting_sync;
+};
+
+struct sc_relay_params {
+    enum sc_relay_type type;
+    enum sc_relay_format format;
+    const char *path; // for SC_RELAY_TYPE_UNIX
+    uint32_t host; // for SC_RELAY_TYPE_TCP
+    uint16_t port; // for SC_RELAY_TYPE_TCP
+    bool video;
+    bool audio;
+};
+
+/**
+ * Relay the encoded streams (without transcoding) to local clients
+ *
+ * Any number of clients (up to SC_RELAY_MAX_CLIENTS) may connect to a local
+ * TCP or Unix socket to receive the video and audio streams, muxed in MPEG-TS
+ * or fragmented MP4.
+ *
+ * The packets received since the last video keyframe are kept, so that a new
+ * client immediately receives a decodable stream. Each client has its own
+ * queue (and thread): if it does not read fast enough, its pending packets are
+ * dropped, and it restarts from the next keyframe.
+ */
+struct sc_relay {
+    struct sc_packet_sink video_packet_sink;
+    struct sc_packet_sink audio_packet_sink;
+
+    enum sc_relay_type type;
+    enum sc_relay_format format;
+
+    // for SC_RELAY_TYPE_TCP
+    sc_socket server_socket;
+    struct sc_intr intr;
+#ifndef _WIN32
+    // for SC_RELAY_TYPE_UNIX
+    struct sc_unix_listener listener;
+#endif
+
+    // accept the clients
+    sc_thread thread;
+
+    sc_mutex mutex;
+    // signaled when the stream parameters are known, on new packet and on stop
+    sc_cond cond;
+    bool stopped;
+
+    bool video;
+    // may be reset if the audio is disabled at runtime
+    bool audio;
+
+    // set on open(), then immutable
+    AVCodecParameters *video_codecpar;
+    AVCodecParameters *audio_codecpar;
+    bool audio_init; // open() or disable() called
+    bool audio_expects_config_packet;
+
+    // latest config packets
+    AVPacket *video_config;
+    AVPacket *audio_config;
+
+    // packets received since the last keyframe (starting with it)
+    struct sc_relay_queue cache;
+    size_t cache_size; // in bytes
+    bool cache_valid; // false until the next keyframe if the cache overflowed
+
+    struct sc_relay_client clients[SC_RELAY_MAX_CLIENTS];
+    unsigned next_client_id;
+};
+
+bool
+sc_relay_init(struct sc_relay *relay, const struct sc_relay_params *params);
+
+void
+sc_relay_destroy(struct sc_relay *relay);
+
+bool
+sc_relay_start(struct sc_relay *relay);
+
+void
+sc_relay_stop(struct sc_relay *relay);
+
+void
+sc_relay_join(struct sc_relay *relay);
+
+#endif
@@ -15,22 +15,36 @@
 #endif
 
 #include "audio_player.h"
+#include "av_sync.h"
+#include "audio/audio_output_null.h"
+#include "audio/audio_output_sdl.h"
 #include "controller.h"
 #include "decoder.h"
 #include "delay_buffer.h"
 #include "demuxer.h"
 #include "events.h"
 #include "file_pusher.h"
+#include "icon.h"
+#include "input_record.h"
+#include "input_replay.h"
+#ifndef _WIN32
+# include "input_socket.h"
+#endif
 #include "keyboard_sdk.h"
+#include "metrics.h"
 #include "mouse_sdk.h"
+#include "packet_splicer.h"
 #include "recorder.h"
+#include "relay.h"
 #include "screen.h"
 #include "server.h"
+#include "startup_timing.h"
 #include "uhid/gamepad_uhid.h"
 #include "uhid/keyboard_uhid.h"
 #include "uhid/mouse_uhid.h"
 #ifdef HAVE_USB
 # include "usb/aoa_hid.h"
+# include "usb/aoa_transport_usb.h"
 # include "usb/gamepad_aoa.h"
 # include "usb/keyboard_aoa.h"
 # include "usb/mouse_aoa.h"
@@ -44,25 +58,53 @@
 #ifdef HAVE_V4L2
 # include "v4l2_sink.h"
 #endif
+#ifdef HAVE_ALSA
+# include "audio/audio_output_alsa.h"
+#endif
+
+// Backoff between reconnection attempts (--reconnect)
+#define SC_RECONNECT_MIN_DELAY SC_TICK_FROM_MS(100)
+#define SC_RECONNECT_MAX_DELAY SC_TICK_FROM_MS(500)
 
 struct scrcpy {
+    struct sc_startup_timing startup_timing;
     struct sc_server server;
     struct sc_screen screen;
     struct sc_audio_player audio_player;
+    struct sc_av_sync av_sync;
+    union {
+        struct sc_audio_output_sdl audio_output_sdl;
+#ifdef HAVE_ALSA
+        struct sc_audio_output_alsa audio_output_alsa;
+#endif
+        struct sc_audio_output_null audio_output_null;
+    };
     struct sc_demuxer video_demuxer;
     struct sc_demuxer audio_demuxer;
     struct sc_decoder video_decoder;
     struct sc_decoder audio_decoder;
+    // only used with --reconnect
+    struct sc_packet_splicer video_splicer;
+    struct sc_packet_splicer audio_splicer;
     struct sc_recorder recorder;
+    struct sc_relay relay;
+    struct sc_delay_scheduler delay_scheduler;
     struct sc_delay_buffer video_buffer;
 #ifdef HAVE_V4L2
     struct sc_v4l2_sink v4l2_sink;
     struct sc_delay_buffer v4l2_buffer;
 #endif
     struct sc_controller controller;
+    struct sc_input_recorder input_recorder;
+    struct sc_input_replayer input_replayer;
+#ifndef _WIN32
+    struct sc_input_socket input_socket;
+#endif
     struct sc_file_pusher file_pusher;
+    struct sc_metrics metrics;
 #ifdef HAVE_USB
     struct sc_usb usb;
+    struct sc_aoa_transport_usb aoa_transport;
     struct sc_aoa aoa;
     // sequence/ack helper to synchronize clipboard and Ctrl+v via HID
     struct sc_acksync acksync;
@@ -182,10 +224,34 @@ static void handle_input(SDL_Event *event) {
     }
 }
 //static enum scrcpy_exit_code
+static bool
+wait_event(struct scrcpy *s, bool has_screen, SDL_Event *event) {
+    for (;;) {
+        sc_tick deadline =
+            has_screen ? sc_input_manager_get_deadline(&s->screen.im) : 0;
+        if (!deadline) {
+            return SDL_WaitEvent(event);
+        }
+
+        sc_tick now = sc_tick_now();
+        if (now < deadline) {
+            // Round up, SDL timeouts are expressed in milliseconds
+            int timeout = (deadline - now + SC_TICK_FROM_MS(1) - 1)
+                        / SC_TICK_FROM_MS(1);
+            if (SDL_WaitEventTimeout(event, timeout)) {
+                return true;
+            }
+        }
+
+        // The pending input events must be sent now
+        sc_input_manager_handle_deadline(&s->screen.im);
+    }
+}
+
 static enum scrcpy_exit_code
 event_loop(struct scrcpy *s, bool has_screen) {
     SDL_Event event;
-    while (SDL_WaitEvent(&event)) {
+    while (wait_event(s, has_screen, &event)) {
         handle_input(&event);
         switch (event.type) {
             case SC_EVENT_DEVICE_DISCONNECTED:
@@ -361,8 +427,38 @@ sc_timeout_on_timeout(struct sc_timeout *timeout, void *userdata) {
     sc_push_event(SC_EVENT_TIME_LIMIT_REACHED);
 }
 
-// Generate a scrcpy id to differentiate multiple running scrcpy instances
-static uint32_t
+static const struct sc_server_callbacks server_cbs = {
+    .on_connection_failed = sc_server_on_connection_failed,
+    .on_connected = sc_server_on_connected,
+    .on_disconnected = sc_server_on_disconnected,
+};
+
+static const struct sc_demuxer_callbacks video_demuxer_cbs = {
+    .on_ended = sc_video_demuxer_on_ended,
+};
+
+static const struct sc_demuxer_callbacks audio_demuxer_cbs = {
+    .on_ended = sc_audio_demuxer_on_ended,
+};
+
+struct scrcpy_icon_loader {
+    struct sc_startup_timing *startup_timing;
+    SDL_Surface *icon; // output
+};
+
+static int
+run_icon_loader(void *data) {
+    struct scrcpy_icon_loader *loader = data;
+
+    sc_startup_timing_begin(loader->startup_timing,
+                            SC_STARTUP_PHASE_ICON_LOAD);
+    loader->icon = scrcpy_icon_load();
+    sc_startup_timing_end(loader->startup_timing, SC_STARTUP_PHASE_ICON_LOAD);
+
+    return 0;
+}
+
+uint32_t
 scrcpy_generate_scid(void) {
     struct sc_rand rand;
     sc_rand_init(&rand);
@@ -370,6 +466,191 @@ scrcpy_generate_scid(void) {
     return sc_rand_u32(&rand) & 0x7FFFFFFF;
 }
 
+void
+scrcpy_init_server_params(struct sc_server_params *params,
+                          const struct scrcpy_options *options,
+                          struct sc_startup_timing *startup_timing) {
+    *params = (struct sc_server_params) {
+        .scid = scrcpy_generate_scid(),
+        .startup_timing = startup_timing,
+        .req_serial = options->serial,
+        .select_usb = options->select_usb,
+        .select_tcpip = options->select_tcpip,
+        .log_level = options->log_level,
+        .video_codec = options->video_codec,
+        .audio_codec = options->audio_codec,
+        .video_source = options->video_source,
+        .audio_source = options->audio_source,
+        .camera_facing = options->camera_facing,
+        .crop = options->crop,
+        .port_range = options->port_range,
+        .tunnel_host = options->tunnel_host,
+        .tunnel_port = options->tunnel_port,
+        .max_size = options->max_size,
+        .video_bit_rate = options->video_bit_rate,
+        .audio_bit_rate = options->audio_bit_rate,
+        .max_fps = options->max_fps,
+        .angle = options->angle,
+        .screen_off_timeout = options->screen_off_timeout,
+        .capture_orientation = options->capture_orientation,
+        .capture_orientation_lock = options->capture_orientation_lock,
+        .control = options->control,
+        .display_id = options->display_id,
+        .new_display = options->new_display,
+        .display_ime_policy = options->display_ime_policy,
+        .video = options->video,
+        .audio = options->audio,
+        .audio_dup = options->audio_dup,
+        .show_touches = options->show_touches,
+        .stay_awake = options->stay_awake,
+        .video_codec_options = options->video_codec_options,
+        .audio_codec_options = options->audio_codec_options,
+        .video_encoder = options->video_encoder,
+        .audio_encoder = options->audio_encoder,
+        .camera_id = options->camera_id,
+        .camera_size = options->camera_size,
+        .camera_ar = options->camera_ar,
+        .camera_fps = options->camera_fps,
+        .force_adb_forward = options->force_adb_forward,
+        .power_off_on_close = options->power_off_on_close,
+        .clipboard_autosync = options->clipboard_autosync,
+        .downsize_on_error = options->downsize_on_error,
+        .tcpip = options->tcpip,
+        .tcpip_dst = options->tcpip_dst,
+        .cleanup = options->cleanup,
+        .power_on = options->power_on,
+        .kill_adb_on_close = options->kill_adb_on_close,
+        .camera_high_speed = options->camera_high_speed,
+        .vd_destroy_content = options->vd_destroy_content,
+        .vd_system_decorations = options->vd_system_decorations,
+        .list = options->list,
+    };
+}
+
+enum scrcpy_reconnect_event {
+    SCRCPY_RECONNECT_EVENT_TIMEOUT,
+    SCRCPY_RECONNECT_EVENT_CONNECTED,
+    SCRCPY_RECONNECT_EVENT_CONNECTION_FAILED,
+    SCRCPY_RECONNECT_EVENT_QUIT, // exit code in *ret
+};
+
+// Handle the events while reconnecting, so that the window stays responsive
+// (deadline == 0 means no deadline)
+static enum scrcpy_reconnect_event
+wait_reconnect_event(struct scrcpy *s, bool has_screen, sc_tick deadline,
+                     enum scrcpy_exit_code *ret) {
+    SDL_Event event;
+    for (;;) {
+        if (deadline) {
+            sc_tick now = sc_tick_now();
+            if (now >= deadline) {
+                return SCRCPY_RECONNECT_EVENT_TIMEOUT;
+            }
+            // Round up, SDL timeouts are expressed in milliseconds
+            int timeout = (deadline - now + SC_TICK_FROM_MS(1) - 1)
+                        / SC_TICK_FROM_MS(1);
+            if (!SDL_WaitEventTimeout(&event, timeout)) {
+                continue;
+            }
+        } else if (!SDL_WaitEvent(&event)) {
+            LOGE("SDL_WaitEvent() error: %s", SDL_GetError());
+            *ret = SCRCPY_EXIT_FAILURE;
+            return SCRCPY_RECONNECT_EVENT_QUIT;
+        }
+
+        handle_input(&event);
+        switch (event.type) {
+            case SC_EVENT_SERVER_CONNECTED:
+                return SCRCPY_RECONNECT_EVENT_CONNECTED;
+            case SC_EVENT_SERVER_CONNECTION_FAILED:
+                return SCRCPY_RECONNECT_EVENT_CONNECTION_FAILED;
+            case SC_EVENT_DEVICE_DISCONNECTED:
+                // Obsolete, from the previous session
+                break;
+            case SC_EVENT_RECORDER_ERROR:
+                LOGE("Recorder error");
+                *ret = SCRCPY_EXIT_FAILURE;
+                return SCRCPY_RECONNECT_EVENT_QUIT;
+            case SC_EVENT_TIME_LIMIT_REACHED:
+                LOGI("Time limit reached");
+                *ret = SCRCPY_EXIT_SUCCESS;
+                return SCRCPY_RECONNECT_EVENT_QUIT;
+            case SDL_QUIT:
+                LOGD("User requested to quit");
+                *ret = SCRCPY_EXIT_SUCCESS;
+                return SCRCPY_RECONNECT_EVENT_QUIT;
+            case SC_EVENT_RUN_ON_MAIN_THREAD: {
+                sc_runnable_fn run = event.user.data1;
+                void *userdata = event.user.data2;
+                run(userdata);
+                break;
+            }
+            default:
+                if (has_screen && !sc_screen_handle_event(&s->screen, &event)) {
+                    *ret = SCRCPY_EXIT_FAILURE;
+                    return SCRCPY_RECONNECT_EVENT_QUIT;
+                }
+                break;
+        }
+    }
+}
+
+// Restart a server until it connects (return true), or until the user quits
+// or an error occurs (return false, with the exit code in *ret)
+static bool
+scrcpy_reconnect(struct scrcpy *s, const struct scrcpy_options *options,
+                 struct sc_server_params *params, bool *server_initialized,
+                 enum scrcpy_exit_code *ret) {
+    assert(!*server_initialized);
+
+    sc_tick delay = SC_RECONNECT_MIN_DELAY;
+    unsigned attempt = 0;
+    for (;;) {
+        ++attempt;
+        LOGI("Reconnecting (attempt %u)...", attempt);
+
+        // Do not reuse the socket name of the previous server
+        params->scid = scrcpy_generate_scid();
+        if (!sc_server_init(&s->server, params, &server_cbs, NULL)) {
+            *ret = SCRCPY_EXIT_FAILURE;
+            return false;
+        }
+        *server_initialized = true;
+
+        if (!sc_server_start(&s->server)) {
+            *ret = SCRCPY_EXIT_FAILURE;
+            return false;
+        }
+
+        enum scrcpy_reconnect_event event =
+            wait_reconnect_event(s, options->window, 0, ret);
+        if (event == SCRCPY_RECONNECT_EVENT_CONNECTED) {
+            LOGI("Reconnected");
+            return true;
+        }
+
+        sc_server_stop(&s->server);
+        sc_server_join(&s->server);
+        if (event == SCRCPY_RECONNECT_EVENT_QUIT) {
+            // The caller destroys the server
+            return false;
+        }
+
+        sc_server_destroy(&s->server);
+        *server_initialized = false;
+
+        LOGD("Reconnection failed, retrying in %" PRItick " ms",
+             SC_TICK_TO_MS(delay));
+        sc_tick deadline = sc_tick_now() + delay;
+        event = wait_reconnect_event(s, options->window, deadline, ret);
+        if (event == SCRCPY_RECONNECT_EVENT_QUIT) {
+            return false;
+        }
+
+        delay = MIN(delay * 2, SC_RECONNECT_MAX_DELAY);
+    }
+}
+
 static void
 init_sdl_gamepads(void) {
     // Trigger a SDL_CONTROLLERDEVICEADDED event for all gamepads already
@@ -394,6 +675,8 @@ scrcpy(struct scrcpy_options *options) {
 #endif
     struct scrcpy *s = &scrcpy;
 
+    sc_startup_timing_init(&s->startup_timing, NULL);
+
     // Minimal SDL initialization
     if (SDL_Init(SDL_INIT_EVENTS)) {
         LOGE("Could not initialize SDL: %s", SDL_GetError());
@@ -404,15 +687,23 @@ scrcpy(struct scrcpy_options *options) {
 
     enum scrcpy_exit_code ret = SCRCPY_EXIT_FAILURE;
 
+    bool server_initialized = false;
     bool server_started = false;
     bool file_pusher_initialized = false;
     bool recorder_initialized = false;
     bool recorder_started = false;
+    bool relay_initialized = false;
+    bool relay_started = false;
 #ifdef HAVE_V4L2
     bool v4l2_sink_initialized = false;
 #endif
+    bool av_sync_initialized = false;
+    bool delay_scheduler_initialized = false;
+    bool delay_scheduler_started = false;
     bool video_demuxer_started = false;
     bool audio_demuxer_started = false;
+    bool video_splicer_initialized = false;
+    bool audio_splicer_initialized = false;
 #ifdef HAVE_USB
     bool aoa_hid_initialized = false;
     bool keyboard_aoa_initialized = false;
@@ -421,77 +712,35 @@ scrcpy(struct scrcpy_options *options) {
 #endif
     bool controller_initialized = false;
     bool controller_started = false;
+    bool input_recorder_opened = false;
+    bool input_replayer_initialized = false;
+    bool input_replayer_started = false;
+#ifndef _WIN32
+    bool input_socket_initialized = false;
+    bool input_socket_started = false;
+#endif
+    bool metrics_initialized = false;
+    bool metrics_started = false;
+    bool icon_loader_started = false;
     bool screen_initialized = false;
     bool timeout_initialized = false;
     bool timeout_started = false;
 
     struct sc_acksync *acksync = NULL;
 
-    uint32_t scid = scrcpy_generate_scid();
-
-    struct sc_server_params params = {
-        .scid = scid,
-        .req_serial = options->serial,
-        .select_usb = options->select_usb,
-        .select_tcpip = options->select_tcpip,
-        .log_level = options->log_level,
-        .video_codec = options->video_codec,
-        .audio_codec = options->audio_codec,
-        .video_source = options->video_source,
-        .audio_source = options->audio_source,
-        .camera_facing = options->camera_facing,
-        .crop = options->crop,
-        .port_range = options->port_range,
-        .tunnel_host = options->tunnel_host,
-        .tunnel_port = options->tunnel_port,
-        .max_size = options->max_size,
-        .video_bit_rate = options->video_bit_rate,
-        .audio_bit_rate = options->audio_bit_rate,
-        .max_fps = options->max_fps,
-        .angle = options->angle,
-        .screen_off_timeout = options->screen_off_timeout,
-        .capture_orientation = options->capture_orientation,
-        .capture_orientation_lock = options->capture_orientation_lock,
-        .control = options->control,
-        .display_id = options->display_id,
-        .new_display = options->new_display,
-        .display_ime_policy = options->display_ime_policy,
-        .video = options->video,
-        .audio = options->audio,
-        .audio_dup = options->audio_dup,
-        .show_touches = options->show_touches,
-        .stay_awake = options->stay_awake,
-        .video_codec_options = options->video_codec_options,
-        .audio_codec_options = options->audio_codec_options,
-        .video_encoder = options->video_encoder,
-        .audio_encoder = options->audio_encoder,
-        .camera_id = options->camera_id,
-        .camera_size = options->camera_size,
-        .camera_ar = options->camera_ar,
-        .camera_fps = options->camera_fps,
-        .force_adb_forward = options->force_adb_forward,
-        .power_off_on_close = options->power_off_on_close,
-        .clipboard_autosync = options->clipboard_autosync,
-        .downsize_on_error = options->downsize_on_error,
-        .tcpip = options->tcpip,
-        .tcpip_dst = options->tcpip_dst,
-        .cleanup = options->cleanup,
-        .power_on = options->power_on,
-        .kill_adb_on_close = options->kill_adb_on_close,
-        .camera_high_speed = options->camera_high_speed,
-        .vd_destroy_content = options->vd_destroy_content,
-        .vd_system_decorations = options->vd_system_decorations,
-        .list = options->list,
+    sc_thread icon_loader_thread;
+    struct scrcpy_icon_loader icon_loader = {
+        .startup_timing = &s->startup_timing,
+        .icon = NULL,
     };
 
-    static const struct sc_server_callbacks cbs = {
-        .on_connection_failed = sc_server_on_connection_failed,
-        .on_connected = sc_server_on_connected,
-        .on_disconnected = sc_server_on_disconnected,
-    };
-    if (!sc_server_init(&s->server, &params, &cbs, NULL)) {
+    struct sc_server_params params;
+    scrcpy_init_server_params(&params, options, &s->startup_timing);
+
+    if (!sc_server_init(&s->server, &params, &server_cbs, NULL)) {
         return SCRCPY_EXIT_FAILURE;
     }
+    server_initialized = true;
 
     if (options->window) {
         // Set hints before starting the server thread to avoid race conditions
@@ -515,6 +764,19 @@ scrcpy(struct scrcpy_options *options) {
     assert(!options->video_playback || options->video);
     assert(!options->audio_playback || options->audio);
 
+    if (options->window) {
+        // Decode the icon while the server is starting
+        icon_loader_started = sc_thread_create(&icon_loader_thread,
+                                               run_icon_loader,
+                                               "scrcpy-icon", &icon_loader);
+        if (!icon_loader_started) {
+            // Not fatal, the icon will be loaded by the screen
+            LOGW("Could not create icon loader thread");
+        }
+    }
+
+    sc_startup_timing_begin(&s->startup_timing, SC_STARTUP_PHASE_SDL_INIT);
+
     if (options->window ||
             (options->control && options->clipboard_autosync)) {
         // Initialize the video subsystem even if --no-video or
@@ -532,7 +794,8 @@ scrcpy(struct scrcpy_options *options) {
         }
     }
 
-    if (options->audio_playback) {
+    if (options->audio_playback
+            && options->audio_output == SC_AUDIO_OUTPUT_BACKEND_SDL) {
         if (SDL_Init(SDL_INIT_AUDIO)) {
             LOGE("Could not initialize SDL audio: %s", SDL_GetError());
             goto end;
@@ -548,6 +811,8 @@ scrcpy(struct scrcpy_options *options) {
 
     sdl_configure(options->video_playback, options->disable_screensaver);
 
+    sc_startup_timing_end(&s->startup_timing, SC_STARTUP_PHASE_SDL_INIT);
+
     // Await for server without blocking Ctrl+C handling
     bool connected;
     if (!await_for_server(&connected)) {
@@ -581,35 +846,62 @@ scrcpy(struct scrcpy_options *options) {
         file_pusher_initialized = true;
     }
 
+    // On reconnection, the demuxers are replaced, so the other components are
+    // plugged to splicers which outlive them
+    struct sc_packet_source *video_packet_source = NULL;
+    struct sc_packet_source *audio_packet_source = NULL;
+
     if (options->video) {
-        static const struct sc_demuxer_callbacks video_demuxer_cbs = {
-            .on_ended = sc_video_demuxer_on_ended,
-        };
         sc_demuxer_init(&s->video_demuxer, "video", s->server.video_socket,
                         &video_demuxer_cbs, NULL);
+        sc_demuxer_set_startup_timing(&s->video_demuxer, &s->startup_timing);
+        video_packet_source = &s->video_demuxer.packet_source;
+
+        if (options->reconnect) {
+            if (!sc_packet_splicer_init(&s->video_splicer, "video")) {
+                goto end;
+            }
+            video_splicer_initialized = true;
+            sc_packet_source_add_sink(video_packet_source,
+                                      &s->video_splicer.packet_sink);
+            video_packet_source = &s->video_splicer.packet_source;
+        }
     }
 
     if (options->audio) {
-        static const struct sc_demuxer_callbacks audio_demuxer_cbs = {
-            .on_ended = sc_audio_demuxer_on_ended,
-        };
         sc_demuxer_init(&s->audio_demuxer, "audio", s->server.audio_socket,
-                        &audio_demuxer_cbs, options);
+                        &audio_demuxer_cbs, (void *) options);
+        sc_demuxer_set_startup_timing(&s->audio_demuxer, &s->startup_timing);
+        audio_packet_source = &s->audio_demuxer.packet_source;
+
+        if (options->reconnect) {
+            if (!sc_packet_splicer_init(&s->audio_splicer, "audio")) {
+                goto end;
+            }
+            audio_splicer_initialized = true;
+            sc_packet_source_add_sink(audio_packet_source,
+                                      &s->audio_splicer.packet_sink);
+            audio_packet_source = &s->audio_splicer.packet_source;
+        }
     }
 
     bool needs_video_decoder = options->video_playback;
-    bool needs_audio_decoder = options->audio_playback;
+    // Raw audio packets are played directly, without decoding
+    bool needs_audio_decoder = options->audio_playback
+                            && options->audio_codec != SC_CODEC_RAW;
 #ifdef HAVE_V4L2
     needs_video_decoder |= !!options->v4l2_device;
 #endif
     if (needs_video_decoder) {
         sc_decoder_init(&s->video_decoder, "video");
-        sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+        sc_decoder_set_mode(&s->video_decoder, options->video_decode_mode,
+                            options->video_decode_lowres_level);
+        sc_packet_source_add_sink(video_packet_source,
                                   &s->video_decoder.packet_sink);
     }
     if (needs_audio_decoder) {
         sc_decoder_init(&s->audio_decoder, "audio");
-        sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
+        sc_packet_source_add_sink(audio_packet_source,
                                   &s->audio_decoder.packet_sink);
     }
 
@@ -631,15 +923,74 @@ scrcpy(struct scrcpy_options *options) {
         recorder_started = true;
 
         if (options->video) {
-            sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+            sc_packet_source_add_sink(video_packet_source,
                                       &s->recorder.video_packet_sink);
         }
         if (options->audio) {
-            sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
+            sc_packet_source_add_sink(audio_packet_source,
                                       &s->recorder.audio_packet_sink);
         }
     }
 
+    if (options->relay_type != SC_RELAY_TYPE_NONE) {
+        struct sc_relay_params relay_params = {
+            .type = options->relay_type,
+            .format = options->relay_format,
+            .path = options->relay_path,
+            .host = options->relay_host,
+            .port = options->relay_port,
+            .video = options->video,
+            .audio = options->audio,
+        };
+        if (!sc_relay_init(&s->relay, &relay_params)) {
+            goto end;
+        }
+        relay_initialized = true;
+
+        if (!sc_relay_start(&s->relay)) {
+            goto end;
+        }
+        relay_started = true;
+
+        if (options->video) {
+            sc_packet_source_add_sink(video_packet_source,
+                                      &s->relay.video_packet_sink);
+        }
+        if (options->audio) {
+            sc_packet_source_add_sink(audio_packet_source,
+                                      &s->relay.audio_packet_sink);
+        }
+    }
+
+    // Monitor the A/V offset whenever both audio and video are played
+    bool needs_av_sync = options->video_playback && options->audio_playback;
+    if (needs_av_sync) {
+        if (!sc_av_sync_init(&s->av_sync, options->av_sync)) {
+            goto end;
+        }
+        av_sync_initialized = true;
+    }
+
+    // The video delay buffer is also necessary to correct the A/V offset
+    bool needs_video_buffer = options->window && options->video_playback
+                           && (options->video_buffer || options->av_sync);
+    bool needs_delay_scheduler = needs_video_buffer;
+#ifdef HAVE_V4L2
+    needs_delay_scheduler |= options->v4l2_device && options->v4l2_buffer;
+#endif
+    if (needs_delay_scheduler) {
+        // A single thread releases the delayed frames of all delay buffers
+        if (!sc_delay_scheduler_init(&s->delay_scheduler)) {
+            goto end;
+        }
+        delay_scheduler_initialized = true;
+
+        if (!sc_delay_scheduler_start(&s->delay_scheduler)) {
+            goto end;
+        }
+        delay_scheduler_started = true;
+    }
+
     struct sc_controller *controller = NULL;
     struct sc_key_processor *kp = NULL;
     struct sc_mouse_processor *mp = NULL;
@@ -699,7 +1050,9 @@ scrcpy(struct scrcpy_options *options) {
                 goto end;
             }
 
-            ok = sc_aoa_init(&s->aoa, &s->usb, &s->acksync);
+            sc_aoa_transport_usb_init(&s->aoa_transport, &s->usb);
+            ok = sc_aoa_init(&s->aoa, &s->aoa_transport.transport,
+                             &s->acksync);
             if (!ok) {
                 LOGE("Failed to enable HID over AOA");
                 sc_usb_disconnect(&s->usb);
@@ -732,7 +1085,9 @@ scrcpy(struct scrcpy_options *options) {
             }
 
             if (use_gamepad_aoa) {
-                sc_gamepad_aoa_init(&s->gamepad_aoa, &s->aoa);
+                sc_gamepad_aoa_init(&s->gamepad_aoa, &s->aoa,
+                                    options->gamepad_report_interval,
+                                    options->gamepad_deadzone);
                 gp = &s->gamepad_aoa.gamepad_processor;
                 gamepad_aoa_initialized = true;
             }
@@ -785,7 +1140,9 @@ aoa_complete:
         }
 
         if (options->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_UHID) {
-            sc_gamepad_uhid_init(&s->gamepad_uhid, &s->controller);
+            sc_gamepad_uhid_init(&s->gamepad_uhid, &s->controller,
+                                 options->gamepad_report_interval,
+                                 options->gamepad_deadzone);
             gp = &s->gamepad_uhid.gamepad_processor;
         }
 
@@ -795,12 +1152,53 @@ aoa_complete:
             uhid_devices = &s->uhid_devices;
         }
 
-        sc_controller_configure(&s->controller, acksync, uhid_devices);
+        struct sc_input_recorder *input_recorder = NULL;
+        if (options->input_record_filename) {
+            if (!sc_input_recorder_open(&s->input_recorder,
+                                        options->input_record_filename)) {
+                goto end;
+            }
+            input_recorder_opened = true;
+            input_recorder = &s->input_recorder;
+        }
+
+        sc_controller_configure(&s->controller, acksync, uhid_devices,
+                                input_recorder);
 
         if (!sc_controller_start(&s->controller)) {
             goto end;
         }
         controller_started = true;
+
+#ifndef _WIN32
+        if (options->input_socket) {
+            if (!sc_input_socket_init(&s->input_socket, options->input_socket,
+                                      &s->controller)) {
+                goto end;
+            }
+            input_socket_initialized = true;
+
+            if (!sc_input_socket_start(&s->input_socket)) {
+                goto end;
+            }
+            input_socket_started = true;
+        }
+#endif
+
+        if (options->input_replay_filename) {
+            if (!sc_input_replayer_init(&s->input_replayer,
+                                        options->input_replay_filename,
+                                        options->input_replay_speed,
+                                        &s->controller)) {
+                goto end;
+            }
+            input_replayer_initialized = true;
+
+            if (!sc_input_replayer_start(&s->input_replayer)) {
+                goto end;
+            }
+            input_replayer_started = true;
+        }
     }
 
     // There is a controller if and only if control is enabled
@@ -817,6 +1215,8 @@ aoa_complete:
             .kp = kp,
             .mp = mp,
             .gp = gp,
+            .av_sync = av_sync_initialized ? &s->av_sync : NULL,
+            .startup_timing = &s->startup_timing,
             .mouse_bindings = options->mouse_bindings,
             .legacy_paste = options->legacy_paste,
             .clipboard_autosync = options->clipboard_autosync,
@@ -832,18 +1232,33 @@ aoa_complete:
             .mipmaps = options->mipmaps,
             .fullscreen = options->fullscreen,
             .start_fps_counter = options->start_fps_counter,
+            .mouse_motion_coalescing = options->mouse_motion_coalescing,
         };
 
+        if (icon_loader_started) {
+            sc_thread_join(&icon_loader_thread, NULL);
+            icon_loader_started = false;
+            screen_params.icon = icon_loader.icon;
+        }
+
+        sc_startup_timing_begin(&s->startup_timing,
+                                SC_STARTUP_PHASE_SCREEN_INIT);
         if (!sc_screen_init(&s->screen, &screen_params)) {
             goto end;
         }
+        sc_startup_timing_end(&s->startup_timing,
+                              SC_STARTUP_PHASE_SCREEN_INIT);
         screen_initialized = true;
 
         if (options->video_playback) {
             struct sc_frame_source *src = &s->video_decoder.frame_source;
-            if (options->video_buffer) {
-                sc_delay_buffer_init(&s->video_buffer,
-                                     options->video_buffer, true);
+            if (needs_video_buffer) {
+                struct sc_av_sync *av_sync =
+                    options->av_sync ? &s->av_sync : NULL;
+                sc_delay_buffer_init(&s->video_buffer, &s->delay_scheduler,
+                                     "video", options->video_buffer,
+                                     options->video_buffer_auto, true,
+                                     av_sync);
                 sc_frame_source_add_sink(src, &s->video_buffer.frame_sink);
                 src = &s->video_buffer.frame_source;
             }
@@ -853,21 +1268,61 @@ aoa_complete:
     }
 
     if (options->audio_playback) {
-        sc_audio_player_init(&s->audio_player, options->audio_buffer,
-                             options->audio_output_buffer);
-        sc_frame_source_add_sink(&s->audio_decoder.frame_source,
-                                 &s->audio_player.frame_sink);
+        struct sc_audio_output *aout;
+        switch (options->audio_output) {
+#ifdef HAVE_ALSA
+            case SC_AUDIO_OUTPUT_BACKEND_ALSA: {
+                const char *pcm = options->audio_output_target
+                                ? options->audio_output_target : "default";
+                sc_audio_output_alsa_init(&s->audio_output_alsa, pcm);
+                aout = &s->audio_output_alsa.audio_output;
+                break;
+            }
+#endif
+            case SC_AUDIO_OUTPUT_BACKEND_NULL:
+            case SC_AUDIO_OUTPUT_BACKEND_FILE:
+                sc_audio_output_null_init(&s->audio_output_null,
+                                          options->audio_output_target);
+                aout = &s->audio_output_null.audio_output;
+                break;
+            default:
+                assert(options->audio_output == SC_AUDIO_OUTPUT_BACKEND_SDL);
+                sc_audio_output_sdl_init(&s->audio_output_sdl);
+                aout = &s->audio_output_sdl.audio_output;
+                break;
+        }
+
+        sc_audio_player_init(&s->audio_player, aout, options->audio_buffer,
+                             options->audio_buffer_auto,
+                             options->audio_output_buffer,
+                             av_sync_initialized ? &s->av_sync : NULL);
+        if (needs_audio_decoder) {
+            sc_frame_source_add_sink(&s->audio_decoder.frame_source,
+                                     &s->audio_player.frame_sink);
+        } else {
+            sc_packet_source_add_sink(audio_packet_source,
+                                      &s->audio_player.packet_sink);
+        }
     }
 
 #ifdef HAVE_V4L2
     if (options->v4l2_device) {
-        if (!sc_v4l2_sink_init(&s->v4l2_sink, options->v4l2_device)) {
+        struct sc_v4l2_sink_params v4l2_params = {
+            .device_name = options->v4l2_device,
+            .format = options->v4l2_format,
+            .crop = options->v4l2_crop,
+            .orientation = options->v4l2_orientation,
+            .size = options->v4l2_size,
+        };
+        if (!sc_v4l2_sink_init(&s->v4l2_sink, &v4l2_params)) {
             goto end;
         }
 
         struct sc_frame_source *src = &s->video_decoder.frame_source;
         if (options->v4l2_buffer) {
-            sc_delay_buffer_init(&s->v4l2_buffer, options->v4l2_buffer, true);
+            sc_delay_buffer_init(&s->v4l2_buffer, &s->delay_scheduler,
+                                 "v4l2", options->v4l2_buffer,
+                                 options->v4l2_buffer_auto, true, NULL);
             sc_frame_source_add_sink(src, &s->v4l2_buffer.frame_sink);
             src = &s->v4l2_buffer.frame_source;
         }
@@ -878,6 +1333,47 @@ aoa_complete:
     }
 #endif
 
+    if (screen_initialized && options->video_playback) {
+        struct sc_hud_sources hud_sources = {
+            .video_demuxer = &s->video_demuxer,
+            .video_decoder = &s->video_decoder,
+            .fps_counter = &s->screen.fps_counter,
+            .audio_player = options->audio_playback ? &s->audio_player : NULL,
+            .controller = controller,
+            .recorder = recorder_initialized ? &s->recorder : NULL,
+        };
+        sc_hud_set_sources(&s->screen.hud, &hud_sources);
+    }
+
+    if (options->metrics_type != SC_METRICS_TYPE_NONE) {
+        struct sc_metrics_params metrics_params = {
+            .type = options->metrics_type,
+            .path = options->metrics_path,
+            .host = options->metrics_host,
+            .port = options->metrics_port,
+            .interval = options->metrics_interval,
+        };
+        struct sc_metrics_sources metrics_sources = {
+            .video_demuxer = options->video ? &s->video_demuxer : NULL,
+            .audio_demuxer = options->audio ? &s->audio_demuxer : NULL,
+            .video_decoder = needs_video_decoder ? &s->video_decoder : NULL,
+            .audio_decoder = needs_audio_decoder ? &s->audio_decoder : NULL,
+            .fps_counter = screen_initialized ? &s->screen.fps_counter : NULL,
+            .audio_player = options->audio_playback ? &s->audio_player : NULL,
+            .controller = controller,
+            .recorder = recorder_initialized ? &s->recorder : NULL,
+        };
+        if (!sc_metrics_init(&s->metrics, &metrics_params, &metrics_sources)) {
+            goto end;
+        }
+        metrics_initialized = true;
+
+        if (!sc_metrics_start(&s->metrics)) {
+            goto end;
+        }
+        metrics_started = true;
+    }
+
     // Now that the header values have been consumed, the socket(s) will
     // receive the stream(s). Start the demuxer(s).
 
@@ -952,7 +1448,89 @@ aoa_complete:
         }
     }
 
-    ret = event_loop(s, options->window);
+    for (;;) {
+        ret = event_loop(s, options->window);
+        if (ret != SCRCPY_EXIT_DISCONNECTED || !options->reconnect) {
+            break;
+        }
+
+        // Stop the session, but keep the window, the decoders and the
+        // recorder alive
+        if (controller_started) {
+            sc_controller_stop(&s->controller);
+        }
+        sc_server_stop(&s->server);
+        if (video_demuxer_started) {
+            sc_demuxer_join(&s->video_demuxer);
+            video_demuxer_started = false;
+        }
+        if (audio_demuxer_started) {
+            sc_demuxer_join(&s->audio_demuxer);
+            audio_demuxer_started = false;
+        }
+        if (controller_started) {
+            sc_controller_join(&s->controller);
+            controller_started = false;
+        }
+        sc_server_join(&s->server);
+        server_started = false;
+        sc_server_destroy(&s->server);
+        server_initialized = false;
+
+        // All the components of the session are joined, their pending events
+        // are obsolete
+        SDL_FlushEvent(SC_EVENT_DEVICE_DISCONNECTED);
+
+        if (!scrcpy_reconnect(s, options, &params, &server_initialized,
+                              &ret)) {
+            break;
+        }
+        server_started = true;
+
+        if (options->control) {
+            sc_controller_reset(&s->controller, s->server.control_socket);
+            if (!sc_controller_start(&s->controller)) {
+                ret = SCRCPY_EXIT_FAILURE;
+                break;
+            }
+            controller_started = true;
+
+            if (options->turn_screen_off) {
+                struct sc_control_msg msg;
+                msg.type = SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER;
+                msg.set_display_power.on = false;
+
+                if (!sc_controller_push_msg(&s->controller, &msg)) {
+                    LOGW("Could not request 'set display power'");
+                }
+            }
+        }
+
+        if (options->video) {
+            sc_demuxer_init(&s->video_demuxer, "video",
+                            s->server.video_socket, &video_demuxer_cbs, NULL);
+            sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+                                      &s->video_splicer.packet_sink);
+            if (!sc_demuxer_start(&s->video_demuxer)) {
+                ret = SCRCPY_EXIT_FAILURE;
+                break;
+            }
+            video_demuxer_started = true;
+        }
+
+        if (options->audio) {
+            sc_demuxer_init(&s->audio_demuxer, "audio",
+                            s->server.audio_socket, &audio_demuxer_cbs,
+                            (void *) options);
+            sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
+                                      &s->audio_splicer.packet_sink);
+            if (!sc_demuxer_start(&s->audio_demuxer)) {
+                ret = SCRCPY_EXIT_FAILURE;
+                break;
+            }
+            audio_demuxer_started = true;
+        }
+    }
     terminate_event_loop();
     LOGD("quit...");
 
@@ -964,6 +1542,16 @@ aoa_complete:
     }
 
 end:
+    // The metrics thread reads the state of the other components, join it
+    // before anything is destroyed
+    if (metrics_started) {
+        sc_metrics_stop(&s->metrics);
+        sc_metrics_join(&s->metrics);
+    }
+    if (metrics_initialized) {
+        sc_metrics_destroy(&s->metrics);
+    }
+
     if (timeout_started) {
         sc_timeout_stop(&s->timeout);
     }
@@ -988,6 +1576,14 @@ end:
         sc_acksync_destroy(acksync);
     }
 #endif
+#ifndef _WIN32
+    if (input_socket_started) {
+        sc_input_socket_stop(&s->input_socket);
+    }
+#endif
+    if (input_replayer_started) {
+        sc_input_replayer_stop(&s->input_replayer);
+    }
     if (controller_started) {
         sc_controller_stop(&s->controller);
     }
@@ -997,10 +1593,21 @@ end:
     if (recorder_initialized) {
         sc_recorder_stop(&s->recorder);
     }
+    if (relay_started) {
+        sc_relay_stop(&s->relay);
+    }
     if (screen_initialized) {
         sc_screen_interrupt(&s->screen);
     }
 
+    if (icon_loader_started) {
+        // The icon loader terminates by itself
+        sc_thread_join(&icon_loader_thread, NULL);
+    }
+    if (icon_loader.icon) {
+        scrcpy_icon_destroy(icon_loader.icon);
+    }
+
     if (server_started) {
         // shutdown the sockets and kill the server
         sc_server_stop(&s->server);
@@ -1023,6 +1630,23 @@ end:
         sc_demuxer_join(&s->audio_demuxer);
     }
 
+    // Without reconnection, the demuxers close their sinks by themselves
+    if (video_splicer_initialized) {
+        sc_packet_splicer_destroy(&s->video_splicer);
+    }
+    if (audio_splicer_initialized) {
+        sc_packet_splicer_destroy(&s->audio_splicer);
+    }
+
+    // The delay buffers are closed once the demuxers are joined
+    if (delay_scheduler_started) {
+        sc_delay_scheduler_stop(&s->delay_scheduler);
+        sc_delay_scheduler_join(&s->delay_scheduler);
+    }
+    if (delay_scheduler_initialized) {
+        sc_delay_scheduler_destroy(&s->delay_scheduler);
+    }
+
 #ifdef HAVE_V4L2
     if (v4l2_sink_initialized) {
         sc_v4l2_sink_destroy(&s->v4l2_sink);
@@ -1047,12 +1671,37 @@ end:
         sc_screen_destroy(&s->screen);
     }
 
+    // The audio player and the screen do not use it anymore
+    if (av_sync_initialized) {
+        sc_av_sync_destroy(&s->av_sync);
+    }
+
+#ifndef _WIN32
+    // The input socket pushes to the controller, join it first
+    if (input_socket_started) {
+        sc_input_socket_join(&s->input_socket);
+    }
+    if (input_socket_initialized) {
+        sc_input_socket_destroy(&s->input_socket);
+    }
+#endif
+    if (input_replayer_started) {
+        sc_input_replayer_join(&s->input_replayer);
+    }
+    if (input_replayer_initialized) {
+        sc_input_replayer_destroy(&s->input_replayer);
+    }
+
     if (controller_started) {
         sc_controller_join(&s->controller);
     }
     if (controller_initialized) {
         sc_controller_destroy(&s->controller);
     }
+    // The controller thread does not write to the recorder anymore
+    if (input_recorder_opened) {
+        sc_input_recorder_close(&s->input_recorder);
+    }
 
     if (recorder_started) {
         sc_recorder_join(&s->recorder);
@@ -1061,6 +1710,14 @@ end:
         sc_recorder_destroy(&s->recorder);
     }
 
+    // The demuxers do not push packets to the relay anymore
+    if (relay_started) {
+        sc_relay_join(&s->relay);
+    }
+    if (relay_initialized) {
+        sc_relay_destroy(&s->relay);
+    }
+
     if (file_pusher_initialized) {
         sc_file_pusher_join(&s->file_pusher);
         sc_file_pusher_destroy(&s->file_pusher);
@@ -1069,8 +1726,9 @@ end:
     if (server_started) {
         sc_server_join(&s->server);
     }
-
-    sc_server_destroy(&s->server);
+    if (server_initialized) {
+        sc_server_destroy(&s->server);
+    }
 
     return ret;
 }
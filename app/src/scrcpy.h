@@ -3,7 +3,11 @@
 
 #include "common.h"
 
+#include <stdint.h>
+
 #include "options.h"
+#include "server.h"
+#include "startup_timing.h"
 
 enum scrcpy_exit_code {
     // Normal program termination
@@ -19,4 +23,14 @@ enum scrcpy_exit_code {
 enum scrcpy_exit_code
 scrcpy(struct scrcpy_options *options);
 
+// Generate a scrcpy id to differentiate multiple running scrcpy instances
+uint32_t
+scrcpy_generate_scid(void);
+
+// Initialize the server parameters from the options (with a new scid)
+void
+scrcpy_init_server_params(struct sc_server_params *params,
+                          const struct scrcpy_options *options,
+                          struct sc_startup_timing *startup_timing);
+
 #endif
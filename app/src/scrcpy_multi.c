@@ -0,0 +1,947 @@
+#include "scrcpy_multi.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "adb/adb.h"
+#include "control_msg.h"
+#include "controller.h"
+#include "decoder.h"
+#include "demuxer.h"
+#include "demuxer_pool.h"
+#include "events.h"
+#include "keyboard_sdk.h"
+#include "mouse_sdk.h"
+#include "screen.h"
+#include "server.h"
+#include "startup_timing.h"
+#include "wall.h"
+#include "util/intr.h"
+#include "util/log.h"
+#include "util/tick.h"
+
+/**
+ * A mirroring session for one device.
+ *
+ * Contrary to scrcpy(), there is no thread per stream: the demuxers (which
+ * also run the decoders) of all the sessions are run by a shared demuxer pool,
+ * and all the windows are handled by a single event loop.
+ *
+ * The events concerning a session carry the session (or its screen) in
+ * event.user.data1.
+ *
+ * In wall mode, the sessions display their video in tiles of a single window
+ * instead of their own screen.
+ */
+struct sc_multi_session {
+    char *serial;
+
+    struct sc_startup_timing startup_timing;
+
+    struct sc_server server;
+    struct sc_demuxer video_demuxer;
+    struct sc_decoder video_decoder;
+    struct sc_controller controller;
+    struct sc_keyboard_sdk keyboard_sdk;
+    struct sc_mouse_sdk mouse_sdk;
+    struct sc_screen screen;
+    struct sc_wall_tile *tile; // wall mode only
+    bool focused; // wall mode only: the tile is focused (fully decoded)
+
+    bool server_initialized;
+    bool server_started;
+    bool connected;
+    bool controller_initialized;
+    bool controller_started;
+    bool screen_initialized;
+    uint32_t window_id;
+
+    bool ended;
+    // the reason of the end of the session
+    enum scrcpy_exit_code exit_code;
+};
+
+struct scrcpy_multi {
+    struct sc_multi_session sessions[SC_MAX_DEVICES];
+    unsigned count;
+
+    struct sc_demuxer_pool demuxer_pool;
+
+    struct sc_wall wall;
+    bool wall_initialized;
+
+    // the decoding mode of the devices (except the focused tile of the wall)
+    enum sc_video_decode_mode video_decode_mode;
+    uint8_t video_decode_lowres_level;
+};
+
+static void
+sc_multi_server_on_connection_failed(struct sc_server *server,
+                                     void *userdata) {
+    (void) server;
+
+    sc_push_event_with_data(SC_EVENT_SERVER_CONNECTION_FAILED, userdata);
+}
+
+static void
+sc_multi_server_on_connected(struct sc_server *server, void *userdata) {
+    (void) server;
+
+    sc_push_event_with_data(SC_EVENT_SERVER_CONNECTED, userdata);
+}
+
+static void
+sc_multi_server_on_disconnected(struct sc_server *server, void *userdata) {
+    (void) server;
+    (void) userdata;
+
+    LOGD("Server disconnected");
+    // Do nothing, the disconnection will be handled by the "stream stopped"
+    // event
+}
+
+static void
+sc_multi_demuxer_on_ended(struct sc_demuxer *demuxer,
+                          enum sc_demuxer_status status, void *userdata) {
+    (void) demuxer;
+
+    // The device may not decide to disable the video
+    assert(status != SC_DEMUXER_STATUS_DISABLED);
+
+    if (status == SC_DEMUXER_STATUS_EOS) {
+        sc_push_event_with_data(SC_EVENT_DEVICE_DISCONNECTED, userdata);
+    } else {
+        sc_push_event_with_data(SC_EVENT_DEMUXER_ERROR, userdata);
+    }
+}
+
+static void
+sc_multi_controller_on_ended(struct sc_controller *controller, bool error,
+                             void *userdata) {
+    // Note: this function may be called twice, once from the controller thread
+    // and once from the receiver thread
+    (void) controller;
+
+    if (error) {
+        sc_push_event_with_data(SC_EVENT_CONTROLLER_ERROR, userdata);
+    } else {
+        sc_push_event_with_data(SC_EVENT_DEVICE_DISCONNECTED, userdata);
+    }
+}
+
+static bool
+sc_multi_parse_serials(struct scrcpy_multi *m, const char *serials) {
+    m->count = 0;
+    for (;;) {
+        const char *sep = strchr(serials, ',');
+        size_t len = sep ? (size_t) (sep - serials) : strlen(serials);
+        // Validated by the CLI parser
+        assert(len);
+        assert(m->count < SC_MAX_DEVICES);
+
+        char *serial = malloc(len + 1);
+        if (!serial) {
+            LOG_OOM();
+            return false;
+        }
+        memcpy(serial, serials, len);
+        serial[len] = '\0';
+
+        struct sc_multi_session *session = &m->sessions[m->count++];
+        memset(session, 0, sizeof(*session));
+        session->serial = serial;
+
+        if (!sep) {
+            return true;
+        }
+        serials = sep + 1;
+    }
+}
+
+static struct sc_multi_session *
+sc_multi_find_session_by_window(struct scrcpy_multi *m, uint32_t window_id) {
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_multi_session *session = &m->sessions[i];
+        if (session->screen_initialized && session->window_id == window_id) {
+            return session;
+        }
+    }
+    return NULL;
+}
+
+static struct sc_multi_session *
+sc_multi_find_session_by_screen(struct scrcpy_multi *m,
+                                const struct sc_screen *screen) {
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_multi_session *session = &m->sessions[i];
+        if (session->screen_initialized && &session->screen == screen) {
+            return session;
+        }
+    }
+    return NULL;
+}
+
+// Return the session whose window is targeted by the event, if any
+static struct sc_multi_session *
+sc_multi_route_event(struct scrcpy_multi *m, const SDL_Event *event) {
+    uint32_t window_id;
+    switch (event->type) {
+        case SC_EVENT_SCREEN_INIT_SIZE:
+        case SC_EVENT_NEW_FRAME:
+        case SC_EVENT_SCREEN_HUD_REFRESH:
+            return sc_multi_find_session_by_screen(m, event->user.data1);
+        case SDL_WINDOWEVENT:
+            window_id = event->window.windowID;
+            break;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            window_id = event->key.windowID;
+            break;
+        case SDL_TEXTINPUT:
+            window_id = event->text.windowID;
+            break;
+        case SDL_MOUSEMOTION:
+            window_id = event->motion.windowID;
+            break;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            window_id = event->button.windowID;
+            break;
+        case SDL_MOUSEWHEEL:
+            window_id = event->wheel.windowID;
+            break;
+        case SDL_DROPFILE:
+            window_id = event->drop.windowID;
+            break;
+        default: {
+            // Other events (e.g. touch events) go to the focused window
+            SDL_Window *focus = SDL_GetKeyboardFocus();
+            if (!focus) {
+                return NULL;
+            }
+            window_id = SDL_GetWindowID(focus);
+            break;
+        }
+    }
+
+    return sc_multi_find_session_by_window(m, window_id);
+}
+
+// Stop the session, the other sessions keep running
+static void
+sc_multi_session_end(struct sc_multi_session *session,
+                     enum scrcpy_exit_code exit_code) {
+    if (session->ended) {
+        // The end of a session may be reported several times (e.g. by the
+        // demuxer and the controller)
+        return;
+    }
+
+    session->ended = true;
+    session->exit_code = exit_code;
+
+    // Interrupt the sockets, so that the demuxer (in the pool) and the
+    // receiver terminate
+    sc_server_stop(&session->server);
+
+    if (session->screen_initialized) {
+        sc_screen_hide_window(&session->screen);
+    }
+    if (session->tile) {
+        sc_wall_tile_end(session->tile);
+    }
+}
+
+static bool
+sc_multi_all_ended(struct scrcpy_multi *m) {
+    for (unsigned i = 0; i < m->count; ++i) {
+        if (!m->sessions[i].ended) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static enum scrcpy_exit_code
+sc_multi_exit_code(struct scrcpy_multi *m) {
+    // Report an error if any, then a disconnection if any
+    enum scrcpy_exit_code ret = SCRCPY_EXIT_SUCCESS;
+    for (unsigned i = 0; i < m->count; ++i) {
+        enum scrcpy_exit_code code = m->sessions[i].exit_code;
+        if (code == SCRCPY_EXIT_FAILURE) {
+            return SCRCPY_EXIT_FAILURE;
+        }
+        if (code == SCRCPY_EXIT_DISCONNECTED) {
+            ret = SCRCPY_EXIT_DISCONNECTED;
+        }
+    }
+    return ret;
+}
+
+// Wait for the connection of all the servers (the devices which could not be
+// connected are ignored). Return false if the user requested to quit.
+static bool
+sc_multi_await_servers(struct scrcpy_multi *m) {
+    unsigned pending = 0;
+    for (unsigned i = 0; i < m->count; ++i) {
+        if (m->sessions[i].server_started) {
+            ++pending;
+        }
+    }
+
+    SDL_Event event;
+    while (pending && SDL_WaitEvent(&event)) {
+        switch (event.type) {
+            case SC_EVENT_SERVER_CONNECTED: {
+                struct sc_multi_session *session = event.user.data1;
+                LOGD("Device %s: server connected", session->serial);
+                session->connected = true;
+                --pending;
+                break;
+            }
+            case SC_EVENT_SERVER_CONNECTION_FAILED: {
+                struct sc_multi_session *session = event.user.data1;
+                LOGE("Device %s: server connection failed", session->serial);
+                sc_multi_session_end(session, SCRCPY_EXIT_FAILURE);
+                --pending;
+                break;
+            }
+            case SDL_QUIT:
+                return false;
+            case SC_EVENT_RUN_ON_MAIN_THREAD: {
+                sc_runnable_fn run = event.user.data1;
+                void *userdata = event.user.data2;
+                run(userdata);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+static bool
+sc_multi_session_init_screen(struct sc_multi_session *session,
+                             const struct scrcpy_options *options,
+                             struct sc_controller *controller,
+                             struct sc_key_processor *kp,
+                             struct sc_mouse_processor *mp) {
+    struct sc_server *server = &session->server;
+
+    // The device names are not unique, add the serial
+    char *window_title = NULL;
+    if (!options->window_title) {
+        int r = asprintf(&window_title, "%s (%s)",
+                         server->info.device_name, session->serial);
+        if (r == -1) {
+            LOG_OOM();
+            return false;
+        }
+    }
+
+    struct sc_screen_params screen_params = {
+        .video = true,
+        .controller = controller,
+        .fp = NULL,
+        .kp = kp,
+        .mp = mp,
+        .gp = NULL,
+        .av_sync = NULL,
+        .startup_timing = &session->startup_timing,
+        .mouse_bindings = options->mouse_bindings,
+        .legacy_paste = options->legacy_paste,
+        .clipboard_autosync = options->clipboard_autosync,
+        .shortcut_mods = options->shortcut_mods,
+        .icon = NULL,
+        .window_title = window_title ? window_title : options->window_title,
+        .always_on_top = options->always_on_top,
+        .window_x = options->window_x,
+        .window_y = options->window_y,
+        .window_width = options->window_width,
+        .window_height = options->window_height,
+        .window_borderless = options->window_borderless,
+        .orientation = options->display_orientation,
+        .mipmaps = options->mipmaps,
+        .fullscreen = options->fullscreen,
+        .start_fps_counter = options->start_fps_counter,
+        .mouse_motion_coalescing = options->mouse_motion_coalescing,
+    };
+
+    sc_startup_timing_begin(&session->startup_timing,
+                            SC_STARTUP_PHASE_SCREEN_INIT);
+    bool ok = sc_screen_init(&session->screen, &screen_params);
+    free(window_title);
+    if (!ok) {
+        return false;
+    }
+    sc_startup_timing_end(&session->startup_timing,
+                          SC_STARTUP_PHASE_SCREEN_INIT);
+    session->screen_initialized = true;
+    session->window_id = SDL_GetWindowID(session->screen.window);
+
+    return true;
+}
+
+static bool
+sc_multi_session_init(struct scrcpy_multi *m, struct sc_multi_session *session,
+                      unsigned tile_index,
+                      const struct scrcpy_options *options) {
+    struct sc_server *server = &session->server;
+
+    static const struct sc_demuxer_callbacks demuxer_cbs = {
+        .on_ended = sc_multi_demuxer_on_ended,
+    };
+    sc_demuxer_init(&session->video_demuxer, "video", server->video_socket,
+                    &demuxer_cbs, session);
+    sc_demuxer_set_startup_timing(&session->video_demuxer,
+                                  &session->startup_timing);
+
+    sc_decoder_init(&session->video_decoder, "video");
+    sc_decoder_set_mode(&session->video_decoder, m->video_decode_mode,
+                        m->video_decode_lowres_level);
+    sc_packet_source_add_sink(&session->video_demuxer.packet_source,
+                              &session->video_decoder.packet_sink);
+
+    struct sc_controller *controller = NULL;
+    struct sc_key_processor *kp = NULL;
+    struct sc_mouse_processor *mp = NULL;
+
+    if (options->control) {
+        static const struct sc_controller_callbacks controller_cbs = {
+            .on_ended = sc_multi_controller_on_ended,
+        };
+        if (!sc_controller_init(&session->controller, server->control_socket,
+                                &controller_cbs, session)) {
+            return false;
+        }
+        session->controller_initialized = true;
+        controller = &session->controller;
+
+        // Only the SDK input modes are supported (validated by the CLI)
+        if (options->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_SDK) {
+            sc_keyboard_sdk_init(&session->keyboard_sdk, controller,
+                                 options->key_inject_mode,
+                                 options->forward_key_repeat);
+            kp = &session->keyboard_sdk.key_processor;
+        }
+
+        if (options->mouse_input_mode == SC_MOUSE_INPUT_MODE_SDK) {
+            sc_mouse_sdk_init(&session->mouse_sdk, controller,
+                              options->mouse_hover);
+            mp = &session->mouse_sdk.mouse_processor;
+        }
+    }
+
+    if (m->wall_initialized) {
+        // The tiles are assigned in the order of the connected sessions
+        assert(tile_index < m->wall.tile_count);
+        session->tile = &m->wall.tiles[tile_index];
+        sc_wall_tile_set_processors(session->tile, kp, mp);
+        sc_wall_tile_set_startup_timing(session->tile,
+                                        &session->startup_timing);
+        sc_frame_source_add_sink(&session->video_decoder.frame_source,
+                                 &session->tile->frame_sink);
+    } else {
+        if (!sc_multi_session_init_screen(session, options, controller, kp,
+                                          mp)) {
+            return false;
+        }
+        sc_frame_source_add_sink(&session->video_decoder.frame_source,
+                                 &session->screen.frame_sink);
+    }
+
+    sc_demuxer_pool_add(&m->demuxer_pool, &session->video_demuxer);
+
+    if (options->control) {
+        if (!sc_controller_start(&session->controller)) {
+            return false;
+        }
+        session->controller_started = true;
+
+        if (options->turn_screen_off) {
+            struct sc_control_msg msg;
+            msg.type = SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER;
+            msg.set_display_power.on = false;
+
+            if (!sc_controller_push_msg(&session->controller, &msg)) {
+                LOGW("Device %s: could not request 'set display power'",
+                     session->serial);
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool
+sc_multi_wait_event(struct scrcpy_multi *m, SDL_Event *event) {
+    for (;;) {
+        // The earliest deadline of the input managers (for input coalescing)
+        // and of the wall (for the focus of the hovered tile)
+        sc_tick deadline = 0;
+        for (unsigned i = 0; i < m->count; ++i) {
+            struct sc_multi_session *session = &m->sessions[i];
+            if (session->screen_initialized && !session->ended) {
+                sc_tick d =
+                    sc_input_manager_get_deadline(&session->screen.im);
+                if (d && (!deadline || d < deadline)) {
+                    deadline = d;
+                }
+            }
+        }
+        if (m->wall_initialized) {
+            sc_tick d = sc_wall_get_deadline(&m->wall);
+            if (d && (!deadline || d < deadline)) {
+                deadline = d;
+            }
+        }
+
+        if (!deadline) {
+            return SDL_WaitEvent(event);
+        }
+
+        sc_tick now = sc_tick_now();
+        if (now < deadline) {
+            // Round up, SDL timeouts are expressed in milliseconds
+            int timeout = (deadline - now + SC_TICK_FROM_MS(1) - 1)
+                        / SC_TICK_FROM_MS(1);
+            if (SDL_WaitEventTimeout(event, timeout)) {
+                return true;
+            }
+        }
+
+        // The pending input events must be sent now
+        now = sc_tick_now();
+        for (unsigned i = 0; i < m->count; ++i) {
+            struct sc_multi_session *session = &m->sessions[i];
+            if (session->screen_initialized && !session->ended) {
+                sc_tick d =
+                    sc_input_manager_get_deadline(&session->screen.im);
+                if (d && d <= now) {
+                    sc_input_manager_handle_deadline(&session->screen.im);
+                }
+            }
+        }
+        if (m->wall_initialized) {
+            sc_wall_handle_deadline(&m->wall);
+        }
+    }
+}
+
+static void
+sc_multi_handle_wall_event(struct scrcpy_multi *m, const SDL_Event *event) {
+    if (sc_wall_handle_event(&m->wall, event)) {
+        return;
+    }
+
+    // Only the frame events may fail: stop the session of the tile
+    struct sc_wall_tile *tile = sc_wall_get_event_tile(&m->wall, event);
+    for (unsigned i = 0; tile && i < m->count; ++i) {
+        struct sc_multi_session *session = &m->sessions[i];
+        if (session->tile == tile) {
+            sc_multi_session_end(session, SCRCPY_EXIT_FAILURE);
+            return;
+        }
+    }
+}
+
+static void
+sc_multi_session_set_focused(struct scrcpy_multi *m,
+                             struct sc_multi_session *session, bool focused) {
+    if (session->focused == focused) {
+        return;
+    }
+    session->focused = focused;
+
+    if (m->video_decode_mode == SC_VIDEO_DECODE_MODE_FULL) {
+        // Nothing to change
+        return;
+    }
+
+    if (!focused) {
+        sc_decoder_set_mode(&session->video_decoder, m->video_decode_mode,
+                            m->video_decode_lowres_level);
+        return;
+    }
+
+    sc_decoder_set_mode(&session->video_decoder, SC_VIDEO_DECODE_MODE_FULL,
+                        0);
+
+    // In "keyframes" mode, the decoder must wait for the next key frame (up to
+    // the key frame interval of the device), so request one. In "lowres" mode,
+    // all the frames are decoded, so the artifacts just fade out on the next
+    // key frame.
+    if (m->video_decode_mode == SC_VIDEO_DECODE_MODE_KEYFRAMES
+            && session->controller_started && !session->ended) {
+        struct sc_control_msg msg;
+        msg.type = SC_CONTROL_MSG_TYPE_RESET_VIDEO;
+        if (!sc_controller_push_msg(&session->controller, &msg)) {
+            LOGW("Device %s: could not request reset video", session->serial);
+        }
+    }
+}
+
+static void
+sc_multi_wall_on_focus_changed(struct sc_wall *wall, struct sc_wall_tile *tile,
+                               void *userdata) {
+    (void) wall;
+    struct scrcpy_multi *m = userdata;
+
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_multi_session *session = &m->sessions[i];
+        if (session->tile) {
+            sc_multi_session_set_focused(m, session, session->tile == tile);
+        }
+    }
+}
+
+static enum scrcpy_exit_code
+sc_multi_event_loop(struct scrcpy_multi *m) {
+    SDL_Event event;
+    while (!sc_multi_all_ended(m) && sc_multi_wait_event(m, &event)) {
+        switch (event.type) {
+            case SC_EVENT_DEVICE_DISCONNECTED: {
+                struct sc_multi_session *session = event.user.data1;
+                if (!session->ended) {
+                    LOGW("Device %s: disconnected", session->serial);
+                    sc_multi_session_end(session, SCRCPY_EXIT_DISCONNECTED);
+                }
+                break;
+            }
+            case SC_EVENT_DEMUXER_ERROR: {
+                struct sc_multi_session *session = event.user.data1;
+                if (!session->ended) {
+                    LOGE("Device %s: demuxer error", session->serial);
+                    sc_multi_session_end(session, SCRCPY_EXIT_FAILURE);
+                }
+                break;
+            }
+            case SC_EVENT_CONTROLLER_ERROR: {
+                struct sc_multi_session *session = event.user.data1;
+                if (!session->ended) {
+                    LOGE("Device %s: controller error", session->serial);
+                    sc_multi_session_end(session, SCRCPY_EXIT_FAILURE);
+                }
+                break;
+            }
+            case SDL_QUIT:
+                LOGD("User requested to quit");
+                return SCRCPY_EXIT_SUCCESS;
+            case SC_EVENT_RUN_ON_MAIN_THREAD: {
+                sc_runnable_fn run = event.user.data1;
+                void *userdata = event.user.data2;
+                run(userdata);
+                break;
+            }
+            default: {
+                if (m->wall_initialized) {
+                    sc_multi_handle_wall_event(m, &event);
+                    break;
+                }
+
+                if (event.type == SDL_RENDER_TARGETS_RESET
+                        || event.type == SDL_RENDER_DEVICE_RESET) {
+                    // Not related to a window: each screen has its own
+                    // renderer, which may have lost its textures
+                    for (unsigned i = 0; i < m->count; ++i) {
+                        struct sc_multi_session *session = &m->sessions[i];
+                        if (session->screen_initialized && !session->ended) {
+                            sc_screen_handle_event(&session->screen, &event);
+                        }
+                    }
+                    break;
+                }
+
+                struct sc_multi_session *session =
+                    sc_multi_route_event(m, &event);
+                if (!session || session->ended) {
+                    break;
+                }
+
+                if (event.type == SDL_WINDOWEVENT
+                        && event.window.event == SDL_WINDOWEVENT_CLOSE) {
+                    // Several windows: closing one does not send SDL_QUIT
+                    LOGI("Device %s: window closed", session->serial);
+                    sc_multi_session_end(session, SCRCPY_EXIT_SUCCESS);
+                    break;
+                }
+
+                if (!sc_screen_handle_event(&session->screen, &event)) {
+                    sc_multi_session_end(session, SCRCPY_EXIT_FAILURE);
+                }
+                break;
+            }
+        }
+    }
+
+    return sc_multi_exit_code(m);
+}
+
+static void
+sc_multi_terminate_event_loop(void) {
+    sc_reject_new_runnables();
+
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SC_EVENT_RUN_ON_MAIN_THREAD) {
+            // Make sure all posted runnables are run, to avoid memory leaks
+            sc_runnable_fn run = event.user.data1;
+            void *userdata = event.user.data2;
+            run(userdata);
+        }
+    }
+}
+
+enum scrcpy_exit_code
+scrcpy_multi(struct scrcpy_options *options) {
+    static struct scrcpy_multi scrcpy_multi;
+    struct scrcpy_multi *m = &scrcpy_multi;
+
+    assert(options->serials);
+
+    m->video_decode_mode = options->video_decode_mode;
+    m->video_decode_lowres_level = options->video_decode_lowres_level;
+
+    if (options->render_driver
+            && !SDL_SetHint(SDL_HINT_RENDER_DRIVER, options->render_driver)) {
+        LOGW("Could not set render driver");
+    }
+
+    // Linear filtering
+    if (!SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1")) {
+        LOGW("Could not enable linear filtering");
+    }
+
+    // Handle a click to gain focus as any other click
+    if (!SDL_SetHint(SDL_HINT_MOUSE_FOCUS_CLICKTHROUGH, "1")) {
+        LOGW("Could not enable mouse focus clickthrough");
+    }
+
+    // Do not minimize on focus loss
+    if (!SDL_SetHint(SDL_HINT_VIDEO_MINIMIZE_ON_FOCUS_LOSS, "0")) {
+        LOGW("Could not disable minimize on focus loss");
+    }
+
+    // Minimal SDL initialization
+    if (SDL_Init(SDL_INIT_EVENTS)) {
+        LOGE("Could not initialize SDL: %s", SDL_GetError());
+        return SCRCPY_EXIT_FAILURE;
+    }
+
+    atexit(SDL_Quit);
+
+    enum scrcpy_exit_code ret = SCRCPY_EXIT_FAILURE;
+
+    bool adb_initialized = false;
+    bool demuxer_pool_started = false;
+
+    struct sc_intr intr;
+    if (!sc_intr_init(&intr)) {
+        return SCRCPY_EXIT_FAILURE;
+    }
+
+    if (!sc_multi_parse_serials(m, options->serials)) {
+        goto end;
+    }
+
+    if (!sc_adb_init()) {
+        goto end;
+    }
+    adb_initialized = true;
+
+    // Start the adb daemon once for all the devices
+    if (!sc_adb_start_server(&intr, 0)) {
+        LOGE("Could not start adb server");
+        goto end;
+    }
+
+    static const struct sc_server_callbacks server_cbs = {
+        .on_connection_failed = sc_multi_server_on_connection_failed,
+        .on_connected = sc_multi_server_on_connected,
+        .on_disconnected = sc_multi_server_on_disconnected,
+    };
+
+    // Start all the servers at once
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_multi_session *session = &m->sessions[i];
+
+        // Each session has its own startup timeline (the servers are started
+        // concurrently)
+        sc_startup_timing_init(&session->startup_timing, session->serial);
+
+        struct sc_server_params params;
+        scrcpy_init_server_params(&params, options, &session->startup_timing);
+        params.req_serial = session->serial;
+        params.adb_server_started = true;
+        // The adb daemon is shared, it is killed once at the end
+        params.kill_adb_on_close = false;
+
+        if (!sc_server_init(&session->server, &params, &server_cbs,
+                            session)) {
+            goto end;
+        }
+        session->server_initialized = true;
+
+        if (!sc_server_start(&session->server)) {
+            goto end;
+        }
+        session->server_started = true;
+    }
+
+    // Initialize the video subsystem while the servers are starting
+    if (SDL_Init(SDL_INIT_VIDEO)) {
+        LOGE("Could not initialize SDL video: %s", SDL_GetError());
+        goto end;
+    }
+
+    if (options->disable_screensaver) {
+        SDL_DisableScreenSaver();
+    } else {
+        SDL_EnableScreenSaver();
+    }
+
+    if (!sc_multi_await_servers(m)) {
+        LOGD("User requested to quit");
+        ret = SCRCPY_EXIT_SUCCESS;
+        goto end;
+    }
+
+    unsigned connected = 0;
+    for (unsigned i = 0; i < m->count; ++i) {
+        if (m->sessions[i].connected) {
+            ++connected;
+        }
+    }
+
+    if (!connected) {
+        LOGE("No device connected");
+        goto end;
+    }
+
+    // At most one demuxer thread per CPU (the decoders run on these threads)
+    int cpus = SDL_GetCPUCount();
+    unsigned workers = MIN(connected, (unsigned) MAX(cpus, 1));
+    sc_demuxer_pool_init(&m->demuxer_pool, workers);
+
+    if (options->wall) {
+        static const struct sc_wall_callbacks wall_cbs = {
+            .on_focus_changed = sc_multi_wall_on_focus_changed,
+        };
+
+        struct sc_wall_params wall_params = {
+            .tile_count = connected,
+            .window_title = options->window_title ? options->window_title
+                                                  : "scrcpy",
+            .always_on_top = options->always_on_top,
+            .window_x = options->window_x,
+            .window_y = options->window_y,
+            .window_width = options->window_width,
+            .window_height = options->window_height,
+            .window_borderless = options->window_borderless,
+            .mipmaps = options->mipmaps,
+            .fullscreen = options->fullscreen,
+            .shortcut_mods = options->shortcut_mods,
+            .cbs = &wall_cbs,
+            .cbs_userdata = m,
+        };
+
+        if (!sc_wall_init(&m->wall, &wall_params)) {
+            goto end;
+        }
+        m->wall_initialized = true;
+    }
+
+    unsigned tile_index = 0;
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_multi_session *session = &m->sessions[i];
+        if (session->connected) {
+            if (!sc_multi_session_init(m, session, tile_index++, options)) {
+                goto end;
+            }
+        }
+    }
+
+    LOGI("Mirroring %u device(s) on %u demuxer thread(s)", connected,
+         workers);
+
+    // Now that the header values have been consumed, the sockets will receive
+    // the streams
+    if (!sc_demuxer_pool_start(&m->demuxer_pool)) {
+        goto end;
+    }
+    demuxer_pool_started = true;
+
+    ret = sc_multi_event_loop(m);
+    sc_multi_terminate_event_loop();
+    LOGD("quit...");
+
+end:
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_multi_session *session = &m->sessions[i];
+        if (session->controller_started) {
+            sc_controller_stop(&session->controller);
+        }
+        if (session->screen_initialized) {
+            sc_screen_interrupt(&session->screen);
+        }
+        if (session->server_started) {
+            // shutdown the sockets and kill the server
+            sc_server_stop(&session->server);
+        }
+    }
+
+    // now that the sockets are shutdown, the demuxers are interrupted
+    if (demuxer_pool_started) {
+        sc_demuxer_pool_join(&m->demuxer_pool);
+    }
+
+    for (unsigned i = 0; i < m->count; ++i) {
+        struct sc_multi_session *session = &m->sessions[i];
+
+        // The demuxers are joined, the screens do not receive new frames
+        if (session->screen_initialized) {
+            sc_screen_join(&session->screen);
+            sc_screen_destroy(&session->screen);
+        }
+
+        if (session->controller_started) {
+            sc_controller_join(&session->controller);
+        }
+        if (session->controller_initialized) {
+            sc_controller_destroy(&session->controller);
+        }
+
+        if (session->server_started) {
+            sc_server_join(&session->server);
+        }
+        if (session->server_initialized) {
+            sc_server_destroy(&session->server);
+        }
+
+        free(session->serial);
+    }
+
+    // The demuxers are joined, the tiles do not receive new frames
+    if (m->wall_initialized) {
+        sc_wall_destroy(&m->wall);
+    }
+
+    if (adb_initialized) {
+        if (options->kill_adb_on_close) {
+            LOGI("Killing adb server...");
+            unsigned flags = SC_ADB_NO_STDOUT | SC_ADB_NO_STDERR
+                           | SC_ADB_NO_LOGERR;
+            sc_adb_kill_server(&intr, flags);
+        }
+        sc_adb_destroy();
+    }
+
+    sc_intr_destroy(&intr);
+
+    return ret;
+}
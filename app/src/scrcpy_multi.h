@@ -0,0 +1,13 @@
+#ifndef SCRCPY_MULTI_H
+#define SCRCPY_MULTI_H
+
+#include "common.h"
+
+#include "options.h"
+#include "scrcpy.h"
+
+// Mirror the devices listed in options->serials from a single process
+enum scrcpy_exit_code
+scrcpy_multi(struct scrcpy_options *options);
+
+#endif
@@ -12,6 +12,9 @@
 
 #define DISPLAY_MARGINS 96
 
+// Redraw the statistics overlay periodically, even without new frames
+#define SC_SCREEN_HUD_REFRESH_MS 250
+
 #define DOWNCAST(SINK) container_of(SINK, struct sc_screen, frame_sink)
 static bool ctrl_held = false; // متغیر برای ردیابی نگه داشتن Ctrl
 static inline struct sc_size
@@ -266,7 +269,7 @@ sc_screen_frame_sink_open(struct sc_frame_sink *sink,
     screen->frame_size.height = ctx->height;
 
     // Post the event on the UI thread (the texture must be created from there)
-    bool ok = sc_push_event(SC_EVENT_SCREEN_INIT_SIZE);
+    bool ok = sc_push_event_with_data(SC_EVENT_SCREEN_INIT_SIZE, screen);
     if (!ok) {
         return false;
     }
@@ -307,7 +310,7 @@ sc_screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
         // this new frame instead
     } else {
         // Post the event on the UI thread
-        bool ok = sc_push_event(SC_EVENT_NEW_FRAME);
+        bool ok = sc_push_event_with_data(SC_EVENT_NEW_FRAME, screen);
         if (!ok) {
             return false;
         }
@@ -339,6 +342,8 @@ sc_screen_init(struct sc_screen *screen,
     screen->selection_rect.h = 0;
 
     screen->video = params->video;
+    screen->av_sync = params->av_sync;
+    screen->startup_timing = params->startup_timing;
 
     screen->req.x = params->window_x;
     screen->req.y = params->window_y;
@@ -404,7 +409,12 @@ sc_screen_init(struct sc_screen *screen,
         goto error_destroy_fps_counter;
     }
 
-    SDL_Surface *icon = scrcpy_icon_load();
+    SDL_Surface *icon = params->icon;
+    bool icon_owned = false;
+    if (!icon) {
+        icon = scrcpy_icon_load();
+        icon_owned = true;
+    }
     if (icon) {
         SDL_SetWindowIcon(screen->window, icon);
     } else if (params->video) {
@@ -420,13 +430,18 @@ sc_screen_init(struct sc_screen *screen,
     bool mipmaps = params->video && params->mipmaps;
     ok = sc_display_init(&screen->display, screen->window, icon_novideo,
                          mipmaps);
-    if (icon) {
+    if (icon && icon_owned) {
         scrcpy_icon_destroy(icon);
     }
     if (!ok) {
         goto error_destroy_window;
     }
 
+    // The sources are set once the other components are initialized
+    sc_hud_init(&screen->hud);
+    screen->display.hud = &screen->hud;
+    screen->hud_timer = 0;
+
     screen->frame = av_frame_alloc();
     if (!screen->frame) {
         LOG_OOM();
@@ -444,6 +459,7 @@ sc_screen_init(struct sc_screen *screen,
         .legacy_paste = params->legacy_paste,
         .clipboard_autosync = params->clipboard_autosync,
         .shortcut_mods = params->shortcut_mods,
+        .mouse_motion_coalescing = params->mouse_motion_coalescing,
     };
 
     sc_input_manager_init(&screen->im, &im_params);
@@ -534,6 +550,10 @@ sc_screen_destroy(struct sc_screen *screen) {
 #ifndef NDEBUG
     assert(!screen->open);
 #endif
+    if (screen->hud_timer) {
+        SDL_RemoveTimer(screen->hud_timer);
+    }
+    sc_hud_destroy(&screen->hud);
     sc_display_destroy(&screen->display);
     av_frame_free(&screen->frame);
     SDL_DestroyWindow(screen->window);
@@ -675,6 +695,9 @@ sc_screen_apply_frame(struct sc_screen *screen) {
         screen->has_frame = true;
         // this is the very first frame, show the window
         sc_screen_show_initial_window(screen);
+        if (screen->startup_timing) {
+            sc_startup_timing_report_first_frame(screen->startup_timing);
+        }
 
         if (sc_screen_is_relative_mode(screen)) {
             // Capture mouse on start
@@ -683,6 +706,14 @@ sc_screen_apply_frame(struct sc_screen *screen) {
     }
 
     sc_screen_render(screen, false);
+    sc_hud_push_presented_frame(&screen->hud, frame->pts);
+
+    if (screen->av_sync && frame->pts != AV_NOPTS_VALUE) {
+        // PTS (written by the server) are expressed in microseconds
+        sc_av_sync_push_video(screen->av_sync, SC_TICK_FROM_US(frame->pts),
+                              sc_tick_now());
+    }
+
     return true;
 }
 
@@ -757,6 +788,43 @@ sc_screen_toggle_fullscreen(struct sc_screen *screen) {
     sc_screen_render(screen, true);
 }
 
+static uint32_t
+sc_screen_on_hud_timer(uint32_t interval, void *userdata) {
+    struct sc_screen *screen = userdata;
+
+    // Called from the SDL timer thread, render from the main thread
+    sc_push_event_with_data(SC_EVENT_SCREEN_HUD_REFRESH, screen);
+    return interval;
+}
+
+void
+sc_screen_toggle_hud(struct sc_screen *screen) {
+    assert(screen->video);
+
+    bool enabled = !sc_hud_is_enabled(&screen->hud);
+    sc_hud_set_enabled(&screen->hud, enabled);
+    LOGI("Statistics overlay %s", enabled ? "enabled" : "disabled");
+
+    // The statistics must be refreshed even if no frame is received (e.g. the
+    // device screen is static)
+    if (enabled) {
+        assert(!screen->hud_timer);
+        screen->hud_timer = SDL_AddTimer(SC_SCREEN_HUD_REFRESH_MS,
+                                         sc_screen_on_hud_timer, screen);
+        if (!screen->hud_timer) {
+            LOGW("Could not start the statistics refresh timer: %s",
+                 SDL_GetError());
+        }
+    } else if (screen->hud_timer) {
+        SDL_RemoveTimer(screen->hud_timer);
+        screen->hud_timer = 0;
+    }
+
+    if (screen->has_frame) {
+        sc_screen_render(screen, false);
+    }
+}
+
 void
 sc_screen_resize_to_fit(struct sc_screen *screen) {
     assert(screen->video);
@@ -888,6 +956,20 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
             }
             return true;
         }
+        case SC_EVENT_SCREEN_HUD_REFRESH:
+            // The timer may have been removed after the event was pushed
+            if (screen->has_frame && sc_hud_is_enabled(&screen->hud)) {
+                sc_screen_render(screen, false);
+            }
+            return true;
+        case SDL_RENDER_TARGETS_RESET:
+        case SDL_RENDER_DEVICE_RESET:
+            // The textures may have been lost
+            sc_hud_reset(&screen->hud);
+            if (screen->has_frame) {
+                sc_screen_render(screen, false);
+            }
+            return true;
         case SC_EVENT_NEW_FRAME: {
             bool ok = sc_screen_update_frame(screen);
             if (!ok) {
@@ -895,6 +977,7 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
                 return false;
             }
             sc_screen_render(screen, true);
+            sc_input_manager_handle_frame(&screen->im);
             return true;
         }
         case SDL_WINDOWEVENT:
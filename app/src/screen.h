@@ -10,14 +10,17 @@
 #include <libavutil/frame.h>
 #include <libavutil/pixfmt.h>
 
+#include "av_sync.h"
 #include "controller.h"
 #include "coords.h"
 #include "display.h"
 #include "fps_counter.h"
 #include "frame_buffer.h"
+#include "hud.h"
 #include "input_manager.h"
 #include "mouse_capture.h"
 #include "options.h"
+#include "startup_timing.h"
 #include "trait/key_processor.h"
 #include "trait/frame_sink.h"
 #include "trait/mouse_processor.h"
@@ -36,6 +39,10 @@ struct sc_screen {
     struct sc_mouse_capture mc; // only used in mouse relative mode
     struct sc_frame_buffer fb;
     struct sc_fps_counter fps_counter;
+    struct sc_hud hud;
+    SDL_TimerID hud_timer; // 0 if the HUD is disabled
+    struct sc_av_sync *av_sync; // may be NULL
+    struct sc_startup_timing *startup_timing; // may be NULL
 
     // The initial requested window properties
     struct {
@@ -84,12 +91,18 @@ struct sc_screen_params {
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
     struct sc_gamepad_processor *gp;
+    struct sc_av_sync *av_sync; // may be NULL
+    // reported on the first frame, may be NULL
+    struct sc_startup_timing *startup_timing;
 
     struct sc_mouse_bindings mouse_bindings;
     bool legacy_paste;
     bool clipboard_autosync;
     uint8_t shortcut_mods; // OR of enum sc_shortcut_mod values
 
+    // preloaded window icon, may be NULL (the caller keeps ownership)
+    SDL_Surface *icon;
+
     const char *window_title;
     bool always_on_top;
 
@@ -105,6 +118,7 @@ struct sc_screen_params {
 
     bool fullscreen;
     bool start_fps_counter;
+    sc_tick mouse_motion_coalescing;
 };
 
 // initialize screen, create window, renderer and texture (window is hidden)
@@ -135,6 +149,10 @@ sc_screen_hide_window(struct sc_screen *screen);
 void
 sc_screen_toggle_fullscreen(struct sc_screen *screen);
 
+// show or hide the statistics overlay
+void
+sc_screen_toggle_hud(struct sc_screen *screen);
+
 // resize window to optimal size (remove black borders)
 void
 sc_screen_resize_to_fit(struct sc_screen *screen);
@@ -8,6 +8,7 @@
 #include <sys/types.h>
 
 #include "adb/adb.h"
+#include "startup_timing.h"
 #include "util/env.h"
 #include "util/file.h"
 #include "util/log.h"
@@ -20,6 +21,15 @@
 #define SC_SERVER_PATH_DEFAULT PREFIX "/share/scrcpy/" SC_SERVER_FILENAME
 #define SC_DEVICE_SERVER_PATH "/data/local/tmp/scrcpy-server.jar"
 
+// Written by the server to its stdout once it listens (must match the server)
+#define SC_SERVER_READY_SIGNAL "scrcpy:ready"
+
+// Connection attempts (forward tunnel): exponential backoff between the min and
+// max delays, until a global timeout
+#define SC_SERVER_CONNECT_MIN_DELAY SC_TICK_FROM_MS(2)
+#define SC_SERVER_CONNECT_MAX_DELAY SC_TICK_FROM_MS(100)
+#define SC_SERVER_CONNECT_TIMEOUT SC_TICK_FROM_SEC(10)
+
 #define SC_ADB_PORT_DEFAULT 5555
 #define SC_SOCKET_NAME_PREFIX "scrcpy_"
 
@@ -69,6 +79,25 @@ push_server(struct sc_intr *intr, const char *serial) {
     return ok;
 }
 
+struct sc_server_push {
+    struct sc_intr *intr;
+    struct sc_startup_timing *startup_timing;
+    const char *serial;
+    bool success;
+};
+
+static int
+run_push_server(void *data) {
+    struct sc_server_push *push = data;
+
+    sc_startup_timing_begin(push->startup_timing,
+                            SC_STARTUP_PHASE_SERVER_PUSH);
+    push->success = push_server(push->intr, push->serial);
+    sc_startup_timing_end(push->startup_timing, SC_STARTUP_PHASE_SERVER_PUSH);
+
+    return 0;
+}
+
 static const char *
 log_level_to_server_string(enum sc_log_level level) {
     switch (level) {
@@ -102,6 +131,100 @@ sc_server_sleep(struct sc_server *server, sc_tick deadline) {
     return !stopped;
 }
 
+// Wait until the server is ready (or until the deadline)
+static bool
+sc_server_wait_ready(struct sc_server *server, sc_tick deadline) {
+    sc_mutex_lock(&server->mutex);
+    bool timed_out = false;
+    while (!server->stopped && !server->ready && !timed_out) {
+        timed_out = !sc_cond_timedwait(&server->cond_stopped,
+                                       &server->mutex, deadline);
+    }
+    bool stopped = server->stopped;
+    sc_mutex_unlock(&server->mutex);
+
+    if (timed_out) {
+        LOGW("Server ready signal not received");
+    }
+
+    return !stopped;
+}
+
+static void
+sc_server_set_ready(struct sc_server *server) {
+    sc_mutex_lock(&server->mutex);
+    server->ready = true;
+    sc_cond_signal(&server->cond_stopped);
+    sc_mutex_unlock(&server->mutex);
+}
+
+static void
+sc_server_on_output_line(struct sc_server *server, const char *line,
+                         size_t len) {
+    size_t content_len = len;
+    while (content_len && (line[content_len - 1] == '\n'
+                        || line[content_len - 1] == '\r')) {
+        --content_len;
+    }
+
+    if (content_len == sizeof(SC_SERVER_READY_SIGNAL) - 1
+            && !memcmp(line, SC_SERVER_READY_SIGNAL, content_len)) {
+        LOGD("Server ready");
+        sc_server_set_ready(server);
+        return;
+    }
+
+    // Forward the server logs to the console, as if stdout was inherited
+    fwrite(line, 1, len, stdout);
+    fflush(stdout);
+}
+
+static int
+run_server_output(void *data) {
+    struct sc_server *server = data;
+
+    char buf[4096];
+    size_t len = 0;
+
+    for (;;) {
+        ssize_t r = sc_pipe_read(server->stdout_pipe, buf + len,
+                                 sizeof(buf) - len);
+        if (r <= 0) {
+            break;
+        }
+
+        len += r;
+
+        size_t consumed = 0;
+        char *eol;
+        while ((eol = memchr(buf + consumed, '\n', len - consumed))) {
+            size_t line_len = eol + 1 - (buf + consumed);
+            sc_server_on_output_line(server, buf + consumed, line_len);
+            consumed += line_len;
+        }
+
+        if (consumed) {
+            memmove(buf, buf + consumed, len - consumed);
+            len -= consumed;
+        } else if (len == sizeof(buf)) {
+            // Line too long, forward it as is
+            sc_server_on_output_line(server, buf, len);
+            len = 0;
+        }
+    }
+
+    if (len) {
+        sc_server_on_output_line(server, buf, len);
+    }
+
+    // The server will never signal readiness if it was not already done, do
+    // not wait for it anymore (the connection will fail)
+    sc_server_set_ready(server);
+
+    LOGD("Server output closed");
+    return 0;
+}
+
 static const char *
 sc_server_get_codec_name(enum sc_codec codec) {
     switch (codec) {
@@ -203,7 +326,7 @@ validate_string(const char *s) {
 
 static sc_pid
 execute_server(struct sc_server *server,
-               const struct sc_server_params *params) {
+               const struct sc_server_params *params, sc_pipe *pout) {
     sc_pid pid = SC_PROCESS_NONE;
 
     const char *serial = server->serial;
@@ -324,6 +447,9 @@ execute_server(struct sc_server *server,
     if (server->tunnel.forward) {
         ADD_PARAM("tunnel_forward=true");
     }
+    if (pout) {
+        ADD_PARAM("ready_signal=true");
+    }
     if (params->crop) {
         VALIDATE_STRING(params->crop);
         ADD_PARAM("crop=%s", params->crop);
@@ -452,8 +578,9 @@ execute_server(struct sc_server *server,
     //     Port: 5005
     // Then click on "Debug"
 #endif
-    // Inherit both stdout and stderr (all server logs are printed to stdout)
-    pid = sc_adb_execute(cmd, 0);
+    // Inherit stderr, and stdout unless it is watched (all server logs are
+    // printed to stdout, they are then forwarded by the watcher)
+    pid = sc_adb_execute_p(cmd, 0, pout);
 
 end:
     for (unsigned i = dyn_idx; i < count; ++i) {
@@ -483,10 +610,21 @@ connect_and_read_byte(struct sc_intr *intr, sc_socket socket,
 }
 
 static sc_socket
-connect_to_server(struct sc_server *server, unsigned attempts, sc_tick delay,
-                  uint32_t host, uint16_t port) {
-    do {
-        LOGD("Remaining connection attempts: %u", attempts);
+connect_to_server(struct sc_server *server, sc_tick deadline, uint32_t host,
+                  uint16_t port) {
+    // Do not connect before the server listens: through an "adb forward"
+    // tunnel, the connection would fail only after a round-trip
+    if (!sc_server_wait_ready(server, deadline)) {
+        LOGI("Connection attempt stopped");
+        return SC_SOCKET_NONE;
+    }
+
+    // The server is normally listening already, retry with an exponential
+    // backoff just in case
+    sc_tick delay = SC_SERVER_CONNECT_MIN_DELAY;
+    unsigned attempt = 0;
+    for (;;) {
+        LOGD("Connection attempt #%u", ++attempt);
         sc_socket socket = net_socket();
         if (socket != SC_SOCKET_NONE) {
             bool ok = connect_and_read_byte(&server->intr, socket, host, port);
@@ -503,15 +641,19 @@ connect_to_server(struct sc_server *server, unsigned attempts, sc_tick delay,
             break;
         }
 
-        if (attempts) {
-            sc_tick deadline = sc_tick_now() + delay;
-            bool ok = sc_server_sleep(server, deadline);
-            if (!ok) {
-                LOGI("Connection attempt stopped");
-                break;
-            }
+        sc_tick now = sc_tick_now();
+        if (now >= deadline) {
+            break;
         }
-    } while (--attempts);
+
+        bool ok = sc_server_sleep(server, MIN(now + delay, deadline));
+        if (!ok) {
+            LOGI("Connection attempt stopped");
+            break;
+        }
+
+        delay = MIN(delay * 2, SC_SERVER_CONNECT_MAX_DELAY);
+    }
     return SC_SOCKET_NONE;
 }
 
@@ -548,9 +690,19 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
         return false;
     }
 
+    ok = sc_intr_init(&server->push_intr);
+    if (!ok) {
+        sc_intr_destroy(&server->intr);
+        sc_cond_destroy(&server->cond_stopped);
+        sc_mutex_destroy(&server->mutex);
+        sc_adb_destroy();
+        return false;
+    }
+
     server->serial = NULL;
     server->device_socket_name = NULL;
     server->stopped = false;
+    server->ready = false;
 
     server->video_socket = SC_SOCKET_NONE;
     server->audio_socket = SC_SOCKET_NONE;
@@ -636,9 +788,8 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
             tunnel_port = tunnel->local_port;
         }
 
-        unsigned attempts = 100;
-        sc_tick delay = SC_TICK_FROM_MS(100);
-        sc_socket first_socket = connect_to_server(server, attempts, delay,
+        sc_tick deadline = sc_tick_now() + SC_SERVER_CONNECT_TIMEOUT;
+        sc_socket first_socket = connect_to_server(server, deadline,
                                                    tunnel_host, tunnel_port);
         if (first_socket == SC_SOCKET_NONE) {
             goto fail;
@@ -937,6 +1088,15 @@ sc_server_kill_adb_if_requested(struct sc_server *server) {
     }
 }
 
+static void
+sc_server_join_output(struct sc_server *server, bool watched) {
+    if (watched) {
+        // The output is closed once the server process is terminated
+        sc_thread_join(&server->stdout_thread, NULL);
+        sc_pipe_close(server->stdout_pipe);
+    }
+}
+
 static int
 run_server(void *data) {
     struct sc_server *server = data;
@@ -946,10 +1106,17 @@ run_server(void *data) {
     // Execute "adb start-server" before "adb devices" so that daemon starting
     // output/errors is correctly printed in the console ("adb devices" output
     // is parsed, so it is not output)
-    bool ok = sc_adb_start_server(&server->intr, 0);
-    if (!ok) {
-        LOGE("Could not start adb server");
-        goto error_connection_failed;
+    bool ok;
+    if (!params->adb_server_started) {
+        sc_startup_timing_begin(params->startup_timing,
+                                SC_STARTUP_PHASE_ADB_START);
+        ok = sc_adb_start_server(&server->intr, 0);
+        if (!ok) {
+            LOGE("Could not start adb server");
+            goto error_connection_failed;
+        }
+        sc_startup_timing_end(params->startup_timing,
+                              SC_STARTUP_PHASE_ADB_START);
     }
 
     // params->tcpip_dst implies params->tcpip
@@ -964,6 +1131,9 @@ run_server(void *data) {
     // exist, and scrcpy will execute "adb connect").
     bool need_initial_serial = !params->tcpip_dst;
 
+    sc_startup_timing_begin(params->startup_timing,
+                            SC_STARTUP_PHASE_DEVICE_SELECTION);
+
     if (need_initial_serial) {
         // At most one of the 3 following parameters may be set
         assert(!!params->req_serial
@@ -1024,19 +1194,22 @@ run_server(void *data) {
         }
     }
 
+    sc_startup_timing_end(params->startup_timing,
+                          SC_STARTUP_PHASE_DEVICE_SELECTION);
+
     const char *serial = server->serial;
     assert(serial);
     LOGD("Device serial: %s", serial);
 
-    ok = push_server(&server->intr, serial);
-    if (!ok) {
-        goto error_connection_failed;
-    }
-
     // If --list-* is passed, then the server just prints the requested data
     // then exits.
     if (params->list) {
-        sc_pid pid = execute_server(server, params);
+        ok = push_server(&server->intr, serial);
+        if (!ok) {
+            goto error_connection_failed;
+        }
+
+        sc_pid pid = execute_server(server, params, NULL);
         if (pid == SC_PROCESS_NONE) {
             goto error_connection_failed;
         }
@@ -1047,30 +1220,81 @@ run_server(void *data) {
         return 0;
     }
 
+    // The server push and the tunnel setup are independent: run them
+    // concurrently (the push is the slowest, especially over TCP/IP)
+    struct sc_server_push push = {
+        .intr = &server->push_intr,
+        .startup_timing = params->startup_timing,
+        .serial = serial,
+        .success = false,
+    };
+    sc_thread push_thread;
+    ok = sc_thread_create(&push_thread, run_push_server, "scrcpy-push", &push);
+    if (!ok) {
+        LOGE("Could not create push thread");
+        goto error_connection_failed;
+    }
+
     int r = asprintf(&server->device_socket_name, SC_SOCKET_NAME_PREFIX "%08x",
                      params->scid);
     if (r == -1) {
         LOG_OOM();
+        sc_intr_interrupt(&server->push_intr);
+        sc_thread_join(&push_thread, NULL);
         goto error_connection_failed;
     }
     assert(r == sizeof(SC_SOCKET_NAME_PREFIX) - 1 + 8);
     assert(server->device_socket_name);
 
+    sc_startup_timing_begin(params->startup_timing,
+                            SC_STARTUP_PHASE_TUNNEL_OPEN);
     ok = sc_adb_tunnel_open(&server->tunnel, &server->intr, serial,
                             server->device_socket_name, params->port_range,
                             params->force_adb_forward);
     if (!ok) {
+        sc_intr_interrupt(&server->push_intr);
+        sc_thread_join(&push_thread, NULL);
         goto error_connection_failed;
     }
+    sc_startup_timing_end(params->startup_timing,
+                          SC_STARTUP_PHASE_TUNNEL_OPEN);
+
+    sc_thread_join(&push_thread, NULL);
+    if (!push.success) {
+        sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
+                            server->device_socket_name);
+        goto error_connection_failed;
+    }
+
+    sc_startup_timing_begin(params->startup_timing,
+                            SC_STARTUP_PHASE_SERVER_CONNECTION);
+
+    // In forward mode, the server output is watched to detect readiness
+    bool watch_output = server->tunnel.forward;
 
     // server will connect to our server socket
-    sc_pid pid = execute_server(server, params);
+    sc_pid pid = execute_server(server, params,
+                                watch_output ? &server->stdout_pipe : NULL);
     if (pid == SC_PROCESS_NONE) {
         sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
                             server->device_socket_name);
         goto error_connection_failed;
     }
 
+    if (watch_output) {
+        ok = sc_thread_create(&server->stdout_thread, run_server_output,
+                              "scrcpy-srv-out", server);
+        if (!ok) {
+            LOGE("Could not create server output thread");
+            sc_process_terminate(pid);
+            sc_process_wait(pid, true); // ignore exit code
+            sc_pipe_close(server->stdout_pipe);
+            sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
+                                server->device_socket_name);
+            goto error_connection_failed;
+        }
+    }
+
     static const struct sc_process_listener listener = {
         .on_terminated = sc_server_on_terminated,
     };
@@ -1079,6 +1303,7 @@ run_server(void *data) {
     if (!ok) {
         sc_process_terminate(pid);
         sc_process_wait(pid, true); // ignore exit code
+        sc_server_join_output(server, watch_output);
         sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
                             server->device_socket_name);
         goto error_connection_failed;
@@ -1091,9 +1316,13 @@ run_server(void *data) {
         sc_process_wait(pid, true); // ignore exit code
         sc_process_observer_join(&observer);
         sc_process_observer_destroy(&observer);
+        sc_server_join_output(server, watch_output);
         goto error_connection_failed;
     }
 
+    sc_startup_timing_end(params->startup_timing,
+                          SC_STARTUP_PHASE_SERVER_CONNECTION);
+
     // Now connected
     server->cbs->on_connected(server, server->cbs_userdata);
 
@@ -1142,6 +1371,8 @@ run_server(void *data) {
 
     sc_process_close(pid);
 
+    sc_server_join_output(server, watch_output);
+
     sc_server_kill_adb_if_requested(server);
 
     return 0;
@@ -1170,6 +1401,7 @@ sc_server_stop(struct sc_server *server) {
     server->stopped = true;
     sc_cond_signal(&server->cond_stopped);
     sc_intr_interrupt(&server->intr);
+    sc_intr_interrupt(&server->push_intr);
     sc_mutex_unlock(&server->mutex);
 }
 
@@ -1192,6 +1424,7 @@ sc_server_destroy(struct sc_server *server) {
 
     free(server->serial);
     free(server->device_socket_name);
+    sc_intr_destroy(&server->push_intr);
     sc_intr_destroy(&server->intr);
     sc_cond_destroy(&server->cond_stopped);
     sc_mutex_destroy(&server->mutex);
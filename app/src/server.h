@@ -8,6 +8,7 @@
 
 #include "adb/adb_tunnel.h"
 #include "options.h"
+#include "startup_timing.h"
 #include "util/intr.h"
 #include "util/net.h"
 #include "util/thread.h"
@@ -20,6 +21,7 @@ struct sc_server_info {
 
 struct sc_server_params {
     uint32_t scid;
+    struct sc_startup_timing *startup_timing;
     const char *req_serial;
     enum sc_log_level log_level;
     enum sc_codec video_codec;
@@ -67,6 +69,8 @@ struct sc_server_params {
     bool cleanup;
     bool power_on;
     bool kill_adb_on_close;
+    // "adb start-server" has already been executed (by the caller)
+    bool adb_server_started;
     bool camera_high_speed;
     bool vd_destroy_content;
     bool vd_system_decorations;
@@ -83,10 +87,19 @@ struct sc_server {
     struct sc_server_info info; // initialized once connected
 
     sc_mutex mutex;
+    // also signaled when the server is ready
     sc_cond cond_stopped;
     bool stopped;
 
+    // In forward tunnel mode, the server writes a signal to its stdout once it
+    // is listening: its output is watched to connect as soon as possible
+    sc_pipe stdout_pipe;
+    sc_thread stdout_thread;
+    bool ready; // protected by mutex
+
     struct sc_intr intr;
+    // the server is pushed concurrently with the tunnel setup
+    struct sc_intr push_intr;
     struct sc_adb_tunnel tunnel;
 
     sc_socket video_socket;
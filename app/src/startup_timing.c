@@ -0,0 +1,95 @@
+#include "startup_timing.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "util/log.h"
+
+static const char *
+sc_startup_phase_name(enum sc_startup_phase phase) {
+    switch (phase) {
+        case SC_STARTUP_PHASE_ADB_START:
+            return "adb start";
+        case SC_STARTUP_PHASE_DEVICE_SELECTION:
+            return "device selection";
+        case SC_STARTUP_PHASE_SERVER_PUSH:
+            return "server push";
+        case SC_STARTUP_PHASE_TUNNEL_OPEN:
+            return "tunnel open";
+        case SC_STARTUP_PHASE_SERVER_CONNECTION:
+            return "server connection";
+        case SC_STARTUP_PHASE_SDL_INIT:
+            return "SDL init";
+        case SC_STARTUP_PHASE_ICON_LOAD:
+            return "icon load";
+        case SC_STARTUP_PHASE_SCREEN_INIT:
+            return "screen init";
+        case SC_STARTUP_PHASE_VIDEO_DECODER_OPEN:
+            return "video decoder open";
+        case SC_STARTUP_PHASE_AUDIO_DECODER_OPEN:
+            return "audio decoder open";
+        default:
+            assert(!"unexpected startup phase");
+            return "?";
+    }
+}
+
+void
+sc_startup_timing_init(struct sc_startup_timing *timing, const char *name) {
+    timing->name = name;
+    timing->origin = sc_tick_now();
+    for (int i = 0; i < SC_STARTUP_PHASE_COUNT; ++i) {
+        atomic_init(&timing->begin[i], 0);
+        atomic_init(&timing->end[i], 0);
+    }
+    atomic_init(&timing->reported, false);
+}
+
+void
+sc_startup_timing_begin(struct sc_startup_timing *timing,
+                        enum sc_startup_phase phase) {
+    assert(phase < SC_STARTUP_PHASE_COUNT);
+    atomic_store_explicit(&timing->begin[phase], sc_tick_now(),
+                          memory_order_relaxed);
+}
+
+void
+sc_startup_timing_end(struct sc_startup_timing *timing,
+                      enum sc_startup_phase phase) {
+    assert(phase < SC_STARTUP_PHASE_COUNT);
+    atomic_store_explicit(&timing->end[phase], sc_tick_now(),
+                          memory_order_relaxed);
+}
+
+void
+sc_startup_timing_report_first_frame(struct sc_startup_timing *timing) {
+    if (atomic_exchange_explicit(&timing->reported, true,
+                                 memory_order_relaxed)) {
+        // Already reported
+        return;
+    }
+
+    // Prefix the logs by the session name, if any
+    const char *name = timing->name ? timing->name : "";
+    const char *sep = timing->name ? ": " : "";
+
+    sc_tick now = sc_tick_now();
+    LOGI("%s%sFirst frame after %" PRItick " ms", name, sep,
+         SC_TICK_TO_MS(now - timing->origin));
+
+    for (int i = 0; i < SC_STARTUP_PHASE_COUNT; ++i) {
+        sc_tick begin = atomic_load_explicit(&timing->begin[i],
+                                             memory_order_relaxed);
+        sc_tick end = atomic_load_explicit(&timing->end[i],
+                                           memory_order_relaxed);
+        if (!begin || end < begin) {
+            // Not executed (or not terminated)
+            continue;
+        }
+
+        LOGD("%s%sStartup: %-18s at %5" PRItick " ms, took %5" PRItick " ms",
+             name, sep, sc_startup_phase_name(i),
+             SC_TICK_TO_MS(begin - timing->origin),
+             SC_TICK_TO_MS(end - begin));
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SC_STARTUP_TIMING_H
+#define SC_STARTUP_TIMING_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "util/tick.h"
+
+/**
+ * Startup phases, measured to detect startup regressions
+ *
+ * Some of them run concurrently.
+ */
+enum sc_startup_phase {
+    SC_STARTUP_PHASE_ADB_START,
+    SC_STARTUP_PHASE_DEVICE_SELECTION,
+    SC_STARTUP_PHASE_SERVER_PUSH,
+    SC_STARTUP_PHASE_TUNNEL_OPEN,
+    SC_STARTUP_PHASE_SERVER_CONNECTION,
+    SC_STARTUP_PHASE_SDL_INIT,
+    SC_STARTUP_PHASE_ICON_LOAD,
+    SC_STARTUP_PHASE_SCREEN_INIT,
+    SC_STARTUP_PHASE_VIDEO_DECODER_OPEN,
+    SC_STARTUP_PHASE_AUDIO_DECODER_OPEN,
+    SC_STARTUP_PHASE_COUNT,
+};
+
+/**
+ * Startup timeline of a session
+ *
+ * In multi-device mode, each session has its own timeline.
+ */
+struct sc_startup_timing {
+    const char *name; // may be NULL
+    sc_tick origin;
+    // 0 if not reached
+    atomic_int_least64_t begin[SC_STARTUP_PHASE_COUNT];
+    atomic_int_least64_t end[SC_STARTUP_PHASE_COUNT];
+    atomic_bool reported;
+};
+
+/**
+ * Set the origin of the startup timeline (to be called once, on start)
+ *
+ * The name (if not NULL) is included in the report, to distinguish several
+ * sessions. It must outlive the timing.
+ */
+void
+sc_startup_timing_init(struct sc_startup_timing *timing, const char *name);
+
+/**
+ * Mark the beginning of a phase (may be called from any thread)
+ */
+void
+sc_startup_timing_begin(struct sc_startup_timing *timing,
+                        enum sc_startup_phase phase);
+
+/**
+ * Mark the end of a phase (may be called from any thread)
+ */
+void
+sc_startup_timing_end(struct sc_startup_timing *timing,
+                      enum sc_startup_phase phase);
+
+/**
+ * Log the time-to-first-frame and the timing of each phase
+ *
+ * Only the first call has an effect.
+ */
+void
+sc_startup_timing_report_first_frame(struct sc_startup_timing *timing);
+
+#endif
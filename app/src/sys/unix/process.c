@@ -9,6 +9,9 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#ifdef __APPLE__
+# include <mach/mach.h>
+#endif
 
 #include "util/log.h"
 
@@ -234,3 +237,44 @@ sc_pipe_close(int pipe) {
         perror("close pipe");
     }
 }
+
+bool
+sc_process_get_rss(uint64_t *rss) {
+#if defined(__linux__)
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) {
+        return false;
+    }
+
+    // The values are in pages
+    unsigned long size;
+    unsigned long resident;
+    int r = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    if (r != 2) {
+        return false;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) {
+        return false;
+    }
+
+    *rss = (uint64_t) resident * page_size;
+    return true;
+#elif defined(__APPLE__)
+    struct mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    kern_return_t kr = task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                                 (task_info_t) &info, &count);
+    if (kr != KERN_SUCCESS) {
+        return false;
+    }
+
+    *rss = info.resident_size;
+    return true;
+#else
+    (void) rss;
+    return false;
+#endif
+}
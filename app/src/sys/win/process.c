@@ -1,6 +1,7 @@
 #include "util/process.h"
 
 #include <processthreadsapi.h>
+#include <psapi.h>
 
 #include <assert.h>
 
@@ -258,3 +259,14 @@ sc_pipe_close(HANDLE pipe) {
         LOGW("Cannot close pipe");
     }
 }
+
+bool
+sc_process_get_rss(uint64_t *rss) {
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return false;
+    }
+
+    *rss = pmc.WorkingSetSize;
+    return true;
+}
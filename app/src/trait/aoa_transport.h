@@ -0,0 +1,87 @@
+#ifndef SC_AOA_TRANSPORT_H
+#define SC_AOA_TRANSPORT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hid/hid_event.h"
+#include "util/tick.h"
+
+// See <https://source.android.com/devices/accessories/aoa2#hid-support>.
+#define SC_AOA_REQUEST_REGISTER_HID 54
+#define SC_AOA_REQUEST_UNREGISTER_HID 55
+#define SC_AOA_REQUEST_SET_HID_REPORT_DESC 56
+#define SC_AOA_REQUEST_SEND_HID_EVENT 57
+
+struct sc_aoa_transport;
+
+/**
+ * An asynchronous HID event transfer
+ *
+ * The memory is owned by the caller, and must remain valid until the transfer
+ * is completed.
+ */
+struct sc_aoa_transfer {
+    struct sc_hid_input hid;
+    // date when the event was pushed to the AOA queue (for metrics)
+    sc_tick push_date;
+
+    /**
+     * Called exactly once when the transfer is completed (or failed),
+     * possibly from another thread
+     */
+    void (*on_complete)(struct sc_aoa_transfer *transfer, bool ok,
+                        void *userdata);
+    void *userdata;
+};
+
+/**
+ * AOA transport trait.
+ *
+ * Component able to send AOA control requests to a device should implement
+ * this trait.
+ */
+struct sc_aoa_transport {
+    const struct sc_aoa_transport_ops *ops;
+};
+
+struct sc_aoa_transport_ops {
+    /**
+     * Start processing asynchronous transfers
+     *
+     * This function is optional.
+     */
+    bool (*start)(struct sc_aoa_transport *transport);
+
+    /**
+     * Stop processing asynchronous transfers, and wait for termination
+     *
+     * It is called once all the submitted transfers are completed.
+     *
+     * This function is optional.
+     */
+    void (*stop)(struct sc_aoa_transport *transport);
+
+    /**
+     * Send a control request synchronously
+     *
+     * This function is mandatory.
+     */
+    bool (*control)(struct sc_aoa_transport *transport, uint8_t request,
+                    uint16_t value, uint16_t index, const uint8_t *data,
+                    uint16_t length);
+
+    /**
+     * Submit a SEND_HID_EVENT request asynchronously
+     *
+     * If it returns true, transfer->on_complete() will be called exactly once.
+     *
+     * This function is mandatory.
+     */
+    bool (*submit)(struct sc_aoa_transport *transport,
+                   struct sc_aoa_transfer *transfer);
+};
+
+#endif
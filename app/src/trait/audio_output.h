@@ -0,0 +1,62 @@
+#ifndef SC_AUDIO_OUTPUT_H
+#define SC_AUDIO_OUTPUT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+/**
+ * Callback to provide the samples to play
+ *
+ * It is called from a real-time thread owned by the audio output, so it must
+ * not block.
+ */
+typedef void (*sc_audio_output_pull_fn)(uint8_t *out, uint32_t samples,
+                                        void *userdata);
+
+struct sc_audio_output_params {
+    uint32_t sample_rate;
+    uint8_t channels; // samples are interleaved 32-bit floats
+    // Requested size of the output buffer (the actual value may differ)
+    sc_tick buffer_duration;
+
+    sc_audio_output_pull_fn pull;
+    void *userdata;
+};
+
+/**
+ * Audio output trait.
+ *
+ * Component able to play audio samples should implement this trait.
+ */
+struct sc_audio_output {
+    const struct sc_audio_output_ops *ops;
+};
+
+struct sc_audio_output_ops {
+    /**
+     * Open the audio output and start playing
+     *
+     * Once opened, params->pull() is called regularly until the output is
+     * closed.
+     */
+    bool (*open)(struct sc_audio_output *ao,
+                 const struct sc_audio_output_params *params);
+
+    void (*close)(struct sc_audio_output *ao);
+
+    /**
+     * Return the current output latency, i.e. the delay before the last pulled
+     * sample is actually played, or -1 if unknown
+     *
+     * It may be called from any thread while the output is open.
+     *
+     * This function is optional.
+     */
+    sc_tick (*get_latency)(struct sc_audio_output *ao);
+};
+
+#endif
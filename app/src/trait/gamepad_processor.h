@@ -4,6 +4,7 @@
 #include "common.h"
 
 #include "input_events.h"
+#include "util/tick.h"
 
 /**
  * Gamepad processor trait.
@@ -51,6 +52,23 @@ struct sc_gamepad_processor_ops {
     void
     (*process_gamepad_button)(struct sc_gamepad_processor *gp,
                               const struct sc_gamepad_button_event *event);
+
+    /**
+     * Return the date when the pending state must be sent, or 0 if there is
+     * no pending state
+     *
+     * This function is optional.
+     */
+    sc_tick
+    (*get_deadline)(struct sc_gamepad_processor *gp);
+
+    /**
+     * Send the pending state whose deadline is reached
+     *
+     * This function is mandatory if get_deadline() is provided.
+     */
+    void
+    (*process_deadline)(struct sc_gamepad_processor *gp);
 };
 
 #endif
@@ -128,10 +128,30 @@ sc_gamepad_processor_process_gamepad_button(struct sc_gamepad_processor *gp,
 
 }
 
+static sc_tick
+sc_gamepad_processor_get_deadline(struct sc_gamepad_processor *gp) {
+    struct sc_gamepad_uhid *gamepad = DOWNCAST(gp);
+
+    return sc_hid_gamepad_get_deadline(&gamepad->hid);
+}
+
+static void
+sc_gamepad_processor_process_deadline(struct sc_gamepad_processor *gp) {
+    struct sc_gamepad_uhid *gamepad = DOWNCAST(gp);
+
+    sc_tick now = sc_tick_now();
+    struct sc_hid_input hid_input;
+    while (sc_hid_gamepad_generate_pending_input(&gamepad->hid, &hid_input,
+                                                 now)) {
+        sc_gamepad_uhid_send_input(gamepad, &hid_input, "gamepad axis");
+    }
+}
+
 void
 sc_gamepad_uhid_init(struct sc_gamepad_uhid *gamepad,
-                     struct sc_controller *controller) {
-    sc_hid_gamepad_init(&gamepad->hid);
+                     struct sc_controller *controller,
+                     sc_tick report_interval, uint8_t deadzone) {
+    sc_hid_gamepad_init(&gamepad->hid, report_interval, deadzone);
 
     gamepad->controller = controller;
 
@@ -140,6 +160,8 @@ sc_gamepad_uhid_init(struct sc_gamepad_uhid *gamepad,
         .process_gamepad_removed = sc_gamepad_processor_process_gamepad_removed,
         .process_gamepad_axis = sc_gamepad_processor_process_gamepad_axis,
         .process_gamepad_button = sc_gamepad_processor_process_gamepad_button,
+        .get_deadline = sc_gamepad_processor_get_deadline,
+        .process_deadline = sc_gamepad_processor_process_deadline,
     };
 
     gamepad->gamepad_processor.ops = &ops;
@@ -6,6 +6,7 @@
 #include "controller.h"
 #include "hid/hid_gamepad.h"
 #include "trait/gamepad_processor.h"
+#include "util/tick.h"
 
 struct sc_gamepad_uhid {
     struct sc_gamepad_processor gamepad_processor; // gamepad processor trait
@@ -16,6 +17,7 @@ struct sc_gamepad_uhid {
 
 void
 sc_gamepad_uhid_init(struct sc_gamepad_uhid *mouse,
-                     struct sc_controller *controller);
+                     struct sc_controller *controller,
+                     sc_tick report_interval, uint8_t deadzone);
 
 #endif
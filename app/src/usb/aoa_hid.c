@@ -5,25 +5,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
-#include <libusb-1.0/libusb.h>
 
 #include "events.h"
+#include "hid/hid_gamepad.h"
+#include "hid/hid_mouse.h"
 #include "util/log.h"
 #include "util/str.h"
-#include "util/tick.h"
 #include "util/vector.h"
 
-// See <https://source.android.com/devices/accessories/aoa2#hid-support>.
-#define ACCESSORY_REGISTER_HID 54
-#define ACCESSORY_SET_HID_REPORT_DESC 56
-#define ACCESSORY_SEND_HID_EVENT 57
-#define ACCESSORY_UNREGISTER_HID 55
-
-#define DEFAULT_TIMEOUT 1000
-
 // Drop droppable events above this limit
 #define SC_AOA_EVENT_QUEUE_LIMIT 60
 
+#define SC_AOA_REPORT_INTERVAL SC_TICK_FROM_SEC(10)
+
 struct sc_vec_hid_ids SC_VECTOR(uint16_t);
 
 static void
@@ -58,7 +52,7 @@ sc_hid_close_log(const struct sc_hid_close *hid_close) {
 }
 
 bool
-sc_aoa_init(struct sc_aoa *aoa, struct sc_usb *usb,
+sc_aoa_init(struct sc_aoa *aoa, struct sc_aoa_transport *transport,
             struct sc_acksync *acksync) {
     sc_vecdeque_init(&aoa->queue);
 
@@ -80,7 +74,17 @@ sc_aoa_init(struct sc_aoa *aoa, struct sc_usb *usb,
 
     aoa->stopped = false;
     aoa->acksync = acksync;
-    aoa->usb = usb;
+    aoa->transport = transport;
+
+    for (size_t i = 0; i < SC_AOA_MAX_IN_FLIGHT; ++i) {
+        aoa->busy[i] = false;
+    }
+    aoa->in_flight = 0;
+
+    sc_histogram_init(&aoa->latencies);
+    aoa->coalesced = 0;
+    aoa->failed = 0;
+    aoa->next_report = 0;
 
     return true;
 }
@@ -96,33 +100,19 @@ sc_aoa_destroy(struct sc_aoa *aoa) {
 static bool
 sc_aoa_register_hid(struct sc_aoa *aoa, uint16_t accessory_id,
                     uint16_t report_desc_size) {
-    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
-    uint8_t request = ACCESSORY_REGISTER_HID;
     // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
     // value (arg0): accessory assigned ID for the HID device
     // index (arg1): total length of the HID report descriptor
-    uint16_t value = accessory_id;
-    uint16_t index = report_desc_size;
-    unsigned char *data = NULL;
-    uint16_t length = 0;
-    int result = libusb_control_transfer(aoa->usb->handle, request_type,
-                                         request, value, index, data, length,
-                                         DEFAULT_TIMEOUT);
-    if (result < 0) {
-        LOGE("REGISTER_HID: libusb error: %s", libusb_strerror(result));
-        sc_usb_check_disconnected(aoa->usb, result);
-        return false;
-    }
-
-    return true;
+    return aoa->transport->ops->control(aoa->transport,
+                                        SC_AOA_REQUEST_REGISTER_HID,
+                                        accessory_id, report_desc_size,
+                                        NULL, 0);
 }
 
 static bool
 sc_aoa_set_hid_report_desc(struct sc_aoa *aoa, uint16_t accessory_id,
                            const uint8_t *report_desc,
                            uint16_t report_desc_size) {
-    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
-    uint8_t request = ACCESSORY_SET_HID_REPORT_DESC;
     /**
      * If the HID descriptor is longer than the endpoint zero max packet size,
      * the descriptor will be sent in multiple ACCESSORY_SET_HID_REPORT_DESC
@@ -137,41 +127,71 @@ sc_aoa_set_hid_report_desc(struct sc_aoa *aoa, uint16_t accessory_id,
      */
     // value (arg0): accessory assigned ID for the HID device
     // index (arg1): offset of data in descriptor
-    uint16_t value = accessory_id;
-    uint16_t index = 0;
-    // libusb_control_transfer expects a pointer to non-const
-    unsigned char *data = (unsigned char *) report_desc;
-    uint16_t length = report_desc_size;
-    int result = libusb_control_transfer(aoa->usb->handle, request_type,
-                                         request, value, index, data, length,
-                                         DEFAULT_TIMEOUT);
-    if (result < 0) {
-        LOGE("SET_HID_REPORT_DESC: libusb error: %s", libusb_strerror(result));
-        sc_usb_check_disconnected(aoa->usb, result);
-        return false;
+    return aoa->transport->ops->control(aoa->transport,
+                                        SC_AOA_REQUEST_SET_HID_REPORT_DESC,
+                                        accessory_id, 0, report_desc,
+                                        report_desc_size);
+}
+
+static void
+sc_aoa_on_transfer_complete(struct sc_aoa_transfer *transfer, bool ok,
+                            void *userdata) {
+    struct sc_aoa *aoa = userdata;
+
+    sc_tick now = sc_tick_now();
+
+    sc_mutex_lock(&aoa->mutex);
+
+    if (ok) {
+        // Completions are serialized by the mutex, so there is a single
+        // writer at a time
+        sc_histogram_record(&aoa->latencies, now - transfer->push_date);
+    } else {
+        ++aoa->failed;
+        LOGW("Could not send HID event to USB device: %" PRIu16,
+             transfer->hid.hid_id);
     }
 
-    return true;
+    size_t idx = transfer - aoa->transfers;
+    assert(idx < SC_AOA_MAX_IN_FLIGHT);
+    assert(aoa->busy[idx]);
+    aoa->busy[idx] = false;
+    assert(aoa->in_flight);
+    --aoa->in_flight;
+    sc_cond_signal(&aoa->event_cond);
+
+    sc_mutex_unlock(&aoa->mutex);
 }
 
 static bool
 sc_aoa_send_hid_event(struct sc_aoa *aoa,
-                      const struct sc_hid_input *hid_input) {
-    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
-    uint8_t request = ACCESSORY_SEND_HID_EVENT;
-    // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
-    // value (arg0): accessory assigned ID for the HID device
-    // index (arg1): 0 (unused)
-    uint16_t value = hid_input->hid_id;
-    uint16_t index = 0;
-    unsigned char *data = (uint8_t *) hid_input->data; // discard const
-    uint16_t length = hid_input->size;
-    int result = libusb_control_transfer(aoa->usb->handle, request_type,
-                                         request, value, index, data, length,
-                                         DEFAULT_TIMEOUT);
-    if (result < 0) {
-        LOGE("SEND_HID_EVENT: libusb error: %s", libusb_strerror(result));
-        sc_usb_check_disconnected(aoa->usb, result);
+                      const struct sc_hid_input *hid_input,
+                      sc_tick push_date) {
+    sc_mutex_lock(&aoa->mutex);
+    // The AOA thread only processes an input event if a slot is available
+    assert(aoa->in_flight < SC_AOA_MAX_IN_FLIGHT);
+    size_t idx = 0;
+    while (aoa->busy[idx]) {
+        ++idx;
+        assert(idx < SC_AOA_MAX_IN_FLIGHT);
+    }
+    aoa->busy[idx] = true;
+    ++aoa->in_flight;
+    sc_mutex_unlock(&aoa->mutex);
+
+    struct sc_aoa_transfer *transfer = &aoa->transfers[idx];
+    transfer->hid = *hid_input;
+    transfer->push_date = push_date;
+    transfer->on_complete = sc_aoa_on_transfer_complete;
+    transfer->userdata = aoa;
+
+    bool ok = aoa->transport->ops->submit(aoa->transport, transfer);
+    if (!ok) {
+        sc_mutex_lock(&aoa->mutex);
+        aoa->busy[idx] = false;
+        --aoa->in_flight;
+        ++aoa->failed;
+        sc_mutex_unlock(&aoa->mutex);
         return false;
     }
 
@@ -180,25 +200,12 @@ sc_aoa_send_hid_event(struct sc_aoa *aoa,
 
 static bool
 sc_aoa_unregister_hid(struct sc_aoa *aoa, uint16_t accessory_id) {
-    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
-    uint8_t request = ACCESSORY_UNREGISTER_HID;
     // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
     // value (arg0): accessory assigned ID for the HID device
     // index (arg1): 0
-    uint16_t value = accessory_id;
-    uint16_t index = 0;
-    unsigned char *data = NULL;
-    uint16_t length = 0;
-    int result = libusb_control_transfer(aoa->usb->handle, request_type,
-                                         request, value, index, data, length,
-                                         DEFAULT_TIMEOUT);
-    if (result < 0) {
-        LOGE("UNREGISTER_HID: libusb error: %s", libusb_strerror(result));
-        sc_usb_check_disconnected(aoa->usb, result);
-        return false;
-    }
-
-    return true;
+    return aoa->transport->ops->control(aoa->transport,
+                                        SC_AOA_REQUEST_UNREGISTER_HID,
+                                        accessory_id, 0, NULL, 0);
 }
 
 static bool
@@ -242,6 +249,7 @@ sc_aoa_push_input_with_ack_to_wait(struct sc_aoa *aoa,
         aoa_event->type = SC_AOA_EVENT_TYPE_INPUT;
         aoa_event->input.hid = *hid_input;
         aoa_event->input.ack_to_wait = ack_to_wait;
+        aoa_event->input.push_date = sc_tick_now();
         pushed = true;
 
         if (was_empty) {
@@ -347,7 +355,8 @@ sc_aoa_process_event(struct sc_aoa *aoa, struct sc_aoa_event *event,
             }
 
             struct sc_hid_input *hid_input = &event->input.hid;
-            bool ok = sc_aoa_send_hid_event(aoa, hid_input);
+            bool ok = sc_aoa_send_hid_event(aoa, hid_input,
+                                            event->input.push_date);
             if (!ok) {
                 LOGW("Could not send HID event to USB device: %" PRIu16,
                      hid_input->hid_id);
@@ -401,6 +410,91 @@ sc_aoa_process_event(struct sc_aoa *aoa, struct sc_aoa_event *event,
     return true;
 }
 
+static bool
+sc_aoa_merge_input(struct sc_hid_input *dst, const struct sc_hid_input *src) {
+    if (dst->hid_id != src->hid_id) {
+        return false;
+    }
+
+    uint16_t hid_id = dst->hid_id;
+    if (hid_id == SC_HID_ID_MOUSE) {
+        return sc_hid_mouse_merge_input(dst, src);
+    }
+    if (hid_id >= SC_HID_ID_GAMEPAD_FIRST && hid_id <= SC_HID_ID_GAMEPAD_LAST) {
+        return sc_hid_gamepad_merge_input(dst, src);
+    }
+
+    // Every keyboard report is a key transition, never merge them
+    return false;
+}
+
+static void
+sc_aoa_coalesce_input(struct sc_aoa *aoa, struct sc_aoa_event *event) {
+    // mutex locked
+    assert(event->type == SC_AOA_EVENT_TYPE_INPUT);
+
+    if (event->input.ack_to_wait != SC_SEQUENCE_INVALID) {
+        return;
+    }
+
+    // Merge the following events for the same HID device into this one, as
+    // long as they do not carry any transition (button, key, wheel...)
+    while (!sc_vecdeque_is_empty(&aoa->queue)) {
+        struct sc_aoa_event *next = sc_vecdeque_peekref(&aoa->queue);
+        if (next->type != SC_AOA_EVENT_TYPE_INPUT
+                || next->input.ack_to_wait != SC_SEQUENCE_INVALID
+                || !sc_aoa_merge_input(&event->input.hid, &next->input.hid)) {
+            break;
+        }
+
+        // The event has been merged, discard it
+        sc_vecdeque_popref(&aoa->queue);
+        ++aoa->coalesced;
+    }
+}
+
+static bool
+sc_aoa_can_process(struct sc_aoa *aoa) {
+    // mutex locked
+    if (sc_vecdeque_is_empty(&aoa->queue)) {
+        return false;
+    }
+
+    struct sc_aoa_event *event = sc_vecdeque_peekref(&aoa->queue);
+    if (event->type == SC_AOA_EVENT_TYPE_INPUT) {
+        return aoa->in_flight < SC_AOA_MAX_IN_FLIGHT;
+    }
+
+    // OPEN and CLOSE are sent synchronously, once all the previous input
+    // events have been transferred
+    return !aoa->in_flight;
+}
+
+static void
+sc_aoa_report(struct sc_aoa *aoa, bool final) {
+    // Cumulative since the AOA thread was started
+    enum sc_log_level level = final ? SC_LOG_LEVEL_INFO : SC_LOG_LEVEL_DEBUG;
+
+    sc_mutex_lock(&aoa->mutex);
+    uint64_t coalesced = aoa->coalesced;
+    uint64_t failed = aoa->failed;
+    sc_mutex_unlock(&aoa->mutex);
+
+    struct sc_histogram *h = &aoa->latencies;
+    uint32_t count = sc_histogram_count(h);
+    if (!count) {
+        return;
+    }
+
+    sc_tick p50 = sc_histogram_quantile(h, 500);
+    sc_tick p99 = sc_histogram_quantile(h, 990);
+    sc_tick max = sc_histogram_max(h);
+
+    LOG(level, "AOA HID events: p50=%.1fms p99=%.1fms max=%.1fms (%" PRIu32
+        " sent, %" PRIu64 " coalesced, %" PRIu64 " failed)",
+        p50 / 1000.0, p99 / 1000.0, max / 1000.0, count, coalesced, failed);
+}
+
 static int
 run_aoa_thread(void *data) {
     struct sc_aoa *aoa = data;
@@ -408,9 +502,11 @@ run_aoa_thread(void *data) {
     // Store the HID ids of opened devices to unregister them all before exiting
     struct sc_vec_hid_ids vec_open = SC_VECTOR_INITIALIZER;
 
+    aoa->next_report = sc_tick_now() + SC_AOA_REPORT_INTERVAL;
+
     for (;;) {
         sc_mutex_lock(&aoa->mutex);
-        while (!aoa->stopped && sc_vecdeque_is_empty(&aoa->queue)) {
+        while (!aoa->stopped && !sc_aoa_can_process(aoa)) {
             sc_cond_wait(&aoa->event_cond, &aoa->mutex);
         }
         if (aoa->stopped) {
@@ -421,6 +517,9 @@ run_aoa_thread(void *data) {
 
         assert(!sc_vecdeque_is_empty(&aoa->queue));
         struct sc_aoa_event event = sc_vecdeque_pop(&aoa->queue);
+        if (event.type == SC_AOA_EVENT_TYPE_INPUT) {
+            sc_aoa_coalesce_input(aoa, &event);
+        }
         sc_mutex_unlock(&aoa->mutex);
 
         bool cont = sc_aoa_process_event(aoa, &event, &vec_open);
@@ -428,8 +527,21 @@ run_aoa_thread(void *data) {
             // stopped
             break;
         }
+
+        sc_tick now = sc_tick_now();
+        if (now >= aoa->next_report) {
+            sc_aoa_report(aoa, false);
+            aoa->next_report = now + SC_AOA_REPORT_INTERVAL;
+        }
     }
 
+    // Wait for the pending transfers (they are completed or fail on timeout)
+    sc_mutex_lock(&aoa->mutex);
+    while (aoa->in_flight) {
+        sc_cond_wait(&aoa->event_cond, &aoa->mutex);
+    }
+    sc_mutex_unlock(&aoa->mutex);
+
     // Explicitly unregister all registered HID ids before exiting
     for (size_t i = 0; i < vec_open.size; ++i) {
         uint16_t hid_id = vec_open.data[i];
@@ -441,16 +553,26 @@ run_aoa_thread(void *data) {
     }
     sc_vector_destroy(&vec_open);
 
+    sc_aoa_report(aoa, true);
+
     return 0;
 }
 
 bool
 sc_aoa_start(struct sc_aoa *aoa) {
+    const struct sc_aoa_transport_ops *ops = aoa->transport->ops;
+    if (ops->start && !ops->start(aoa->transport)) {
+        return false;
+    }
+
     LOGD("Starting AOA thread");
 
     bool ok = sc_thread_create(&aoa->thread, run_aoa_thread, "scrcpy-aoa", aoa);
     if (!ok) {
         LOGE("Could not start AOA thread");
+        if (ops->stop) {
+            ops->stop(aoa->transport);
+        }
         return false;
     }
 
@@ -472,4 +594,11 @@ sc_aoa_stop(struct sc_aoa *aoa) {
 void
 sc_aoa_join(struct sc_aoa *aoa) {
     sc_thread_join(&aoa->thread, NULL);
+
+    // All the transfers are completed once the AOA thread has terminated
+    assert(!aoa->in_flight);
+    const struct sc_aoa_transport_ops *ops = aoa->transport->ops;
+    if (ops->stop) {
+        ops->stop(aoa->transport);
+    }
 }
@@ -7,11 +7,16 @@
 #include <stdint.h>
 
 #include "hid/hid_event.h"
-#include "usb/usb.h"
+#include "trait/aoa_transport.h"
 #include "util/acksync.h"
+#include "util/histogram.h"
 #include "util/thread.h"
+#include "util/tick.h"
 #include "util/vecdeque.h"
 
+// Maximum number of HID event transfers submitted but not completed yet
+#define SC_AOA_MAX_IN_FLIGHT 4
+
 enum sc_aoa_event_type {
     SC_AOA_EVENT_TYPE_OPEN,
     SC_AOA_EVENT_TYPE_INPUT,
@@ -31,6 +36,7 @@ struct sc_aoa_event {
         struct {
             struct sc_hid_input hid;
             uint64_t ack_to_wait;
+            sc_tick push_date;
         } input;
     };
 };
@@ -38,18 +44,42 @@ struct sc_aoa_event {
 struct sc_aoa_event_queue SC_VECDEQUE(struct sc_aoa_event);
 
 struct sc_aoa {
-    struct sc_usb *usb;
+    struct sc_aoa_transport *transport;
     sc_thread thread;
     sc_mutex mutex;
+    // signaled when an event is pushed or a transfer is completed
     sc_cond event_cond;
     bool stopped;
     struct sc_aoa_event_queue queue;
 
+    // HID event transfers, a slot is busy until its transfer is completed
+    struct sc_aoa_transfer transfers[SC_AOA_MAX_IN_FLIGHT];
+    bool busy[SC_AOA_MAX_IN_FLIGHT];
+    unsigned in_flight;
+
+    // Metrics (protected by mutex)
+
+    // delay between the push of an input event and its transfer completion
+    struct sc_histogram latencies;
+    // number of input events merged into a previous one
+    uint64_t coalesced;
+    // number of HID event transfers which failed
+    uint64_t failed;
+    sc_tick next_report;
+
     struct sc_acksync *acksync;
 };
 
+/**
+ * Initialize an AOA HID handler
+ *
+ * HID events are sent asynchronously through the transport, with up to
+ * SC_AOA_MAX_IN_FLIGHT transfers pending. Consecutive queued events for the
+ * same mouse or gamepad are coalesced when it does not lose any transition.
+ */
 bool
-sc_aoa_init(struct sc_aoa *aoa, struct sc_usb *usb, struct sc_acksync *acksync);
+sc_aoa_init(struct sc_aoa *aoa, struct sc_aoa_transport *transport,
+            struct sc_acksync *acksync);
 
 void
 sc_aoa_destroy(struct sc_aoa *aoa);
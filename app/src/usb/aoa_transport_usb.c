@@ -0,0 +1,187 @@
+#include "aoa_transport_usb.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libusb-1.0/libusb.h>
+
+#include "util/log.h"
+
+#define DEFAULT_TIMEOUT 1000
+
+// Interval to check the stopped flag from the event thread
+#define SC_AOA_TRANSPORT_USB_POLL_INTERVAL_US 100000
+
+/** Downcast AOA transport to sc_aoa_transport_usb */
+#define DOWNCAST(T) container_of(T, struct sc_aoa_transport_usb, transport)
+
+static const char *
+sc_aoa_request_name(uint8_t request) {
+    switch (request) {
+        case SC_AOA_REQUEST_REGISTER_HID:
+            return "REGISTER_HID";
+        case SC_AOA_REQUEST_UNREGISTER_HID:
+            return "UNREGISTER_HID";
+        case SC_AOA_REQUEST_SET_HID_REPORT_DESC:
+            return "SET_HID_REPORT_DESC";
+        case SC_AOA_REQUEST_SEND_HID_EVENT:
+            return "SEND_HID_EVENT";
+        default:
+            return "(unknown)";
+    }
+}
+
+static int
+run_event_thread(void *data) {
+    struct sc_aoa_transport_usb *tu = data;
+
+    while (!atomic_load(&tu->stopped)) {
+        struct timeval tv = {
+            .tv_sec = 0,
+            .tv_usec = SC_AOA_TRANSPORT_USB_POLL_INTERVAL_US,
+        };
+        libusb_handle_events_timeout_completed(tu->usb->context, &tv, NULL);
+    }
+
+    return 0;
+}
+
+static bool
+sc_aoa_transport_usb_start(struct sc_aoa_transport *transport) {
+    struct sc_aoa_transport_usb *tu = DOWNCAST(transport);
+
+    atomic_init(&tu->stopped, false);
+
+    bool ok = sc_thread_create(&tu->event_thread, run_event_thread,
+                               "scrcpy-aoa-usb", tu);
+    if (!ok) {
+        LOGE("Could not start AOA USB event thread");
+        return false;
+    }
+
+    return true;
+}
+
+static void
+sc_aoa_transport_usb_stop(struct sc_aoa_transport *transport) {
+    struct sc_aoa_transport_usb *tu = DOWNCAST(transport);
+
+    // The event thread will notice within SC_AOA_TRANSPORT_USB_POLL_INTERVAL_US
+    atomic_store(&tu->stopped, true);
+    sc_thread_join(&tu->event_thread, NULL);
+}
+
+static bool
+sc_aoa_transport_usb_control(struct sc_aoa_transport *transport,
+                             uint8_t request, uint16_t value, uint16_t index,
+                             const uint8_t *data, uint16_t length) {
+    struct sc_aoa_transport_usb *tu = DOWNCAST(transport);
+
+    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
+    // libusb_control_transfer expects a pointer to non-const
+    unsigned char *buf = (unsigned char *) data;
+    int result = libusb_control_transfer(tu->usb->handle, request_type,
+                                         request, value, index, buf, length,
+                                         DEFAULT_TIMEOUT);
+    if (result < 0) {
+        LOGE("%s: libusb error: %s", sc_aoa_request_name(request),
+             libusb_strerror(result));
+        sc_usb_check_disconnected(tu->usb, result);
+        return false;
+    }
+
+    return true;
+}
+
+struct sc_aoa_transport_usb_request {
+    struct sc_aoa_transport_usb *tu;
+    struct sc_aoa_transfer *transfer;
+    // setup packet followed by the HID event
+    unsigned char buf[LIBUSB_CONTROL_SETUP_SIZE + SC_HID_MAX_SIZE];
+};
+
+static void LIBUSB_CALL
+sc_aoa_transport_usb_on_transfer_complete(struct libusb_transfer *t) {
+    struct sc_aoa_transport_usb_request *req = t->user_data;
+    struct sc_aoa_transfer *transfer = req->transfer;
+
+    bool ok = t->status == LIBUSB_TRANSFER_COMPLETED;
+    if (!ok) {
+        LOGE("SEND_HID_EVENT: libusb transfer error: %s",
+             libusb_error_name(t->status));
+        if (t->status == LIBUSB_TRANSFER_NO_DEVICE) {
+            sc_usb_check_disconnected(req->tu->usb, LIBUSB_ERROR_NO_DEVICE);
+        }
+    }
+
+    // The libusb transfer is freed by libusb after this callback
+    // (LIBUSB_TRANSFER_FREE_TRANSFER)
+    free(req);
+
+    transfer->on_complete(transfer, ok, transfer->userdata);
+}
+
+static bool
+sc_aoa_transport_usb_submit(struct sc_aoa_transport *transport,
+                            struct sc_aoa_transfer *transfer) {
+    struct sc_aoa_transport_usb *tu = DOWNCAST(transport);
+
+    assert(transfer->hid.size <= SC_HID_MAX_SIZE);
+
+    struct sc_aoa_transport_usb_request *req = malloc(sizeof(*req));
+    if (!req) {
+        LOG_OOM();
+        return false;
+    }
+
+    struct libusb_transfer *t = libusb_alloc_transfer(0);
+    if (!t) {
+        LOG_OOM();
+        free(req);
+        return false;
+    }
+
+    req->tu = tu;
+    req->transfer = transfer;
+
+    uint8_t request_type = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
+    // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
+    // value (arg0): accessory assigned ID for the HID device
+    // index (arg1): 0 (unused)
+    libusb_fill_control_setup(req->buf, request_type,
+                              SC_AOA_REQUEST_SEND_HID_EVENT,
+                              transfer->hid.hid_id, 0, transfer->hid.size);
+    memcpy(req->buf + LIBUSB_CONTROL_SETUP_SIZE, transfer->hid.data,
+           transfer->hid.size);
+
+    libusb_fill_control_transfer(t, tu->usb->handle, req->buf,
+                                 sc_aoa_transport_usb_on_transfer_complete,
+                                 req, DEFAULT_TIMEOUT);
+    t->flags = LIBUSB_TRANSFER_FREE_TRANSFER;
+
+    int result = libusb_submit_transfer(t);
+    if (result < 0) {
+        LOGE("SEND_HID_EVENT: libusb error: %s", libusb_strerror(result));
+        sc_usb_check_disconnected(tu->usb, result);
+        libusb_free_transfer(t);
+        free(req);
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_aoa_transport_usb_init(struct sc_aoa_transport_usb *tu,
+                          struct sc_usb *usb) {
+    tu->usb = usb;
+
+    static const struct sc_aoa_transport_ops ops = {
+        .start = sc_aoa_transport_usb_start,
+        .stop = sc_aoa_transport_usb_stop,
+        .control = sc_aoa_transport_usb_control,
+        .submit = sc_aoa_transport_usb_submit,
+    };
+
+    tu->transport.ops = &ops;
+}
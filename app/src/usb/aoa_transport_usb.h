@@ -0,0 +1,31 @@
+#ifndef SC_AOA_TRANSPORT_USB_H
+#define SC_AOA_TRANSPORT_USB_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "trait/aoa_transport.h"
+#include "usb/usb.h"
+#include "util/thread.h"
+
+/**
+ * AOA transport over libusb
+ *
+ * Asynchronous transfers are completed from a dedicated libusb event thread.
+ */
+struct sc_aoa_transport_usb {
+    struct sc_aoa_transport transport; // AOA transport trait
+
+    struct sc_usb *usb;
+
+    sc_thread event_thread;
+    atomic_bool stopped;
+};
+
+void
+sc_aoa_transport_usb_init(struct sc_aoa_transport_usb *tu,
+                          struct sc_usb *usb);
+
+#endif
@@ -73,17 +73,41 @@ sc_gamepad_processor_process_gamepad_button(struct sc_gamepad_processor *gp,
     }
 }
 
+static sc_tick
+sc_gamepad_processor_get_deadline(struct sc_gamepad_processor *gp) {
+    struct sc_gamepad_aoa *gamepad = DOWNCAST(gp);
+
+    return sc_hid_gamepad_get_deadline(&gamepad->hid);
+}
+
+static void
+sc_gamepad_processor_process_deadline(struct sc_gamepad_processor *gp) {
+    struct sc_gamepad_aoa *gamepad = DOWNCAST(gp);
+
+    sc_tick now = sc_tick_now();
+    struct sc_hid_input hid_input;
+    while (sc_hid_gamepad_generate_pending_input(&gamepad->hid, &hid_input,
+                                                 now)) {
+        if (!sc_aoa_push_input(gamepad->aoa, &hid_input)) {
+            LOGW("Could not push AOA HID input (gamepad axis)");
+        }
+    }
+}
+
 void
-sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa) {
+sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa,
+                    sc_tick report_interval, uint8_t deadzone) {
     gamepad->aoa = aoa;
 
-    sc_hid_gamepad_init(&gamepad->hid);
+    sc_hid_gamepad_init(&gamepad->hid, report_interval, deadzone);
 
     static const struct sc_gamepad_processor_ops ops = {
         .process_gamepad_added = sc_gamepad_processor_process_gamepad_added,
         .process_gamepad_removed = sc_gamepad_processor_process_gamepad_removed,
         .process_gamepad_axis = sc_gamepad_processor_process_gamepad_axis,
         .process_gamepad_button = sc_gamepad_processor_process_gamepad_button,
+        .get_deadline = sc_gamepad_processor_get_deadline,
+        .process_deadline = sc_gamepad_processor_process_deadline,
     };
 
     gamepad->gamepad_processor.ops = &ops;
@@ -6,6 +6,7 @@
 #include "hid/hid_gamepad.h"
 #include "usb/aoa_hid.h"
 #include "trait/gamepad_processor.h"
+#include "util/tick.h"
 
 struct sc_gamepad_aoa {
     struct sc_gamepad_processor gamepad_processor; // gamepad processor trait
@@ -15,7 +16,8 @@ struct sc_gamepad_aoa {
 };
 
 void
-sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa);
+sc_gamepad_aoa_init(struct sc_gamepad_aoa *gamepad, struct sc_aoa *aoa,
+                    sc_tick report_interval, uint8_t deadzone);
 
 void
 sc_gamepad_aoa_destroy(struct sc_gamepad_aoa *gamepad);
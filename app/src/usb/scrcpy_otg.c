@@ -11,6 +11,7 @@
 #include "events.h"
 #include "usb/screen_otg.h"
 #include "usb/aoa_hid.h"
+#include "usb/aoa_transport_usb.h"
 #include "usb/gamepad_aoa.h"
 #include "usb/keyboard_aoa.h"
 #include "usb/mouse_aoa.h"
@@ -18,6 +19,7 @@
 
 struct scrcpy_otg {
     struct sc_usb usb;
+    struct sc_aoa_transport_usb aoa_transport;
     struct sc_aoa aoa;
     struct sc_keyboard_aoa keyboard;
     struct sc_mouse_aoa mouse;
@@ -34,10 +36,37 @@ sc_usb_on_disconnected(struct sc_usb *usb, void *userdata) {
     sc_push_event(SC_EVENT_USB_DEVICE_DISCONNECTED);
 }
 
+static bool
+wait_event(struct scrcpy_otg *s, SDL_Event *event) {
+    struct sc_gamepad_aoa *gamepad = s->screen_otg.gamepad;
+    struct sc_gamepad_processor *gp =
+        gamepad ? &gamepad->gamepad_processor : NULL;
+
+    for (;;) {
+        sc_tick deadline = gp ? gp->ops->get_deadline(gp) : 0;
+        if (!deadline) {
+            return SDL_WaitEvent(event);
+        }
+
+        sc_tick now = sc_tick_now();
+        if (now < deadline) {
+            // Round up, SDL timeouts are expressed in milliseconds
+            int timeout = (deadline - now + SC_TICK_FROM_MS(1) - 1)
+                        / SC_TICK_FROM_MS(1);
+            if (SDL_WaitEventTimeout(event, timeout)) {
+                return true;
+            }
+        }
+
+        // The pending gamepad state must be sent now
+        gp->ops->process_deadline(gp);
+    }
+}
+
 static enum scrcpy_exit_code
 event_loop(struct scrcpy_otg *s) {
     SDL_Event event;
-    while (SDL_WaitEvent(&event)) {
+    while (wait_event(s, &event)) {
         switch (event.type) {
             case SC_EVENT_USB_DEVICE_DISCONNECTED:
                 LOGW("Device disconnected");
@@ -136,7 +165,8 @@ scrcpy_otg(struct scrcpy_options *options) {
     }
     usb_connected = true;
 
-    ok = sc_aoa_init(&s->aoa, &s->usb, NULL);
+    sc_aoa_transport_usb_init(&s->aoa_transport, &s->usb);
+    ok = sc_aoa_init(&s->aoa, &s->aoa_transport.transport, NULL);
     if (!ok) {
         goto end;
     }
@@ -173,7 +203,9 @@ scrcpy_otg(struct scrcpy_options *options) {
     }
 
     if (enable_gamepad) {
-        sc_gamepad_aoa_init(&s->gamepad, &s->aoa);
+        sc_gamepad_aoa_init(&s->gamepad, &s->aoa,
+                            options->gamepad_report_interval,
+                            options->gamepad_deadzone);
         gamepad = &s->gamepad;
     }
 
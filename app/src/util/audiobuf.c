@@ -4,6 +4,7 @@
 #include <string.h>
 #include <util/log.h>
 #include <util/memory.h>
+#include <util/pcm.h>
 
 bool
 sc_audiobuf_init(struct sc_audiobuf *buf, size_t sample_size,
@@ -23,6 +24,7 @@ sc_audiobuf_init(struct sc_audiobuf *buf, size_t sample_size,
     buf->sample_size = sample_size;
     atomic_init(&buf->head, 0);
     atomic_init(&buf->tail, 0);
+    atomic_init(&buf->skip, 0);
 
     return true;
 }
@@ -46,6 +48,19 @@ sc_audiobuf_read(struct sc_audiobuf *buf, void *to_, uint32_t samples_count) {
     uint32_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
 
     uint32_t can_read = (buf->alloc_size + head - tail) % buf->alloc_size;
+
+    uint32_t skip = atomic_load_explicit(&buf->skip, memory_order_acquire);
+    if (skip) {
+        uint32_t skipped = MIN(skip, can_read);
+        tail = (tail + skipped) % buf->alloc_size;
+        can_read -= skipped;
+        // Move the tail before acknowledging the request, so that the writer
+        // may underestimate can_read() temporarily, but never overestimate it
+        atomic_store_explicit(&buf->tail, tail, memory_order_release);
+        // The part of the request exceeding can_read is discarded
+        atomic_fetch_sub_explicit(&buf->skip, skip, memory_order_release);
+    }
+
     if (!can_read) {
         return 0;
     }
@@ -151,3 +166,43 @@ sc_audiobuf_write_silence(struct sc_audiobuf *buf, uint32_t samples_count) {
 
     return samples_count;
 }
+
+uint32_t
+sc_audiobuf_write_s16(struct sc_audiobuf *buf, const int16_t *from,
+                      uint32_t samples_count) {
+    assert(buf->sample_size % sizeof(float) == 0);
+    size_t channels = buf->sample_size / sizeof(float);
+
+    // Only the writer thread can write head, so memory_order_relaxed is
+    // sufficient
+    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+
+    // The tail cursor is updated after the data is consumed by the reader
+    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+
+    uint32_t can_write = (buf->alloc_size + tail - head - 1) % buf->alloc_size;
+    if (!can_write) {
+        return 0;
+    }
+    if (samples_count > can_write) {
+        samples_count = can_write;
+    }
+
+    uint32_t right_count = buf->alloc_size - head;
+    if (right_count > samples_count) {
+        right_count = samples_count;
+    }
+    sc_pcm_s16_to_f32((float *) (buf->data + (head * buf->sample_size)), from,
+                      right_count * channels);
+
+    if (samples_count > right_count) {
+        uint32_t left_count = samples_count - right_count;
+        sc_pcm_s16_to_f32((float *) buf->data, from + right_count * channels,
+                          left_count * channels);
+    }
+
+    uint32_t new_head = (head + samples_count) % buf->alloc_size;
+    atomic_store_explicit(&buf->head, new_head, memory_order_release);
+
+    return samples_count;
+}
@@ -23,6 +23,10 @@ struct sc_audiobuf {
     atomic_uint_least32_t tail; // reader cursor, in samples
     // empty: tail == head
     // full: ((tail + 1) % alloc_size) == head
+
+    // Number of samples the reader must drop before its next read, requested
+    // by the writer (the writer never moves the tail cursor)
+    atomic_uint_least32_t skip;
 };
 
 static inline uint32_t
@@ -53,17 +57,50 @@ sc_audiobuf_write(struct sc_audiobuf *buf, const void *from,
 uint32_t
 sc_audiobuf_write_silence(struct sc_audiobuf *buf, uint32_t samples);
 
+/**
+ * Write signed 16-bit samples, converted to 32-bit float samples
+ *
+ * The buffer must store 32-bit float samples (sample_size is the number of
+ * channels * 4), while the input samples take sample_size / 2 bytes.
+ */
+uint32_t
+sc_audiobuf_write_s16(struct sc_audiobuf *buf, const int16_t *from,
+                      uint32_t samples_count);
+
+/**
+ * Request the reader to drop the oldest samples
+ *
+ * This must be called from the writer thread. The samples are dropped by the
+ * next sc_audiobuf_read(), so that only the reader moves the tail cursor.
+ *
+ * If the buffer contains fewer samples than requested at that time, the
+ * remaining part of the request is ignored.
+ */
+static inline void
+sc_audiobuf_request_skip(struct sc_audiobuf *buf, uint32_t samples_count) {
+    atomic_fetch_add_explicit(&buf->skip, samples_count, memory_order_release);
+}
+
 static inline uint32_t
 sc_audiobuf_capacity(struct sc_audiobuf *buf) {
     assert(buf->alloc_size);
     return buf->alloc_size - 1;
 }
 
+/**
+ * Return the number of samples available for reading, excluding the samples
+ * requested to be skipped
+ */
 static inline uint32_t
 sc_audiobuf_can_read(struct sc_audiobuf *buf) {
     uint32_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    // The reader moves the tail before acknowledging a skip request, so skip
+    // must be loaded before tail: if the acknowledgment is visible, then the
+    // new tail is visible too, and can_read may only be underestimated
+    uint32_t skip = atomic_load_explicit(&buf->skip, memory_order_acquire);
     uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
-    return (buf->alloc_size + head - tail) % buf->alloc_size;
+    uint32_t can_read = (buf->alloc_size + head - tail) % buf->alloc_size;
+    return can_read > skip ? can_read - skip : 0;
 }
 
 #endif
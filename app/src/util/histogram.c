@@ -0,0 +1,116 @@
+#include "histogram.h"
+
+#include <assert.h>
+
+void
+sc_histogram_init(struct sc_histogram *h) {
+    for (unsigned i = 0; i < SC_HISTOGRAM_BUCKETS; ++i) {
+        atomic_init(&h->buckets[i], 0);
+    }
+    atomic_init(&h->count, 0);
+    atomic_init(&h->max, 0);
+}
+
+static unsigned
+sc_histogram_index(uint32_t value) {
+    if (value < SC_HISTOGRAM_LINEAR) {
+        return value;
+    }
+
+    unsigned exp = 31 - __builtin_clz(value); // >= 4
+    if (exp >= SC_HISTOGRAM_MAX_EXP) {
+        return SC_HISTOGRAM_BUCKETS - 1;
+    }
+
+    // The 3 bits following the most significant bit
+    unsigned sub = (value >> (exp - 3)) - SC_HISTOGRAM_SUB_BUCKETS;
+    return SC_HISTOGRAM_LINEAR + (exp - 4) * SC_HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+static sc_tick
+sc_histogram_upper_bound(unsigned index) {
+    if (index < SC_HISTOGRAM_LINEAR) {
+        return index;
+    }
+
+    index -= SC_HISTOGRAM_LINEAR;
+    unsigned exp = index / SC_HISTOGRAM_SUB_BUCKETS + 4;
+    unsigned sub = index % SC_HISTOGRAM_SUB_BUCKETS;
+    sc_tick lower = (sc_tick) (SC_HISTOGRAM_SUB_BUCKETS + sub) << (exp - 3);
+    return lower + ((sc_tick) 1 << (exp - 3)) - 1;
+}
+
+void
+sc_histogram_record(struct sc_histogram *h, sc_tick value) {
+    if (value < 0) {
+        value = 0;
+    }
+
+    uint32_t v = value < UINT32_MAX ? value : UINT32_MAX;
+    unsigned index = sc_histogram_index(v);
+
+    // There is a single writer, so a load/store is sufficient (and cheaper
+    // than a read-modify-write)
+    uint32_t c = atomic_load_explicit(&h->buckets[index],
+                                      memory_order_relaxed);
+    atomic_store_explicit(&h->buckets[index], c + 1, memory_order_relaxed);
+
+    if (value > atomic_load_explicit(&h->max, memory_order_relaxed)) {
+        atomic_store_explicit(&h->max, value, memory_order_relaxed);
+    }
+
+    c = atomic_load_explicit(&h->count, memory_order_relaxed);
+    atomic_store_explicit(&h->count, c + 1, memory_order_release);
+}
+
+uint32_t
+sc_histogram_count(struct sc_histogram *h) {
+    return atomic_load_explicit(&h->count, memory_order_acquire);
+}
+
+sc_tick
+sc_histogram_max(struct sc_histogram *h) {
+    return atomic_load_explicit(&h->max, memory_order_relaxed);
+}
+
+sc_tick
+sc_histogram_quantile(struct sc_histogram *h, unsigned permille) {
+    assert(permille <= 1000);
+
+    // Read the buckets once, the writer may update them concurrently
+    uint32_t buckets[SC_HISTOGRAM_BUCKETS];
+    uint64_t total = 0;
+    for (unsigned i = 0; i < SC_HISTOGRAM_BUCKETS; ++i) {
+        buckets[i] = atomic_load_explicit(&h->buckets[i],
+                                          memory_order_relaxed);
+        total += buckets[i];
+    }
+
+    if (!total) {
+        return 0;
+    }
+
+    // Rank of the requested value (1-based)
+    uint64_t rank = (total * permille + 999) / 1000;
+    if (!rank) {
+        rank = 1;
+    }
+
+    uint64_t cumul = 0;
+    for (unsigned i = 0; i < SC_HISTOGRAM_BUCKETS; ++i) {
+        cumul += buckets[i];
+        if (cumul >= rank) {
+            sc_tick max = sc_histogram_max(h);
+            if (i == SC_HISTOGRAM_BUCKETS - 1) {
+                // The last bucket is open-ended
+                return max;
+            }
+            sc_tick bound = sc_histogram_upper_bound(i);
+            // The maximum is exact, never report a higher value
+            return MIN(bound, max);
+        }
+    }
+
+    assert(!"unreachable");
+    return 0;
+}
@@ -0,0 +1,63 @@
+#ifndef SC_HISTOGRAM_H
+#define SC_HISTOGRAM_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+// Values lower than this are counted exactly
+#define SC_HISTOGRAM_LINEAR 16
+// Number of buckets per power of 2 above SC_HISTOGRAM_LINEAR (~12% precision)
+#define SC_HISTOGRAM_SUB_BUCKETS 8
+// Values are clamped to 2^SC_HISTOGRAM_MAX_EXP - 1 (more than 16 seconds)
+#define SC_HISTOGRAM_MAX_EXP 25
+#define SC_HISTOGRAM_BUCKETS (SC_HISTOGRAM_LINEAR + \
+        (SC_HISTOGRAM_MAX_EXP - 4) * SC_HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * Log-linear histogram of durations (in sc_tick)
+ *
+ * It is intended to be fed from a real-time thread: recording a value is
+ * wait-free (it never blocks nor allocates). There must be a single writer,
+ * but the histogram may be read concurrently from another thread.
+ */
+struct sc_histogram {
+    atomic_uint_least32_t buckets[SC_HISTOGRAM_BUCKETS];
+    atomic_uint_least32_t count;
+    atomic_int_least64_t max;
+};
+
+void
+sc_histogram_init(struct sc_histogram *h);
+
+/**
+ * Record a value (must be called from a single thread)
+ */
+void
+sc_histogram_record(struct sc_histogram *h, sc_tick value);
+
+/**
+ * Return the number of recorded values
+ */
+uint32_t
+sc_histogram_count(struct sc_histogram *h);
+
+/**
+ * Return the maximum recorded value (exact)
+ */
+sc_tick
+sc_histogram_max(struct sc_histogram *h);
+
+/**
+ * Return the value at the given quantile, in per mille (e.g. 990 for p99)
+ *
+ * The result is the upper bound of the bucket containing the quantile (but
+ * never more than the maximum), so it never underestimates the actual value.
+ */
+sc_tick
+sc_histogram_quantile(struct sc_histogram *h, unsigned permille);
+
+#endif
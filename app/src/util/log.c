@@ -2,13 +2,105 @@
 
 #if _WIN32
 # include <windows.h>
+#else
+# include <pthread.h>
 #endif
 #include <assert.h>
+#include <inttypes.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL_timer.h>
 #include <libavutil/log.h>
 
+#include "util/thread.h"
+#include "util/tick.h"
+
+// Same as SDL_MAX_LOG_MESSAGE (longer messages are truncated)
+#define SC_LOG_MESSAGE_MAX 4096
+// Per-thread ring buffer size, must be a power of 2
+#define SC_LOG_RING_SIZE (64 * 1024)
+#define SC_LOG_RING_COUNT 64
+#define SC_LOG_FLUSH_INTERVAL SC_TICK_FROM_MS(10)
+
+// Priority of the record marking the end of the ring buffer (the next record
+// is at the beginning)
+#define SC_LOG_RECORD_WRAP 0
+
+/**
+ * A log line, followed by its message (without '\0') in the ring buffer
+ *
+ * The records are aligned on their (header) size, so that there is always
+ * room for a SC_LOG_RECORD_WRAP record at the end of the ring buffer.
+ */
+struct sc_log_record {
+    sc_tick timestamp;
+    uint16_t size; // including the header and the padding
+    uint16_t len; // of the message
+    uint8_t priority; // SDL_LogPriority or SC_LOG_RECORD_WRAP
+};
+
+#define SC_LOG_RECORD_ALIGN sizeof(struct sc_log_record)
+static_assert(SC_LOG_RECORD_ALIGN == 16, "Unexpected log record size");
+static_assert(SC_LOG_RING_SIZE % SC_LOG_RECORD_ALIGN == 0,
+              "Unaligned log ring size");
+
+enum sc_log_ring_state {
+    SC_LOG_RING_FREE,
+    SC_LOG_RING_USED,
+    SC_LOG_RING_RELEASED, // its thread has terminated, it must be drained
+};
+
+/**
+ * Single-producer single-consumer ring buffer of log records
+ *
+ * The producer is the thread owning the ring, the consumer is the flusher
+ * thread. Neither ever blocks: if the ring is full, the line is dropped (and
+ * counted).
+ */
+struct sc_log_ring {
+    atomic_int state; // enum sc_log_ring_state
+    // set by the producer before its first record
+    atomic_uint thread_number;
+    atomic_size_t head; // written only by the producer
+    atomic_size_t tail; // written only by the consumer
+    atomic_uint dropped;
+    uint8_t data[SC_LOG_RING_SIZE];
+};
+
+static struct {
+    // minimum priority of the scrcpy logs (set before any thread is started)
+    SDL_LogPriority priority;
+    // prefix the lines by a timestamp and a thread number
+    bool decorate;
+    sc_tick epoch;
+
+    // the logs are written to the ring buffers of the threads
+    atomic_bool async;
+    // number of threads currently writing a log (possibly to their ring)
+    atomic_uint writers;
+    // the ring of the current thread (released when any thread terminates,
+    // including the threads not created by SDL, e.g. by FFmpeg or libusb)
+#ifdef _WIN32
+    DWORD tls;
+#else
+    pthread_key_t tls;
+#endif
+    atomic_uint thread_count;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    struct sc_log_ring rings[SC_LOG_RING_COUNT];
+} logger = {
+    .priority = SDL_LOG_PRIORITY_INFO,
+};
+
 static SDL_LogPriority
 log_level_sc_to_sdl(enum sc_log_level level) {
     switch (level) {
@@ -52,6 +144,7 @@ sc_set_log_level(enum sc_log_level level) {
     SDL_LogPriority sdl_log = log_level_sc_to_sdl(level);
     SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, sdl_log);
     SDL_LogSetPriority(SDL_LOG_CATEGORY_CUSTOM, sdl_log);
+    logger.priority = sdl_log;
 }
 
 enum sc_log_level
@@ -60,13 +153,241 @@ sc_get_log_level(void) {
     return log_level_sdl_to_sc(sdl_log);
 }
 
+static const char *const sc_sdl_log_priority_names[SDL_NUM_LOG_PRIORITIES] = {
+    [SDL_LOG_PRIORITY_VERBOSE] = "VERBOSE",
+    [SDL_LOG_PRIORITY_DEBUG] = "DEBUG",
+    [SDL_LOG_PRIORITY_INFO] = "INFO",
+    [SDL_LOG_PRIORITY_WARN] = "WARN",
+    [SDL_LOG_PRIORITY_ERROR] = "ERROR",
+    [SDL_LOG_PRIORITY_CRITICAL] = "CRITICAL",
+};
+
+// thread_number is 0 if unknown
+static void
+sc_log_print(SDL_LogPriority priority, sc_tick timestamp,
+             unsigned thread_number, const char *msg, size_t len) {
+    FILE *out = priority < SDL_LOG_PRIORITY_WARN ? stdout : stderr;
+    assert(priority > 0 && priority < SDL_NUM_LOG_PRIORITIES);
+    const char *prio_name = sc_sdl_log_priority_names[priority];
+
+    if (!logger.decorate) {
+        fprintf(out, "%s: %.*s\n", prio_name, (int) len, msg);
+        return;
+    }
+
+    sc_tick t = timestamp - logger.epoch;
+    sc_tick sec = t / SC_TICK_FREQ;
+    sc_tick usec = t % SC_TICK_FREQ;
+    if (thread_number) {
+        fprintf(out, "%s: [%4" PRItick ".%06" PRItick " t%u] %.*s\n",
+                prio_name, sec, usec, thread_number, (int) len, msg);
+    } else {
+        fprintf(out, "%s: [%4" PRItick ".%06" PRItick "] %.*s\n",
+                prio_name, sec, usec, (int) len, msg);
+    }
+}
+
+static size_t
+sc_log_record_size(size_t len) {
+    size_t size = sizeof(struct sc_log_record) + len;
+    // Round up
+    return (size + SC_LOG_RECORD_ALIGN - 1) & ~(SC_LOG_RECORD_ALIGN - 1);
+}
+
+// Called only from the thread owning the ring
+static void
+sc_log_ring_push(struct sc_log_ring *ring, SDL_LogPriority priority,
+                 sc_tick timestamp, const char *msg, size_t len) {
+    size_t size = sc_log_record_size(len);
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t offset = head & (SC_LOG_RING_SIZE - 1);
+
+    // A record is never split: skip the end of the ring if necessary
+    size_t padding = SC_LOG_RING_SIZE - offset < size
+                   ? SC_LOG_RING_SIZE - offset : 0;
+    if (padding + size > SC_LOG_RING_SIZE - (head - tail)) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    if (padding) {
+        struct sc_log_record wrap = {
+            .priority = SC_LOG_RECORD_WRAP,
+        };
+        memcpy(&ring->data[offset], &wrap, sizeof(wrap));
+        offset = 0;
+    }
+
+    struct sc_log_record record = {
+        .timestamp = timestamp,
+        .size = size,
+        .len = len,
+        .priority = priority,
+    };
+    memcpy(&ring->data[offset], &record, sizeof(record));
+    memcpy(&ring->data[offset + sizeof(record)], msg, len);
+
+    // Publish the record
+    atomic_store_explicit(&ring->head, head + padding + size,
+                          memory_order_release);
+}
+
+// Called only from the consumer, return a pointer to the message
+static const char *
+sc_log_ring_peek(struct sc_log_ring *ring, struct sc_log_record *record) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head) {
+        return NULL;
+    }
+
+    size_t offset = tail & (SC_LOG_RING_SIZE - 1);
+    memcpy(record, &ring->data[offset], sizeof(*record));
+    if (record->priority == SC_LOG_RECORD_WRAP) {
+        // The producer publishes the padding and the next record at once
+        tail += SC_LOG_RING_SIZE - offset;
+        assert(tail != head);
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        offset = 0;
+        memcpy(record, &ring->data[0], sizeof(*record));
+    }
+
+    assert(record->priority != SC_LOG_RECORD_WRAP);
+    return (const char *) &ring->data[offset + sizeof(*record)];
+}
+
+static void
+sc_log_ring_pop(struct sc_log_ring *ring, const struct sc_log_record *record) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + record->size,
+                          memory_order_release);
+}
+
+#ifdef _WIN32
+static VOID WINAPI
+#else
+static void
+#endif
+sc_log_release_ring(void *data) {
+    struct sc_log_ring *ring = data;
+    if (!ring) {
+        // The thread has no ring
+        return;
+    }
+
+    // The flusher will drain it before making it available again
+    atomic_store_explicit(&ring->state, SC_LOG_RING_RELEASED,
+                          memory_order_release);
+}
+
+static bool
+sc_log_tls_init(void) {
+#ifdef _WIN32
+    // Unlike TlsAlloc(), the callback is called when any thread terminates
+    logger.tls = FlsAlloc(sc_log_release_ring);
+    return logger.tls != FLS_OUT_OF_INDEXES;
+#else
+    return !pthread_key_create(&logger.tls, sc_log_release_ring);
+#endif
+}
+
+static struct sc_log_ring *
+sc_log_tls_get(void) {
+#ifdef _WIN32
+    return FlsGetValue(logger.tls);
+#else
+    return pthread_getspecific(logger.tls);
+#endif
+}
+
+static bool
+sc_log_tls_set(struct sc_log_ring *ring) {
+#ifdef _WIN32
+    return FlsSetValue(logger.tls, ring);
+#else
+    return !pthread_setspecific(logger.tls, ring);
+#endif
+}
+
+// Return the ring of the current thread, or NULL if none is available
+static struct sc_log_ring *
+sc_log_get_thread_ring(void) {
+    struct sc_log_ring *ring = sc_log_tls_get();
+    if (ring) {
+        return ring;
+    }
+
+    for (unsigned i = 0; i < SC_LOG_RING_COUNT; ++i) {
+        ring = &logger.rings[i];
+        int expected = SC_LOG_RING_FREE;
+        if (atomic_compare_exchange_strong(&ring->state, &expected,
+                                           SC_LOG_RING_USED)) {
+            // A free ring is empty (head == tail)
+            unsigned number =
+                atomic_fetch_add_explicit(&logger.thread_count, 1,
+                                          memory_order_relaxed) + 1;
+            atomic_store_explicit(&ring->thread_number, number,
+                                  memory_order_relaxed);
+
+            // Release the ring when the thread terminates (this allocates
+            // once per thread)
+            if (!sc_log_tls_set(ring)) {
+                sc_log_release_ring(ring);
+                return NULL;
+            }
+            return ring;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+sc_log_write(SDL_LogPriority priority, const char *msg, size_t len) {
+    sc_tick now = sc_tick_now();
+
+    // Register as a writer before reading the async flag (sequentially
+    // consistent): sc_log_stop_async() waits for the writers which read it as
+    // set, so that their records are flushed
+    atomic_fetch_add(&logger.writers, 1);
+    if (atomic_load(&logger.async)) {
+        struct sc_log_ring *ring = sc_log_get_thread_ring();
+        if (ring) {
+            sc_log_ring_push(ring, priority, now, msg, len);
+            atomic_fetch_sub_explicit(&logger.writers, 1,
+                                      memory_order_release);
+            return;
+        }
+        // Too many threads, fallback to synchronous logging
+    }
+    atomic_fetch_sub_explicit(&logger.writers, 1, memory_order_release);
+
+    sc_log_print(priority, now, 0, msg, len);
+}
+
+static void
+sc_log_vwrite(SDL_LogPriority priority, const char *fmt, va_list ap) {
+    char msg[SC_LOG_MESSAGE_MAX];
+    int len = vsnprintf(msg, sizeof(msg), fmt, ap);
+    if (len < 0) {
+        return;
+    }
+
+    sc_log_write(priority, msg, MIN((size_t) len, sizeof(msg) - 1));
+}
+
 void
 sc_log(enum sc_log_level level, const char *fmt, ...) {
-    SDL_LogPriority sdl_level = log_level_sc_to_sdl(level);
+    SDL_LogPriority priority = log_level_sc_to_sdl(level);
+    if (priority < logger.priority) {
+        return;
+    }
 
     va_list ap;
     va_start(ap, fmt);
-    SDL_LogMessageV(SDL_LOG_CATEGORY_APPLICATION, sdl_level, fmt, ap);
+    sc_log_vwrite(priority, fmt, ap);
     va_end(ap);
 }
 
@@ -116,42 +437,192 @@ sc_av_log_callback(void *avcl, int level, const char *fmt, va_list vl) {
         return;
     }
 
-    size_t fmt_len = strlen(fmt);
-    char *local_fmt = malloc(fmt_len + 10);
-    if (!local_fmt) {
-        LOG_OOM();
+    if (priority < logger.priority) {
         return;
     }
-    memcpy(local_fmt, "[FFmpeg] ", 9); // do not write the final '\0'
-    memcpy(local_fmt + 9, fmt, fmt_len + 1); // include '\0'
-    SDL_LogMessageV(SDL_LOG_CATEGORY_CUSTOM, priority, local_fmt, vl);
-    free(local_fmt);
-}
 
-static const char *const sc_sdl_log_priority_names[SDL_NUM_LOG_PRIORITIES] = {
-    [SDL_LOG_PRIORITY_VERBOSE] = "VERBOSE",
-    [SDL_LOG_PRIORITY_DEBUG] = "DEBUG",
-    [SDL_LOG_PRIORITY_INFO] = "INFO",
-    [SDL_LOG_PRIORITY_WARN] = "WARN",
-    [SDL_LOG_PRIORITY_ERROR] = "ERROR",
-    [SDL_LOG_PRIORITY_CRITICAL] = "CRITICAL",
-};
+    char local_fmt[SC_LOG_MESSAGE_MAX];
+    int len = snprintf(local_fmt, sizeof(local_fmt), "[FFmpeg] %s", fmt);
+    if (len < 0 || (size_t) len >= sizeof(local_fmt)) {
+        return;
+    }
+    sc_log_vwrite(priority, local_fmt, vl);
+}
 
+// Output function for the SDL logs (already filtered by SDL)
 static void SDLCALL
 sc_sdl_log_print(void *userdata, int category, SDL_LogPriority priority,
                  const char *message) {
     (void) userdata;
     (void) category;
 
-    FILE *out = priority < SDL_LOG_PRIORITY_WARN ? stdout : stderr;
-    assert(priority < SDL_NUM_LOG_PRIORITIES);
-    const char *prio_name = sc_sdl_log_priority_names[priority];
-    fprintf(out, "%s: %s\n", prio_name, message);
+    sc_log_write(priority, message, strlen(message));
 }
 
 void
 sc_log_configure(void) {
+    logger.epoch = sc_tick_now();
+    logger.decorate = logger.priority <= SDL_LOG_PRIORITY_DEBUG;
+
     SDL_LogSetOutputFunction(sc_sdl_log_print, NULL);
     // Redirect FFmpeg logs to SDL logs
     av_log_set_callback(sc_av_log_callback);
 }
+
+static void
+sc_log_report_dropped(struct sc_log_ring *ring) {
+    unsigned dropped = atomic_exchange_explicit(&ring->dropped, 0,
+                                                memory_order_relaxed);
+    if (dropped) {
+        char msg[64];
+        int len = snprintf(msg, sizeof(msg), "%u log line(s) dropped",
+                           dropped);
+        assert(len > 0 && (size_t) len < sizeof(msg));
+        unsigned number = atomic_load_explicit(&ring->thread_number,
+                                               memory_order_relaxed);
+        sc_log_print(SDL_LOG_PRIORITY_WARN, sc_tick_now(), number, msg, len);
+    }
+}
+
+// Write all the pending records, in timestamp order
+static void
+sc_log_flush(void) {
+    bool written = false;
+
+    for (;;) {
+        struct sc_log_ring *next = NULL;
+        struct sc_log_record next_record;
+        const char *next_msg = NULL;
+
+        for (unsigned i = 0; i < SC_LOG_RING_COUNT; ++i) {
+            struct sc_log_ring *ring = &logger.rings[i];
+            int state = atomic_load_explicit(&ring->state,
+                                             memory_order_acquire);
+            if (state == SC_LOG_RING_FREE) {
+                continue;
+            }
+
+            struct sc_log_record record;
+            const char *msg = sc_log_ring_peek(ring, &record);
+            if (!msg) {
+                sc_log_report_dropped(ring);
+                if (state == SC_LOG_RING_RELEASED) {
+                    // Drained, it may be reused by another thread
+                    atomic_store_explicit(&ring->state, SC_LOG_RING_FREE,
+                                          memory_order_release);
+                }
+                continue;
+            }
+
+            if (!next || record.timestamp < next_record.timestamp) {
+                next = ring;
+                next_record = record;
+                next_msg = msg;
+            }
+        }
+
+        if (!next) {
+            break;
+        }
+
+        unsigned number = atomic_load_explicit(&next->thread_number,
+                                               memory_order_relaxed);
+        sc_log_print(next_record.priority, next_record.timestamp, number,
+                     next_msg, next_record.len);
+        sc_log_ring_pop(next, &next_record);
+        written = true;
+    }
+
+    if (written) {
+        fflush(stdout);
+    }
+}
+
+static int
+run_log_flusher(void *data) {
+    (void) data;
+
+    sc_mutex_lock(&logger.mutex);
+    while (!logger.stopped) {
+        sc_mutex_unlock(&logger.mutex);
+        sc_log_flush();
+        sc_mutex_lock(&logger.mutex);
+
+        sc_tick deadline = sc_tick_now() + SC_LOG_FLUSH_INTERVAL;
+        while (!logger.stopped && sc_tick_now() < deadline) {
+            sc_cond_timedwait(&logger.cond, &logger.mutex, deadline);
+        }
+    }
+    sc_mutex_unlock(&logger.mutex);
+
+    // Flush the last records
+    sc_log_flush();
+
+    return 0;
+}
+
+bool
+sc_log_start_async(void) {
+    assert(!atomic_load(&logger.async));
+
+    if (!sc_log_tls_init()) {
+        LOGW("Could not create thread local storage");
+        return false;
+    }
+
+    if (!sc_mutex_init(&logger.mutex)) {
+        return false;
+    }
+
+    if (!sc_cond_init(&logger.cond)) {
+        goto error_destroy_mutex;
+    }
+
+    logger.stopped = false;
+
+    bool ok = sc_thread_create(&logger.thread, run_log_flusher, "scrcpy-log",
+                               NULL);
+    if (!ok) {
+        LOGW("Could not start log flusher");
+        goto error_destroy_cond;
+    }
+
+    atomic_store(&logger.async, true);
+
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&logger.cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&logger.mutex);
+
+    return false;
+}
+
+void
+sc_log_stop_async(void) {
+    if (!atomic_load(&logger.async)) {
+        // Not started
+        return;
+    }
+
+    // The next logs are written synchronously
+    atomic_store(&logger.async, false);
+
+    // Wait for the writers which may still push to their ring (they never
+    // block, except to register their ring)
+    while (atomic_load_explicit(&logger.writers, memory_order_acquire)) {
+        SDL_Delay(1);
+    }
+
+    sc_mutex_lock(&logger.mutex);
+    logger.stopped = true;
+    sc_cond_signal(&logger.cond);
+    sc_mutex_unlock(&logger.mutex);
+
+    // The flusher writes the last records before terminating
+    sc_thread_join(&logger.thread, NULL);
+
+    sc_cond_destroy(&logger.cond);
+    sc_mutex_destroy(&logger.mutex);
+}
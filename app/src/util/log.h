@@ -10,11 +10,11 @@
 #define LOG_STR_IMPL_(x) # x
 #define LOG_STR(x) LOG_STR_IMPL_(x)
 
-#define LOGV(...) SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGD(...) SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGI(...) SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGW(...) SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGE(...) SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
+#define LOGV(...) sc_log(SC_LOG_LEVEL_VERBOSE, __VA_ARGS__)
+#define LOGD(...) sc_log(SC_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOGI(...) sc_log(SC_LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOGW(...) sc_log(SC_LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOGE(...) sc_log(SC_LOG_LEVEL_ERROR, __VA_ARGS__)
 
 #define LOG_OOM() \
     LOGE("OOM: %s:%d %s()", __FILE__, __LINE__, __func__)
@@ -25,8 +25,18 @@ sc_set_log_level(enum sc_log_level level);
 enum sc_log_level
 sc_get_log_level(void);
 
+/**
+ * Log a message
+ *
+ * Once sc_log_start_async() is called, the message is formatted by the
+ * calling thread into its own ring buffer, and written by a separate thread:
+ * this never blocks (except for the first message of each thread, which
+ * registers its ring buffer). If the ring buffer is full, the message is
+ * dropped (the number of dropped messages is logged).
+ */
 void
-sc_log(enum sc_log_level level, const char *fmt, ...);
+sc_log(enum sc_log_level level, SDL_PRINTF_FORMAT_STRING const char *fmt, ...)
+    SDL_PRINTF_VARARG_FUNC(2);
 #define LOG(LEVEL, ...) sc_log((LEVEL), __VA_ARGS__)
 
 #ifdef _WIN32
@@ -38,4 +48,12 @@ sc_log_windows_error(const char *prefix, int error);
 void
 sc_log_configure(void);
 
+// If this function fails, the logs are written synchronously
+bool
+sc_log_start_async(void);
+
+// Write the pending logs, the next logs are written synchronously
+void
+sc_log_stop_async(void);
+
 #endif
@@ -1,6 +1,7 @@
 #include "net.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 
 #ifdef _WIN32
@@ -12,7 +13,9 @@
 # include <netinet/in.h>
 # include <netinet/tcp.h>
 # include <unistd.h>
+# include <sys/select.h>
 # include <sys/socket.h>
+# include <sys/time.h>
 # include <sys/types.h>
 # define SOCKET_ERROR -1
   typedef struct sockaddr_in SOCKADDR_IN;
@@ -199,6 +202,15 @@ net_accept(sc_socket server_socket) {
     }
 #endif
 
+#ifdef SO_NOSIGPIPE
+    // MSG_NOSIGNAL is not available on macOS
+    if (raw_sock != SC_RAW_SOCKET_NONE) {
+        int nosigpipe = 1;
+        setsockopt(raw_sock, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe,
+                   sizeof(nosigpipe));
+    }
+#endif
+
     return wrap(raw_sock);
 }
 
@@ -217,7 +229,12 @@ net_recv_all(sc_socket socket, void *buf, size_t len) {
 ssize_t
 net_send(sc_socket socket, const void *buf, size_t len) {
     sc_raw_socket raw_sock = unwrap(socket);
+#ifdef MSG_NOSIGNAL
+    // Do not raise SIGPIPE if the peer closed the connection
+    return send(raw_sock, buf, len, MSG_NOSIGNAL);
+#else
     return send(raw_sock, buf, len, 0);
+#endif
 }
 
 ssize_t
@@ -235,6 +252,57 @@ net_send_all(sc_socket socket, const void *buf, size_t len) {
     return copied;
 }
 
+bool
+net_wait_readable(const sc_socket *sockets, bool *ready, unsigned count,
+                  bool block) {
+    assert(count);
+
+#ifdef _WIN32
+    // On Windows, an fd_set is an array of at most FD_SETSIZE sockets
+    if (count > FD_SETSIZE) {
+        LOGE("Too many sockets for select(): %u", count);
+        return false;
+    }
+#endif
+
+    fd_set fds;
+    FD_ZERO(&fds);
+
+    sc_raw_socket max = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        sc_raw_socket raw_sock = unwrap(sockets[i]);
+#ifndef _WIN32
+        if (raw_sock >= FD_SETSIZE) {
+            LOGE("Socket %d out of select() range", raw_sock);
+            return false;
+        }
+#endif
+        FD_SET(raw_sock, &fds);
+        max = MAX(max, raw_sock);
+    }
+
+    struct timeval zero = {0};
+    int r;
+    do {
+        // The first argument is ignored on Windows
+        r = select((int) max + 1, &fds, NULL, NULL, block ? NULL : &zero);
+#ifndef _WIN32
+    } while (r == -1 && errno == EINTR);
+#else
+    } while (false);
+#endif
+    if (r == SOCKET_ERROR) {
+        net_perror("select");
+        return false;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        ready[i] = FD_ISSET(unwrap(sockets[i]), &fds);
+    }
+
+    return true;
+}
+
 bool
 net_interrupt(sc_socket socket) {
     assert(socket != SC_SOCKET_NONE);
@@ -283,6 +351,30 @@ net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay) {
     return true;
 }
 
+bool
+net_set_recv_timeout(sc_socket socket, sc_tick timeout) {
+    assert(timeout > 0);
+    sc_raw_socket raw_sock = unwrap(socket);
+
+#ifdef _WIN32
+    DWORD value = SC_TICK_TO_MS(timeout + SC_TICK_FROM_MS(1) - 1);
+#else
+    struct timeval value = {
+        .tv_sec = timeout / SC_TICK_FREQ,
+        .tv_usec = timeout % SC_TICK_FREQ,
+    };
+#endif
+    int ret = setsockopt(raw_sock, SOL_SOCKET, SO_RCVTIMEO,
+                         (const void *) &value, sizeof(value));
+    if (ret == -1) {
+        net_perror("setsockopt(SO_RCVTIMEO)");
+        return false;
+    }
+
+    assert(ret == 0);
+    return true;
+}
+
 bool
 net_parse_ipv4(const char *s, uint32_t *ipv4) {
     struct in_addr addr;
@@ -8,6 +8,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include "util/tick.h"
+
 #ifdef _WIN32
 # include <winsock2.h>
   typedef SOCKET sc_raw_socket;
@@ -73,6 +75,13 @@ net_send(sc_socket socket, const void *buf, size_t len);
 ssize_t
 net_send_all(sc_socket socket, const void *buf, size_t len);
 
+// Wait until at least one of the sockets is readable (data available,
+// end-of-stream or error), and set ready[i] accordingly for each socket.
+// If block is false, return immediately.
+bool
+net_wait_readable(const sc_socket *sockets, bool *ready, unsigned count,
+                  bool block);
+
 // Shutdown the socket (or close on Windows) so that any blocking send() or
 // recv() are interrupted.
 bool
@@ -87,6 +96,10 @@ net_close(sc_socket socket);
 bool
 net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay);
 
+// Make the next recv() calls fail if no data is received within timeout
+bool
+net_set_recv_timeout(sc_socket socket, sc_tick timeout);
+
 /**
  * Parse `ip` "xxx.xxx.xxx.xxx" to an IPv4 host representation
  */
@@ -0,0 +1,206 @@
+#include "net_unix.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "util/log.h"
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+bool
+net_unix_listen(struct sc_unix_listener *listener, const char *path,
+                int backlog, const char *name) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    size_t len = strlen(path);
+    if (len >= sizeof(addr.sun_path)) {
+        LOGE("The %s socket path is too long: %s", name, path);
+        return false;
+    }
+    memcpy(addr.sun_path, path, len + 1);
+
+    // Remove a stale socket from a previous session (but never remove any
+    // other kind of file)
+    struct stat st;
+    if (!lstat(path, &st) && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    listener->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener->fd == -1) {
+        LOGE("Could not create %s socket: %s", name, strerror(errno));
+        return false;
+    }
+
+    // Restrict the socket to the current user (do not change the umask, it is
+    // process-wide)
+#ifdef __linux__
+    // On Linux, bind() creates the file with the mode of the socket inode
+    if (fchmod(listener->fd, 0600) == -1) {
+        LOGE("Could not set %s socket permissions: %s", name,
+             strerror(errno));
+        goto error_close;
+    }
+#endif
+
+    if (bind(listener->fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        LOGE("Could not bind %s socket %s: %s", name, path, strerror(errno));
+        goto error_close;
+    }
+
+#ifndef __linux__
+    // Other users could not connect in between: the socket is not listening
+    // yet
+    if (chmod(path, 0600) == -1) {
+        LOGE("Could not set %s socket permissions: %s", name,
+             strerror(errno));
+        goto error_unlink;
+    }
+#endif
+
+    if (listen(listener->fd, backlog) == -1) {
+        LOGE("Could not listen on %s socket: %s", name, strerror(errno));
+        goto error_unlink;
+    }
+
+    if (pipe(listener->interrupt_pipe) == -1) {
+        LOGE("Could not create pipe: %s", strerror(errno));
+        goto error_unlink;
+    }
+
+    listener->path = path;
+    listener->name = name;
+
+    return true;
+
+error_unlink:
+    unlink(path);
+error_close:
+    close(listener->fd);
+
+    return false;
+}
+
+bool
+net_unix_wait_readable(struct sc_unix_listener *listener, int fd,
+                       sc_tick deadline, bool *blocked) {
+    struct pollfd fds[2] = {
+        {.fd = fd, .events = POLLIN},
+        {.fd = listener->interrupt_pipe[0], .events = POLLIN},
+    };
+
+    if (blocked) {
+        *blocked = false;
+    }
+
+    // Poll without waiting first, to know if fd was immediately readable
+    bool wait = false;
+    for (;;) {
+        int timeout = 0;
+        if (wait) {
+            timeout = -1;
+            if (deadline) {
+                sc_tick now = sc_tick_now();
+                if (now >= deadline) {
+                    return false;
+                }
+                // Round up, so that the deadline is reached on timeout
+                timeout =
+                    SC_TICK_TO_MS(deadline - now + SC_TICK_FROM_MS(1) - 1);
+            }
+        }
+
+        int r = poll(fds, 2, timeout);
+        if (r == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("The %s socket poll failed: %s", listener->name,
+                 strerror(errno));
+            return false;
+        }
+
+        if (!r) {
+            if (!wait && blocked) {
+                *blocked = true;
+            }
+            // Wait (again, on timeout the deadline is checked)
+            wait = true;
+            continue;
+        }
+
+        // Interrupted if fds[1] is readable
+        return !fds[1].revents;
+    }
+}
+
+int
+net_unix_accept(struct sc_unix_listener *listener) {
+    for (;;) {
+        if (!net_unix_wait_readable(listener, listener->fd, 0, NULL)) {
+            return -1;
+        }
+
+        int fd = accept(listener->fd, NULL, NULL);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            LOGE("The %s socket accept failed: %s", listener->name,
+                 strerror(errno));
+            return -1;
+        }
+
+#ifdef SO_NOSIGPIPE
+        // MSG_NOSIGNAL is not available on macOS
+        int nosigpipe = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe,
+                   sizeof(nosigpipe));
+#endif
+
+        return fd;
+    }
+}
+
+bool
+net_unix_send_all(int fd, const void *buf, size_t len) {
+    const char *data = buf;
+    while (len) {
+        ssize_t w = send(fd, data, len, MSG_NOSIGNAL);
+        if (w == -1 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            return false;
+        }
+        data += w;
+        len -= w;
+    }
+
+    return true;
+}
+
+void
+net_unix_interrupt(struct sc_unix_listener *listener) {
+    // Wake up poll()
+    ssize_t w = write(listener->interrupt_pipe[1], "", 1);
+    (void) w;
+}
+
+void
+net_unix_close(struct sc_unix_listener *listener) {
+    close(listener->interrupt_pipe[0]);
+    close(listener->interrupt_pipe[1]);
+    close(listener->fd);
+    unlink(listener->path);
+}
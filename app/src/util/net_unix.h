@@ -0,0 +1,75 @@
+#ifndef SC_NET_UNIX_H
+#define SC_NET_UNIX_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/tick.h"
+
+/**
+ * Local Unix-domain socket listening for clients (not available on Windows)
+ *
+ * The socket file is only accessible by the current user. Any blocking wait
+ * (for a client or for data from a client) is interrupted by
+ * net_unix_interrupt(), from any thread.
+ */
+struct sc_unix_listener {
+    const char *path;
+    const char *name; // for the logs, e.g. "relay"
+    int fd;
+    // written on interrupt to wake up poll()
+    int interrupt_pipe[2];
+};
+
+/**
+ * Create the socket file at path (replacing a stale socket from a previous
+ * session), and listen on it
+ *
+ * The path and the name must outlive the listener.
+ */
+bool
+net_unix_listen(struct sc_unix_listener *listener, const char *path,
+                int backlog, const char *name);
+
+/**
+ * Wait for a client and accept it
+ *
+ * Return the client socket (which never raises SIGPIPE on send), or -1 on
+ * interruption or error.
+ */
+int
+net_unix_accept(struct sc_unix_listener *listener);
+
+/**
+ * Wait until fd (typically a client socket) is readable
+ *
+ * If deadline is not 0, stop waiting once it is reached.
+ *
+ * If blocked is not NULL, it is set to true if fd was not immediately
+ * readable.
+ *
+ * Return false on interruption, timeout or error.
+ */
+bool
+net_unix_wait_readable(struct sc_unix_listener *listener, int fd,
+                       sc_tick deadline, bool *blocked);
+
+/**
+ * Send all the data to a client socket, without raising SIGPIPE
+ *
+ * Return false if the client is disconnected.
+ */
+bool
+net_unix_send_all(int fd, const void *buf, size_t len);
+
+// Wake up any blocking net_unix_accept() or net_unix_wait_readable()
+void
+net_unix_interrupt(struct sc_unix_listener *listener);
+
+// Close the socket and remove the socket file
+void
+net_unix_close(struct sc_unix_listener *listener);
+
+#endif
@@ -0,0 +1,40 @@
+#include "pcm.h"
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+# define SC_PCM_SSE2
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+# define SC_PCM_NEON
+#endif
+
+#define SC_PCM_S16_SCALE (1.0f / 32768)
+
+void
+sc_pcm_s16_to_f32(float *dst, const int16_t *src, size_t count) {
+    size_t i = 0;
+#if defined(SC_PCM_SSE2)
+    __m128 scale = _mm_set1_ps(SC_PCM_S16_SCALE);
+    for (; i + 8 <= count; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        // Sign-extend to 32 bits: move each value to the upper half, then
+        // shift it back arithmetically
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(SC_PCM_NEON)
+    float32x4_t scale = vdupq_n_f32(SC_PCM_S16_SCALE);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t s = vld1q_s16(src + i);
+        int32x4_t lo = vmovl_s16(vget_low_s16(s));
+        int32x4_t hi = vmovl_s16(vget_high_s16(s));
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(lo), scale));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(hi), scale));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = src[i] * SC_PCM_S16_SCALE;
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef SC_PCM_H
+#define SC_PCM_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Convert signed 16-bit samples to 32-bit float samples in [-1, 1)
+ *
+ * The result is the same as libswresample (x / 32768).
+ *
+ * The conversion uses SIMD instructions when available (SSE2 or NEON).
+ */
+void
+sc_pcm_s16_to_f32(float *dst, const int16_t *src, size_t count);
+
+#endif
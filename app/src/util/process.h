@@ -5,6 +5,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "util/thread.h"
 #include "util/tick.h"
 
@@ -138,6 +139,14 @@ sc_pipe_read_all(sc_pipe pipe, char *data, size_t len);
 void
 sc_pipe_close(sc_pipe pipe);
 
+/**
+ * Get the resident memory size of the current process, in bytes
+ *
+ * Return false if it is not available on this platform.
+ */
+bool
+sc_process_get_rss(uint64_t *rss);
+
 /**
  * Start observing process
  *
@@ -377,4 +377,27 @@ sc_vecdeque_growsize_(size_t value)
 #define sc_vecdeque_pop(pv) \
     (*sc_vecdeque_popref(pv))
 
+/**
+ * Return a pointer to the first item without removing it
+ *
+ * It is an error to call this function if the VecDeque is empty.
+ */
+#define sc_vecdeque_peekref(pv) \
+({ \
+    assert(!sc_vecdeque_is_empty(pv)); \
+    &(pv)->data[(pv)->origin]; \
+})
+
+/**
+ * Return a pointer to the item at the given index (0 is the first item),
+ * without removing it
+ *
+ * It is an error to call this function with an index out of bounds.
+ */
+#define sc_vecdeque_getref(pv, index) \
+({ \
+    assert((index) < (pv)->size); \
+    &(pv)->data[((pv)->origin + (index)) % (pv)->cap]; \
+})
+
 #endif
@@ -0,0 +1,191 @@
+#include "yuv.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+# define SC_YUV_SSE2
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+# define SC_YUV_NEON
+#endif
+
+void
+sc_yuv_copy_plane(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                  size_t src_stride, unsigned width, unsigned height) {
+    if (dst_stride == src_stride && dst_stride == width) {
+        // Contiguous
+        memcpy(dst, src, (size_t) width * height);
+        return;
+    }
+
+    for (unsigned i = 0; i < height; ++i) {
+        memcpy(dst, src, width);
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+// Interleave n bytes of u and v into uv (2 * n bytes)
+static void
+sc_yuv_interleave_uv(uint8_t *uv, const uint8_t *u, const uint8_t *v,
+                     unsigned n) {
+    unsigned i = 0;
+#if defined(SC_YUV_SSE2)
+    for (; i + 16 <= n; i += 16) {
+        __m128i u16 = _mm_loadu_si128((const __m128i *) (u + i));
+        __m128i v16 = _mm_loadu_si128((const __m128i *) (v + i));
+        _mm_storeu_si128((__m128i *) (uv + 2 * i),
+                         _mm_unpacklo_epi8(u16, v16));
+        _mm_storeu_si128((__m128i *) (uv + 2 * i + 16),
+                         _mm_unpackhi_epi8(u16, v16));
+    }
+#elif defined(SC_YUV_NEON)
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x2_t out;
+        out.val[0] = vld1q_u8(u + i);
+        out.val[1] = vld1q_u8(v + i);
+        vst2q_u8(uv + 2 * i, out);
+    }
+#endif
+    for (; i < n; ++i) {
+        uv[2 * i] = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+}
+
+// Pack 2 * n bytes of y, and n bytes of u and v into yuyv (4 * n bytes)
+static void
+sc_yuv_pack_yuyv(uint8_t *yuyv, const uint8_t *y, const uint8_t *u,
+                 const uint8_t *v, unsigned n) {
+    unsigned i = 0;
+#if defined(SC_YUV_SSE2)
+    for (; i + 16 <= n; i += 16) {
+        __m128i y0 = _mm_loadu_si128((const __m128i *) (y + 2 * i));
+        __m128i y1 = _mm_loadu_si128((const __m128i *) (y + 2 * i + 16));
+        __m128i u16 = _mm_loadu_si128((const __m128i *) (u + i));
+        __m128i v16 = _mm_loadu_si128((const __m128i *) (v + i));
+        __m128i uv0 = _mm_unpacklo_epi8(u16, v16);
+        __m128i uv1 = _mm_unpackhi_epi8(u16, v16);
+        __m128i *out = (__m128i *) (yuyv + 4 * i);
+        _mm_storeu_si128(out, _mm_unpacklo_epi8(y0, uv0));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(y0, uv0));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi8(y1, uv1));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi8(y1, uv1));
+    }
+#elif defined(SC_YUV_NEON)
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x2_t y8 = vld2_u8(y + 2 * i); // even and odd pixels
+        uint8x8x4_t out;
+        out.val[0] = y8.val[0];
+        out.val[1] = vld1_u8(u + i);
+        out.val[2] = y8.val[1];
+        out.val[3] = vld1_u8(v + i);
+        vst4_u8(yuyv + 4 * i, out);
+    }
+#endif
+    for (; i < n; ++i) {
+        yuyv[4 * i] = y[2 * i];
+        yuyv[4 * i + 1] = u[i];
+        yuyv[4 * i + 2] = y[2 * i + 1];
+        yuyv[4 * i + 3] = v[i];
+    }
+}
+
+void
+sc_yuv420p_to_nv12(uint8_t *dst_y, size_t dst_y_stride, uint8_t *dst_uv,
+                   size_t dst_uv_stride, const uint8_t *const src[3],
+                   const int src_stride[3], unsigned width, unsigned height) {
+    sc_yuv_copy_plane(dst_y, dst_y_stride, src[0], src_stride[0], width,
+                      height);
+
+    unsigned chroma_width = (width + 1) / 2;
+    unsigned chroma_height = (height + 1) / 2;
+    for (unsigned i = 0; i < chroma_height; ++i) {
+        sc_yuv_interleave_uv(dst_uv + i * dst_uv_stride,
+                             src[1] + i * src_stride[1],
+                             src[2] + i * src_stride[2], chroma_width);
+    }
+}
+
+void
+sc_yuv420p_to_yuyv(uint8_t *dst, size_t dst_stride,
+                   const uint8_t *const src[3], const int src_stride[3],
+                   unsigned width, unsigned height) {
+    // YUYV encodes pixels by pairs, the last column of an odd width is dropped
+    unsigned pairs = width / 2;
+    for (unsigned i = 0; i < height; ++i) {
+        sc_yuv_pack_yuyv(dst + i * dst_stride,
+                         src[0] + i * src_stride[0],
+                         src[1] + (i / 2) * src_stride[1],
+                         src[2] + (i / 2) * src_stride[2], pairs);
+    }
+}
+
+void
+sc_yuv_orient_plane(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                    size_t src_stride, unsigned src_width, unsigned src_height,
+                    unsigned rotation, bool hflip) {
+    assert(rotation < 4);
+
+    if (!rotation && !hflip) {
+        sc_yuv_copy_plane(dst, dst_stride, src, src_stride, src_width,
+                          src_height);
+        return;
+    }
+
+    bool swap = rotation & 1;
+    unsigned dst_width = swap ? src_height : src_width;
+    unsigned dst_height = swap ? src_width : src_height;
+
+    // The source position of the destination pixel (dx, dy) is:
+    //     sx = sx0 + dx * sx_dx + dy * sx_dy
+    //     sy = sy0 + dx * sy_dx + dy * sy_dy
+    ptrdiff_t sx0 = 0;
+    ptrdiff_t sy0 = 0;
+    ptrdiff_t sx_dx = 0;
+    ptrdiff_t sx_dy = 0;
+    ptrdiff_t sy_dx = 0;
+    ptrdiff_t sy_dy = 0;
+    switch (rotation) {
+        case 0:
+            sx_dx = 1;
+            sy_dy = 1;
+            break;
+        case 1: // 90° clockwise
+            sy0 = src_height - 1;
+            sx_dy = 1;
+            sy_dx = -1;
+            break;
+        case 2:
+            sx0 = src_width - 1;
+            sy0 = src_height - 1;
+            sx_dx = -1;
+            sy_dy = -1;
+            break;
+        default: // 270° clockwise
+            sx0 = src_width - 1;
+            sx_dy = -1;
+            sy_dx = 1;
+            break;
+    }
+
+    if (hflip) {
+        // The flip is applied before the rotation: sx -> src_width - 1 - sx
+        sx0 = src_width - 1 - sx0;
+        sx_dx = -sx_dx;
+        sx_dy = -sx_dy;
+    }
+
+    ptrdiff_t step = sx_dx + sy_dx * (ptrdiff_t) src_stride;
+    for (ptrdiff_t dy = 0; dy < dst_height; ++dy) {
+        const uint8_t *s = src + sx0 + dy * sx_dy
+                         + (sy0 + dy * sy_dy) * (ptrdiff_t) src_stride;
+        uint8_t *d = dst + dy * dst_stride;
+        for (unsigned dx = 0; dx < dst_width; ++dx) {
+            d[dx] = *s;
+            s += step;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef SC_YUV_H
+#define SC_YUV_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Pixel format conversions from planar YUV 4:2:0 (the format of the decoded
+ * frames).
+ *
+ * The source planes are given as src[0] (Y), src[1] (U) and src[2] (V), with
+ * their line sizes (in bytes). The width and height are in pixels.
+ *
+ * The conversions use SIMD instructions when available (SSE2 or NEON).
+ */
+
+/**
+ * Copy a plane of width bytes per line
+ */
+void
+sc_yuv_copy_plane(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                  size_t src_stride, unsigned width, unsigned height);
+
+/**
+ * Convert to NV12 (a Y plane, then an interleaved UV plane)
+ */
+void
+sc_yuv420p_to_nv12(uint8_t *dst_y, size_t dst_y_stride, uint8_t *dst_uv,
+                   size_t dst_uv_stride, const uint8_t *const src[3],
+                   const int src_stride[3], unsigned width, unsigned height);
+
+/**
+ * Convert to YUYV (packed 4:2:2, each chroma line being used twice)
+ */
+void
+sc_yuv420p_to_yuyv(uint8_t *dst, size_t dst_stride,
+                   const uint8_t *const src[3], const int src_stride[3],
+                   unsigned width, unsigned height);
+
+/**
+ * Copy a plane of src_width x src_height bytes, rotated by rotation quarter
+ * turns clockwise (0 to 3), after an optional horizontal flip
+ *
+ * The destination size is src_height x src_width if rotation is odd.
+ */
+void
+sc_yuv_orient_plane(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                    size_t src_stride, unsigned src_width, unsigned src_height,
+                    unsigned rotation, bool hflip);
+
+#endif
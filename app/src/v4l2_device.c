@@ -0,0 +1,431 @@
+#include "v4l2_device.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+#include "util/log.h"
+#include "util/yuv.h"
+
+static int
+sc_v4l2_sys_open(const char *path, int flags) {
+    return open(path, flags);
+}
+
+static int
+sc_v4l2_sys_ioctl(int fd, unsigned long request, void *arg) {
+    return ioctl(fd, request, arg);
+}
+
+const struct sc_v4l2_io_ops sc_v4l2_io_sys = {
+    .open = sc_v4l2_sys_open,
+    .close = close,
+    .ioctl = sc_v4l2_sys_ioctl,
+    .mmap = mmap,
+    .munmap = munmap,
+    .write = write,
+};
+
+static int
+sc_v4l2_ioctl(struct sc_v4l2_device *dev, unsigned long request, void *arg) {
+    int r;
+    do {
+        r = dev->io->ioctl(dev->fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+static uint32_t
+sc_v4l2_get_pixelformat(enum sc_v4l2_format format) {
+    switch (format) {
+        case SC_V4L2_FORMAT_YUV420:
+            return V4L2_PIX_FMT_YUV420;
+        case SC_V4L2_FORMAT_NV12:
+            return V4L2_PIX_FMT_NV12;
+        case SC_V4L2_FORMAT_YUYV:
+            return V4L2_PIX_FMT_YUYV;
+        default:
+            assert(!"unexpected format");
+            return 0;
+    }
+}
+
+static const char *
+sc_v4l2_get_format_name(enum sc_v4l2_format format) {
+    switch (format) {
+        case SC_V4L2_FORMAT_YUV420:
+            return "yuv420";
+        case SC_V4L2_FORMAT_NV12:
+            return "nv12";
+        case SC_V4L2_FORMAT_YUYV:
+            return "yuyv";
+        default:
+            assert(!"unexpected format");
+            return NULL;
+    }
+}
+
+// Minimal image size for the given line size
+static size_t
+sc_v4l2_get_min_sizeimage(enum sc_v4l2_format format, uint32_t bytesperline,
+                          unsigned height) {
+    size_t chroma_height = (height + 1) / 2;
+    switch (format) {
+        case SC_V4L2_FORMAT_YUV420:
+            return (size_t) bytesperline * height
+                 + 2 * (size_t) (bytesperline / 2) * chroma_height;
+        case SC_V4L2_FORMAT_NV12:
+            return (size_t) bytesperline * (height + chroma_height);
+        case SC_V4L2_FORMAT_YUYV:
+            return (size_t) bytesperline * height;
+        default:
+            assert(!"unexpected format");
+            return 0;
+    }
+}
+
+bool
+sc_v4l2_device_open(struct sc_v4l2_device *dev,
+                    const struct sc_v4l2_io_ops *io, const char *path) {
+    dev->io = io;
+    dev->fd = io->open(path, O_RDWR);
+    if (dev->fd == -1) {
+        LOGE("Could not open V4L2 device %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    struct v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (sc_v4l2_ioctl(dev, VIDIOC_QUERYCAP, &cap) == -1) {
+        LOGE("%s is not a V4L2 device", path);
+        goto error_close;
+    }
+
+    uint32_t caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps
+                                                            : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_OUTPUT)) {
+        LOGE("%s is not a V4L2 video output device", path);
+        goto error_close;
+    }
+
+    dev->can_stream = caps & V4L2_CAP_STREAMING;
+    if (!dev->can_stream && !(caps & V4L2_CAP_READWRITE)) {
+        LOGE("%s supports neither streaming nor write() I/O", path);
+        goto error_close;
+    }
+
+    dev->configured = false;
+    dev->streaming = false;
+    dev->stream_on = false;
+    dev->buffer_count = 0;
+    dev->buffers_used = 0;
+    dev->write_buffer = NULL;
+
+    return true;
+
+error_close:
+    io->close(dev->fd);
+    return false;
+}
+
+static void
+sc_v4l2_device_release_buffers(struct sc_v4l2_device *dev) {
+    if (dev->stream_on) {
+        int type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        if (sc_v4l2_ioctl(dev, VIDIOC_STREAMOFF, &type) == -1) {
+            LOGW("Could not stop V4L2 streaming: %s", strerror(errno));
+        }
+        dev->stream_on = false;
+    }
+
+    for (unsigned i = 0; i < dev->buffer_count; ++i) {
+        struct sc_v4l2_mapped_buffer *buf = &dev->buffers[i];
+        dev->io->munmap(buf->data, buf->length);
+    }
+
+    if (dev->buffer_count) {
+        struct v4l2_requestbuffers req;
+        memset(&req, 0, sizeof(req));
+        req.count = 0;
+        req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        req.memory = V4L2_MEMORY_MMAP;
+        if (sc_v4l2_ioctl(dev, VIDIOC_REQBUFS, &req) == -1) {
+            LOGW("Could not release V4L2 buffers: %s", strerror(errno));
+        }
+        dev->buffer_count = 0;
+    }
+    dev->buffers_used = 0;
+
+    free(dev->write_buffer);
+    dev->write_buffer = NULL;
+
+    dev->streaming = false;
+}
+
+void
+sc_v4l2_device_close(struct sc_v4l2_device *dev) {
+    sc_v4l2_device_release_buffers(dev);
+    dev->io->close(dev->fd);
+}
+
+static bool
+sc_v4l2_device_map_buffers(struct sc_v4l2_device *dev) {
+    assert(!dev->buffer_count);
+
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = SC_V4L2_MAX_BUFFERS;
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (sc_v4l2_ioctl(dev, VIDIOC_REQBUFS, &req) == -1) {
+        LOGD("V4L2 mmap buffers not supported: %s", strerror(errno));
+        return false;
+    }
+
+    if (!req.count) {
+        LOGD("No V4L2 mmap buffer allocated");
+        return false;
+    }
+
+    unsigned count = MIN(req.count, SC_V4L2_MAX_BUFFERS);
+    for (unsigned i = 0; i < count; ++i) {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.index = i;
+        buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if (sc_v4l2_ioctl(dev, VIDIOC_QUERYBUF, &buf) == -1) {
+            LOGE("Could not query V4L2 buffer %u: %s", i, strerror(errno));
+            goto error;
+        }
+
+        if (buf.length < dev->sizeimage) {
+            LOGE("V4L2 buffer %u too small: %" PRIu32 " < %" PRIu32, i,
+                 buf.length, dev->sizeimage);
+            goto error;
+        }
+
+        void *data = dev->io->mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED, dev->fd, buf.m.offset);
+        if (data == MAP_FAILED) {
+            LOGE("Could not map V4L2 buffer %u: %s", i, strerror(errno));
+            goto error;
+        }
+
+        dev->buffers[i].data = data;
+        dev->buffers[i].length = buf.length;
+        // Increment progressively, so that only the mapped buffers are
+        // released on error
+        dev->buffer_count = i + 1;
+    }
+
+    dev->streaming = true;
+    return true;
+
+error:
+    sc_v4l2_device_release_buffers(dev);
+    return false;
+}
+
+bool
+sc_v4l2_device_configure(struct sc_v4l2_device *dev,
+                         enum sc_v4l2_format format, unsigned width,
+                         unsigned height) {
+    // All the formats subsample the chroma horizontally (YUYV encodes pixels
+    // by pairs, and the chroma lines of YUV420 and NV12 are half the luma
+    // lines), so an odd width would make the chroma lines overlap
+    width &= ~1;
+
+    if (dev->configured && dev->format == format && dev->width == width
+            && dev->height == height) {
+        // Nothing to do
+        return true;
+    }
+
+    // The buffers must be released before changing the format
+    sc_v4l2_device_release_buffers(dev);
+    dev->configured = false;
+
+    uint32_t pixelformat = sc_v4l2_get_pixelformat(format);
+
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    fmt.fmt.pix.width = width;
+    fmt.fmt.pix.height = height;
+    fmt.fmt.pix.pixelformat = pixelformat;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    if (sc_v4l2_ioctl(dev, VIDIOC_S_FMT, &fmt) == -1) {
+        LOGE("Could not set V4L2 format %s %ux%u: %s",
+             sc_v4l2_get_format_name(format), width, height, strerror(errno));
+        return false;
+    }
+
+    if (fmt.fmt.pix.pixelformat != pixelformat
+            || fmt.fmt.pix.width != width || fmt.fmt.pix.height != height) {
+        LOGE("V4L2 format %s %ux%u not supported by the device",
+             sc_v4l2_get_format_name(format), width, height);
+        return false;
+    }
+
+    unsigned min_bytesperline = format == SC_V4L2_FORMAT_YUYV ? 2 * width
+                                                              : width;
+    uint32_t bytesperline = MAX(fmt.fmt.pix.bytesperline, min_bytesperline);
+    size_t min_sizeimage =
+        sc_v4l2_get_min_sizeimage(format, bytesperline, height);
+    if (fmt.fmt.pix.sizeimage && fmt.fmt.pix.sizeimage < min_sizeimage) {
+        LOGE("Unexpected V4L2 image size: %" PRIu32 " < %zu",
+             fmt.fmt.pix.sizeimage, min_sizeimage);
+        return false;
+    }
+
+    dev->format = format;
+    dev->width = width;
+    dev->height = height;
+    dev->bytesperline = bytesperline;
+    dev->sizeimage = MAX(fmt.fmt.pix.sizeimage, min_sizeimage);
+
+    if (!dev->can_stream || !sc_v4l2_device_map_buffers(dev)) {
+        // Fallback to write()
+        dev->write_buffer = malloc(dev->sizeimage);
+        if (!dev->write_buffer) {
+            LOG_OOM();
+            return false;
+        }
+    }
+
+    LOGI("V4L2 output: %s %ux%u (%s)", sc_v4l2_get_format_name(format), width,
+         height, dev->streaming ? "mmap" : "write");
+
+    dev->configured = true;
+    return true;
+}
+
+static void
+sc_v4l2_device_convert(struct sc_v4l2_device *dev, uint8_t *dst,
+                       const AVFrame *frame) {
+    const uint8_t *const src[3] = {frame->data[0], frame->data[1],
+                                   frame->data[2]};
+    const int *src_stride = frame->linesize;
+
+    unsigned width = dev->width;
+    unsigned height = dev->height;
+    size_t stride = dev->bytesperline;
+    size_t y_size = stride * height;
+
+    switch (dev->format) {
+        case SC_V4L2_FORMAT_YUV420: {
+            unsigned cw = (width + 1) / 2;
+            unsigned ch = (height + 1) / 2;
+            size_t cstride = stride / 2;
+            uint8_t *dst_u = dst + y_size;
+            uint8_t *dst_v = dst_u + cstride * ch;
+            sc_yuv_copy_plane(dst, stride, src[0], src_stride[0], width,
+                              height);
+            sc_yuv_copy_plane(dst_u, cstride, src[1], src_stride[1], cw, ch);
+            sc_yuv_copy_plane(dst_v, cstride, src[2], src_stride[2], cw, ch);
+            break;
+        }
+        case SC_V4L2_FORMAT_NV12:
+            sc_yuv420p_to_nv12(dst, stride, dst + y_size, stride, src,
+                               src_stride, width, height);
+            break;
+        case SC_V4L2_FORMAT_YUYV:
+            sc_yuv420p_to_yuyv(dst, stride, src, src_stride, width, height);
+            break;
+        default:
+            assert(!"unexpected format");
+    }
+}
+
+static bool
+sc_v4l2_device_write_mmap(struct sc_v4l2_device *dev, const AVFrame *frame) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (dev->buffers_used < dev->buffer_count) {
+        // This buffer has never been queued
+        buf.index = dev->buffers_used++;
+    } else {
+        // Wait for a buffer to be released by the driver
+        if (sc_v4l2_ioctl(dev, VIDIOC_DQBUF, &buf) == -1) {
+            LOGE("Could not dequeue V4L2 buffer: %s", strerror(errno));
+            return false;
+        }
+        if (buf.index >= dev->buffer_count) {
+            LOGE("Unexpected V4L2 buffer index: %" PRIu32, buf.index);
+            return false;
+        }
+    }
+
+    sc_v4l2_device_convert(dev, dev->buffers[buf.index].data, frame);
+
+    buf.bytesused = dev->sizeimage;
+    buf.field = V4L2_FIELD_NONE;
+    buf.flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+    if (frame->pts != AV_NOPTS_VALUE) {
+        // The pts is in microseconds
+        buf.timestamp.tv_sec = frame->pts / 1000000;
+        buf.timestamp.tv_usec = frame->pts % 1000000;
+    }
+
+    if (sc_v4l2_ioctl(dev, VIDIOC_QBUF, &buf) == -1) {
+        LOGE("Could not queue V4L2 buffer: %s", strerror(errno));
+        return false;
+    }
+
+    if (!dev->stream_on) {
+        int type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        if (sc_v4l2_ioctl(dev, VIDIOC_STREAMON, &type) == -1) {
+            LOGE("Could not start V4L2 streaming: %s", strerror(errno));
+            return false;
+        }
+        dev->stream_on = true;
+    }
+
+    return true;
+}
+
+static bool
+sc_v4l2_device_write_io(struct sc_v4l2_device *dev, const AVFrame *frame) {
+    sc_v4l2_device_convert(dev, dev->write_buffer, frame);
+
+    size_t written = 0;
+    while (written < dev->sizeimage) {
+        ssize_t w = dev->io->write(dev->fd, dev->write_buffer + written,
+                                   dev->sizeimage - written);
+        if (w == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("Could not write to V4L2 device: %s", strerror(errno));
+            return false;
+        }
+        written += w;
+    }
+
+    return true;
+}
+
+bool
+sc_v4l2_device_write_frame(struct sc_v4l2_device *dev, const AVFrame *frame) {
+    assert(dev->configured);
+    assert(frame->format == AV_PIX_FMT_YUV420P);
+    assert((unsigned) frame->width >= dev->width);
+    assert((unsigned) frame->height >= dev->height);
+
+    if (dev->streaming) {
+        return sc_v4l2_device_write_mmap(dev, frame);
+    }
+
+    return sc_v4l2_device_write_io(dev, frame);
+}
@@ -0,0 +1,97 @@
+#ifndef SC_V4L2_DEVICE_H
+#define SC_V4L2_DEVICE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <libavutil/frame.h>
+
+#include "options.h"
+
+#define SC_V4L2_MAX_BUFFERS 4
+
+/**
+ * System calls used to access the device.
+ *
+ * They may be replaced by a fake implementation (to test without a
+ * v4l2loopback device).
+ */
+struct sc_v4l2_io_ops {
+    int (*open)(const char *path, int flags);
+    int (*close)(int fd);
+    int (*ioctl)(int fd, unsigned long request, void *arg);
+    void *(*mmap)(void *addr, size_t length, int prot, int flags, int fd,
+                  off_t offset);
+    int (*munmap)(void *addr, size_t length);
+    ssize_t (*write)(int fd, const void *buf, size_t count);
+};
+
+extern const struct sc_v4l2_io_ops sc_v4l2_io_sys;
+
+struct sc_v4l2_mapped_buffer {
+    uint8_t *data;
+    size_t length;
+};
+
+/**
+ * V4L2 video output device.
+ *
+ * The frames are written directly to buffers shared with the driver
+ * (VIDIOC_REQBUFS with V4L2_MEMORY_MMAP), converted to the output pixel
+ * format on the fly. If the device does not support streaming I/O, the frames
+ * are written by write().
+ */
+struct sc_v4l2_device {
+    const struct sc_v4l2_io_ops *io;
+    int fd;
+    bool can_stream; // V4L2_CAP_STREAMING
+
+    bool configured;
+    enum sc_v4l2_format format;
+    unsigned width;
+    unsigned height;
+    uint32_t bytesperline;
+    uint32_t sizeimage;
+
+    bool streaming; // mmap buffers are used
+    bool stream_on;
+    struct sc_v4l2_mapped_buffer buffers[SC_V4L2_MAX_BUFFERS];
+    unsigned buffer_count;
+    // number of buffers queued at least once (the next ones are available
+    // without dequeuing)
+    unsigned buffers_used;
+
+    // used if !streaming
+    uint8_t *write_buffer;
+};
+
+bool
+sc_v4l2_device_open(struct sc_v4l2_device *dev,
+                    const struct sc_v4l2_io_ops *io, const char *path);
+
+void
+sc_v4l2_device_close(struct sc_v4l2_device *dev);
+
+/**
+ * Configure the output format (does nothing if it is unchanged)
+ *
+ * May be called again to change the format, without reopening the device.
+ *
+ * The width is rounded down to an even value (the last column of frames of
+ * odd width is dropped).
+ */
+bool
+sc_v4l2_device_configure(struct sc_v4l2_device *dev,
+                         enum sc_v4l2_format format, unsigned width,
+                         unsigned height);
+
+/**
+ * Write a YUV420P frame (of the configured size)
+ */
+bool
+sc_v4l2_device_write_frame(struct sc_v4l2_device *dev, const AVFrame *frame);
+
+#endif
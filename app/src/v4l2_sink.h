@@ -5,9 +5,12 @@
 
 #include <stdbool.h>
 #include <libavcodec/avcodec.h>
-#include <libavformat/avformat.h>
 
+#include "coords.h"
 #include "frame_buffer.h"
+#include "frame_transform.h"
+#include "options.h"
+#include "v4l2_device.h"
 #include "trait/frame_sink.h"
 #include "util/thread.h"
 
@@ -15,24 +18,35 @@ struct sc_v4l2_sink {
     struct sc_frame_sink frame_sink; // frame sink trait
 
     struct sc_frame_buffer fb;
-    AVFormatContext *format_ctx;
-    AVCodecContext *encoder_ctx;
+    struct sc_v4l2_device device;
+    struct sc_frame_transform transform;
 
     char *device_name;
+    enum sc_v4l2_format format;
+    struct sc_rect crop;
+    enum sc_orientation orientation;
+    struct sc_size size;
 
     sc_thread thread;
     sc_mutex mutex;
     sc_cond cond;
     bool has_frame;
     bool stopped;
-    bool header_written;
 
     AVFrame *frame;
-    AVPacket *packet;
+};
+
+struct sc_v4l2_sink_params {
+    const char *device_name;
+    enum sc_v4l2_format format;
+    struct sc_rect crop; // no crop if the size is 0
+    enum sc_orientation orientation;
+    struct sc_size size; // output size, or 0 to keep the frame size
 };
 
 bool
-sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name);
+sc_v4l2_sink_init(struct sc_v4l2_sink *vs,
+                  const struct sc_v4l2_sink_params *params);
 
 void
 sc_v4l2_sink_destroy(struct sc_v4l2_sink *vs);
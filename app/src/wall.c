@@ -0,0 +1,827 @@
+#include "wall.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "control_msg.h"
+#include "events.h"
+#include "icon.h"
+#include "input_events.h"
+#include "shortcut_mod.h"
+#include "util/acksync.h"
+#include "util/log.h"
+
+#define DOWNCAST(SINK) container_of(SINK, struct sc_wall_tile, frame_sink)
+
+#define SC_WALL_DEFAULT_WIDTH 1280
+#define SC_WALL_DEFAULT_HEIGHT 720
+
+#define SC_WALL_FOCUS_HOVER_DELAY SC_TICK_FROM_MS(300)
+
+static bool
+sc_wall_tile_frame_sink_open(struct sc_frame_sink *sink,
+                             const AVCodecContext *ctx) {
+    assert(ctx->pix_fmt == AV_PIX_FMT_YUV420P);
+
+    struct sc_wall_tile *tile = DOWNCAST(sink);
+
+    if (ctx->width <= 0 || ctx->width > 0xFFFF
+            || ctx->height <= 0 || ctx->height > 0xFFFF) {
+        LOGE("Invalid video size: %dx%d", ctx->width, ctx->height);
+        return false;
+    }
+
+    // tile->frame_size is never used before the event is pushed, and the
+    // event acts as a memory barrier so it is safe without mutex
+    tile->frame_size.width = ctx->width;
+    tile->frame_size.height = ctx->height;
+
+    // Post the event on the UI thread (the texture must be created from there)
+    return sc_push_event_with_data(SC_EVENT_SCREEN_INIT_SIZE, tile);
+}
+
+static void
+sc_wall_tile_frame_sink_close(struct sc_frame_sink *sink) {
+    (void) sink;
+    // nothing to do, the tile lifecycle is not managed by the frame producer
+}
+
+static bool
+sc_wall_tile_frame_sink_push(struct sc_frame_sink *sink,
+                             const AVFrame *frame) {
+    struct sc_wall_tile *tile = DOWNCAST(sink);
+
+    bool previous_skipped;
+    bool ok = sc_frame_buffer_push(&tile->fb, frame, &previous_skipped);
+    if (!ok) {
+        return false;
+    }
+
+    if (!previous_skipped) {
+        // Post the event on the UI thread (the SC_EVENT_NEW_FRAME triggered
+        // for a skipped frame consumes the new frame instead)
+        return sc_push_event_with_data(SC_EVENT_NEW_FRAME, tile);
+    }
+
+    return true;
+}
+
+static struct sc_size
+sc_wall_get_initial_size(const struct sc_wall_params *params) {
+    if (params->window_width && params->window_height) {
+        return (struct sc_size) {params->window_width, params->window_height};
+    }
+
+    // 3/4 of the usable display bounds, to display as many devices as possible
+    SDL_Rect bounds;
+    if (SDL_GetDisplayUsableBounds(0, &bounds)) {
+        LOGW("Could not get display usable bounds: %s", SDL_GetError());
+        return (struct sc_size) {SC_WALL_DEFAULT_WIDTH,
+                                 SC_WALL_DEFAULT_HEIGHT};
+    }
+
+    return (struct sc_size) {bounds.w * 3 / 4, bounds.h * 3 / 4};
+}
+
+bool
+sc_wall_init(struct sc_wall *wall, const struct sc_wall_params *params) {
+    assert(params->tile_count && params->tile_count <= SC_WALL_MAX_TILES);
+
+    const char *title = params->window_title;
+    assert(title);
+
+    struct sc_size size = sc_wall_get_initial_size(params);
+    int x = params->window_x != SC_WINDOW_POSITION_UNDEFINED
+          ? params->window_x : (int) SDL_WINDOWPOS_UNDEFINED;
+    int y = params->window_y != SC_WINDOW_POSITION_UNDEFINED
+          ? params->window_y : (int) SDL_WINDOWPOS_UNDEFINED;
+
+    uint32_t window_flags = SDL_WINDOW_HIDDEN
+                          | SDL_WINDOW_RESIZABLE
+                          | SDL_WINDOW_ALLOW_HIGHDPI;
+    if (params->always_on_top) {
+        window_flags |= SDL_WINDOW_ALWAYS_ON_TOP;
+    }
+    if (params->window_borderless) {
+        window_flags |= SDL_WINDOW_BORDERLESS;
+    }
+    if (params->fullscreen) {
+        window_flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+    }
+
+    wall->window = SDL_CreateWindow(title, x, y, size.width, size.height,
+                                    window_flags);
+    if (!wall->window) {
+        LOGE("Could not create window: %s", SDL_GetError());
+        return false;
+    }
+
+    SDL_Surface *icon = scrcpy_icon_load();
+    if (icon) {
+        SDL_SetWindowIcon(wall->window, icon);
+    } else {
+        LOGW("Could not load icon");
+    }
+
+    // A single renderer (and OpenGL context) for all the devices
+    bool ok = sc_display_init(&wall->display, wall->window, NULL,
+                              params->mipmaps);
+    if (icon) {
+        scrcpy_icon_destroy(icon);
+    }
+    if (!ok) {
+        goto error_destroy_window;
+    }
+
+    static const struct sc_frame_sink_ops frame_sink_ops = {
+        .open = sc_wall_tile_frame_sink_open,
+        .close = sc_wall_tile_frame_sink_close,
+        .push = sc_wall_tile_frame_sink_push,
+    };
+
+    unsigned i;
+    for (i = 0; i < params->tile_count; ++i) {
+        struct sc_wall_tile *tile = &wall->tiles[i];
+
+        if (!sc_frame_buffer_init(&tile->fb)) {
+            goto error_destroy_tiles;
+        }
+
+        tile->frame = av_frame_alloc();
+        if (!tile->frame) {
+            LOG_OOM();
+            sc_frame_buffer_destroy(&tile->fb);
+            goto error_destroy_tiles;
+        }
+
+        sc_display_init_shared(&tile->display, &wall->display);
+
+        tile->frame_sink.ops = &frame_sink_ops;
+        tile->wall = wall;
+        tile->kp = NULL;
+        tile->mp = NULL;
+        tile->startup_timing = NULL;
+        tile->frame_size.width = 0;
+        tile->frame_size.height = 0;
+        tile->rect = (SDL_Rect) {0, 0, 0, 0};
+        tile->has_frame = false;
+        tile->stale = false;
+        tile->ended = false;
+    }
+
+    wall->tile_count = params->tile_count;
+    wall->sdl_shortcut_mods = sc_shortcut_mods_to_sdl(params->shortcut_mods);
+    wall->zoomed = NULL;
+    wall->mouse_grab = NULL;
+    wall->key_tile = NULL;
+    wall->keys_down = 0;
+    wall->focused = NULL;
+    wall->focus_pending = NULL;
+    wall->focus_deadline = 0;
+    wall->cbs = params->cbs;
+    wall->cbs_userdata = params->cbs_userdata;
+    wall->render_posted = false;
+    wall->has_frame = false;
+
+    return true;
+
+error_destroy_tiles:
+    while (i--) {
+        struct sc_wall_tile *tile = &wall->tiles[i];
+        sc_display_destroy(&tile->display);
+        av_frame_free(&tile->frame);
+        sc_frame_buffer_destroy(&tile->fb);
+    }
+    sc_display_destroy(&wall->display);
+error_destroy_window:
+    SDL_DestroyWindow(wall->window);
+
+    return false;
+}
+
+void
+sc_wall_destroy(struct sc_wall *wall) {
+    for (unsigned i = 0; i < wall->tile_count; ++i) {
+        struct sc_wall_tile *tile = &wall->tiles[i];
+        // The textures must be destroyed before the shared renderer
+        sc_display_destroy(&tile->display);
+        av_frame_free(&tile->frame);
+        sc_frame_buffer_destroy(&tile->fb);
+    }
+    sc_display_destroy(&wall->display);
+    SDL_DestroyWindow(wall->window);
+}
+
+void
+sc_wall_tile_set_processors(struct sc_wall_tile *tile,
+                            struct sc_key_processor *kp,
+                            struct sc_mouse_processor *mp) {
+    tile->kp = kp;
+    tile->mp = mp;
+}
+
+void
+sc_wall_tile_set_startup_timing(struct sc_wall_tile *tile,
+                                struct sc_startup_timing *startup_timing) {
+    tile->startup_timing = startup_timing;
+}
+
+static inline bool
+sc_wall_tile_is_visible(struct sc_wall_tile *tile) {
+    struct sc_wall *wall = tile->wall;
+    return !tile->ended && (!wall->zoomed || wall->zoomed == tile);
+}
+
+// Fit the content into the cell, keeping the aspect ratio
+static void
+sc_wall_tile_layout(struct sc_wall_tile *tile, const SDL_Rect *cell) {
+    struct sc_size content = tile->frame_size;
+    SDL_Rect *rect = &tile->rect;
+
+    bool keep_width = (int64_t) content.width * cell->h
+                    > (int64_t) content.height * cell->w;
+    if (keep_width) {
+        rect->w = cell->w;
+        rect->h = (int64_t) cell->w * content.height / content.width;
+    } else {
+        rect->h = cell->h;
+        rect->w = (int64_t) cell->h * content.width / content.height;
+    }
+    rect->x = cell->x + (cell->w - rect->w) / 2;
+    rect->y = cell->y + (cell->h - rect->h) / 2;
+}
+
+static void
+sc_wall_update_layout(struct sc_wall *wall) {
+    int dw;
+    int dh;
+    SDL_GL_GetDrawableSize(wall->window, &dw, &dh);
+
+    // The grid keeps the slots of ended devices, so that the other devices do
+    // not move
+    unsigned columns = 1;
+    while (columns * columns < wall->tile_count) {
+        ++columns;
+    }
+    unsigned rows = (wall->tile_count + columns - 1) / columns;
+
+    for (unsigned i = 0; i < wall->tile_count; ++i) {
+        struct sc_wall_tile *tile = &wall->tiles[i];
+        if (!tile->has_frame || !sc_wall_tile_is_visible(tile)) {
+            tile->rect = (SDL_Rect) {0, 0, 0, 0};
+            continue;
+        }
+
+        SDL_Rect cell;
+        if (wall->zoomed) {
+            cell = (SDL_Rect) {0, 0, dw, dh};
+        } else {
+            unsigned column = i % columns;
+            unsigned row = i / columns;
+            cell.x = dw * column / columns;
+            cell.y = dh * row / rows;
+            cell.w = dw * (column + 1) / columns - cell.x;
+            cell.h = dh * (row + 1) / rows - cell.y;
+        }
+
+        sc_wall_tile_layout(tile, &cell);
+    }
+}
+
+// Upload the last frame of the tile to its texture
+static bool
+sc_wall_tile_upload(struct sc_wall_tile *tile) {
+    assert(tile->stale);
+
+    AVFrame *frame = tile->frame;
+    struct sc_size frame_size = {frame->width, frame->height};
+    if (frame_size.width != tile->frame_size.width
+            || frame_size.height != tile->frame_size.height) {
+        // frame dimension changed
+        tile->frame_size = frame_size;
+        enum sc_display_result res =
+            sc_display_set_texture_size(&tile->display, frame_size);
+        if (res == SC_DISPLAY_RESULT_ERROR) {
+            return false;
+        }
+    }
+
+    // On SC_DISPLAY_RESULT_PENDING, the frame is uploaded on render
+    enum sc_display_result res =
+        sc_display_update_texture(&tile->display, frame);
+    if (res == SC_DISPLAY_RESULT_ERROR) {
+        return false;
+    }
+
+    tile->stale = false;
+    return true;
+}
+
+static bool
+sc_wall_render(struct sc_wall *wall) {
+    sc_wall_update_layout(wall);
+
+    SDL_RenderClear(wall->display.renderer);
+
+    for (unsigned i = 0; i < wall->tile_count; ++i) {
+        struct sc_wall_tile *tile = &wall->tiles[i];
+        if (!tile->rect.w || !tile->rect.h) {
+            // not displayed
+            continue;
+        }
+
+        // The frames of hidden tiles are only uploaded once visible
+        if (tile->stale && !sc_wall_tile_upload(tile)) {
+            return false;
+        }
+
+        enum sc_display_result res =
+            sc_display_draw(&tile->display, &tile->rect, SC_ORIENTATION_0);
+        if (res == SC_DISPLAY_RESULT_ERROR) {
+            return false;
+        }
+    }
+
+    SDL_RenderPresent(wall->display.renderer);
+    return true;
+}
+
+static void
+sc_wall_run_render(void *userdata) {
+    struct sc_wall *wall = userdata;
+
+    wall->render_posted = false;
+    bool ok = sc_wall_render(wall);
+    (void) ok; // any error already logged
+}
+
+// Render once all the events already queued (typically the new frames of the
+// other devices) have been handled
+static void
+sc_wall_request_render(struct sc_wall *wall) {
+    if (!wall->render_posted) {
+        wall->render_posted = sc_post_to_main_thread(sc_wall_run_render, wall);
+    }
+}
+
+// The focused tile is the tile displayed alone, or else the tile clicked or
+// hovered long enough
+static void
+sc_wall_set_focused(struct sc_wall *wall, struct sc_wall_tile *tile) {
+    if (wall->zoomed) {
+        tile = wall->zoomed;
+    }
+
+    wall->focus_pending = NULL;
+    wall->focus_deadline = 0;
+
+    if (tile == wall->focused) {
+        return;
+    }
+
+    wall->focused = tile;
+    if (wall->cbs && wall->cbs->on_focus_changed) {
+        wall->cbs->on_focus_changed(wall, tile, wall->cbs_userdata);
+    }
+}
+
+// Moving the cursor across the wall must not switch the focus of every tile on
+// the way (each switch may request a key frame), so the hovered tile is only
+// focused once the cursor stayed on it for SC_WALL_FOCUS_HOVER_DELAY
+static void
+sc_wall_set_hovered(struct sc_wall *wall, struct sc_wall_tile *tile) {
+    if (wall->zoomed || tile == wall->focused) {
+        wall->focus_pending = NULL;
+        wall->focus_deadline = 0;
+        return;
+    }
+
+    if (wall->focus_deadline && tile == wall->focus_pending) {
+        // Already waiting for this tile
+        return;
+    }
+
+    wall->focus_pending = tile;
+    wall->focus_deadline = sc_tick_now() + SC_WALL_FOCUS_HOVER_DELAY;
+}
+
+void
+sc_wall_tile_end(struct sc_wall_tile *tile) {
+    struct sc_wall *wall = tile->wall;
+
+    tile->ended = true;
+    if (wall->zoomed == tile) {
+        wall->zoomed = NULL;
+    }
+    if (wall->mouse_grab == tile) {
+        wall->mouse_grab = NULL;
+    }
+    if (wall->key_tile == tile) {
+        wall->key_tile = NULL;
+    }
+    if (wall->focused == tile) {
+        sc_wall_set_focused(wall, NULL);
+    }
+    if (wall->focus_pending == tile) {
+        wall->focus_pending = NULL;
+        wall->focus_deadline = 0;
+    }
+
+    sc_wall_request_render(wall);
+}
+
+static bool
+sc_wall_tile_update_frame(struct sc_wall_tile *tile) {
+    struct sc_wall *wall = tile->wall;
+
+    av_frame_unref(tile->frame);
+    sc_frame_buffer_consume(&tile->fb, tile->frame);
+
+    if (tile->ended) {
+        return true;
+    }
+
+    tile->stale = true;
+    if (sc_wall_tile_is_visible(tile) && !sc_wall_tile_upload(tile)) {
+        return false;
+    }
+
+    if (!tile->has_frame && tile->startup_timing) {
+        sc_startup_timing_report_first_frame(tile->startup_timing);
+    }
+
+    tile->has_frame = true;
+    if (!wall->has_frame) {
+        wall->has_frame = true;
+        // this is the very first frame, show the window
+        SDL_ShowWindow(wall->window);
+    }
+
+    sc_wall_request_render(wall);
+    return true;
+}
+
+// Convert window coordinates to drawable coordinates (HiDPI)
+static void
+sc_wall_hidpi_scale_coords(struct sc_wall *wall, int32_t *x, int32_t *y) {
+    int ww, wh, dw, dh;
+    SDL_GetWindowSize(wall->window, &ww, &wh);
+    SDL_GL_GetDrawableSize(wall->window, &dw, &dh);
+
+    // scale for HiDPI (64 bits for intermediate multiplications)
+    *x = (int64_t) *x * dw / ww;
+    *y = (int64_t) *y * dh / wh;
+}
+
+static struct sc_wall_tile *
+sc_wall_get_tile_at(struct sc_wall *wall, int32_t x, int32_t y) {
+    for (unsigned i = 0; i < wall->tile_count; ++i) {
+        struct sc_wall_tile *tile = &wall->tiles[i];
+        const SDL_Rect *r = &tile->rect;
+        if (x >= r->x && x < r->x + r->w && y >= r->y && y < r->y + r->h) {
+            return tile;
+        }
+    }
+    return NULL;
+}
+
+// Return the tile under the mouse cursor, if any
+static struct sc_wall_tile *
+sc_wall_get_hovered_tile(struct sc_wall *wall) {
+    int x;
+    int y;
+    SDL_GetMouseState(&x, &y);
+    sc_wall_hidpi_scale_coords(wall, &x, &y);
+    return sc_wall_get_tile_at(wall, x, y);
+}
+
+static struct sc_position
+sc_wall_tile_get_position(struct sc_wall_tile *tile, int32_t x, int32_t y) {
+    const SDL_Rect *r = &tile->rect;
+    assert(r->w && r->h);
+
+    // The position may be outside the tile (while a button is pressed), the
+    // device ignores it
+    return (struct sc_position) {
+        .screen_size = tile->frame_size,
+        .point = {
+            .x = (int64_t) (x - r->x) * tile->frame_size.width / r->w,
+            .y = (int64_t) (y - r->y) * tile->frame_size.height / r->h,
+        },
+    };
+}
+
+static void
+sc_wall_toggle_zoom(struct sc_wall *wall) {
+    if (wall->zoomed) {
+        wall->zoomed = NULL;
+    } else {
+        wall->zoomed = sc_wall_get_hovered_tile(wall);
+        if (!wall->zoomed) {
+            return;
+        }
+    }
+
+    // The tiles under the mouse have changed
+    wall->mouse_grab = NULL;
+    sc_wall_set_focused(wall, sc_wall_get_hovered_tile(wall));
+    sc_wall_request_render(wall);
+}
+
+static void
+sc_wall_toggle_fullscreen(struct sc_wall *wall) {
+    uint32_t flags = SDL_GetWindowFlags(wall->window);
+    bool fullscreen = flags & SDL_WINDOW_FULLSCREEN_DESKTOP;
+    uint32_t new_mode = fullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP;
+    if (SDL_SetWindowFullscreen(wall->window, new_mode)) {
+        LOGW("Could not switch fullscreen mode: %s", SDL_GetError());
+    }
+}
+
+// Return the tile receiving the keyboard events
+static struct sc_wall_tile *
+sc_wall_get_key_tile(struct sc_wall *wall) {
+    if (wall->keys_down) {
+        // Never change the target while keys are pressed, so that each key up
+        // event is sent to the device which received the key down event
+        return wall->key_tile;
+    }
+    return wall->zoomed ? wall->zoomed : sc_wall_get_hovered_tile(wall);
+}
+
+static void
+sc_wall_process_key(struct sc_wall *wall, const SDL_KeyboardEvent *event) {
+    bool down = event->type == SDL_KEYDOWN;
+
+    if (sc_shortcut_mods_is_shortcut_mod(wall->sdl_shortcut_mods,
+                                         event->keysym.mod)) {
+        // Wall shortcuts only, never forwarded
+        if (down && !event->repeat) {
+            switch (event->keysym.sym) {
+                case SDLK_z:
+                    sc_wall_toggle_zoom(wall);
+                    break;
+                case SDLK_f:
+                    sc_wall_toggle_fullscreen(wall);
+                    break;
+            }
+        }
+        return;
+    }
+
+    struct sc_wall_tile *tile = sc_wall_get_key_tile(wall);
+    if (down && !event->repeat) {
+        if (!wall->keys_down) {
+            wall->key_tile = tile;
+        }
+        ++wall->keys_down;
+    } else if (!down && wall->keys_down) {
+        --wall->keys_down;
+    }
+
+    if (!tile || !tile->kp) {
+        return;
+    }
+
+    enum sc_keycode keycode = sc_keycode_from_sdl(event->keysym.sym);
+    if (keycode == SC_KEYCODE_UNKNOWN) {
+        return;
+    }
+
+    enum sc_scancode scancode = sc_scancode_from_sdl(event->keysym.scancode);
+    if (scancode == SC_SCANCODE_UNKNOWN) {
+        return;
+    }
+
+    struct sc_key_event evt = {
+        .action = sc_action_from_sdl_keyboard_type(event->type),
+        .keycode = keycode,
+        .scancode = scancode,
+        .repeat = event->repeat,
+        .mods_state = sc_mods_state_from_sdl(event->keysym.mod),
+    };
+
+    struct sc_key_processor *kp = tile->kp;
+    assert(kp->ops->process_key);
+    kp->ops->process_key(kp, &evt, SC_SEQUENCE_INVALID);
+}
+
+static void
+sc_wall_process_text(struct sc_wall *wall, const SDL_TextInputEvent *event) {
+    if (sc_shortcut_mods_is_shortcut_mod(wall->sdl_shortcut_mods,
+                                         SDL_GetModState())) {
+        // A shortcut must never generate text events
+        return;
+    }
+
+    struct sc_wall_tile *tile = sc_wall_get_key_tile(wall);
+    if (!tile || !tile->kp || !tile->kp->ops->process_text) {
+        return;
+    }
+
+    struct sc_text_event evt = {
+        .text = event->text,
+    };
+
+    tile->kp->ops->process_text(tile->kp, &evt);
+}
+
+static void
+sc_wall_process_mouse_motion(struct sc_wall *wall,
+                             const SDL_MouseMotionEvent *event) {
+    if (event->which == SDL_TOUCH_MOUSEID) {
+        // simulated from touch events, so it's a duplicate
+        return;
+    }
+
+    int32_t x = event->x;
+    int32_t y = event->y;
+    sc_wall_hidpi_scale_coords(wall, &x, &y);
+
+    struct sc_wall_tile *tile = wall->mouse_grab;
+    if (!tile) {
+        tile = sc_wall_get_tile_at(wall, x, y);
+    }
+    sc_wall_set_hovered(wall, tile);
+    if (!tile || !tile->mp) {
+        return;
+    }
+
+    struct sc_mouse_processor *mp = tile->mp;
+    struct sc_mouse_motion_event evt = {
+        .position = sc_wall_tile_get_position(tile, x, y),
+        .pointer_id = SC_POINTER_ID_MOUSE,
+        .xrel = event->xrel,
+        .yrel = event->yrel,
+        // Only the left button is forwarded
+        .buttons_state = wall->mouse_grab ? SC_MOUSE_BUTTON_LEFT : 0,
+    };
+
+    assert(mp->ops->process_mouse_motion);
+    mp->ops->process_mouse_motion(mp, &evt);
+}
+
+static void
+sc_wall_process_mouse_button(struct sc_wall *wall,
+                             const SDL_MouseButtonEvent *event) {
+    if (event->which == SDL_TOUCH_MOUSEID) {
+        // simulated from touch events, so it's a duplicate
+        return;
+    }
+
+    if (event->button != SDL_BUTTON_LEFT) {
+        // Without shortcuts, the other buttons have no meaning on the wall
+        return;
+    }
+
+    int32_t x = event->x;
+    int32_t y = event->y;
+    sc_wall_hidpi_scale_coords(wall, &x, &y);
+
+    bool down = event->type == SDL_MOUSEBUTTONDOWN;
+    struct sc_wall_tile *tile;
+    if (down) {
+        tile = sc_wall_get_tile_at(wall, x, y);
+        // Send the motion events to this device until the button is released
+        wall->mouse_grab = tile;
+        if (tile) {
+            // A click focuses the tile immediately
+            sc_wall_set_focused(wall, tile);
+        }
+    } else {
+        tile = wall->mouse_grab;
+        wall->mouse_grab = NULL;
+    }
+
+    if (!tile || !tile->mp) {
+        return;
+    }
+
+    struct sc_mouse_processor *mp = tile->mp;
+    struct sc_mouse_click_event evt = {
+        .position = sc_wall_tile_get_position(tile, x, y),
+        .action = sc_action_from_sdl_mousebutton_type(event->type),
+        .button = SC_MOUSE_BUTTON_LEFT,
+        .pointer_id = SC_POINTER_ID_MOUSE,
+        .buttons_state = down ? SC_MOUSE_BUTTON_LEFT : 0,
+    };
+
+    assert(mp->ops->process_mouse_click);
+    mp->ops->process_mouse_click(mp, &evt);
+}
+
+static void
+sc_wall_process_mouse_wheel(struct sc_wall *wall,
+                            const SDL_MouseWheelEvent *event) {
+    int x;
+    int y;
+    SDL_GetMouseState(&x, &y);
+    sc_wall_hidpi_scale_coords(wall, &x, &y);
+
+    struct sc_wall_tile *tile = sc_wall_get_tile_at(wall, x, y);
+    if (!tile || !tile->mp || !tile->mp->ops->process_mouse_scroll) {
+        return;
+    }
+
+    struct sc_mouse_scroll_event evt = {
+        .position = sc_wall_tile_get_position(tile, x, y),
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        .hscroll = CLAMP(event->preciseX, -1.0f, 1.0f),
+        .vscroll = CLAMP(event->preciseY, -1.0f, 1.0f),
+#else
+        .hscroll = CLAMP(event->x, -1, 1),
+        .vscroll = CLAMP(event->y, -1, 1),
+#endif
+        .buttons_state = wall->mouse_grab ? SC_MOUSE_BUTTON_LEFT : 0,
+    };
+
+    tile->mp->ops->process_mouse_scroll(tile->mp, &evt);
+}
+
+struct sc_wall_tile *
+sc_wall_get_event_tile(struct sc_wall *wall, const SDL_Event *event) {
+    if (event->type != SC_EVENT_SCREEN_INIT_SIZE
+            && event->type != SC_EVENT_NEW_FRAME) {
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < wall->tile_count; ++i) {
+        if (&wall->tiles[i] == event->user.data1) {
+            return &wall->tiles[i];
+        }
+    }
+    return NULL;
+}
+
+bool
+sc_wall_handle_event(struct sc_wall *wall, const SDL_Event *event) {
+    switch (event->type) {
+        case SC_EVENT_SCREEN_INIT_SIZE: {
+            struct sc_wall_tile *tile = sc_wall_get_event_tile(wall, event);
+            assert(tile);
+            enum sc_display_result res =
+                sc_display_set_texture_size(&tile->display, tile->frame_size);
+            if (res == SC_DISPLAY_RESULT_ERROR) {
+                LOGE("Could not initialize tile size");
+                return false;
+            }
+            return true;
+        }
+        case SC_EVENT_NEW_FRAME: {
+            struct sc_wall_tile *tile = sc_wall_get_event_tile(wall, event);
+            assert(tile);
+            if (!sc_wall_tile_update_frame(tile)) {
+                LOGE("Frame update failed");
+                return false;
+            }
+            return true;
+        }
+        case SDL_WINDOWEVENT:
+            switch (event->window.event) {
+                case SDL_WINDOWEVENT_EXPOSED:
+                case SDL_WINDOWEVENT_SIZE_CHANGED:
+                    sc_wall_request_render(wall);
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_LOST:
+                    // The key up events will not be received
+                    wall->keys_down = 0;
+                    break;
+                case SDL_WINDOWEVENT_LEAVE:
+                    // No tile is under the cursor anymore
+                    sc_wall_set_hovered(wall, wall->mouse_grab);
+                    break;
+            }
+            return true;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            sc_wall_process_key(wall, &event->key);
+            return true;
+        case SDL_TEXTINPUT:
+            sc_wall_process_text(wall, &event->text);
+            return true;
+        case SDL_MOUSEMOTION:
+            sc_wall_process_mouse_motion(wall, &event->motion);
+            return true;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            sc_wall_process_mouse_button(wall, &event->button);
+            return true;
+        case SDL_MOUSEWHEEL:
+            sc_wall_process_mouse_wheel(wall, &event->wheel);
+            return true;
+    }
+
+    return true;
+}
+
+sc_tick
+sc_wall_get_deadline(const struct sc_wall *wall) {
+    return wall->focus_deadline;
+}
+
+void
+sc_wall_handle_deadline(struct sc_wall *wall) {
+    if (wall->focus_deadline && sc_tick_now() >= wall->focus_deadline) {
+        sc_wall_set_focused(wall, wall->focus_pending);
+    }
+}
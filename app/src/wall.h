@@ -0,0 +1,167 @@
+#ifndef SC_WALL_H
+#define SC_WALL_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include <libavutil/frame.h>
+
+#include "coords.h"
+#include "display.h"
+#include "frame_buffer.h"
+#include "options.h"
+#include "startup_timing.h"
+#include "trait/frame_sink.h"
+#include "trait/key_processor.h"
+#include "trait/mouse_processor.h"
+#include "util/tick.h"
+
+#define SC_WALL_MAX_TILES SC_MAX_DEVICES
+
+struct sc_wall;
+struct sc_wall_tile;
+
+struct sc_wall_callbacks {
+    // The focused tile (the tile displayed alone, or else the tile clicked or
+    // hovered long enough) has changed (tile is NULL if no tile is focused)
+    void (*on_focus_changed)(struct sc_wall *wall, struct sc_wall_tile *tile,
+                             void *userdata);
+};
+
+/**
+ * The area of the wall displaying the video stream of one device
+ */
+struct sc_wall_tile {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    struct sc_wall *wall;
+
+    struct sc_frame_buffer fb;
+    // draws to the renderer of the wall
+    struct sc_display display;
+    AVFrame *frame;
+
+    struct sc_key_processor *kp; // may be NULL
+    struct sc_mouse_processor *mp; // may be NULL
+    struct sc_startup_timing *startup_timing; // may be NULL
+
+    struct sc_size frame_size;
+    // rectangle of the content, in drawable coordinates (empty if hidden)
+    SDL_Rect rect;
+    bool has_frame;
+    // the last frame has not been uploaded yet (because the tile was hidden)
+    bool stale;
+    bool ended;
+};
+
+/**
+ * A single window displaying the devices in a grid
+ *
+ * All the tiles are rendered by a single renderer, with a single present per
+ * frame: the frames received from all the devices until the main thread is
+ * available are rendered together.
+ *
+ * Mouse events are sent to the device under the cursor (or to the device
+ * where a button was pressed, until it is released), and keyboard events to
+ * the device under the cursor. MOD+z shows the device under the cursor alone
+ * (full size), or goes back to the grid.
+ */
+struct sc_wall {
+    SDL_Window *window;
+    // owns the renderer shared by the tiles
+    struct sc_display display;
+
+    struct sc_wall_tile tiles[SC_WALL_MAX_TILES];
+    unsigned tile_count;
+
+    uint16_t sdl_shortcut_mods;
+
+    // the tile displayed alone, or NULL to display the grid
+    struct sc_wall_tile *zoomed;
+    // the tile receiving the mouse events while a button is pressed
+    struct sc_wall_tile *mouse_grab;
+    // the tile receiving the keyboard events while keys are pressed
+    struct sc_wall_tile *key_tile;
+    unsigned keys_down;
+    struct sc_wall_tile *focused;
+    // the hovered tile to focus once focus_deadline is reached (if not 0)
+    struct sc_wall_tile *focus_pending;
+    sc_tick focus_deadline;
+
+    const struct sc_wall_callbacks *cbs;
+    void *cbs_userdata;
+
+    bool render_posted;
+    bool has_frame; // any tile has received a frame
+};
+
+struct sc_wall_params {
+    unsigned tile_count;
+
+    const char *window_title;
+    bool always_on_top;
+
+    int16_t window_x; // accepts SC_WINDOW_POSITION_UNDEFINED
+    int16_t window_y; // accepts SC_WINDOW_POSITION_UNDEFINED
+    uint16_t window_width;
+    uint16_t window_height;
+
+    bool window_borderless;
+    bool mipmaps;
+    bool fullscreen;
+
+    uint8_t shortcut_mods; // OR of enum sc_shortcut_mod values
+
+    const struct sc_wall_callbacks *cbs; // may be NULL
+    void *cbs_userdata;
+};
+
+// create the window and the renderer (the window is hidden until the first
+// frame)
+bool
+sc_wall_init(struct sc_wall *wall, const struct sc_wall_params *params);
+
+void
+sc_wall_destroy(struct sc_wall *wall);
+
+// set the input processors of a tile (may be NULL)
+void
+sc_wall_tile_set_processors(struct sc_wall_tile *tile,
+                            struct sc_key_processor *kp,
+                            struct sc_mouse_processor *mp);
+
+// report the first frame of the tile to the startup timing (may be NULL)
+void
+sc_wall_tile_set_startup_timing(struct sc_wall_tile *tile,
+                                struct sc_startup_timing *startup_timing);
+
+// stop displaying the tile (its device is disconnected)
+void
+sc_wall_tile_end(struct sc_wall_tile *tile);
+
+// return the tile targeted by the event (SC_EVENT_SCREEN_INIT_SIZE and
+// SC_EVENT_NEW_FRAME), or NULL if the event does not concern a tile
+struct sc_wall_tile *
+sc_wall_get_event_tile(struct sc_wall *wall, const SDL_Event *event);
+
+// react to SDL events
+// If this function returns false, scrcpy must exit with an error.
+bool
+sc_wall_handle_event(struct sc_wall *wall, const SDL_Event *event);
+
+/**
+ * Return the date when sc_wall_handle_deadline() must be called, or 0 if
+ * there is nothing to do
+ */
+sc_tick
+sc_wall_get_deadline(const struct sc_wall *wall);
+
+/**
+ * Focus the hovered tile if the cursor stayed on it long enough
+ */
+void
+sc_wall_handle_deadline(struct sc_wall *wall);
+
+#endif
@@ -0,0 +1,171 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+
+#include "util/audiobuf.h"
+
+/**
+ * Benchmark of the conversion of raw audio (signed 16-bit PCM) to the float
+ * samples played by the audio output.
+ *
+ * It reports the CPU time spent per second of audio (lower is better) for:
+ *  - the generic path: swr_convert() then sc_audiobuf_write();
+ *  - the direct path: sc_audiobuf_write_s16().
+ *
+ * Usage:
+ *
+ *     bench_audio_pcm [seconds]
+ */
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 2
+// The device sends packets of 960 samples (20 ms at 48 kHz)
+#define PACKET_SAMPLES 960
+#define SAMPLE_SIZE (CHANNELS * sizeof(float))
+
+static uint64_t
+cpu_time_ns(void) {
+    struct timespec ts;
+    int r = clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    assert(!r);
+    (void) r;
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static SwrContext *
+create_swr_ctx(void) {
+    SwrContext *swr_ctx = swr_alloc();
+    if (!swr_ctx) {
+        return NULL;
+    }
+
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    AVChannelLayout layout = AV_CHANNEL_LAYOUT_STEREO;
+    av_opt_set_chlayout(swr_ctx, "in_chlayout", &layout, 0);
+    av_opt_set_chlayout(swr_ctx, "out_chlayout", &layout, 0);
+#else
+    av_opt_set_channel_layout(swr_ctx, "in_channel_layout",
+                              AV_CH_LAYOUT_STEREO, 0);
+    av_opt_set_channel_layout(swr_ctx, "out_channel_layout",
+                              AV_CH_LAYOUT_STEREO, 0);
+#endif
+
+    av_opt_set_int(swr_ctx, "in_sample_rate", SAMPLE_RATE, 0);
+    av_opt_set_int(swr_ctx, "out_sample_rate", SAMPLE_RATE, 0);
+    av_opt_set_sample_fmt(swr_ctx, "in_sample_fmt", AV_SAMPLE_FMT_S16, 0);
+    av_opt_set_sample_fmt(swr_ctx, "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0);
+
+    if (swr_init(swr_ctx) < 0) {
+        swr_free(&swr_ctx);
+        return NULL;
+    }
+
+    return swr_ctx;
+}
+
+static void
+drain(struct sc_audiobuf *buf, float *out) {
+    // Consume the samples as the audio output would
+    uint32_t r = sc_audiobuf_read(buf, out, PACKET_SAMPLES);
+    assert(r == PACKET_SAMPLES);
+    (void) r;
+}
+
+static uint64_t
+run_swr(const int16_t *packet, unsigned packets, struct sc_audiobuf *buf,
+        float *out) {
+    SwrContext *swr_ctx = create_swr_ctx();
+    if (!swr_ctx) {
+        fprintf(stderr, "Could not create swr context\n");
+        abort();
+    }
+
+    uint8_t *swr_buf = malloc(PACKET_SAMPLES * SAMPLE_SIZE);
+    if (!swr_buf) {
+        fprintf(stderr, "OOM\n");
+        abort();
+    }
+
+    uint64_t start = cpu_time_ns();
+    for (unsigned i = 0; i < packets; ++i) {
+        const uint8_t *in = (const uint8_t *) packet;
+        int ret = swr_convert(swr_ctx, &swr_buf, PACKET_SAMPLES, &in,
+                              PACKET_SAMPLES);
+        assert(ret == PACKET_SAMPLES);
+        (void) ret;
+        uint32_t w = sc_audiobuf_write(buf, swr_buf, PACKET_SAMPLES);
+        assert(w == PACKET_SAMPLES);
+        (void) w;
+        drain(buf, out);
+    }
+    uint64_t elapsed = cpu_time_ns() - start;
+
+    free(swr_buf);
+    swr_free(&swr_ctx);
+
+    return elapsed;
+}
+
+static uint64_t
+run_direct(const int16_t *packet, unsigned packets, struct sc_audiobuf *buf,
+           float *out) {
+    uint64_t start = cpu_time_ns();
+    for (unsigned i = 0; i < packets; ++i) {
+        uint32_t w = sc_audiobuf_write_s16(buf, packet, PACKET_SAMPLES);
+        assert(w == PACKET_SAMPLES);
+        (void) w;
+        drain(buf, out);
+    }
+    return cpu_time_ns() - start;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned seconds = 600;
+    if (argc > 1) {
+        seconds = strtoul(argv[1], NULL, 10);
+        if (!seconds) {
+            fprintf(stderr, "Invalid duration: %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    int16_t packet[PACKET_SAMPLES * CHANNELS];
+    for (size_t i = 0; i < ARRAY_LEN(packet); ++i) {
+        packet[i] = rand();
+    }
+
+    float *out = malloc(PACKET_SAMPLES * SAMPLE_SIZE);
+    if (!out) {
+        fprintf(stderr, "OOM\n");
+        return 1;
+    }
+
+    // A capacity which is not a multiple of the packet size, so that writes
+    // wrap around the end of the ring buffer
+    struct sc_audiobuf buf;
+    bool ok = sc_audiobuf_init(&buf, SAMPLE_SIZE, PACKET_SAMPLES * 3 + 7);
+    if (!ok) {
+        free(out);
+        return 1;
+    }
+
+    unsigned packets = seconds * (SAMPLE_RATE / PACKET_SAMPLES);
+    uint64_t swr = run_swr(packet, packets, &buf, out);
+    uint64_t direct = run_direct(packet, packets, &buf, out);
+
+    printf("%u s of %d Hz stereo audio, CPU time per second of audio:\n",
+           seconds, SAMPLE_RATE);
+    printf("  swr_convert + write  %8.2f us\n", swr / 1000. / seconds);
+    printf("  write_s16 (direct)   %8.2f us\n", direct / 1000. / seconds);
+
+    sc_audiobuf_destroy(&buf);
+    free(out);
+
+    return 0;
+}
@@ -0,0 +1,338 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+
+/**
+ * Simulation benchmark for the clock estimation.
+ *
+ * It replays traces of (stream PTS, arrival date) points, and reports for each
+ * estimator:
+ *  - the latency required so that 95%, 99% and 100% of the frames are not
+ *    late, relative to the average arrival date (lower is better), i.e. the
+ *    percentiles of the lateness minus its mean (so that the values do not
+ *    depend on the reference arrival date chosen by the estimator);
+ *  - the mean and max pacing error, i.e. the difference between the interval
+ *    of the release dates of consecutive frames and the interval of their
+ *    PTS (lower is smoother).
+ *
+ * Usage:
+ *
+ *     bench_clock [trace_file...]
+ *
+ * A trace file contains one point per line: "<pts_us> <arrival_us>" (lines
+ * starting with '#' are ignored). Such a trace may be recorded by logging
+ * the PTS and sc_tick_now() on each frame in sc_delay_buffer_frame_sink_push().
+ *
+ * Without arguments, synthetic traces are generated.
+ */
+
+#define WARMUP 64
+#define FRAME_INTERVAL SC_TICK_FROM_US(16667) // 60 fps
+
+struct point {
+    sc_tick pts;
+    sc_tick arrival;
+};
+
+struct trace {
+    const char *name;
+    struct point *points;
+    size_t count;
+};
+
+// The previous estimator (exponentially weighted offset), for comparison
+#define EWMA_RANGE 32
+
+struct ewma_clock {
+    unsigned range;
+    sc_tick offset;
+};
+
+static void
+ewma_clock_update(struct ewma_clock *clock, sc_tick system, sc_tick stream) {
+    if (clock->range < EWMA_RANGE) {
+        ++clock->range;
+    }
+
+    sc_tick offset = system - stream;
+    unsigned clock_weight = clock->range - 1;
+    unsigned value_weight = EWMA_RANGE - clock->range + 1;
+    clock->offset = (clock->offset * clock_weight + offset * value_weight)
+                  / EWMA_RANGE;
+}
+
+struct estimator {
+    const char *name;
+    void (*init)(void *clock);
+    void (*update)(void *clock, sc_tick system, sc_tick stream);
+    sc_tick (*to_system_time)(void *clock, sc_tick stream);
+    size_t size;
+};
+
+static void
+ewma_init(void *clock) {
+    memset(clock, 0, sizeof(struct ewma_clock));
+}
+
+static void
+ewma_update(void *clock, sc_tick system, sc_tick stream) {
+    ewma_clock_update(clock, system, stream);
+}
+
+static sc_tick
+ewma_to_system_time(void *clock, sc_tick stream) {
+    return stream + ((struct ewma_clock *) clock)->offset;
+}
+
+static void
+envelope_init(void *clock) {
+    sc_clock_init(clock);
+}
+
+static void
+envelope_update(void *clock, sc_tick system, sc_tick stream) {
+    sc_clock_update(clock, system, stream);
+}
+
+static sc_tick
+envelope_to_system_time(void *clock, sc_tick stream) {
+    return sc_clock_to_system_time(clock, stream);
+}
+
+static const struct estimator estimators[] = {
+    {
+        .name = "ewma",
+        .init = ewma_init,
+        .update = ewma_update,
+        .to_system_time = ewma_to_system_time,
+        .size = sizeof(struct ewma_clock),
+    },
+    {
+        .name = "envelope",
+        .init = envelope_init,
+        .update = envelope_update,
+        .to_system_time = envelope_to_system_time,
+        .size = sizeof(struct sc_clock),
+    },
+};
+
+static int
+tick_cmp(const void *a, const void *b) {
+    sc_tick ta = *(const sc_tick *) a;
+    sc_tick tb = *(const sc_tick *) b;
+    return (ta > tb) - (ta < tb);
+}
+
+static sc_tick
+percentile(sc_tick *sorted, size_t count, unsigned p) {
+    assert(count);
+    return sorted[(count - 1) * p / 100];
+}
+
+static void
+run(const struct estimator *est, const struct trace *trace) {
+    void *clock = malloc(est->size);
+    sc_tick *lateness = malloc(trace->count * sizeof(*lateness));
+    if (!clock || !lateness) {
+        fprintf(stderr, "OOM\n");
+        abort();
+    }
+
+    est->init(clock);
+
+    size_t n = 0;
+    sc_tick lateness_sum = 0;
+    sc_tick pacing_sum = 0;
+    sc_tick pacing_max = 0;
+    sc_tick prev_release = 0;
+
+    for (size_t i = 0; i < trace->count; ++i) {
+        const struct point *p = &trace->points[i];
+        est->update(clock, p->arrival, p->pts);
+
+        if (i >= WARMUP) {
+            // Lateness, as measured by the delay buffer
+            sc_tick l = p->arrival - est->to_system_time(clock, p->pts);
+            lateness[n++] = l;
+            lateness_sum += l;
+        }
+
+        if (i > WARMUP) {
+            // The previous frame is released approximately when this one
+            // arrives, according to the current estimation
+            const struct point *prev = &trace->points[i - 1];
+            sc_tick release = est->to_system_time(clock, prev->pts);
+            if (i > WARMUP + 1) {
+                const struct point *prev2 = &trace->points[i - 2];
+                sc_tick err = llabs((release - prev_release)
+                                  - (prev->pts - prev2->pts));
+                pacing_sum += err;
+                pacing_max = MAX(pacing_max, err);
+            }
+            prev_release = release;
+        }
+    }
+
+    if (n > 2) {
+        qsort(lateness, n, sizeof(*lateness), tick_cmp);
+        sc_tick mean = lateness_sum / (sc_tick) n;
+        sc_tick p95 = percentile(lateness, n, 95) - mean;
+        sc_tick p99 = percentile(lateness, n, 99) - mean;
+        sc_tick max = lateness[n - 1] - mean;
+        printf("  %-10s latency p95=%6.2fms p99=%6.2fms max=%7.2fms"
+               "  pacing mean=%5.0fus max=%6" PRItick "us\n",
+               est->name, p95 / 1000., p99 / 1000., max / 1000.,
+               (double) pacing_sum / (n - 2), pacing_max);
+    }
+
+    free(lateness);
+    free(clock);
+}
+
+static uint32_t rand_state = 42;
+
+static sc_tick
+rand_tick(sc_tick max) {
+    rand_state = rand_state * 1664525 + 1013904223;
+    return max ? (rand_state >> 8) % max : 0;
+}
+
+// drift in ppm, uniform jitter, bursts (delayed frames) of a given size
+// every burst_period frames, and a permanent change of the transmission delay
+// in the middle of the trace
+static struct trace
+generate(const char *name, size_t count, int drift_ppm, sc_tick jitter,
+         unsigned burst_period, unsigned burst_size, sc_tick burst_delay,
+         sc_tick step) {
+    struct point *points = malloc(count * sizeof(*points));
+    if (!points) {
+        fprintf(stderr, "OOM\n");
+        abort();
+    }
+
+    sc_tick prev_arrival = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sc_tick pts = i * FRAME_INTERVAL;
+        sc_tick arrival = SC_TICK_FROM_MS(30) + pts
+                        + pts * drift_ppm / 1000000 + rand_tick(jitter);
+        if (i >= count / 2) {
+            arrival += step;
+        }
+        if (burst_period && i % burst_period < burst_size) {
+            // frames stuck then received at once
+            unsigned pos = i % burst_period;
+            arrival += burst_delay - pos * FRAME_INTERVAL;
+        }
+        // frames are received in order
+        arrival = MAX(arrival, prev_arrival);
+        prev_arrival = arrival;
+
+        points[i].pts = pts;
+        points[i].arrival = arrival;
+    }
+
+    struct trace trace = {
+        .name = name,
+        .points = points,
+        .count = count,
+    };
+    return trace;
+}
+
+static bool
+load(const char *filename, struct trace *trace) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        perror(filename);
+        return false;
+    }
+
+    size_t cap = 1024;
+    struct point *points = malloc(cap * sizeof(*points));
+    if (!points) {
+        fclose(file);
+        return false;
+    }
+
+    size_t count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') {
+            continue;
+        }
+        long long pts;
+        long long arrival;
+        if (sscanf(line, "%lld %lld", &pts, &arrival) != 2) {
+            continue;
+        }
+        if (count == cap) {
+            cap *= 2;
+            struct point *p = realloc(points, cap * sizeof(*points));
+            if (!p) {
+                free(points);
+                fclose(file);
+                return false;
+            }
+            points = p;
+        }
+        points[count].pts = pts;
+        points[count].arrival = arrival;
+        ++count;
+    }
+
+    fclose(file);
+
+    trace->name = filename;
+    trace->points = points;
+    trace->count = count;
+    return true;
+}
+
+static void
+bench(struct trace *trace) {
+    printf("%s (%zu frames)\n", trace->name, trace->count);
+    for (size_t i = 0; i < ARRAY_LEN(estimators); ++i) {
+        run(&estimators[i], trace);
+    }
+    free(trace->points);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) {
+            struct trace trace;
+            if (!load(argv[i], &trace)) {
+                return 1;
+            }
+            bench(&trace);
+        }
+        return 0;
+    }
+
+    // 5 minutes at 60 fps
+    size_t count = 5 * 60 * 60;
+
+    struct trace traces[] = {
+        generate("usb", count, 0, SC_TICK_FROM_MS(1), 0, 0, 0, 0),
+        generate("usb, 300 ppm drift", count, 300, SC_TICK_FROM_MS(1),
+                 0, 0, 0, 0),
+        generate("wifi", count, 50, SC_TICK_FROM_MS(8), 0, 0, 0, 0),
+        generate("wifi with bursts", count, 50, SC_TICK_FROM_MS(8),
+                 120, 6, SC_TICK_FROM_MS(150), 0),
+        generate("wifi, +20 ms delay step", count, 50, SC_TICK_FROM_MS(8),
+                 0, 0, 0, SC_TICK_FROM_MS(20)),
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(traces); ++i) {
+        bench(&traces[i]);
+    }
+
+    return 0;
+}
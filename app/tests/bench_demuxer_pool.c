@@ -0,0 +1,353 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <libavcodec/avcodec.h>
+
+#include "demuxer.h"
+#include "demuxer_pool.h"
+#include "trait/packet_sink.h"
+#include "util/binary.h"
+#include "util/histogram.h"
+#include "util/net.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Benchmark of the demuxer pool (used to mirror several devices from a single
+ * process) against one demuxer thread per stream.
+ *
+ * This does not run N separate scrcpy processes (which would require N
+ * devices): the "threads" mode only reproduces their receiving side (one
+ * demuxer thread per stream), so the per-process costs (decoders, windows,
+ * adb and the other threads) are not measured.
+ *
+ * Each stream is a localhost TCP connection fed by a sender thread, using the
+ * "raw" codec (so that no real decoder is involved). The PTS of each packet is
+ * its send date, so that the sink measures the delivery latency.
+ *
+ * Two scenarios are run for each mode:
+ *  - "paced": each stream sends 60 packets per second, to measure the latency
+ *    and the CPU time;
+ *  - "flood": each stream sends its packets as fast as possible, to measure
+ *    the throughput (the latencies then mostly measure the time spent in the
+ *    socket buffers).
+ *
+ * The CPU time is measured for the whole process, so it includes the sender
+ * threads (which are identical in both modes).
+ *
+ * Usage:
+ *
+ *     bench_demuxer_pool [stream_count]
+ */
+
+#define DEFAULT_STREAM_COUNT 8
+#define MAX_STREAM_COUNT SC_DEMUXER_POOL_MAX_DEMUXERS
+
+#define PACKET_SIZE (16 * 1024)
+#define PACED_PACKET_COUNT 120 // 2 seconds at 60 fps
+#define PACED_INTERVAL SC_TICK_FROM_US(16667)
+#define FLOOD_PACKET_COUNT 2000
+
+#define PORT_FIRST 27300
+#define PORT_LAST 27399
+
+#define SC_CODEC_ID_RAW UINT32_C(0x00726177) // "raw" in ASCII
+
+struct stream {
+    struct sc_demuxer demuxer;
+    struct sc_packet_sink sink;
+    struct sc_histogram latency;
+    uint64_t bytes;
+
+    sc_socket sender_socket;
+    sc_thread sender_thread;
+    unsigned packet_count;
+    sc_tick interval; // 0 to send as fast as possible
+};
+
+struct result {
+    sc_tick duration;
+    sc_tick cpu;
+    unsigned threads;
+    uint64_t bytes;
+    uint32_t packets;
+    sc_tick p50;
+    sc_tick p99;
+    sc_tick max;
+};
+
+static struct stream streams[MAX_STREAM_COUNT];
+static atomic_uint ended_count;
+
+#define DOWNCAST(SINK) container_of(SINK, struct stream, sink)
+
+static bool
+sink_open(struct sc_packet_sink *sink, AVCodecContext *ctx) {
+    (void) sink;
+    (void) ctx;
+    return true;
+}
+
+static void
+sink_close(struct sc_packet_sink *sink) {
+    (void) sink;
+}
+
+static bool
+sink_push(struct sc_packet_sink *sink, const AVPacket *packet) {
+    struct stream *stream = DOWNCAST(sink);
+    sc_histogram_record(&stream->latency, sc_tick_now() - packet->pts);
+    stream->bytes += packet->size;
+    return true;
+}
+
+static void
+on_demuxer_ended(struct sc_demuxer *demuxer, enum sc_demuxer_status status,
+                 void *userdata) {
+    (void) demuxer;
+    (void) userdata;
+    assert(status == SC_DEMUXER_STATUS_EOS);
+    (void) status;
+    atomic_fetch_add(&ended_count, 1);
+}
+
+static int
+run_sender(void *data) {
+    struct stream *stream = data;
+
+    uint8_t codec_id[4];
+    sc_write32be(codec_id, SC_CODEC_ID_RAW);
+    ssize_t w = net_send_all(stream->sender_socket, codec_id, 4);
+    assert(w == 4);
+
+    // 12-byte packet header (PTS and size), the payload content is irrelevant
+    uint8_t *buf = calloc(1, 12 + PACKET_SIZE);
+    assert(buf);
+    sc_write32be(&buf[8], PACKET_SIZE);
+
+    sc_tick start = sc_tick_now();
+    for (unsigned i = 0; i < stream->packet_count; ++i) {
+        if (stream->interval) {
+            sc_tick deadline = start + i * stream->interval;
+            sc_tick now = sc_tick_now();
+            if (now < deadline) {
+                usleep(deadline - now);
+            }
+        }
+
+        sc_write64be(buf, sc_tick_now());
+        w = net_send_all(stream->sender_socket, buf, 12 + PACKET_SIZE);
+        assert(w == 12 + PACKET_SIZE);
+        (void) w;
+    }
+
+    free(buf);
+
+    // End of stream
+    net_close(stream->sender_socket);
+    return 0;
+}
+
+static sc_tick
+cpu_time(void) {
+    struct rusage usage;
+    int r = getrusage(RUSAGE_SELF, &usage);
+    assert(!r);
+    (void) r;
+    return SC_TICK_FROM_SEC(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+         + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static sc_socket
+listen_localhost(uint16_t *port) {
+    for (uint16_t p = PORT_FIRST; p <= PORT_LAST; ++p) {
+        sc_socket server_socket = net_socket();
+        assert(server_socket != SC_SOCKET_NONE);
+        if (net_listen(server_socket, IPV4_LOCALHOST, p, MAX_STREAM_COUNT)) {
+            *port = p;
+            return server_socket;
+        }
+        net_close(server_socket);
+    }
+
+    fprintf(stderr, "Could not listen on localhost\n");
+    abort();
+}
+
+static void
+run(unsigned stream_count, unsigned worker_count, unsigned packet_count,
+    sc_tick interval, struct result *result) {
+    static const struct sc_packet_sink_ops sink_ops = {
+        .open = sink_open,
+        .close = sink_close,
+        .push = sink_push,
+    };
+    static const struct sc_demuxer_callbacks demuxer_cbs = {
+        .on_ended = on_demuxer_ended,
+    };
+
+    uint16_t port;
+    sc_socket server_socket = listen_localhost(&port);
+
+    for (unsigned i = 0; i < stream_count; ++i) {
+        struct stream *stream = &streams[i];
+
+        stream->sender_socket = net_socket();
+        assert(stream->sender_socket != SC_SOCKET_NONE);
+        bool ok = net_connect(stream->sender_socket, IPV4_LOCALHOST, port);
+        assert(ok);
+        (void) ok;
+        net_set_tcp_nodelay(stream->sender_socket, true);
+
+        sc_socket socket = net_accept(server_socket);
+        assert(socket != SC_SOCKET_NONE);
+
+        sc_demuxer_init(&stream->demuxer, "bench", socket, &demuxer_cbs,
+                        NULL);
+        stream->sink.ops = &sink_ops;
+        sc_packet_source_add_sink(&stream->demuxer.packet_source,
+                                  &stream->sink);
+        sc_histogram_init(&stream->latency);
+        stream->bytes = 0;
+        stream->packet_count = packet_count;
+        stream->interval = interval;
+    }
+
+    net_close(server_socket);
+
+    atomic_store(&ended_count, 0);
+
+    static struct sc_demuxer_pool pool;
+    if (worker_count) {
+        sc_demuxer_pool_init(&pool, worker_count);
+        for (unsigned i = 0; i < stream_count; ++i) {
+            sc_demuxer_pool_add(&pool, &streams[i].demuxer);
+        }
+    }
+
+    sc_tick cpu_start = cpu_time();
+    sc_tick start = sc_tick_now();
+
+    bool ok;
+    if (worker_count) {
+        ok = sc_demuxer_pool_start(&pool);
+        assert(ok);
+    } else {
+        for (unsigned i = 0; i < stream_count; ++i) {
+            ok = sc_demuxer_start(&streams[i].demuxer);
+            assert(ok);
+        }
+    }
+
+    for (unsigned i = 0; i < stream_count; ++i) {
+        struct stream *stream = &streams[i];
+        ok = sc_thread_create(&stream->sender_thread, run_sender,
+                              "bench-sender", stream);
+        assert(ok);
+    }
+    (void) ok;
+
+    for (unsigned i = 0; i < stream_count; ++i) {
+        sc_thread_join(&streams[i].sender_thread, NULL);
+    }
+
+    if (worker_count) {
+        sc_demuxer_pool_join(&pool);
+    } else {
+        for (unsigned i = 0; i < stream_count; ++i) {
+            sc_demuxer_join(&streams[i].demuxer);
+        }
+    }
+
+    result->duration = sc_tick_now() - start;
+    result->cpu = cpu_time() - cpu_start;
+    assert(atomic_load(&ended_count) == stream_count);
+
+    // Merge the latencies of all the streams (quantiles are estimated from
+    // the histograms of each stream: keep the worst)
+    result->threads = worker_count ? worker_count : stream_count;
+    result->bytes = 0;
+    result->packets = 0;
+    result->p50 = 0;
+    result->p99 = 0;
+    result->max = 0;
+    for (unsigned i = 0; i < stream_count; ++i) {
+        struct stream *stream = &streams[i];
+        net_close(stream->demuxer.socket);
+
+        result->bytes += stream->bytes;
+        result->packets += sc_histogram_count(&stream->latency);
+        result->p50 = MAX(result->p50,
+                          sc_histogram_quantile(&stream->latency, 500));
+        result->p99 = MAX(result->p99,
+                          sc_histogram_quantile(&stream->latency, 990));
+        result->max = MAX(result->max, sc_histogram_max(&stream->latency));
+    }
+
+    assert(result->packets == stream_count * packet_count);
+}
+
+static void
+print_result(const char *mode, const char *scenario,
+             const struct result *result) {
+    double seconds = (double) result->duration / SC_TICK_FREQ;
+    double mib = (double) result->bytes / (1024 * 1024);
+    printf("%-8s %-6s %7u %9.1f %8.1f %9" PRItick " %9" PRItick " %9" PRItick
+           " %8.1f\n", mode, scenario, result->threads, mib / seconds,
+           (double) SC_TICK_TO_MS(result->cpu),
+           result->p50, result->p99, result->max,
+           100.0 * result->cpu / result->duration);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned stream_count = DEFAULT_STREAM_COUNT;
+    if (argc > 1) {
+        stream_count = strtoul(argv[1], NULL, 10);
+        if (!stream_count || stream_count > MAX_STREAM_COUNT) {
+            fprintf(stderr, "Invalid stream count (1-%u)\n",
+                    MAX_STREAM_COUNT);
+            return 1;
+        }
+    }
+
+    if (!net_init()) {
+        return 1;
+    }
+
+    // Like scrcpy_multi(): at most one worker per CPU
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned worker_count = MIN(stream_count, (unsigned) MAX(cpus, 1));
+    worker_count = MIN(worker_count, SC_DEMUXER_POOL_MAX_WORKERS);
+
+    printf("%u streams of %u-byte packets, %u CPUs\n", stream_count,
+           PACKET_SIZE, (unsigned) MAX(cpus, 1));
+    printf("latencies in microseconds (worst stream)\n");
+    printf("\"threads\" is one demuxer thread per stream, as in N scrcpy "
+           "processes\n(only the receiving side is compared, not N whole "
+           "processes)\n\n");
+    printf("mode     scen.  threads     MiB/s   cpu_ms       p50       p99"
+           "       max     cpu%%\n");
+
+    struct result result;
+
+    run(stream_count, 0, PACED_PACKET_COUNT, PACED_INTERVAL, &result);
+    print_result("threads", "paced", &result);
+    run(stream_count, worker_count, PACED_PACKET_COUNT, PACED_INTERVAL,
+        &result);
+    print_result("pool", "paced", &result);
+
+    run(stream_count, 0, FLOOD_PACKET_COUNT, 0, &result);
+    print_result("threads", "flood", &result);
+    run(stream_count, worker_count, FLOOD_PACKET_COUNT, 0, &result);
+    print_result("pool", "flood", &result);
+
+    net_cleanup();
+    return 0;
+}
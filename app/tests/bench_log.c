@@ -0,0 +1,133 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "util/histogram.h"
+#include "util/log.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Benchmark of the logging cost for the calling threads, with synchronous
+ * and asynchronous logging.
+ *
+ * Several threads log verbose lines (like the controller and the receiver
+ * with -V verbose), and the time spent in each LOGV() call is measured.
+ *
+ * Two scenarios are run for each mode:
+ *  - "paced": each thread logs one line every 100 microseconds;
+ *  - "burst": each thread logs its lines as fast as possible (in asynchronous
+ *    mode, most of them are dropped, and the count is logged).
+ *
+ * The log lines are written to stdout, and the results to stderr, so the
+ * output may be redirected to a file, a pipe or a terminal to compare their
+ * impact:
+ *
+ *     bench_log >/dev/null
+ */
+
+#define THREAD_COUNT 4
+#define LINE_COUNT 5000
+#define PACED_INTERVAL SC_TICK_FROM_US(100)
+
+struct logger_thread {
+    sc_thread thread;
+    unsigned index;
+    sc_tick interval; // 0 to log as fast as possible
+    struct sc_histogram latency;
+    sc_tick total;
+};
+
+static struct logger_thread threads[THREAD_COUNT];
+
+static int
+run_logger(void *data) {
+    struct logger_thread *t = data;
+
+    sc_tick start = sc_tick_now();
+    for (unsigned i = 0; i < LINE_COUNT; ++i) {
+        if (t->interval) {
+            sc_tick deadline = start + i * t->interval;
+            sc_tick now = sc_tick_now();
+            if (now < deadline) {
+                usleep(deadline - now);
+            }
+        }
+
+        sc_tick before = sc_tick_now();
+        LOGV("-> msg type=%d thread=%u seq=%u data=%s", 2, t->index, i,
+             "04 00 2a 00 00 00 00 00 00 01 c2 00 00 03 b1 04 38 09 60");
+        sc_tick latency = sc_tick_now() - before;
+
+        sc_histogram_record(&t->latency, latency);
+        t->total += latency;
+    }
+
+    return 0;
+}
+
+static void
+run(const char *mode, const char *scenario, sc_tick interval) {
+    for (unsigned i = 0; i < THREAD_COUNT; ++i) {
+        struct logger_thread *t = &threads[i];
+        t->index = i;
+        t->interval = interval;
+        sc_histogram_init(&t->latency);
+        t->total = 0;
+
+        bool ok = sc_thread_create(&t->thread, run_logger, "bench-logger", t);
+        assert(ok);
+        (void) ok;
+    }
+
+    sc_tick total = 0;
+    sc_tick p50 = 0;
+    sc_tick p99 = 0;
+    sc_tick max = 0;
+    for (unsigned i = 0; i < THREAD_COUNT; ++i) {
+        struct logger_thread *t = &threads[i];
+        sc_thread_join(&t->thread, NULL);
+
+        // Keep the worst thread
+        total += t->total;
+        p50 = MAX(p50, sc_histogram_quantile(&t->latency, 500));
+        p99 = MAX(p99, sc_histogram_quantile(&t->latency, 990));
+        max = MAX(max, sc_histogram_max(&t->latency));
+    }
+
+    double mean_ns = 1000.0 * total / (THREAD_COUNT * LINE_COUNT);
+    fprintf(stderr, "%-6s %-6s %9.0f %9" PRItick " %9" PRItick " %9" PRItick
+            "\n", mode, scenario, mean_ns, p50, p99, max);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_VERBOSE);
+    sc_log_configure();
+
+    fprintf(stderr, "%u threads, %u lines per thread\n", THREAD_COUNT,
+            LINE_COUNT);
+    fprintf(stderr, "latencies in microseconds (worst thread)\n\n");
+    fprintf(stderr, "mode   scen.    mean_ns       p50       p99       max\n");
+
+    run("sync", "paced", PACED_INTERVAL);
+    run("sync", "burst", 0);
+
+    bool ok = sc_log_start_async();
+    if (!ok) {
+        return 1;
+    }
+
+    run("async", "paced", PACED_INTERVAL);
+    run("async", "burst", 0);
+
+    sc_log_stop_async();
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "adaptive_audio_buffer.h"
+
+#define SAMPLE_RATE 48000
+#define MS(X) ((X) * SAMPLE_RATE / 1000)
+
+static void test_adaptive_audio_buffer_stable(void) {
+    struct sc_adaptive_audio_buffer aab;
+    sc_adaptive_audio_buffer_init(&aab, MS(50), MS(10), MS(200), SAMPLE_RATE);
+    assert(aab.target == MS(50));
+
+    // Do not lower the target too early
+    uint32_t target;
+    for (int i = 0; i < 30; ++i) {
+        target = sc_adaptive_audio_buffer_update(&aab, 0);
+        assert(target == MS(50));
+    }
+
+    // Then lower it slowly
+    uint32_t prev = target;
+    for (int i = 0; i < 60; ++i) {
+        target = sc_adaptive_audio_buffer_update(&aab, 0);
+        assert(target < prev);
+        prev = target;
+    }
+    assert(target > MS(30));
+
+    for (int i = 0; i < 10000; ++i) {
+        target = sc_adaptive_audio_buffer_update(&aab, 0);
+    }
+    assert(target == MS(10));
+}
+
+static void test_adaptive_audio_buffer_isolated_glitch(void) {
+    struct sc_adaptive_audio_buffer aab;
+    sc_adaptive_audio_buffer_init(&aab, MS(50), MS(10), MS(200), SAMPLE_RATE);
+
+    // A glitch every 20 seconds is not a cluster
+    for (int i = 0; i < 100; ++i) {
+        uint32_t target = sc_adaptive_audio_buffer_update(&aab, i % 20 == 0);
+        assert(target == MS(50));
+    }
+}
+
+static void test_adaptive_audio_buffer_clustered_glitches(void) {
+    struct sc_adaptive_audio_buffer aab;
+    sc_adaptive_audio_buffer_init(&aab, MS(50), MS(10), MS(200), SAMPLE_RATE);
+
+    uint32_t target = sc_adaptive_audio_buffer_update(&aab, 1);
+    assert(target == MS(50));
+
+    // A second glitch within a few seconds raises the target
+    sc_adaptive_audio_buffer_update(&aab, 0);
+    target = sc_adaptive_audio_buffer_update(&aab, 1);
+    assert(target > MS(50));
+
+    // Do not raise again immediately, let the compensation catch up
+    uint32_t raised = target;
+    target = sc_adaptive_audio_buffer_update(&aab, 1);
+    assert(target == raised);
+
+    // Several glitches in the same second form a cluster
+    for (int i = 0; i < 100; ++i) {
+        target = sc_adaptive_audio_buffer_update(&aab, 3);
+    }
+    assert(target == MS(200));
+}
+
+static void test_adaptive_audio_buffer_min(void) {
+    struct sc_adaptive_audio_buffer aab;
+    sc_adaptive_audio_buffer_init(&aab, MS(50), MS(10), MS(200), SAMPLE_RATE);
+
+    // Packets of ~85ms (e.g. FLAC)
+    sc_adaptive_audio_buffer_set_min(&aab, 4096);
+    assert(aab.target == 4096);
+
+    for (int i = 0; i < 10000; ++i) {
+        uint32_t target = sc_adaptive_audio_buffer_update(&aab, 0);
+        assert(target == 4096);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_adaptive_audio_buffer_stable();
+    test_adaptive_audio_buffer_isolated_glitch();
+    test_adaptive_audio_buffer_clustered_glitches();
+    test_adaptive_audio_buffer_min();
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptive_delay.h"
+
+static void test_adaptive_delay_no_jitter(void) {
+    struct sc_adaptive_delay ad;
+    sc_adaptive_delay_init(&ad, SC_TICK_FROM_MS(200));
+
+    for (int i = 0; i < 1000; ++i) {
+        sc_tick delay = sc_adaptive_delay_push(&ad, 0);
+        assert(delay == 0);
+    }
+}
+
+static void test_adaptive_delay_jitter(void) {
+    struct sc_adaptive_delay ad;
+    sc_adaptive_delay_init(&ad, SC_TICK_FROM_MS(200));
+
+    sc_tick delay = 0;
+    for (int i = 0; i < 1000; ++i) {
+        // 1 frame out of 10 is late by 30ms
+        sc_tick lateness = i % 10 ? 0 : SC_TICK_FROM_MS(30);
+        delay = sc_adaptive_delay_push(&ad, lateness);
+    }
+
+    assert(delay == SC_TICK_FROM_MS(30));
+
+    // Once the network is stable, the delay decreases slowly
+    sc_tick prev = delay;
+    for (int i = 0; i < SC_ADAPTIVE_DELAY_WINDOW; ++i) {
+        delay = sc_adaptive_delay_push(&ad, 0);
+        assert(delay <= prev);
+        prev = delay;
+    }
+    assert(delay > 0);
+
+    for (int i = 0; i < 10000; ++i) {
+        delay = sc_adaptive_delay_push(&ad, 0);
+    }
+    assert(delay < SC_TICK_FROM_MS(1));
+}
+
+static void test_adaptive_delay_max(void) {
+    struct sc_adaptive_delay ad;
+    sc_adaptive_delay_init(&ad, SC_TICK_FROM_MS(50));
+
+    sc_tick delay = 0;
+    for (int i = 0; i < 1000; ++i) {
+        delay = sc_adaptive_delay_push(&ad, SC_TICK_FROM_MS(500));
+    }
+
+    assert(delay == SC_TICK_FROM_MS(50));
+}
+
+static int
+tick_cmp(const void *a, const void *b) {
+    sc_tick ta = *(const sc_tick *) a;
+    sc_tick tb = *(const sc_tick *) b;
+    return (ta > tb) - (ta < tb);
+}
+
+static void test_adaptive_delay_sorted_window(void) {
+    struct sc_adaptive_delay ad;
+    sc_adaptive_delay_init(&ad, SC_TICK_FROM_MS(200));
+
+    uint32_t state = 42;
+    for (int i = 0; i < 3 * SC_ADAPTIVE_DELAY_WINDOW; ++i) {
+        // Include duplicates and negative values
+        state = state * 1103515245 + 12345;
+        sc_tick lateness = SC_TICK_FROM_MS((int) (state >> 16) % 50 - 10);
+        sc_adaptive_delay_push(&ad, lateness);
+
+        // The incrementally sorted window must match the samples
+        sc_tick expected[SC_ADAPTIVE_DELAY_WINDOW];
+        memcpy(expected, ad.samples, ad.count * sizeof(*expected));
+        qsort(expected, ad.count, sizeof(*expected), tick_cmp);
+        assert(!memcmp(expected, ad.sorted, ad.count * sizeof(*expected)));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_adaptive_delay_no_jitter();
+    test_adaptive_delay_jitter();
+    test_adaptive_delay_max();
+    test_adaptive_delay_sorted_window();
+    return 0;
+}
@@ -0,0 +1,383 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "hid/hid_gamepad.h"
+#include "hid/hid_keyboard.h"
+#include "hid/hid_mouse.h"
+#include "trait/aoa_transport.h"
+#include "usb/aoa_hid.h"
+#include "util/thread.h"
+
+#define MOCK_LOG_CAPACITY 64
+
+struct mock_request {
+    uint8_t request;
+    uint16_t value;
+    struct sc_hid_input hid; // only for SEND_HID_EVENT
+};
+
+/**
+ * Transport which does not talk to any device
+ *
+ * It records all the requests, and keeps the asynchronous transfers pending
+ * until the test completes them explicitly.
+ */
+struct mock_transport {
+    struct sc_aoa_transport transport;
+
+    sc_mutex mutex;
+    sc_cond cond;
+
+    struct mock_request log[MOCK_LOG_CAPACITY];
+    unsigned log_count;
+
+    struct sc_aoa_transfer *pending[SC_AOA_MAX_IN_FLIGHT + 1];
+    unsigned pending_count;
+    unsigned max_pending;
+};
+
+#define DOWNCAST(T) container_of(T, struct mock_transport, transport)
+
+static void
+mock_append(struct mock_transport *mt, uint8_t request, uint16_t value,
+            const struct sc_hid_input *hid) {
+    // mutex locked
+    assert(mt->log_count < MOCK_LOG_CAPACITY);
+    struct mock_request *req = &mt->log[mt->log_count++];
+    req->request = request;
+    req->value = value;
+    if (hid) {
+        req->hid = *hid;
+    }
+    sc_cond_broadcast(&mt->cond);
+}
+
+static bool
+mock_control(struct sc_aoa_transport *transport, uint8_t request,
+             uint16_t value, uint16_t index, const uint8_t *data,
+             uint16_t length) {
+    (void) index;
+    (void) data;
+    (void) length;
+    struct mock_transport *mt = DOWNCAST(transport);
+
+    sc_mutex_lock(&mt->mutex);
+    mock_append(mt, request, value, NULL);
+    sc_mutex_unlock(&mt->mutex);
+    return true;
+}
+
+static bool
+mock_submit(struct sc_aoa_transport *transport,
+            struct sc_aoa_transfer *transfer) {
+    struct mock_transport *mt = DOWNCAST(transport);
+
+    sc_mutex_lock(&mt->mutex);
+    assert(mt->pending_count < ARRAY_LEN(mt->pending));
+    mt->pending[mt->pending_count++] = transfer;
+    mt->max_pending = MAX(mt->max_pending, mt->pending_count);
+    mock_append(mt, SC_AOA_REQUEST_SEND_HID_EVENT, transfer->hid.hid_id,
+                &transfer->hid);
+    sc_mutex_unlock(&mt->mutex);
+    return true;
+}
+
+static void
+mock_init(struct mock_transport *mt) {
+    bool ok = sc_mutex_init(&mt->mutex);
+    assert(ok);
+    ok = sc_cond_init(&mt->cond);
+    assert(ok);
+    (void) ok;
+
+    mt->log_count = 0;
+    mt->pending_count = 0;
+    mt->max_pending = 0;
+
+    static const struct sc_aoa_transport_ops ops = {
+        .control = mock_control,
+        .submit = mock_submit,
+    };
+    mt->transport.ops = &ops;
+}
+
+static void
+mock_destroy(struct mock_transport *mt) {
+    sc_cond_destroy(&mt->cond);
+    sc_mutex_destroy(&mt->mutex);
+}
+
+static void
+mock_wait_log(struct mock_transport *mt, unsigned count) {
+    sc_mutex_lock(&mt->mutex);
+    while (mt->log_count < count) {
+        sc_cond_wait(&mt->cond, &mt->mutex);
+    }
+    sc_mutex_unlock(&mt->mutex);
+}
+
+static void
+mock_complete_all(struct mock_transport *mt) {
+    sc_mutex_lock(&mt->mutex);
+    struct sc_aoa_transfer *pending[ARRAY_LEN(mt->pending)];
+    unsigned count = mt->pending_count;
+    memcpy(pending, mt->pending, count * sizeof(*pending));
+    mt->pending_count = 0;
+    sc_mutex_unlock(&mt->mutex);
+
+    for (unsigned i = 0; i < count; ++i) {
+        pending[i]->on_complete(pending[i], true, pending[i]->userdata);
+    }
+}
+
+static const uint8_t report_desc[] = {0x05, 0x01};
+
+static void
+push_open(struct sc_aoa *aoa, uint16_t hid_id) {
+    struct sc_hid_open hid_open = {
+        .hid_id = hid_id,
+        .report_desc = report_desc,
+        .report_desc_size = sizeof(report_desc),
+    };
+    bool ok = sc_aoa_push_open(aoa, &hid_open, false);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+push_mouse(struct sc_aoa *aoa, uint8_t buttons, int8_t dx, int8_t dy) {
+    struct sc_hid_input hid_input = {
+        .hid_id = SC_HID_ID_MOUSE,
+        .data = {buttons, dx, dy, 0},
+        .size = 4,
+    };
+    bool ok = sc_aoa_push_input(aoa, &hid_input);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+push_gamepad(struct sc_aoa *aoa, uint8_t axis, uint8_t buttons) {
+    struct sc_hid_input hid_input = {
+        .hid_id = SC_HID_ID_GAMEPAD_FIRST,
+        .data = {axis, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, buttons, 0, 0},
+        .size = 15,
+    };
+    bool ok = sc_aoa_push_input(aoa, &hid_input);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+push_key(struct sc_aoa *aoa, uint8_t key) {
+    struct sc_hid_input hid_input = {
+        .hid_id = SC_HID_ID_KEYBOARD,
+        .data = {0, 0, key, 0, 0, 0, 0, 0},
+        .size = 8,
+    };
+    bool ok = sc_aoa_push_input(aoa, &hid_input);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+start(struct sc_aoa *aoa, struct mock_transport *mt) {
+    mock_init(mt);
+    bool ok = sc_aoa_init(aoa, &mt->transport, NULL);
+    assert(ok);
+    ok = sc_aoa_start(aoa);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+stop(struct sc_aoa *aoa, struct mock_transport *mt) {
+    sc_aoa_stop(aoa);
+    sc_aoa_join(aoa);
+    assert(mt->max_pending <= SC_AOA_MAX_IN_FLIGHT);
+}
+
+static void
+destroy(struct sc_aoa *aoa, struct mock_transport *mt) {
+    sc_aoa_destroy(aoa);
+    mock_destroy(mt);
+}
+
+// Fill the transfer window so that the next events stay in the queue
+static unsigned
+fill_window(struct sc_aoa *aoa, struct mock_transport *mt, unsigned log) {
+    for (unsigned i = 0; i < SC_AOA_MAX_IN_FLIGHT; ++i) {
+        // Clicks are never coalesced
+        push_mouse(aoa, i % 2, 0, 0);
+    }
+    log += SC_AOA_MAX_IN_FLIGHT;
+    mock_wait_log(mt, log);
+    return log;
+}
+
+static void test_coalesce_mouse(void) {
+    struct mock_transport mt;
+    struct sc_aoa aoa;
+    start(&aoa, &mt);
+
+    push_open(&aoa, SC_HID_ID_MOUSE);
+    unsigned log = fill_window(&aoa, &mt, 2); // REGISTER + SET_REPORT_DESC
+
+    for (int i = 0; i < 10; ++i) {
+        push_mouse(&aoa, 0, 1, -2);
+    }
+    push_mouse(&aoa, 1, 0, 0); // click
+    for (int i = 0; i < 3; ++i) {
+        push_mouse(&aoa, 1, 50, 0);
+    }
+
+    mock_complete_all(&mt);
+    // 10 motions, the click, then 2 motions (100 + 50 > 127)
+    log += 4;
+    mock_wait_log(&mt, log);
+    mock_complete_all(&mt);
+
+    struct mock_request *r = &mt.log[2 + SC_AOA_MAX_IN_FLIGHT];
+    assert(r[0].request == SC_AOA_REQUEST_SEND_HID_EVENT);
+    assert(r[0].hid.data[0] == 0);
+    assert((int8_t) r[0].hid.data[1] == 10);
+    assert((int8_t) r[0].hid.data[2] == -20);
+
+    assert(r[1].hid.data[0] == 1);
+    assert(r[1].hid.data[1] == 0);
+    assert(r[1].hid.data[2] == 0);
+
+    assert(r[2].hid.data[0] == 1);
+    assert(r[2].hid.data[1] == 100);
+    assert(r[3].hid.data[0] == 1);
+    assert(r[3].hid.data[1] == 50);
+    (void) r;
+
+    stop(&aoa, &mt);
+    assert(mt.log_count == log + 1); // UNREGISTER on exit
+    assert(aoa.coalesced == 9 + 1);
+    assert(sc_histogram_count(&aoa.latencies) == SC_AOA_MAX_IN_FLIGHT + 4);
+    destroy(&aoa, &mt);
+}
+
+static void test_coalesce_gamepad(void) {
+    struct mock_transport mt;
+    struct sc_aoa aoa;
+    start(&aoa, &mt);
+
+    push_open(&aoa, SC_HID_ID_MOUSE);
+    push_open(&aoa, SC_HID_ID_GAMEPAD_FIRST);
+    unsigned log = fill_window(&aoa, &mt, 4);
+
+    for (int i = 0; i < 10; ++i) {
+        push_gamepad(&aoa, i, 0);
+    }
+    push_gamepad(&aoa, 10, 1); // button pressed
+    push_gamepad(&aoa, 11, 1);
+    push_gamepad(&aoa, 12, 0); // button released
+
+    mock_complete_all(&mt);
+    log += 3;
+    mock_wait_log(&mt, log);
+    mock_complete_all(&mt);
+
+    struct mock_request *r = &mt.log[4 + SC_AOA_MAX_IN_FLIGHT];
+    // The axes values are the most recent ones
+    assert(r[0].hid.data[0] == 9 && r[0].hid.data[12] == 0);
+    assert(r[1].hid.data[0] == 11 && r[1].hid.data[12] == 1);
+    assert(r[2].hid.data[0] == 12 && r[2].hid.data[12] == 0);
+    (void) r;
+
+    stop(&aoa, &mt);
+    assert(aoa.coalesced == 9 + 1);
+    destroy(&aoa, &mt);
+}
+
+static void test_no_coalesce_keyboard(void) {
+    struct mock_transport mt;
+    struct sc_aoa aoa;
+    start(&aoa, &mt);
+
+    push_open(&aoa, SC_HID_ID_MOUSE);
+    push_open(&aoa, SC_HID_ID_KEYBOARD);
+    unsigned log = fill_window(&aoa, &mt, 4);
+
+    // Press and release the same key several times
+    for (int i = 0; i < 3; ++i) {
+        push_key(&aoa, 0x04);
+        push_key(&aoa, 0);
+    }
+
+    // Complete the transfers progressively
+    log += 6;
+    for (unsigned i = 0; mt.log_count < log; ++i) {
+        assert(i < 100);
+        mock_complete_all(&mt);
+        sc_mutex_lock(&mt.mutex);
+        if (mt.log_count < log && !mt.pending_count) {
+            // Wait for the next submission
+            sc_cond_wait(&mt.cond, &mt.mutex);
+        }
+        sc_mutex_unlock(&mt.mutex);
+    }
+    mock_complete_all(&mt);
+
+    struct mock_request *r = &mt.log[4 + SC_AOA_MAX_IN_FLIGHT];
+    for (int i = 0; i < 6; ++i) {
+        assert(r[i].value == SC_HID_ID_KEYBOARD);
+        assert(r[i].hid.data[2] == (i % 2 ? 0 : 0x04));
+    }
+    (void) r;
+
+    stop(&aoa, &mt);
+    assert(aoa.coalesced == 0);
+    destroy(&aoa, &mt);
+}
+
+static void test_close_after_transfers(void) {
+    struct mock_transport mt;
+    struct sc_aoa aoa;
+    start(&aoa, &mt);
+
+    push_open(&aoa, SC_HID_ID_MOUSE);
+    push_mouse(&aoa, 0, 1, 1);
+    push_mouse(&aoa, 1, 0, 0);
+    struct sc_hid_close hid_close = {.hid_id = SC_HID_ID_MOUSE};
+    bool ok = sc_aoa_push_close(&aoa, &hid_close);
+    assert(ok);
+    (void) ok;
+
+    mock_wait_log(&mt, 4);
+
+    // The CLOSE request must not be sent while transfers are pending
+    sc_mutex_lock(&mt.mutex);
+    assert(mt.pending_count == 2);
+    bool timed_out = !sc_cond_timedwait(&mt.cond, &mt.mutex,
+                                        sc_tick_now() + SC_TICK_FROM_MS(50));
+    assert(timed_out);
+    assert(mt.log_count == 4);
+    (void) timed_out;
+    sc_mutex_unlock(&mt.mutex);
+
+    mock_complete_all(&mt);
+    mock_wait_log(&mt, 5);
+    assert(mt.log[4].request == SC_AOA_REQUEST_UNREGISTER_HID);
+
+    stop(&aoa, &mt);
+    // Already closed, not unregistered again on exit
+    assert(mt.log_count == 5);
+    destroy(&aoa, &mt);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_coalesce_mouse();
+    test_coalesce_gamepad();
+    test_no_coalesce_keyboard();
+    test_close_after_transfers();
+    return 0;
+}
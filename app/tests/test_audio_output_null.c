@@ -0,0 +1,87 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "audio/audio_output_null.h"
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 2
+
+struct pull_state {
+    uint32_t calls;
+    uint32_t next; // next sample index
+};
+
+static void
+pull(uint8_t *out, uint32_t samples, void *userdata) {
+    struct pull_state *state = userdata;
+    float *f = (float *) out;
+    for (uint32_t i = 0; i < samples; ++i) {
+        for (unsigned c = 0; c < CHANNELS; ++c) {
+            f[i * CHANNELS + c] = state->next + c * 0.5f;
+        }
+        ++state->next;
+    }
+    ++state->calls;
+}
+
+static void test_audio_output_file(void) {
+    char filename[] = "/tmp/scrcpy_test_audio_XXXXXX";
+    int fd = mkstemp(filename);
+    assert(fd != -1);
+    close(fd);
+
+    struct pull_state state = {0};
+
+    struct sc_audio_output_null ao;
+    sc_audio_output_null_init(&ao, filename);
+
+    struct sc_audio_output_params params = {
+        .sample_rate = SAMPLE_RATE,
+        .channels = CHANNELS,
+        .buffer_duration = SC_TICK_FROM_MS(5),
+        .pull = pull,
+        .userdata = &state,
+    };
+
+    sc_tick start = sc_tick_now();
+    bool ok = ao.audio_output.ops->open(&ao.audio_output, &params);
+    assert(ok);
+
+    usleep(100000); // 100 ms
+
+    ao.audio_output.ops->close(&ao.audio_output);
+    sc_tick elapsed = sc_tick_now() - start;
+
+    // The samples are consumed in real-time, by periods of 5 ms
+    assert(state.calls >= 2);
+    assert(state.next == state.calls * 240);
+    sc_tick consumed = (sc_tick) state.next * SC_TICK_FREQ / SAMPLE_RATE;
+    assert(consumed <= elapsed + SC_TICK_FROM_MS(5));
+
+    FILE *file = fopen(filename, "rb");
+    assert(file);
+    float f[CHANNELS];
+    uint32_t count = 0;
+    while (fread(f, sizeof(f), 1, file) == 1) {
+        assert(f[0] == count);
+        assert(f[1] == count + 0.5f);
+        ++count;
+    }
+    fclose(file);
+    assert(count == state.next);
+
+    unlink(filename);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_audio_output_file();
+
+    return 0;
+}
@@ -124,6 +124,102 @@ static void test_audiobuf_partial_read_write(void) {
     sc_audiobuf_destroy(&buf);
 }
 
+static void test_audiobuf_skip(void) {
+    struct sc_audiobuf buf;
+    uint32_t data[10];
+
+    bool ok = sc_audiobuf_init(&buf, 4, 10);
+    assert(ok);
+
+    uint32_t samples[] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint32_t w = sc_audiobuf_write(&buf, samples, 8);
+    assert(w == 8);
+
+    // The skipped samples are not readable anymore
+    sc_audiobuf_request_skip(&buf, 3);
+    assert(sc_audiobuf_can_read(&buf) == 5);
+
+    // But they still take space until the reader drops them
+    w = sc_audiobuf_write(&buf, samples, 8);
+    assert(w == 2);
+
+    uint32_t r = sc_audiobuf_read(&buf, data, 4);
+    assert(r == 4);
+    uint32_t expected[] = {4, 5, 6, 7};
+    assert(!memcmp(data, expected, 16));
+    assert(sc_audiobuf_can_read(&buf) == 3);
+
+    // Requests are cumulative
+    sc_audiobuf_request_skip(&buf, 1);
+    sc_audiobuf_request_skip(&buf, 1);
+    assert(sc_audiobuf_can_read(&buf) == 1);
+
+    r = sc_audiobuf_read(&buf, data, 4);
+    assert(r == 1);
+    assert(data[0] == 2);
+
+    // Skipping more than available drops everything, and the excess is
+    // discarded
+    w = sc_audiobuf_write(&buf, samples, 2);
+    assert(w == 2);
+    sc_audiobuf_request_skip(&buf, 5);
+    assert(sc_audiobuf_can_read(&buf) == 0);
+
+    r = sc_audiobuf_read(&buf, data, 4);
+    assert(r == 0);
+
+    w = sc_audiobuf_write(&buf, samples, 3);
+    assert(w == 3);
+    assert(sc_audiobuf_can_read(&buf) == 3);
+
+    r = sc_audiobuf_read(&buf, data, 4);
+    assert(r == 3);
+    assert(!memcmp(data, samples, 12));
+
+    sc_audiobuf_destroy(&buf);
+}
+
+static void test_audiobuf_write_s16(void) {
+    struct sc_audiobuf buf;
+    float data[2 * 8];
+
+    // stereo float samples
+    bool ok = sc_audiobuf_init(&buf, 8, 8);
+    assert(ok);
+
+    int16_t in[2 * 6];
+    for (int i = 0; i < 12; ++i) {
+        in[i] = (i - 6) * 1000;
+    }
+
+    uint32_t w = sc_audiobuf_write_s16(&buf, in, 6);
+    assert(w == 6);
+
+    uint32_t r = sc_audiobuf_read(&buf, data, 4);
+    assert(r == 4);
+
+    // wrap around the end of the ring buffer
+    w = sc_audiobuf_write_s16(&buf, in, 6);
+    assert(w == 6);
+
+    r = sc_audiobuf_read(&buf, data, 8);
+    assert(r == 8);
+    for (int i = 0; i < 4; ++i) {
+        assert(data[i] == in[8 + i] / 32768.f);
+    }
+    for (int i = 0; i < 12; ++i) {
+        assert(data[4 + i] == in[i] / 32768.f);
+    }
+
+    // only the available space is written
+    w = sc_audiobuf_write_s16(&buf, in, 6);
+    assert(w == 6);
+    w = sc_audiobuf_write_s16(&buf, in, 6);
+    assert(w == 2);
+
+    sc_audiobuf_destroy(&buf);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -131,6 +227,8 @@ int main(int argc, char *argv[]) {
     test_audiobuf_simple();
     test_audiobuf_boundaries();
     test_audiobuf_partial_read_write();
+    test_audiobuf_skip();
+    test_audiobuf_write_s16();
 
     return 0;
 }
@@ -0,0 +1,157 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "av_sync.h"
+
+#define DURATION SC_TICK_FROM_SEC(60)
+#define AUDIO_PACKET_DURATION SC_TICK_FROM_MS(20)
+#define FRAME_INTERVAL SC_TICK_FROM_US(16667) // 60 fps
+
+// Ignore the first seconds to measure the residual offset
+#define CONVERGENCE SC_TICK_FROM_SEC(20)
+
+struct frame {
+    sc_tick pts;
+    sc_tick display_date;
+};
+
+struct result {
+    // the offset estimated by sc_av_sync at the end
+    struct sc_av_sync_stats stats;
+    // the actual mean A/V offset after convergence
+    sc_tick residual;
+};
+
+static uint32_t rand_state;
+
+static sc_tick
+rand_tick(sc_tick max) {
+    rand_state = rand_state * 1664525 + 1013904223;
+    return (rand_state >> 8) % max;
+}
+
+/**
+ * Replay a playback session, 1ms step by 1ms step.
+ *
+ * The audio samples are heard audio_latency (+ jitter) after their PTS.
+ * The video frames are received video_latency after their PTS, then delayed
+ * by the video delay requested by sc_av_sync (as the delay buffer does), then
+ * displayed on the next vsync.
+ */
+static void
+replay(bool correct, sc_tick audio_latency, sc_tick video_latency,
+       struct result *result) {
+    struct sc_av_sync as;
+    bool ok = sc_av_sync_init(&as, correct);
+    assert(ok);
+
+    rand_state = 42;
+
+    struct frame queue[256];
+    size_t head = 0;
+    size_t tail = 0;
+
+    sc_tick next_audio_pts = 0;
+    sc_tick next_video_pts = 0;
+    sc_tick last_display = 0;
+    sc_tick residual_sum = 0;
+    unsigned residual_count = 0;
+
+    for (sc_tick t = 0; t < DURATION; t += SC_TICK_FROM_MS(1)) {
+        // Audio: the buffering level varies with the packet arrival
+        sc_tick audio_jitter = rand_tick(SC_TICK_FROM_MS(4));
+        while (next_audio_pts + audio_latency + audio_jitter <= t) {
+            sc_av_sync_push_audio(&as, next_audio_pts,
+                                  next_audio_pts + audio_latency
+                                                 + audio_jitter);
+            next_audio_pts += AUDIO_PACKET_DURATION;
+        }
+
+        // Video: frames received at t
+        while (next_video_pts + video_latency <= t) {
+            sc_tick delay = sc_av_sync_get_video_delay(&as);
+            sc_tick date = t + delay;
+            // wait for the next vsync (60Hz)
+            date += FRAME_INTERVAL - date % FRAME_INTERVAL;
+            // frames are displayed in order
+            date = MAX(date, last_display);
+            last_display = date;
+
+            assert(tail - head < ARRAY_LEN(queue));
+            queue[tail++ % ARRAY_LEN(queue)] = (struct frame) {
+                .pts = next_video_pts,
+                .display_date = date,
+            };
+            next_video_pts += FRAME_INTERVAL;
+        }
+
+        // Video: frames displayed at t
+        while (head != tail
+                && queue[head % ARRAY_LEN(queue)].display_date <= t) {
+            struct frame *frame = &queue[head++ % ARRAY_LEN(queue)];
+            sc_av_sync_push_video(&as, frame->pts, frame->display_date);
+
+            if (t >= CONVERGENCE) {
+                // The actual offset between the frame and the audio sample
+                // having the same PTS
+                sc_tick audio_date = frame->pts + audio_latency
+                                   + SC_TICK_FROM_MS(2); // mean jitter
+                residual_sum += frame->display_date - audio_date;
+                ++residual_count;
+            }
+        }
+    }
+
+    sc_av_sync_get_stats(&as, &result->stats);
+    assert(residual_count);
+    result->residual = residual_sum / (sc_tick) residual_count;
+
+    sc_av_sync_destroy(&as);
+}
+
+static void test_monitor(void) {
+    struct result r;
+    replay(false, SC_TICK_FROM_MS(80), SC_TICK_FROM_MS(30), &r);
+
+    assert(r.stats.valid);
+    assert(!r.stats.video_delay);
+    // the video is early
+    assert(r.residual < -SC_TICK_FROM_MS(30));
+    // the estimation matches the actual offset
+    assert(llabs(r.stats.offset - r.residual) < SC_TICK_FROM_MS(3));
+}
+
+static void test_correct_early_video(void) {
+    struct result r;
+    replay(true, SC_TICK_FROM_MS(80), SC_TICK_FROM_MS(30), &r);
+
+    assert(r.stats.valid);
+    assert(r.stats.video_delay > SC_TICK_FROM_MS(30));
+    // the video is delayed so that the residual offset is small
+    assert(llabs(r.residual) < SC_TICK_FROM_MS(6));
+    assert(llabs(r.stats.offset) < SC_TICK_FROM_MS(6));
+}
+
+static void test_correct_late_video(void) {
+    struct result r;
+    replay(true, SC_TICK_FROM_MS(20), SC_TICK_FROM_MS(60), &r);
+
+    assert(r.stats.valid);
+    // the video cannot be advanced
+    assert(!r.stats.video_delay);
+    assert(r.residual > SC_TICK_FROM_MS(30));
+    assert(llabs(r.stats.offset - r.residual) < SC_TICK_FROM_MS(3));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_monitor();
+    test_correct_early_video();
+    test_correct_late_video();
+
+    return 0;
+}
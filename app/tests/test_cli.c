@@ -5,6 +5,7 @@
 
 #include "cli.h"
 #include "options.h"
+#include "util/net.h"
 
 static void test_flag_version(void) {
     struct scrcpy_cli_args args = {
@@ -121,6 +122,131 @@ static void test_options2(void) {
     assert(opts->record_format == SC_RECORD_FORMAT_MP4);
 }
 
+static void test_video_buffer_auto(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--video-buffer=auto:300"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->video_buffer_auto);
+    assert(opts->video_buffer == SC_TICK_FROM_MS(300));
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--video-buffer=auto"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(opts->video_buffer_auto);
+    assert(opts->video_buffer == SC_TICK_FROM_MS(200));
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--video-buffer=autox"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--audio-buffer=auto:150"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(ok);
+    assert(opts->audio_buffer_auto);
+    assert(opts->audio_buffer == SC_TICK_FROM_MS(150));
+}
+
+#ifdef HAVE_V4L2
+static void test_audio_output(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--audio-output=file:out.raw"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->audio_output == SC_AUDIO_OUTPUT_BACKEND_FILE);
+    assert(!strcmp(opts->audio_output_target, "out.raw"));
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--audio-output=null"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(opts->audio_output == SC_AUDIO_OUTPUT_BACKEND_NULL);
+    assert(!opts->audio_output_target);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--audio-output=null", "--no-audio-playback"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+
+#ifdef HAVE_ALSA
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--audio-output=alsa:hw:1,0"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(ok);
+    assert(opts->audio_output == SC_AUDIO_OUTPUT_BACKEND_ALSA);
+    assert(!strcmp(opts->audio_output_target, "hw:1,0"));
+#endif
+}
+
+static void test_v4l2_options(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {
+        "scrcpy",
+        "--v4l2-sink=/dev/video0",
+        "--v4l2-size=1280x720",
+        "--v4l2-crop=1080:1080:0:600",
+        "--v4l2-orientation=flip90",
+        "--v4l2-format=nv12",
+    };
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(!strcmp(opts->v4l2_device, "/dev/video0"));
+    assert(opts->v4l2_size.width == 1280);
+    assert(opts->v4l2_size.height == 720);
+    assert(opts->v4l2_crop.size.width == 1080);
+    assert(opts->v4l2_crop.size.height == 1080);
+    assert(opts->v4l2_crop.point.x == 0);
+    assert(opts->v4l2_crop.point.y == 600);
+    assert(opts->v4l2_orientation == SC_ORIENTATION_FLIP_90);
+    assert(opts->v4l2_format == SC_V4L2_FORMAT_NV12);
+    // the output size is fixed, so the video may be downsized on error
+    assert(opts->downsize_on_error);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--v4l2-sink=/dev/video0", "--v4l2-size=1280"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--v4l2-orientation=90"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok); // requires --v4l2-sink
+}
+#endif
+
 static void test_parse_shortcut_mods(void) {
     uint8_t mods;
     bool ok;
@@ -149,6 +275,377 @@ static void test_parse_shortcut_mods(void) {
     assert(!ok);
 }
 
+static void test_mouse_motion_coalescing(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--mouse-motion-coalescing=frame"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->mouse_motion_coalescing == SC_MOUSE_MOTION_COALESCING_FRAME);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--mouse-motion-coalescing=4"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(opts->mouse_motion_coalescing == SC_TICK_FROM_MS(4));
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--mouse-motion-coalescing=-1"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+}
+
+static void test_gamepad_options(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--gamepad-report-interval=1",
+                    "--gamepad-deadzone=10"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->gamepad_report_interval == SC_TICK_FROM_MS(1));
+    assert(opts->gamepad_deadzone == 10);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--gamepad-deadzone=60"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+static void test_input_record_options(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--input-record=rec.bin",
+                    "--input-replay=old.bin", "--input-replay-speed=250"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(!strcmp(opts->input_record_filename, "rec.bin"));
+    assert(!strcmp(opts->input_replay_filename, "old.bin"));
+    assert(opts->input_replay_speed == 250);
+
+    // A replay speed without replay is an error
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--input-replay-speed=50"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+static void test_reconnect(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--reconnect"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.reconnect);
+
+    // UHID devices cannot be recreated on reconnection
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--reconnect", "--keyboard=uhid"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+static void test_serials(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--serials=0123456789abcdef,192.168.1.1:5555"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(!strcmp(args.opts.serials, "0123456789abcdef,192.168.1.1:5555"));
+    assert(!args.opts.audio);
+
+    // --serials is a device selector
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--serials=a,b", "-s", "a"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--serials=a,,b"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--serials=1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,"
+                               "16,17"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv5[] = {"scrcpy", "--serials=a,b", "--record=file.mkv"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv5), argv5);
+    assert(!ok);
+
+    // Audio is disabled by default, explicit audio options are rejected
+    args.opts = scrcpy_options_default;
+    char *argv6[] = {"scrcpy", "--serials=a,b", "--audio-codec=aac"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv6), argv6);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv7[] = {"scrcpy", "--serials=a,b", "--no-audio"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv7), argv7);
+    assert(ok);
+    assert(!args.opts.audio);
+
+    args.opts = scrcpy_options_default;
+    char *argv8[] = {"scrcpy", "--serials=a,b", "--wall"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv8), argv8);
+    assert(ok);
+    assert(args.opts.wall);
+
+    // The wall is a multi-device mode
+    args.opts = scrcpy_options_default;
+    char *argv9[] = {"scrcpy", "--wall"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv9), argv9);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv10[] = {"scrcpy", "--serials=a,b", "--wall",
+                     "--display-orientation=90"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv10), argv10);
+    assert(!ok);
+}
+
+#ifndef _WIN32
+static void test_input_socket_options(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--input-socket=/tmp/scrcpy.sock"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(!strcmp(args.opts.input_socket, "/tmp/scrcpy.sock"));
+
+    // The input socket requires control
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--input-socket=/tmp/scrcpy.sock",
+                     "--no-control"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+#endif
+
+static void test_video_decode_mode(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--video-decode-mode=keyframes"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->video_decode_mode == SC_VIDEO_DECODE_MODE_KEYFRAMES);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--video-decode-mode=lowres"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(opts->video_decode_mode == SC_VIDEO_DECODE_MODE_LOWRES);
+    assert(opts->video_decode_lowres_level
+            == SC_VIDEO_DECODE_LOWRES_DEFAULT_LEVEL);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--video-decode-mode=lowres:3"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(ok);
+    assert(opts->video_decode_mode == SC_VIDEO_DECODE_MODE_LOWRES);
+    assert(opts->video_decode_lowres_level == 3);
+
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--video-decode-mode=lowres:4"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv5[] = {"scrcpy", "--video-decode-mode=lowresx"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv5), argv5);
+    assert(!ok);
+}
+
+static void test_metrics(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--metrics=tcp:9100"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->metrics_type == SC_METRICS_TYPE_TCP);
+    assert(opts->metrics_host == IPV4_LOCALHOST);
+    assert(opts->metrics_port == 9100);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--metrics=tcp:0.0.0.0:9101"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(opts->metrics_type == SC_METRICS_TYPE_TCP);
+    assert(opts->metrics_host == 0);
+    assert(opts->metrics_port == 9101);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--metrics=json:/tmp/metrics.jsonl",
+                     "--metrics-interval=500"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(ok);
+    assert(opts->metrics_type == SC_METRICS_TYPE_JSON);
+    assert(!strcmp(opts->metrics_path, "/tmp/metrics.jsonl"));
+    assert(opts->metrics_interval == SC_TICK_FROM_MS(500));
+
+    // The interval only applies to a file
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--metrics=tcp:9100", "--metrics-interval=500"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv5[] = {"scrcpy", "--metrics=tcp:0"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv5), argv5);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv6[] = {"scrcpy", "--metrics=http:9100"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv6), argv6);
+    assert(!ok);
+
+#ifndef _WIN32
+    args.opts = scrcpy_options_default;
+    char *argv7[] = {"scrcpy", "--metrics=unix:/tmp/scrcpy-metrics.sock"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv7), argv7);
+    assert(ok);
+    assert(opts->metrics_type == SC_METRICS_TYPE_UNIX);
+    assert(!strcmp(opts->metrics_path, "/tmp/scrcpy-metrics.sock"));
+#endif
+}
+
+static void test_relay(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--no-playback", "--no-window",
+                    "--relay=tcp:1234"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    // The relay needs the video and audio streams, even without playback
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->video);
+    assert(opts->audio);
+    assert(opts->relay_type == SC_RELAY_TYPE_TCP);
+    assert(opts->relay_host == IPV4_LOCALHOST);
+    assert(opts->relay_port == 1234);
+    assert(opts->relay_format == SC_RELAY_FORMAT_MPEGTS);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--relay=tcp:0.0.0.0:1235",
+                     "--relay-format=fmp4", "--video-codec=av1"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(opts->relay_host == 0);
+    assert(opts->relay_port == 1235);
+    assert(opts->relay_format == SC_RELAY_FORMAT_FMP4);
+
+    // MPEG-TS does not support AV1
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--relay=tcp:1234", "--video-codec=av1"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+
+    // MPEG-TS does not support FLAC
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--relay=tcp:1234", "--audio-codec=flac"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv5[] = {"scrcpy", "--relay-format=fmp4"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv5), argv5);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv6[] = {"scrcpy", "--relay=tcp:1234", "--relay-format=mkv"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv6), argv6);
+    assert(!ok);
+
+#ifndef _WIN32
+    args.opts = scrcpy_options_default;
+    char *argv7[] = {"scrcpy", "--relay=unix:/tmp/scrcpy-relay.sock"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv7), argv7);
+    assert(ok);
+    assert(opts->relay_type == SC_RELAY_TYPE_UNIX);
+    assert(!strcmp(opts->relay_path, "/tmp/scrcpy-relay.sock"));
+#endif
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -157,6 +654,22 @@ int main(int argc, char *argv[]) {
     test_flag_help();
     test_options();
     test_options2();
+    test_video_buffer_auto();
+    test_audio_output();
+    test_mouse_motion_coalescing();
+    test_gamepad_options();
+    test_input_record_options();
+    test_reconnect();
+    test_serials();
+    test_video_decode_mode();
+    test_metrics();
+    test_relay();
+#ifndef _WIN32
+    test_input_socket_options();
+#endif
+#ifdef HAVE_V4L2
+    test_v4l2_options();
+#endif
     test_parse_shortcut_mods();
     return 0;
 }
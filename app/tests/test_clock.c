@@ -0,0 +1,117 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "clock.h"
+
+#define FRAME_INTERVAL SC_TICK_FROM_US(16667) // 60 fps
+
+// deterministic pseudo-random jitter in [0, max)
+static sc_tick
+next_jitter(uint32_t *state, sc_tick max) {
+    *state = *state * 1664525 + 1013904223;
+    return (*state >> 8) % max;
+}
+
+static void test_clock_constant_offset(void) {
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    for (int i = 0; i < 1000; ++i) {
+        sc_tick stream = i * FRAME_INTERVAL;
+        sc_clock_update(&clock, stream + 1000, stream);
+        assert(sc_clock_to_system_time(&clock, stream) == stream + 1000);
+    }
+
+    // predict a point in the future
+    sc_tick stream = 1000 * FRAME_INTERVAL;
+    assert(sc_clock_to_system_time(&clock, stream) == stream + 1000);
+}
+
+static void test_clock_reject_delayed(void) {
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    uint32_t state = 42;
+    for (int i = 0; i < 1000; ++i) {
+        sc_tick stream = i * FRAME_INTERVAL;
+        // jitter up to 2ms, and a burst delayed by 100ms every 50 frames
+        sc_tick delay = next_jitter(&state, SC_TICK_FROM_MS(2));
+        if (i % 50 >= 45) {
+            delay += SC_TICK_FROM_MS(100);
+        }
+        sc_clock_update(&clock, stream + 5000 + delay, stream);
+
+        if (i >= SC_CLOCK_WINDOW) {
+            // the estimation follows the least delayed points
+            sc_tick system = sc_clock_to_system_time(&clock, stream);
+            sc_tick error = system - (stream + 5000);
+            assert(llabs(error) < SC_TICK_FROM_MS(1));
+        }
+    }
+}
+
+static void test_clock_drift(void) {
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    // the device clock is 200 ppm slower than the computer clock
+    uint32_t state = 1;
+    sc_tick stream = 0;
+    for (int i = 0; i < 2000; ++i) {
+        stream = i * FRAME_INTERVAL;
+        sc_tick delay = next_jitter(&state, SC_TICK_FROM_MS(1));
+        sc_tick system = stream + stream / 5000 + delay;
+        sc_clock_update(&clock, system, stream);
+    }
+
+    assert(clock.drift > 150e-6 && clock.drift < 250e-6);
+
+    // predict 1 second in the future
+    sc_tick future = stream + SC_TICK_FROM_SEC(1);
+    sc_tick expected = future + future / 5000;
+    sc_tick error = sc_clock_to_system_time(&clock, future) - expected;
+    assert(llabs(error) < SC_TICK_FROM_MS(1));
+}
+
+static void test_clock_drift_bounded(void) {
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    // a huge apparent drift (e.g. a growing delay) must be bounded
+    for (int i = 0; i < 1000; ++i) {
+        sc_tick stream = i * FRAME_INTERVAL;
+        sc_clock_update(&clock, stream + stream / 10, stream);
+    }
+
+    assert(clock.drift > 0 && clock.drift <= 1e-3);
+}
+
+static void test_clock_offset_decrease(void) {
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    for (int i = 0; i < 100; ++i) {
+        sc_tick stream = i * FRAME_INTERVAL;
+        sc_clock_update(&clock, stream + SC_TICK_FROM_MS(50), stream);
+    }
+
+    // a point less delayed than all previous ones is immediately followed
+    sc_tick stream = 100 * FRAME_INTERVAL;
+    sc_clock_update(&clock, stream + SC_TICK_FROM_MS(10), stream);
+    assert(sc_clock_to_system_time(&clock, stream)
+            == stream + SC_TICK_FROM_MS(10));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_clock_constant_offset();
+    test_clock_reject_delayed();
+    test_clock_drift();
+    test_clock_drift_bounded();
+    test_clock_offset_decrease();
+    return 0;
+}
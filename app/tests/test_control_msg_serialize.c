@@ -426,6 +426,98 @@ static void test_serialize_reset_video(void) {
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
 
+static void test_deserialize_round_trip(void) {
+    char text[] = "hello";
+    char name[] = "org.example";
+    struct sc_control_msg msgs[] = {
+        {
+            .type = SC_CONTROL_MSG_TYPE_INJECT_KEYCODE,
+            .inject_keycode = {
+                .action = AKEY_EVENT_ACTION_DOWN,
+                .keycode = AKEYCODE_ENTER,
+                .repeat = 2,
+                .metastate = AMETA_CTRL_ON,
+            },
+        },
+        {
+            .type = SC_CONTROL_MSG_TYPE_INJECT_TEXT,
+            .inject_text.text = text,
+        },
+        {
+            .type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+            .inject_touch_event = {
+                .action = AMOTION_EVENT_ACTION_MOVE,
+                .pointer_id = SC_POINTER_ID_GENERIC_FINGER,
+                .position = {
+                    .point = {.x = -10, .y = 2000},
+                    .screen_size = {.width = 1080, .height = 2400},
+                },
+                .pressure = 1.0f,
+                .action_button = 0,
+                .buttons = AMOTION_EVENT_BUTTON_PRIMARY,
+            },
+        },
+        {
+            .type = SC_CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT,
+            .inject_scroll_event = {
+                .position = {
+                    .point = {.x = 260, .y = 1026},
+                    .screen_size = {.width = 1080, .height = 1920},
+                },
+                .hscroll = 1.0f,
+                .vscroll = -0.25f,
+                .buttons = 0,
+            },
+        },
+        {
+            .type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+            .set_clipboard = {
+                .sequence = 0x0102030405060708,
+                .paste = true,
+                .text = text,
+            },
+        },
+        {
+            .type = SC_CONTROL_MSG_TYPE_UHID_INPUT,
+            .uhid_input = {
+                .id = 42,
+                .size = 3,
+                .data = {1, 2, 3},
+            },
+        },
+        {
+            .type = SC_CONTROL_MSG_TYPE_START_APP,
+            .start_app.name = name,
+        },
+        {
+            .type = SC_CONTROL_MSG_TYPE_RESET_VIDEO,
+        },
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(msgs); ++i) {
+        static uint8_t buf[SC_CONTROL_MSG_MAX_SIZE];
+        size_t size = sc_control_msg_serialize(&msgs[i], buf);
+        assert(size);
+
+        struct sc_control_msg msg;
+        // Incomplete
+        ssize_t r = sc_control_msg_deserialize(buf, size - 1, &msg);
+        assert(!r);
+
+        r = sc_control_msg_deserialize(buf, size, &msg);
+        assert(r == (ssize_t) size);
+        assert(msg.type == msgs[i].type);
+
+        // Serializing the deserialized message gives the same bytes
+        static uint8_t buf2[SC_CONTROL_MSG_MAX_SIZE];
+        size_t size2 = sc_control_msg_serialize(&msg, buf2);
+        assert(size2 == size);
+        assert(!memcmp(buf, buf2, size));
+
+        sc_control_msg_destroy(&msg);
+    }
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -449,5 +541,6 @@ int main(int argc, char *argv[]) {
     test_serialize_uhid_destroy();
     test_serialize_open_hard_keyboard();
     test_serialize_reset_video();
+    test_deserialize_round_trip();
     return 0;
 }
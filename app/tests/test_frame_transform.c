@@ -0,0 +1,153 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+#include <libavutil/frame.h>
+
+#include "frame_transform.h"
+
+static AVFrame *
+create_frame(unsigned width, unsigned height) {
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    int ret = av_frame_get_buffer(frame, 0);
+    assert(!ret);
+    (void) ret;
+
+    // Each luma sample encodes its position
+    for (unsigned y = 0; y < height; ++y) {
+        for (unsigned x = 0; x < width; ++x) {
+            frame->data[0][y * frame->linesize[0] + x] = y * 16 + x;
+        }
+    }
+    for (unsigned y = 0; y < height / 2; ++y) {
+        memset(frame->data[1] + y * frame->linesize[1], 50, width / 2);
+        memset(frame->data[2] + y * frame->linesize[2], 60, width / 2);
+    }
+    frame->pts = 42;
+    return frame;
+}
+
+static inline uint8_t
+luma(const AVFrame *frame, unsigned x, unsigned y) {
+    return frame->data[0][y * frame->linesize[0] + x];
+}
+
+static void test_identity(void) {
+    struct sc_rect crop = {{0, 0}, {0, 0}};
+    struct sc_size size = {0, 0};
+
+    struct sc_frame_transform ft;
+    bool ok = sc_frame_transform_init(&ft, &crop, SC_ORIENTATION_0, &size);
+    assert(ok);
+    assert(sc_frame_transform_is_identity(&ft));
+    sc_frame_transform_destroy(&ft);
+
+    ok = sc_frame_transform_init(&ft, &crop, SC_ORIENTATION_90, &size);
+    assert(ok);
+    assert(!sc_frame_transform_is_identity(&ft));
+    sc_frame_transform_destroy(&ft);
+}
+
+static void test_crop_orientation(void) {
+    AVFrame *frame = create_frame(8, 6);
+
+    struct sc_rect crop = {{2, 2}, {4, 2}};
+    struct sc_size size = {0, 0};
+
+    struct sc_frame_transform ft;
+    bool ok = sc_frame_transform_init(&ft, &crop, SC_ORIENTATION_90, &size);
+    assert(ok);
+
+    const AVFrame *out = sc_frame_transform_apply(&ft, frame);
+    assert(out);
+    assert(out->width == 2);
+    assert(out->height == 4);
+    assert(out->pts == 42);
+
+    // 90° clockwise: the bottom-left corner of the crop area becomes the
+    // top-left corner
+    assert(luma(out, 0, 0) == luma(frame, 2, 3));
+    assert(luma(out, 1, 0) == luma(frame, 2, 2));
+    assert(luma(out, 0, 3) == luma(frame, 5, 3));
+    assert(luma(out, 1, 3) == luma(frame, 5, 2));
+    assert(out->data[1][0] == 50);
+    assert(out->data[2][0] == 60);
+
+    sc_frame_transform_destroy(&ft);
+    av_frame_free(&frame);
+}
+
+static void test_crop_outside(void) {
+    AVFrame *frame = create_frame(8, 6);
+
+    // The crop area is outside the frame, it is ignored
+    struct sc_rect crop = {{10, 10}, {4, 2}};
+    struct sc_size size = {0, 0};
+
+    struct sc_frame_transform ft;
+    bool ok = sc_frame_transform_init(&ft, &crop, SC_ORIENTATION_FLIP_0,
+                                      &size);
+    assert(ok);
+
+    const AVFrame *out = sc_frame_transform_apply(&ft, frame);
+    assert(out);
+    assert(out->width == 8);
+    assert(out->height == 6);
+    assert(luma(out, 0, 0) == luma(frame, 7, 0));
+    assert(luma(out, 7, 5) == luma(frame, 0, 5));
+
+    sc_frame_transform_destroy(&ft);
+    av_frame_free(&frame);
+}
+
+static void test_fixed_size(void) {
+    struct sc_rect crop = {{0, 0}, {0, 0}};
+    struct sc_size size = {16, 8};
+
+    struct sc_frame_transform ft;
+    bool ok = sc_frame_transform_init(&ft, &crop, SC_ORIENTATION_0, &size);
+    assert(ok);
+
+    // Portrait frame in landscape output: black borders on the sides
+    AVFrame *frame = create_frame(4, 8);
+    const AVFrame *out = sc_frame_transform_apply(&ft, frame);
+    assert(out);
+    assert(out->width == 16);
+    assert(out->height == 8);
+    assert(ft.content.point.x == 6);
+    assert(ft.content.point.y == 0);
+    assert(ft.content.size.width == 4);
+    assert(ft.content.size.height == 8);
+    assert(luma(out, 0, 0) == 16); // black
+    assert(luma(out, 15, 7) == 16); // black
+    assert(luma(out, 6, 0) == luma(frame, 0, 0));
+    av_frame_free(&frame);
+
+    // On rotation, the output size does not change
+    frame = create_frame(8, 4);
+    out = sc_frame_transform_apply(&ft, frame);
+    assert(out);
+    assert(out->width == 16);
+    assert(out->height == 8);
+    assert(ft.content.point.x == 0);
+    assert(ft.content.size.width == 16);
+    assert(ft.content.size.height == 8);
+    av_frame_free(&frame);
+
+    sc_frame_transform_destroy(&ft);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_identity();
+    test_crop_orientation();
+    test_crop_outside();
+    test_fixed_size();
+    return 0;
+}
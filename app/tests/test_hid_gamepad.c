@@ -0,0 +1,136 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "hid/hid_gamepad.h"
+
+#define GAMEPAD_ID 42
+
+static uint16_t
+read16le(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8);
+}
+
+static void
+open_gamepad(struct sc_hid_gamepad *hid) {
+    struct sc_hid_open hid_open;
+    bool ok = sc_hid_gamepad_generate_open(hid, &hid_open, GAMEPAD_ID);
+    assert(ok);
+    (void) ok;
+}
+
+static bool
+push_axis(struct sc_hid_gamepad *hid, struct sc_hid_input *hid_input,
+          enum sc_gamepad_axis axis, int16_t value) {
+    struct sc_gamepad_axis_event event = {
+        .gamepad_id = GAMEPAD_ID,
+        .axis = axis,
+        .value = value,
+    };
+    return sc_hid_gamepad_generate_input_from_axis(hid, hid_input, &event);
+}
+
+static bool
+push_button(struct sc_hid_gamepad *hid, struct sc_hid_input *hid_input,
+            enum sc_action action) {
+    struct sc_gamepad_button_event event = {
+        .gamepad_id = GAMEPAD_ID,
+        .action = action,
+        .button = SC_GAMEPAD_BUTTON_SOUTH,
+    };
+    return sc_hid_gamepad_generate_input_from_button(hid, hid_input, &event);
+}
+
+static void test_gamepad_report_interval(void) {
+    struct sc_hid_gamepad hid;
+    // Large interval, so that the test does not depend on the timing
+    sc_hid_gamepad_init(&hid, SC_TICK_FROM_SEC(1000), 0);
+    open_gamepad(&hid);
+
+    struct sc_hid_input hid_input;
+
+    // The first change is reported immediately
+    bool ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFTX, 1000);
+    assert(ok);
+    assert(read16le(hid_input.data) == 0x8000 + 1000);
+    assert(!sc_hid_gamepad_get_deadline(&hid));
+
+    // The next changes are delayed
+    for (int i = 1; i <= 10; ++i) {
+        ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFTX, 1000 + i);
+        assert(!ok);
+    }
+    ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_RIGHTY, -1000);
+    assert(!ok);
+
+    sc_tick deadline = sc_hid_gamepad_get_deadline(&hid);
+    assert(deadline);
+
+    ok = sc_hid_gamepad_generate_pending_input(&hid, &hid_input, deadline - 1);
+    assert(!ok);
+
+    // A single report contains the latest state
+    ok = sc_hid_gamepad_generate_pending_input(&hid, &hid_input, deadline);
+    assert(ok);
+    assert(read16le(hid_input.data) == 0x8000 + 1010);
+    assert(read16le(hid_input.data + 6) == 0x8000 - 1000);
+    ok = sc_hid_gamepad_generate_pending_input(&hid, &hid_input, deadline);
+    assert(!ok);
+    assert(!sc_hid_gamepad_get_deadline(&hid));
+
+    // Button edges are reported immediately, with the pending axes state
+    ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFTX, 2000);
+    assert(!ok);
+    ok = push_button(&hid, &hid_input, SC_ACTION_DOWN);
+    assert(ok);
+    assert(read16le(hid_input.data) == 0x8000 + 2000);
+    assert(read16le(hid_input.data + 12) == 1);
+    assert(!sc_hid_gamepad_get_deadline(&hid));
+
+    ok = push_button(&hid, &hid_input, SC_ACTION_UP);
+    assert(ok);
+    assert(read16le(hid_input.data + 12) == 0);
+    (void) ok;
+}
+
+static void test_gamepad_deadzone(void) {
+    struct sc_hid_gamepad hid;
+    sc_hid_gamepad_init(&hid, 0, 10);
+    open_gamepad(&hid);
+
+    struct sc_hid_input hid_input;
+
+    // Within the deadzone, the stick is still centered: nothing to report
+    bool ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFTY, 3000);
+    assert(!ok);
+    ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFTY, -3000);
+    assert(!ok);
+
+    ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFTY, 4000);
+    assert(ok);
+    assert(read16le(hid_input.data + 2) == 0x8000 + 4000);
+
+    // Back to the center
+    ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFTY, 100);
+    assert(ok);
+    assert(read16le(hid_input.data + 2) == 0x8000);
+
+    // The deadzone does not apply to triggers
+    ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFT_TRIGGER, 100);
+    assert(ok);
+    assert(read16le(hid_input.data + 8) == 100);
+
+    // Identical values are not reported again
+    ok = push_axis(&hid, &hid_input, SC_GAMEPAD_AXIS_LEFT_TRIGGER, 100);
+    assert(!ok);
+    (void) ok;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_gamepad_report_interval();
+    test_gamepad_deadzone();
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/histogram.h"
+
+static void test_histogram_exact(void) {
+    struct sc_histogram h;
+    sc_histogram_init(&h);
+
+    assert(sc_histogram_count(&h) == 0);
+    assert(sc_histogram_quantile(&h, 500) == 0);
+
+    // Small values are counted exactly
+    for (int i = 1; i <= 10; ++i) {
+        sc_histogram_record(&h, i);
+    }
+
+    assert(sc_histogram_count(&h) == 10);
+    assert(sc_histogram_max(&h) == 10);
+    assert(sc_histogram_quantile(&h, 0) == 1);
+    assert(sc_histogram_quantile(&h, 100) == 1);
+    assert(sc_histogram_quantile(&h, 500) == 5);
+    assert(sc_histogram_quantile(&h, 900) == 9);
+    assert(sc_histogram_quantile(&h, 1000) == 10);
+}
+
+static void test_histogram_precision(void) {
+    struct sc_histogram h;
+    sc_histogram_init(&h);
+
+    // 1000 values from 1µs to 1s
+    for (int i = 1; i <= 1000; ++i) {
+        sc_histogram_record(&h, i * 1000);
+    }
+
+    assert(sc_histogram_max(&h) == 1000000);
+
+    unsigned quantiles[] = {10, 500, 900, 990, 999};
+    for (size_t i = 0; i < ARRAY_LEN(quantiles); ++i) {
+        sc_tick expected = quantiles[i] * 1000;
+        sc_tick value = sc_histogram_quantile(&h, quantiles[i]);
+        // Never underestimated, and within the bucket precision
+        assert(value >= expected);
+        assert(value <= expected + expected / 8);
+    }
+
+    assert(sc_histogram_quantile(&h, 1000) == 1000000);
+}
+
+static void test_histogram_limits(void) {
+    struct sc_histogram h;
+    sc_histogram_init(&h);
+
+    sc_histogram_record(&h, -5);
+    sc_histogram_record(&h, SC_TICK_FROM_SEC(3600));
+
+    assert(sc_histogram_count(&h) == 2);
+    assert(sc_histogram_quantile(&h, 500) == 0);
+    assert(sc_histogram_max(&h) == SC_TICK_FROM_SEC(3600));
+    // The last bucket is open-ended, the maximum is reported
+    assert(sc_histogram_quantile(&h, 1000) == SC_TICK_FROM_SEC(3600));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_histogram_exact();
+    test_histogram_precision();
+    test_histogram_limits();
+
+    return 0;
+}
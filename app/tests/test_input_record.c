@@ -0,0 +1,199 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "control_msg.h"
+#include "controller.h"
+#include "input_record.h"
+#include "input_replay.h"
+#include "util/tick.h"
+
+#define RECORD_CAPACITY 16
+
+/**
+ * Replace the controller: record the pushed messages with their push date
+ */
+static struct {
+    struct sc_control_msg msgs[RECORD_CAPACITY];
+    sc_tick dates[RECORD_CAPACITY];
+    unsigned count;
+} pushed;
+
+bool
+sc_controller_push_msg_blocking(struct sc_controller *controller,
+                                const struct sc_control_msg *msg) {
+    (void) controller;
+
+    // Only called from the replayer thread
+    assert(pushed.count < RECORD_CAPACITY);
+    pushed.dates[pushed.count] = sc_tick_now();
+    pushed.msgs[pushed.count] = *msg; // take ownership
+    ++pushed.count;
+    return true;
+}
+
+static void
+make_touch(struct sc_control_msg *msg, enum android_motionevent_action action,
+           int32_t x) {
+    msg->type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT;
+    msg->inject_touch_event.action = action;
+    msg->inject_touch_event.pointer_id = SC_POINTER_ID_GENERIC_FINGER;
+    msg->inject_touch_event.position.point.x = x;
+    msg->inject_touch_event.position.point.y = 100;
+    msg->inject_touch_event.position.screen_size.width = 1080;
+    msg->inject_touch_event.position.screen_size.height = 2400;
+    msg->inject_touch_event.pressure =
+        action == AMOTION_EVENT_ACTION_UP ? 0.0f : 1.0f;
+    msg->inject_touch_event.action_button = 0;
+    msg->inject_touch_event.buttons = 0;
+}
+
+static void
+write_touch(struct sc_input_recorder *ir, sc_tick date,
+            enum android_motionevent_action action, int32_t x) {
+    struct sc_control_msg msg;
+    make_touch(&msg, action, x);
+
+    uint8_t buf[64];
+    size_t len = sc_control_msg_serialize(&msg, buf);
+    assert(len);
+    sc_input_recorder_write(ir, date, buf, len);
+}
+
+static void test_record_read(const char *filename) {
+    struct sc_input_recorder ir;
+    bool ok = sc_input_recorder_open(&ir, filename);
+    assert(ok);
+
+    sc_tick start = ir.last;
+    write_touch(&ir, start, AMOTION_EVENT_ACTION_DOWN, 1);
+    write_touch(&ir, start + SC_TICK_FROM_MS(20), AMOTION_EVENT_ACTION_MOVE,
+                2);
+    write_touch(&ir, start + SC_TICK_FROM_MS(20), AMOTION_EVENT_ACTION_MOVE,
+                3);
+    write_touch(&ir, start + SC_TICK_FROM_MS(50), AMOTION_EVENT_ACTION_UP, 4);
+    assert(ir.count == 4);
+    sc_input_recorder_close(&ir);
+    assert(!ir.failed);
+
+    struct sc_input_record_reader reader;
+    ok = sc_input_record_reader_open(&reader, filename);
+    assert(ok);
+    (void) ok;
+
+    static const sc_tick expected_delays[] = {0, 20, 0, 30};
+    for (int i = 0; i < 4; ++i) {
+        sc_tick delay;
+        const uint8_t *data;
+        size_t len;
+        int r = sc_input_record_reader_next(&reader, &delay, &data, &len);
+        assert(r == 1);
+        assert(delay == SC_TICK_FROM_MS(expected_delays[i]));
+        assert(len == 32);
+
+        struct sc_control_msg msg;
+        ssize_t consumed = sc_control_msg_deserialize(data, len, &msg);
+        assert(consumed == 32);
+        assert(msg.type == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+        assert(msg.inject_touch_event.position.point.x == i + 1);
+        (void) r;
+        (void) consumed;
+    }
+
+    sc_tick delay;
+    const uint8_t *data;
+    size_t len;
+    int r = sc_input_record_reader_next(&reader, &delay, &data, &len);
+    assert(r == 0); // end of file
+    (void) r;
+
+    sc_input_record_reader_close(&reader);
+}
+
+static void test_reject_invalid_file(const char *filename) {
+    FILE *file = fopen(filename, "wb");
+    assert(file);
+    fputs("not an input record", file);
+    fclose(file);
+
+    struct sc_input_record_reader reader;
+    bool ok = sc_input_record_reader_open(&reader, filename);
+    assert(!ok);
+    (void) ok;
+}
+
+static void test_replay(const char *filename) {
+    struct sc_input_recorder ir;
+    bool ok = sc_input_recorder_open(&ir, filename);
+    assert(ok);
+
+    sc_tick start = ir.last;
+    write_touch(&ir, start, AMOTION_EVENT_ACTION_DOWN, 1);
+    // UHID devices belong to the session: never replayed
+    const uint8_t uhid_create[] = {SC_CONTROL_MSG_TYPE_UHID_CREATE, 0, 1};
+    sc_input_recorder_write(&ir, start + SC_TICK_FROM_MS(10), uhid_create,
+                            sizeof(uhid_create));
+    write_touch(&ir, start + SC_TICK_FROM_MS(40), AMOTION_EVENT_ACTION_MOVE,
+                2);
+    write_touch(&ir, start + SC_TICK_FROM_MS(100), AMOTION_EVENT_ACTION_UP,
+                3);
+    sc_input_recorder_close(&ir);
+
+    struct sc_input_replayer replayer;
+    // Replay twice as fast
+    ok = sc_input_replayer_init(&replayer, filename, 200, NULL);
+    assert(ok);
+    ok = sc_input_replayer_start(&replayer);
+    assert(ok);
+    (void) ok;
+
+    // The replayer thread terminates at the end of the file
+    sc_input_replayer_join(&replayer);
+
+    assert(pushed.count == 3);
+    assert(replayer.skipped == 1);
+    assert(sc_histogram_count(&replayer.jitter) == 3);
+
+    static const enum android_motionevent_action expected_actions[] = {
+        AMOTION_EVENT_ACTION_DOWN,
+        AMOTION_EVENT_ACTION_MOVE,
+        AMOTION_EVENT_ACTION_UP,
+    };
+    static const unsigned expected_ms[] = {0, 20, 50};
+    for (unsigned i = 0; i < 3; ++i) {
+        struct sc_control_msg *msg = &pushed.msgs[i];
+        assert(msg->type == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+        assert(msg->inject_touch_event.action == expected_actions[i]);
+        assert(msg->inject_touch_event.position.point.x == (int32_t) i + 1);
+
+        // The first event is pushed immediately, the others are scheduled
+        // relative to the start of the replay (never early, even if the first
+        // event is pushed slightly after the start)
+        sc_tick elapsed = pushed.dates[i] - pushed.dates[0];
+        assert(elapsed + SC_TICK_FROM_MS(1) >= SC_TICK_FROM_MS(expected_ms[i]));
+        assert(elapsed < SC_TICK_FROM_MS(expected_ms[i] + 40));
+        (void) elapsed;
+
+        sc_control_msg_destroy(msg);
+    }
+
+    sc_input_replayer_destroy(&replayer);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    char filename[64];
+    sprintf(filename, "/tmp/scrcpy-test-input-record-%d", (int) getpid());
+
+    test_record_read(filename);
+    test_reject_invalid_file(filename);
+    test_replay(filename);
+
+    unlink(filename);
+    return 0;
+}
@@ -0,0 +1,317 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control_msg.h"
+#include "controller.h"
+#include "input_socket.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define RECORD_CAPACITY 8192
+
+struct record {
+    struct sc_control_msg msg;
+    sc_tick date;
+};
+
+/**
+ * Replace the controller: record the pushed messages with their push date
+ */
+static struct {
+    sc_mutex mutex;
+    struct record records[RECORD_CAPACITY];
+    unsigned count;
+} recorder;
+
+bool
+sc_controller_push_msg_blocking(struct sc_controller *controller,
+                                const struct sc_control_msg *msg) {
+    (void) controller;
+
+    sc_tick now = sc_tick_now();
+    sc_mutex_lock(&recorder.mutex);
+    assert(recorder.count < RECORD_CAPACITY);
+    struct record *r = &recorder.records[recorder.count++];
+    r->msg = *msg; // take ownership
+    r->date = now;
+    sc_mutex_unlock(&recorder.mutex);
+    return true;
+}
+
+static void
+recorder_reset(void) {
+    for (unsigned i = 0; i < recorder.count; ++i) {
+        sc_control_msg_destroy(&recorder.records[i].msg);
+    }
+    recorder.count = 0;
+}
+
+static int
+client_connect(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd != -1);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    int r = connect(fd, (struct sockaddr *) &addr, sizeof(addr));
+    assert(!r);
+    (void) r;
+
+    return fd;
+}
+
+static void
+client_send(int fd, const char *s) {
+    size_t len = strlen(s);
+    while (len) {
+        ssize_t w = send(fd, s, len, 0);
+        assert(w > 0);
+        s += w;
+        len -= w;
+    }
+}
+
+// Read a single reply line (without the '\n')
+static void
+client_read_line(int fd, char *line, size_t size) {
+    size_t len = 0;
+    for (;;) {
+        assert(len < size - 1);
+        ssize_t r = recv(fd, &line[len], 1, 0);
+        assert(r == 1);
+        (void) r;
+        if (line[len] == '\n') {
+            line[len] = '\0';
+            return;
+        }
+        ++len;
+    }
+}
+
+static void
+client_expect(int fd, const char *expected) {
+    char line[256];
+    client_read_line(fd, line, sizeof(line));
+    assert(!strcmp(line, expected));
+}
+
+static const struct sc_control_msg *
+record_msg(unsigned i) {
+    assert(i < recorder.count);
+    return &recorder.records[i].msg;
+}
+
+static sc_tick
+record_date(unsigned i) {
+    assert(i < recorder.count);
+    return recorder.records[i].date;
+}
+
+static void
+assert_touch(unsigned i, enum android_motionevent_action action, int32_t x,
+             int32_t y) {
+    const struct sc_control_msg *msg = record_msg(i);
+    assert(msg->type == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+    assert(msg->inject_touch_event.action == action);
+    assert(msg->inject_touch_event.position.point.x == x);
+    assert(msg->inject_touch_event.position.point.y == y);
+    assert(msg->inject_touch_event.position.screen_size.width == 1080);
+    assert(msg->inject_touch_event.position.screen_size.height == 2400);
+}
+
+static void
+assert_key(unsigned i, enum android_keyevent_action action,
+           enum android_keycode keycode) {
+    const struct sc_control_msg *msg = record_msg(i);
+    assert(msg->type == SC_CONTROL_MSG_TYPE_INJECT_KEYCODE);
+    assert(msg->inject_keycode.action == action);
+    assert(msg->inject_keycode.keycode == keycode);
+}
+
+// Check that the event i was pushed ms milliseconds after the first event
+static void
+assert_scheduled(unsigned i, unsigned ms) {
+    sc_tick elapsed = record_date(i) - record_date(0);
+    // Never early (but the first event itself may have been pushed slightly
+    // after the origin of the schedule). There is no upper bound: an event
+    // may be arbitrarily late on a loaded machine.
+    assert(elapsed + SC_TICK_FROM_MS(1) >= SC_TICK_FROM_MS(ms));
+    (void) elapsed;
+}
+
+static void
+test_batch(const char *path) {
+    int fd = client_connect(path);
+
+    // Send the whole script at once: the timing must not depend on when the
+    // lines are received
+    client_send(fd, "size 1080 2400\n"
+                    "tap 100 200\n"
+                    "wait 50\n"
+                    "swipe 0 0 100 50 20\n"
+                    "key 3 4\n"
+                    "text hello world\n"
+                    "path 0,10,10 30,20,20 40,30,30\n"
+                    "down 1 2 7\n"
+                    "up 1 2 7\n"
+                    "ping batch\n");
+    client_expect(fd, "pong batch");
+
+    // tap
+    assert_touch(0, AMOTION_EVENT_ACTION_DOWN, 100, 200);
+    assert_touch(1, AMOTION_EVENT_ACTION_UP, 100, 200);
+
+    // swipe, interpolated every 5 ms
+    assert_touch(2, AMOTION_EVENT_ACTION_DOWN, 0, 0);
+    assert_scheduled(2, 50);
+    assert_touch(3, AMOTION_EVENT_ACTION_MOVE, 25, 12);
+    assert_scheduled(3, 55);
+    assert_touch(4, AMOTION_EVENT_ACTION_MOVE, 50, 25);
+    assert_scheduled(4, 60);
+    assert_touch(5, AMOTION_EVENT_ACTION_MOVE, 75, 37);
+    assert_scheduled(5, 65);
+    assert_touch(6, AMOTION_EVENT_ACTION_MOVE, 100, 50);
+    assert_scheduled(6, 70);
+    assert_touch(7, AMOTION_EVENT_ACTION_UP, 100, 50);
+
+    assert_key(8, AKEY_EVENT_ACTION_DOWN, 3);
+    assert_key(9, AKEY_EVENT_ACTION_UP, 3);
+    assert_key(10, AKEY_EVENT_ACTION_DOWN, 4);
+    assert_key(11, AKEY_EVENT_ACTION_UP, 4);
+
+    const struct sc_control_msg *msg = record_msg(12);
+    assert(msg->type == SC_CONTROL_MSG_TYPE_INJECT_TEXT);
+    assert(!strcmp(msg->inject_text.text, "hello world"));
+
+    // path, with timestamps relative to its start (the schedule is absolute,
+    // a late event does not delay the next ones)
+    assert_touch(13, AMOTION_EVENT_ACTION_DOWN, 10, 10);
+    assert_scheduled(13, 70);
+    assert_touch(14, AMOTION_EVENT_ACTION_MOVE, 20, 20);
+    assert_scheduled(14, 100);
+    assert_touch(15, AMOTION_EVENT_ACTION_UP, 30, 30);
+    assert_scheduled(15, 110);
+
+    assert_touch(16, AMOTION_EVENT_ACTION_DOWN, 1, 2);
+    assert(record_msg(16)->inject_touch_event.pointer_id == 7);
+    assert_touch(17, AMOTION_EVENT_ACTION_UP, 1, 2);
+
+    assert(recorder.count == 18);
+
+    close(fd);
+    recorder_reset();
+}
+
+static void
+test_errors(const char *path) {
+    int fd = client_connect(path);
+
+    // The size is reset for each client
+    client_send(fd, "tap 1 2\n");
+    client_expect(fd, "error size not set");
+
+    client_send(fd, "size 1080 2400\n"
+                    "bogus\n"
+                    "tap 1\n"
+                    "key 3 x\n"
+                    "path 0,1,1 20,2\n"
+                    "path 10,1,1 0,2,2\n"
+                    "wait -1\n"
+                    "ping errors\n");
+    client_expect(fd, "error unknown command: bogus");
+    client_expect(fd, "error invalid position");
+    client_expect(fd, "error invalid keycode: x");
+    client_expect(fd, "error invalid path point #1");
+    client_expect(fd, "error invalid path point #1");
+    client_expect(fd, "error invalid wait duration");
+    client_expect(fd, "pong errors");
+
+    // Nothing is pushed for invalid commands (not even the valid first
+    // keycode or path point)
+    assert(recorder.count == 0);
+
+    close(fd);
+}
+
+static void
+test_throughput(const char *path) {
+    int fd = client_connect(path);
+
+    client_send(fd, "size 1080 2400\ndown 0 0\n");
+
+    // Many events in a single batch, as fast as possible
+    char line[64];
+    for (int i = 1; i <= 5000; ++i) {
+        sprintf(line, "move %d %d\n", i % 1080, i % 2400);
+        client_send(fd, line);
+    }
+
+    client_send(fd, "up 0 0\nping end\n");
+    client_expect(fd, "pong end");
+
+    assert(recorder.count == 5002);
+    assert_touch(0, AMOTION_EVENT_ACTION_DOWN, 0, 0);
+    for (int i = 1; i <= 5000; ++i) {
+        // In order, none dropped
+        assert_touch(i, AMOTION_EVENT_ACTION_MOVE, i % 1080, i % 2400);
+    }
+    assert_touch(5001, AMOTION_EVENT_ACTION_UP, 0, 0);
+
+    close(fd);
+    recorder_reset();
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = sc_mutex_init(&recorder.mutex);
+    assert(ok);
+
+    char path[64];
+    sprintf(path, "/tmp/scrcpy-test-input-socket-%d", (int) getpid());
+
+    struct sc_input_socket is;
+    ok = sc_input_socket_init(&is, path, NULL);
+    assert(ok);
+
+    // Only the current user may connect
+    struct stat st;
+    assert(!lstat(path, &st));
+    assert((st.st_mode & 0777) == 0600);
+
+    ok = sc_input_socket_start(&is);
+    assert(ok);
+    (void) ok;
+
+    test_batch(path);
+    test_errors(path);
+    test_throughput(path);
+
+    // Stopping must interrupt a pending wait
+    int fd = client_connect(path);
+    client_send(fd, "wait 3600000\nping never\n");
+    sc_tick start = sc_tick_now();
+    sc_input_socket_stop(&is);
+    sc_input_socket_join(&is);
+    assert(sc_tick_now() - start < SC_TICK_FROM_SEC(1));
+    (void) start;
+    close(fd);
+    sc_input_socket_destroy(&is);
+
+    // The socket file is removed
+    assert(lstat(path, &st) == -1);
+
+    sc_mutex_destroy(&recorder.mutex);
+    return 0;
+}
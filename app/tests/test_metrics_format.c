@@ -0,0 +1,122 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "metrics_format.h"
+
+static void init_snapshot(struct sc_metrics_snapshot *snapshot) {
+    *snapshot = (struct sc_metrics_snapshot) {
+        .time = 1700000000,
+        .uptime = SC_TICK_FROM_SEC(42),
+        .video = {
+            .received = true,
+            .bytes = 5000000000,
+            .packets = 1200,
+            .decoded = true,
+            .decoded_frames = 1190,
+            .decode_errors = 1,
+            .decode_time = SC_TICK_FROM_MS(2500),
+        },
+        .audio = {
+            .received = true,
+            .bytes = 48000,
+            .packets = 300,
+        },
+        .has_display = true,
+        .rendered_frames = 1000,
+        .skipped_frames = 190,
+        .has_controller = true,
+        .control_queued = 2,
+        .control_sent = 50,
+        .control_dropped = 3,
+        .has_rss = true,
+        .rss = 123456789,
+    };
+}
+
+static void test_prometheus(void) {
+    struct sc_metrics_snapshot snapshot;
+    init_snapshot(&snapshot);
+
+    char buf[SC_METRICS_FORMAT_BUFFER_SIZE];
+    ssize_t len = sc_metrics_format_prometheus(&snapshot, buf, sizeof(buf));
+    assert(len > 0);
+    assert((size_t) len == strlen(buf));
+    assert(buf[len - 1] == '\n');
+
+    assert(strstr(buf, "# TYPE scrcpy_received_bytes_total counter\n"));
+    assert(strstr(buf, "\nscrcpy_received_bytes_total{stream=\"video\"} "
+                       "5000000000\n"));
+    assert(strstr(buf, "\nscrcpy_received_packets_total{stream=\"audio\"} "
+                       "300\n"));
+    assert(strstr(buf, "\nscrcpy_decode_errors_total{stream=\"video\"} 1\n"));
+    assert(strstr(buf, "\nscrcpy_decode_seconds_total{stream=\"video\"} "
+                       "2.500000\n"));
+    // The audio stream is not decoded
+    assert(!strstr(buf, "scrcpy_decoded_frames_total{stream=\"audio\"}"));
+    assert(strstr(buf, "\nscrcpy_skipped_frames_total 190\n"));
+    assert(strstr(buf, "\nscrcpy_control_dropped_messages_total 3\n"));
+    assert(strstr(buf, "# TYPE process_resident_memory_bytes gauge\n"
+                       "process_resident_memory_bytes 123456789\n"));
+
+    // No audio player and no recorder
+    assert(!strstr(buf, "scrcpy_audio_"));
+    assert(!strstr(buf, "scrcpy_recorder_"));
+}
+
+static void test_prometheus_empty(void) {
+    struct sc_metrics_snapshot snapshot = {0};
+
+    char buf[16];
+    ssize_t len = sc_metrics_format_prometheus(&snapshot, buf, sizeof(buf));
+    assert(len == 0);
+    assert(!strcmp(buf, ""));
+}
+
+static void test_json(void) {
+    struct sc_metrics_snapshot snapshot;
+    init_snapshot(&snapshot);
+    snapshot.has_recorder = true;
+    snapshot.record_video_queued = 4;
+    snapshot.record_video_written = 1000;
+    snapshot.has_rss = false;
+
+    char buf[SC_METRICS_FORMAT_BUFFER_SIZE];
+    ssize_t len = sc_metrics_format_json(&snapshot, buf, sizeof(buf));
+    assert(len > 0);
+
+    const char *expected =
+        "{\"time\":1700000000,\"uptime_us\":42000000,"
+        "\"video\":{\"bytes\":5000000000,\"packets\":1200,"
+        "\"decoded_frames\":1190,\"decode_errors\":1,"
+        "\"decode_time_us\":2500000},"
+        "\"audio\":{\"bytes\":48000,\"packets\":300},"
+        "\"display\":{\"rendered_frames\":1000,\"skipped_frames\":190},"
+        "\"control\":{\"queued\":2,\"sent\":50,\"dropped\":3},"
+        "\"recorder\":{\"video_queued\":4,\"audio_queued\":0,"
+        "\"video_written\":1000,\"audio_written\":0}}\n";
+    assert(!strcmp(buf, expected));
+    assert((size_t) len == strlen(expected));
+}
+
+static void test_truncated(void) {
+    struct sc_metrics_snapshot snapshot;
+    init_snapshot(&snapshot);
+
+    char buf[64];
+    assert(sc_metrics_format_prometheus(&snapshot, buf, sizeof(buf)) == -1);
+    assert(sc_metrics_format_json(&snapshot, buf, sizeof(buf)) == -1);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_prometheus();
+    test_prometheus_empty();
+    test_json();
+    test_truncated();
+
+    return 0;
+}
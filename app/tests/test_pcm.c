@@ -0,0 +1,43 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "util/pcm.h"
+
+#define COUNT 67 // not a multiple of the SIMD width
+
+static void test_s16_to_f32(void) {
+    int16_t src[COUNT];
+    float dst[COUNT + 1];
+
+    src[0] = INT16_MIN;
+    src[1] = INT16_MAX;
+    src[2] = 0;
+    src[3] = -1;
+    for (size_t i = 4; i < COUNT; ++i) {
+        src[i] = rand();
+    }
+
+    for (size_t count = 0; count <= COUNT; ++count) {
+        dst[count] = 42.f; // canary
+        sc_pcm_s16_to_f32(dst, src, count);
+        for (size_t i = 0; i < count; ++i) {
+            // the conversion is exact
+            assert(dst[i] == src[i] / 32768.f);
+        }
+        assert(dst[count] == 42.f);
+    }
+
+    assert(dst[0] == -1.f);
+    assert(dst[1] < 1.f);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_s16_to_f32();
+    return 0;
+}
@@ -0,0 +1,420 @@
+#include "common.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+#include "v4l2_device.h"
+
+#define FAKE_FD 42
+#define FAKE_BUFFERS 3
+
+// Fake v4l2loopback output device
+static struct {
+    bool streaming_supported;
+    bool opened;
+    bool stream_on;
+    struct v4l2_pix_format pix;
+    unsigned buffer_count;
+    uint8_t *buffers[FAKE_BUFFERS];
+    size_t buffer_length;
+    unsigned mapped;
+    // queued buffer indices, in order
+    unsigned queue[FAKE_BUFFERS];
+    unsigned queued;
+    unsigned qbuf_count;
+    int64_t last_timestamp;
+    // data received by write()
+    uint8_t *written;
+    size_t written_size;
+    unsigned s_fmt_count;
+} fake;
+
+static void
+fake_reset(bool streaming_supported) {
+    memset(&fake, 0, sizeof(fake));
+    fake.streaming_supported = streaming_supported;
+}
+
+static int
+fake_open(const char *path, int flags) {
+    (void) flags;
+    assert(!strcmp(path, "/dev/video42"));
+    assert(!fake.opened);
+    fake.opened = true;
+    return FAKE_FD;
+}
+
+static int
+fake_close(int fd) {
+    assert(fd == FAKE_FD);
+    assert(fake.opened);
+    fake.opened = false;
+    return 0;
+}
+
+static int
+fake_ioctl(int fd, unsigned long request, void *arg) {
+    assert(fd == FAKE_FD);
+
+    switch (request) {
+        case VIDIOC_QUERYCAP: {
+            struct v4l2_capability *cap = arg;
+            cap->capabilities = V4L2_CAP_VIDEO_OUTPUT | V4L2_CAP_READWRITE;
+            if (fake.streaming_supported) {
+                cap->capabilities |= V4L2_CAP_STREAMING;
+            }
+            return 0;
+        }
+        case VIDIOC_S_FMT: {
+            struct v4l2_format *fmt = arg;
+            assert(fmt->type == V4L2_BUF_TYPE_VIDEO_OUTPUT);
+            // The format cannot be changed while buffers are allocated
+            assert(!fake.buffer_count);
+            struct v4l2_pix_format *pix = &fmt->fmt.pix;
+            unsigned bpp = pix->pixelformat == V4L2_PIX_FMT_YUYV ? 2 : 1;
+            pix->bytesperline = pix->width * bpp;
+            pix->sizeimage = pix->pixelformat == V4L2_PIX_FMT_YUYV
+                           ? pix->bytesperline * pix->height
+                           : pix->bytesperline * pix->height * 3 / 2;
+            fake.pix = *pix;
+            ++fake.s_fmt_count;
+            return 0;
+        }
+        case VIDIOC_REQBUFS: {
+            struct v4l2_requestbuffers *req = arg;
+            if (!fake.streaming_supported) {
+                errno = EINVAL;
+                return -1;
+            }
+            assert(req->memory == V4L2_MEMORY_MMAP);
+            if (!req->count) {
+                assert(!fake.mapped);
+                for (unsigned i = 0; i < fake.buffer_count; ++i) {
+                    free(fake.buffers[i]);
+                }
+                fake.buffer_count = 0;
+                fake.queued = 0;
+                return 0;
+            }
+            assert(!fake.buffer_count);
+            req->count = FAKE_BUFFERS;
+            fake.buffer_count = FAKE_BUFFERS;
+            fake.buffer_length = fake.pix.sizeimage;
+            for (unsigned i = 0; i < FAKE_BUFFERS; ++i) {
+                fake.buffers[i] = calloc(1, fake.buffer_length);
+                assert(fake.buffers[i]);
+            }
+            return 0;
+        }
+        case VIDIOC_QUERYBUF: {
+            struct v4l2_buffer *buf = arg;
+            assert(buf->index < fake.buffer_count);
+            buf->length = fake.buffer_length;
+            buf->m.offset = buf->index * 4096;
+            return 0;
+        }
+        case VIDIOC_QBUF: {
+            struct v4l2_buffer *buf = arg;
+            assert(buf->index < fake.buffer_count);
+            assert(buf->bytesused == fake.pix.sizeimage);
+            assert(fake.queued < FAKE_BUFFERS);
+            fake.queue[fake.queued++] = buf->index;
+            ++fake.qbuf_count;
+            fake.last_timestamp = buf->timestamp.tv_sec * 1000000
+                                + buf->timestamp.tv_usec;
+            return 0;
+        }
+        case VIDIOC_DQBUF: {
+            struct v4l2_buffer *buf = arg;
+            // The consumer releases the oldest buffer
+            assert(fake.queued);
+            buf->index = fake.queue[0];
+            memmove(fake.queue, fake.queue + 1,
+                    (fake.queued - 1) * sizeof(*fake.queue));
+            --fake.queued;
+            return 0;
+        }
+        case VIDIOC_STREAMON:
+            assert(!fake.stream_on);
+            fake.stream_on = true;
+            return 0;
+        case VIDIOC_STREAMOFF:
+            fake.stream_on = false;
+            fake.queued = 0;
+            return 0;
+        default:
+            errno = ENOTTY;
+            return -1;
+    }
+}
+
+static void *
+fake_mmap(void *addr, size_t length, int prot, int flags, int fd,
+          off_t offset) {
+    (void) addr;
+    (void) prot;
+    (void) flags;
+    assert(fd == FAKE_FD);
+    assert(length == fake.buffer_length);
+    ++fake.mapped;
+    return fake.buffers[offset / 4096];
+}
+
+static int
+fake_munmap(void *addr, size_t length) {
+    (void) addr;
+    (void) length;
+    assert(fake.mapped);
+    --fake.mapped;
+    return 0;
+}
+
+static ssize_t
+fake_write(int fd, const void *buf, size_t count) {
+    assert(fd == FAKE_FD);
+    free(fake.written);
+    fake.written = malloc(count);
+    assert(fake.written);
+    memcpy(fake.written, buf, count);
+    fake.written_size = count;
+    return count;
+}
+
+static const struct sc_v4l2_io_ops fake_io = {
+    .open = fake_open,
+    .close = fake_close,
+    .ioctl = fake_ioctl,
+    .mmap = fake_mmap,
+    .munmap = fake_munmap,
+    .write = fake_write,
+};
+
+struct test_frame {
+    AVFrame frame;
+    uint8_t y[16 * 4];
+    uint8_t u[8 * 2];
+    uint8_t v[8 * 2];
+};
+
+// A YUV420P frame with padded lines
+static void
+init_frame(struct test_frame *f, unsigned width, unsigned height,
+           uint8_t seed) {
+    memset(f, 0, sizeof(*f));
+    assert(width <= 12 && height <= 4);
+    for (size_t i = 0; i < sizeof(f->y); ++i) {
+        f->y[i] = seed + i;
+    }
+    for (size_t i = 0; i < sizeof(f->u); ++i) {
+        f->u[i] = seed + 100 + i;
+        f->v[i] = seed + 200 + i;
+    }
+    f->frame.data[0] = f->y;
+    f->frame.data[1] = f->u;
+    f->frame.data[2] = f->v;
+    f->frame.linesize[0] = 16;
+    f->frame.linesize[1] = 8;
+    f->frame.linesize[2] = 8;
+    f->frame.width = width;
+    f->frame.height = height;
+    f->frame.format = AV_PIX_FMT_YUV420P;
+    f->frame.pts = 1234567;
+}
+
+static void
+assert_yuv420(const uint8_t *data, const struct test_frame *f) {
+    unsigned w = f->frame.width;
+    unsigned h = f->frame.height;
+    for (unsigned i = 0; i < h; ++i) {
+        assert(!memcmp(data + i * w, f->y + i * 16, w));
+    }
+    const uint8_t *u = data + w * h;
+    const uint8_t *v = u + (w / 2) * (h / 2);
+    for (unsigned i = 0; i < h / 2; ++i) {
+        assert(!memcmp(u + i * w / 2, f->u + i * 8, w / 2));
+        assert(!memcmp(v + i * w / 2, f->v + i * 8, w / 2));
+    }
+}
+
+static void test_v4l2_mmap(void) {
+    fake_reset(true);
+
+    struct sc_v4l2_device dev;
+    bool ok = sc_v4l2_device_open(&dev, &fake_io, "/dev/video42");
+    assert(ok);
+
+    ok = sc_v4l2_device_configure(&dev, SC_V4L2_FORMAT_YUV420, 8, 4);
+    assert(ok);
+    assert(dev.streaming);
+    assert(fake.pix.pixelformat == V4L2_PIX_FMT_YUV420);
+    assert(fake.mapped == FAKE_BUFFERS);
+
+    // Write more frames than buffers, to dequeue them
+    for (unsigned i = 0; i < 2 * FAKE_BUFFERS; ++i) {
+        struct test_frame f;
+        init_frame(&f, 8, 4, i);
+
+        ok = sc_v4l2_device_write_frame(&dev, &f.frame);
+        assert(ok);
+        assert(fake.stream_on);
+        assert(fake.qbuf_count == i + 1);
+        assert(fake.last_timestamp == 1234567);
+
+        unsigned index = fake.queue[fake.queued - 1];
+        assert_yuv420(fake.buffers[index], &f);
+    }
+
+    // Configuring the same format again does nothing
+    ok = sc_v4l2_device_configure(&dev, SC_V4L2_FORMAT_YUV420, 8, 4);
+    assert(ok);
+    assert(fake.s_fmt_count == 1);
+
+    sc_v4l2_device_close(&dev);
+    assert(!fake.opened);
+    assert(!fake.mapped);
+    assert(!fake.buffer_count);
+}
+
+static void test_v4l2_reconfigure(void) {
+    fake_reset(true);
+
+    struct sc_v4l2_device dev;
+    bool ok = sc_v4l2_device_open(&dev, &fake_io, "/dev/video42");
+    assert(ok);
+
+    ok = sc_v4l2_device_configure(&dev, SC_V4L2_FORMAT_NV12, 8, 4);
+    assert(ok);
+
+    struct test_frame f;
+    init_frame(&f, 8, 4, 0);
+    ok = sc_v4l2_device_write_frame(&dev, &f.frame);
+    assert(ok);
+
+    // Change the size without reopening the device
+    ok = sc_v4l2_device_configure(&dev, SC_V4L2_FORMAT_NV12, 4, 4);
+    assert(ok);
+    assert(fake.s_fmt_count == 2);
+    assert(fake.pix.width == 4);
+    assert(fake.opened);
+    assert(!fake.stream_on);
+    assert(fake.mapped == FAKE_BUFFERS);
+
+    init_frame(&f, 4, 4, 7);
+    ok = sc_v4l2_device_write_frame(&dev, &f.frame);
+    assert(ok);
+    assert(fake.stream_on);
+
+    const uint8_t *data = fake.buffers[fake.queue[fake.queued - 1]];
+    for (unsigned i = 0; i < 4; ++i) {
+        assert(!memcmp(data + i * 4, f.y + i * 16, 4));
+    }
+    const uint8_t *uv = data + 4 * 4;
+    for (unsigned i = 0; i < 2; ++i) {
+        for (unsigned j = 0; j < 2; ++j) {
+            assert(uv[i * 4 + 2 * j] == f.u[i * 8 + j]);
+            assert(uv[i * 4 + 2 * j + 1] == f.v[i * 8 + j]);
+        }
+    }
+
+    sc_v4l2_device_close(&dev);
+    assert(!fake.opened);
+    assert(!fake.mapped);
+}
+
+static void test_v4l2_write_fallback(void) {
+    fake_reset(false);
+
+    struct sc_v4l2_device dev;
+    bool ok = sc_v4l2_device_open(&dev, &fake_io, "/dev/video42");
+    assert(ok);
+
+    ok = sc_v4l2_device_configure(&dev, SC_V4L2_FORMAT_YUYV, 8, 4);
+    assert(ok);
+    assert(!dev.streaming);
+    assert(fake.pix.pixelformat == V4L2_PIX_FMT_YUYV);
+
+    struct test_frame f;
+    init_frame(&f, 8, 4, 3);
+    ok = sc_v4l2_device_write_frame(&dev, &f.frame);
+    assert(ok);
+    assert(fake.written_size == 8 * 2 * 4);
+
+    for (unsigned i = 0; i < 4; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            const uint8_t *yuyv = fake.written + i * 16 + 4 * j;
+            assert(yuyv[0] == f.y[i * 16 + 2 * j]);
+            assert(yuyv[1] == f.u[(i / 2) * 8 + j]);
+            assert(yuyv[2] == f.y[i * 16 + 2 * j + 1]);
+            assert(yuyv[3] == f.v[(i / 2) * 8 + j]);
+        }
+    }
+
+    sc_v4l2_device_close(&dev);
+    assert(!fake.opened);
+    free(fake.written);
+}
+
+static void test_v4l2_odd_width(void) {
+    fake_reset(true);
+
+    struct sc_v4l2_device dev;
+    bool ok = sc_v4l2_device_open(&dev, &fake_io, "/dev/video42");
+    assert(ok);
+
+    // The last column is dropped
+    ok = sc_v4l2_device_configure(&dev, SC_V4L2_FORMAT_YUV420, 7, 4);
+    assert(ok);
+    assert(dev.width == 6);
+    assert(fake.pix.width == 6);
+    assert(dev.sizeimage == fake.pix.sizeimage);
+
+    struct test_frame f;
+    init_frame(&f, 7, 4, 5);
+    ok = sc_v4l2_device_write_frame(&dev, &f.frame);
+    assert(ok);
+
+    // Compare to the same frame, cropped to an even width
+    struct test_frame cropped;
+    init_frame(&cropped, 6, 4, 5);
+    assert_yuv420(fake.buffers[fake.queue[fake.queued - 1]], &cropped);
+
+    // The same width is not reconfigured
+    ok = sc_v4l2_device_configure(&dev, SC_V4L2_FORMAT_YUV420, 7, 4);
+    assert(ok);
+    assert(fake.s_fmt_count == 1);
+
+    ok = sc_v4l2_device_configure(&dev, SC_V4L2_FORMAT_NV12, 7, 4);
+    assert(ok);
+    assert(fake.pix.width == 6);
+    assert(dev.sizeimage == fake.pix.sizeimage);
+
+    ok = sc_v4l2_device_write_frame(&dev, &f.frame);
+    assert(ok);
+
+    const uint8_t *uv = fake.buffers[fake.queue[fake.queued - 1]] + 6 * 4;
+    for (unsigned i = 0; i < 2; ++i) {
+        for (unsigned j = 0; j < 3; ++j) {
+            assert(uv[i * 6 + 2 * j] == f.u[i * 8 + j]);
+            assert(uv[i * 6 + 2 * j + 1] == f.v[i * 8 + j]);
+        }
+    }
+
+    sc_v4l2_device_close(&dev);
+    assert(!fake.opened);
+    assert(!fake.mapped);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_v4l2_mmap();
+    test_v4l2_reconfigure();
+    test_v4l2_write_fallback();
+    test_v4l2_odd_width();
+    return 0;
+}
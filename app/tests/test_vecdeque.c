@@ -26,6 +26,10 @@ static void test_vecdeque_push_pop(void) {
     assert(ok);
     assert(sc_vecdeque_size(&vdq) == 2);
 
+    int *head = sc_vecdeque_peekref(&vdq);
+    assert(*head == 5);
+    assert(sc_vecdeque_size(&vdq) == 2);
+
     int v = sc_vecdeque_pop(&vdq);
     assert(v == 5);
     assert(sc_vecdeque_size(&vdq) == 1);
@@ -174,6 +178,12 @@ static void test_vecdeque_push_hole(void) {
 
     assert(sc_vecdeque_size(&vdq) == 20);
 
+    // The items wrap around the end of the buffer
+    for (size_t i = 0; i < 20; ++i) {
+        int *p = sc_vecdeque_getref(&vdq, i);
+        assert(*p == (int) (i + 10) * 10);
+    }
+
     for (int i = 10; i < 30; ++i) {
         int v = sc_vecdeque_pop(&vdq);
         assert(v == i * 10);
@@ -0,0 +1,165 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/yuv.h"
+
+#define MAX_WIDTH 80
+#define MAX_HEIGHT 6
+#define PADDING 7
+
+struct planes {
+    uint8_t y[(MAX_WIDTH + PADDING) * MAX_HEIGHT];
+    uint8_t u[(MAX_WIDTH / 2 + PADDING) * MAX_HEIGHT / 2];
+    uint8_t v[(MAX_WIDTH / 2 + PADDING) * MAX_HEIGHT / 2];
+    const uint8_t *data[3];
+    int stride[3];
+};
+
+static void
+init_planes(struct planes *p, unsigned width) {
+    for (size_t i = 0; i < sizeof(p->y); ++i) {
+        p->y[i] = rand();
+    }
+    for (size_t i = 0; i < sizeof(p->u); ++i) {
+        p->u[i] = rand();
+        p->v[i] = rand();
+    }
+    p->data[0] = p->y;
+    p->data[1] = p->u;
+    p->data[2] = p->v;
+    p->stride[0] = width + PADDING;
+    p->stride[1] = (width + 1) / 2 + PADDING;
+    p->stride[2] = (width + 1) / 2 + PADDING;
+}
+
+static void test_nv12(void) {
+    for (unsigned width = 1; width <= MAX_WIDTH; ++width) {
+        struct planes p;
+        init_planes(&p, width);
+
+        unsigned height = MAX_HEIGHT;
+        unsigned cw = (width + 1) / 2;
+        uint8_t out_y[MAX_WIDTH * MAX_HEIGHT];
+        uint8_t out_uv[MAX_WIDTH * MAX_HEIGHT / 2 + MAX_HEIGHT];
+        sc_yuv420p_to_nv12(out_y, width, out_uv, 2 * cw, p.data, p.stride,
+                           width, height);
+
+        for (unsigned i = 0; i < height; ++i) {
+            assert(!memcmp(&out_y[i * width], &p.y[i * p.stride[0]], width));
+        }
+        for (unsigned i = 0; i < height / 2; ++i) {
+            for (unsigned j = 0; j < cw; ++j) {
+                uint8_t *uv = &out_uv[i * 2 * cw + 2 * j];
+                assert(uv[0] == p.u[i * p.stride[1] + j]);
+                assert(uv[1] == p.v[i * p.stride[2] + j]);
+            }
+        }
+    }
+}
+
+static void test_yuyv(void) {
+    for (unsigned width = 2; width <= MAX_WIDTH; width += 2) {
+        struct planes p;
+        init_planes(&p, width);
+
+        unsigned height = MAX_HEIGHT;
+        size_t stride = 2 * width + 4;
+        uint8_t out[(2 * MAX_WIDTH + 4) * MAX_HEIGHT];
+        sc_yuv420p_to_yuyv(out, stride, p.data, p.stride, width, height);
+
+        for (unsigned i = 0; i < height; ++i) {
+            for (unsigned j = 0; j < width / 2; ++j) {
+                uint8_t *yuyv = &out[i * stride + 4 * j];
+                assert(yuyv[0] == p.y[i * p.stride[0] + 2 * j]);
+                assert(yuyv[1] == p.u[(i / 2) * p.stride[1] + j]);
+                assert(yuyv[2] == p.y[i * p.stride[0] + 2 * j + 1]);
+                assert(yuyv[3] == p.v[(i / 2) * p.stride[2] + j]);
+            }
+        }
+    }
+}
+
+static void test_copy_plane(void) {
+    uint8_t src[4 * 10];
+    for (size_t i = 0; i < sizeof(src); ++i) {
+        src[i] = i;
+    }
+
+    uint8_t dst[3 * 6];
+    sc_yuv_copy_plane(dst, 6, src, 10, 6, 3);
+    for (unsigned i = 0; i < 3; ++i) {
+        assert(!memcmp(&dst[i * 6], &src[i * 10], 6));
+    }
+
+    uint8_t dst2[sizeof(src)];
+    sc_yuv_copy_plane(dst2, 10, src, 10, 10, 4);
+    assert(!memcmp(dst2, src, sizeof(src)));
+}
+
+static void test_orient_plane(void) {
+    // 3x2 plane, with padding
+    const uint8_t src[] = {
+        1, 2, 3, 0,
+        4, 5, 6, 0,
+    };
+
+    for (unsigned r = 0; r < 4; ++r) {
+        for (int flip = 0; flip < 2; ++flip) {
+            uint8_t dst[6];
+            unsigned dw = r & 1 ? 2 : 3;
+            sc_yuv_orient_plane(dst, dw, src, 4, 3, 2, r, flip);
+
+            // Apply the forward transformation to each source pixel
+            for (unsigned y = 0; y < 2; ++y) {
+                for (unsigned x = 0; x < 3; ++x) {
+                    unsigned fx = flip ? 2 - x : x;
+                    unsigned dx, dy;
+                    switch (r) {
+                        case 0:
+                            dx = fx;
+                            dy = y;
+                            break;
+                        case 1:
+                            dx = 1 - y;
+                            dy = fx;
+                            break;
+                        case 2:
+                            dx = 2 - fx;
+                            dy = 1 - y;
+                            break;
+                        default:
+                            dx = y;
+                            dy = 2 - fx;
+                            break;
+                    }
+                    assert(dst[dy * dw + dx] == src[y * 4 + x]);
+                }
+            }
+        }
+    }
+
+    // 90° clockwise
+    uint8_t dst[6];
+    sc_yuv_orient_plane(dst, 2, src, 4, 3, 2, 1, false);
+    const uint8_t expected[] = {
+        4, 1,
+        5, 2,
+        6, 3,
+    };
+    assert(!memcmp(dst, expected, sizeof(expected)));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_copy_plane();
+    test_nv12();
+    test_yuyv();
+    test_orient_plane();
+    return 0;
+}
@@ -79,6 +79,7 @@ public class Options {
     private boolean sendFrameMeta = true; // send PTS so that the client may record properly
     private boolean sendDummyByte = true; // write a byte on start to detect connection issues
     private boolean sendCodecMeta = true; // write the codec metadata before the stream
+    private boolean readySignal; // write a line to stdout once listening (tunnel forward only)
 
     public Ln.Level getLogLevel() {
         return logLevel;
@@ -288,6 +289,10 @@ public class Options {
         return sendCodecMeta;
     }
 
+    public boolean getReadySignal() {
+        return readySignal;
+    }
+
     @SuppressWarnings("MethodLength")
     public static Options parse(String... args) {
         if (args.length < 1) {
@@ -503,6 +508,9 @@ public class Options {
                 case "send_codec_meta":
                     options.sendCodecMeta = Boolean.parseBoolean(value);
                     break;
+                case "ready_signal":
+                    options.readySignal = Boolean.parseBoolean(value);
+                    break;
                 case "raw_stream":
                     boolean rawStream = Boolean.parseBoolean(value);
                     if (rawStream) {
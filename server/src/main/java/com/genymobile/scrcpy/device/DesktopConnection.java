@@ -2,6 +2,7 @@ package com.genymobile.scrcpy.device;
 
 import com.genymobile.scrcpy.control.ControlChannel;
 import com.genymobile.scrcpy.util.IO;
+import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.StringUtils;
 
 import android.net.LocalServerSocket;
@@ -19,6 +20,9 @@ public final class DesktopConnection implements Closeable {
 
     private static final String SOCKET_NAME_PREFIX = "scrcpy";
 
+    // written to stdout once the server socket is listening (must match the client)
+    private static final String READY_SIGNAL = "scrcpy:ready";
+
     private final LocalSocket videoSocket;
     private final FileDescriptor videoFd;
 
@@ -53,8 +57,8 @@ public final class DesktopConnection implements Closeable {
         return SOCKET_NAME_PREFIX + String.format("_%08x", scid);
     }
 
-    public static DesktopConnection open(int scid, boolean tunnelForward, boolean video, boolean audio, boolean control, boolean sendDummyByte)
-            throws IOException {
+    public static DesktopConnection open(int scid, boolean tunnelForward, boolean video, boolean audio, boolean control, boolean sendDummyByte,
+            boolean readySignal) throws IOException {
         String socketName = getSocketName(scid);
 
         LocalSocket videoSocket = null;
@@ -63,6 +67,10 @@ public final class DesktopConnection implements Closeable {
         try {
             if (tunnelForward) {
                 try (LocalServerSocket localServerSocket = new LocalServerSocket(socketName)) {
+                    if (readySignal) {
+                        // the client watches stdout, it may connect immediately instead of retrying blindly
+                        Ln.raw(READY_SIGNAL);
+                    }
                     if (video) {
                         videoSocket = localServerSocket.accept();
                         if (sendDummyByte) {
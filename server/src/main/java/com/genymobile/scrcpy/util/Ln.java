@@ -50,6 +50,15 @@ public final class Ln {
         return level.ordinal() >= threshold.ordinal();
     }
 
+    /**
+     * Write a line to stdout as is (not a log), to be parsed by the client.
+     *
+     * @param line the line, without the trailing newline
+     */
+    public static void raw(String line) {
+        CONSOLE_OUT.print(line + '\n');
+    }
+
     public static void v(String message) {
         if (isEnabled(Level.VERBOSE)) {
             Log.v(TAG, message);